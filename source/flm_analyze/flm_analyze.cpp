@@ -0,0 +1,493 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_analyze.cpp
+/// @brief  Offline analysis of recorded FLM sessions
+//=============================================================================
+
+#include "flm_analyze.h"
+#include "flm_csv_reader.h"
+#include "flm_sample_log_format.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#define FLM_DEFAULT_TICKS_PER_SECOND 10000000  // AMF_SECOND, used if a converted sample log has no metadata
+#define FLM_MAX_FRAME_INTERVAL_MS    1000.0    // Longer gaps are pauses in capture, not frame intervals
+#define FLM_STUTTER_FACTOR           2.0       // A frame interval above this times the median is a stutter
+
+static const int FLM_READ_CHUNK = 65536;  // Sample log records per fread
+
+FLM_Session_Analyzer::FLM_Session_Analyzer(int rowSize)
+    : m_iRowSize(std::max(1, rowSize))
+    , m_latencyHistogram(0.01, 2000.0)
+    , m_frameIntervalHistogram(0.01, FLM_MAX_FRAME_INTERVAL_MS)
+{
+}
+
+void FLM_Session_Analyzer::Reset()
+{
+    m_latency.Reset();
+    m_latencyHistogram.Reset();
+    m_fps.Reset();
+    m_frameInterval.Reset();
+    m_frameIntervalHistogram.Reset();
+    m_frameJitter.Reset();
+    m_drift.Reset();
+
+    m_bRowsFromFile     = false;
+    m_iRowCount         = 0;
+    m_fRowSum           = 0.0;
+    m_iiPrevPresentTime = 0;
+    m_iiPrevFrameIdx    = -1;
+    m_fPrevIntervalMS   = -1.0;
+    m_frames            = 0;
+    m_repeatedFrames    = 0;
+    m_droppedFrames     = 0;
+}
+
+bool FLM_Session_Analyzer::Analyze(const std::string& fileName, FLM_SESSION_SUMMARY& summary)
+{
+    Reset();
+    summary          = FLM_SESSION_SUMMARY();
+    summary.fileName = fileName;
+
+    // Sample logs are recognized by their header, anything else is read as CSV
+    bool bSampleLog = false;
+    FILE* file      = fopen(fileName.c_str(), "rb");
+    if (file == NULL)
+    {
+        summary.error = "unable to open file";
+        return false;
+    }
+    char magic[4] = {};
+    bSampleLog    = (fread(magic, 1, sizeof(magic), file) == sizeof(magic)) && (memcmp(magic, FLM_SAMPLE_LOG_MAGIC, sizeof(magic)) == 0);
+    fclose(file);
+
+    bool bRes = bSampleLog ? AnalyzeSampleLog(fileName, summary) : AnalyzeCSV(fileName, summary);
+    if (bRes)
+        Finish(summary);
+    return bRes;
+}
+
+// A line that did not fit the reader buffer was skipped, the file is damaged
+static bool CheckLongLines(const FLM_Csv_Reader& reader, FLM_SESSION_SUMMARY& summary)
+{
+    if (reader.GetNumLongLines() == 0)
+        return true;
+
+    char error[128];
+    snprintf(error, sizeof(error), "line %llu is too long, %llu lines skipped", (unsigned long long)reader.GetFirstLongLine(),
+             (unsigned long long)reader.GetNumLongLines());
+    summary.error = error;
+    return false;
+}
+
+bool FLM_Session_Analyzer::AnalyzeCSV(const std::string& fileName, FLM_SESSION_SUMMARY& summary)
+{
+    FLM_Csv_Reader reader;
+    if (!reader.Open(fileName.c_str()))
+    {
+        summary.error = "no CSV header";
+        return false;
+    }
+    summary.metadata = reader.Metadata();
+
+    // Converted sample log
+    int latencyColumn  = reader.FindColumn("latency_ms");
+    int flagsColumn    = reader.FindColumn("flags");
+    int presentColumn  = reader.FindColumn("present_time");
+    int frameIdxColumn = reader.FindColumn("frame_idx");
+    if ((latencyColumn >= 0) && (flagsColumn >= 0))
+    {
+        summary.type = FLM_INPUT_TYPE::SAMPLE_CSV;
+
+        const char* ticks      = reader.GetMetadata("ticks_per_second");
+        double      ticksPerMS = ((ticks != NULL) ? atof(ticks) : FLM_DEFAULT_TICKS_PER_SECOND) / 1000.0;
+        if (ticksPerMS <= 0.0)
+            ticksPerMS = FLM_DEFAULT_TICKS_PER_SECOND / 1000.0;
+
+        while (reader.ReadRow())
+        {
+            int64_t flags;
+            if (!reader.GetInt64(flagsColumn, flags))
+                continue;
+
+            double latency;
+            if ((flags & FLM_SAMPLE_FLAG_MEASUREMENT) && reader.GetDouble(latencyColumn, latency))
+                AddLatency(latency);
+
+            int64_t presentTime, frameIdx;
+            if ((presentColumn >= 0) && (frameIdxColumn >= 0) && reader.GetInt64(presentColumn, presentTime) && reader.GetInt64(frameIdxColumn, frameIdx))
+                AddFrame(presentTime, frameIdx, ticksPerMS);
+        }
+        return CheckLongLines(reader, summary);
+    }
+
+    // Telemetry CSV, one row per MeasurementsPerLine measurements
+    std::vector<int> latColumns;
+    for (int i = 0; i < (int)reader.Columns().size(); i++)
+    {
+        const std::string& name = reader.Columns()[i];
+        if ((name.size() == 5) && (strncmp(name.c_str(), "lat", 3) == 0) && isdigit((unsigned char)name[3]) && isdigit((unsigned char)name[4]))
+            latColumns.push_back(i);
+    }
+    int rowLatencyColumn = reader.FindColumn("latency (ms)");
+    int fpsColumn        = reader.FindColumn("FPS");
+    if (latColumns.empty() && (rowLatencyColumn < 0))
+    {
+        summary.error = "unknown CSV columns";
+        return false;
+    }
+
+    summary.type    = FLM_INPUT_TYPE::TELEMETRY_CSV;
+    m_bRowsFromFile = true;
+
+    while (reader.ReadRow())
+    {
+        double value;
+        if ((fpsColumn >= 0) && reader.GetDouble(fpsColumn, value) && (value > 0.0))
+            m_fps.Add(value);
+
+        for (int column : latColumns)
+            if (reader.GetDouble(column, value))
+                AddLatency(value);
+
+        if ((rowLatencyColumn >= 0) && reader.GetDouble(rowLatencyColumn, value))
+            AddRow(value);
+    }
+
+    return CheckLongLines(reader, summary);
+}
+
+bool FLM_Session_Analyzer::AnalyzeSampleLog(const std::string& fileName, FLM_SESSION_SUMMARY& summary)
+{
+    summary.type = FLM_INPUT_TYPE::SAMPLE_LOG;
+
+    FILE* file = fopen(fileName.c_str(), "rb");
+    if (file == NULL)
+    {
+        summary.error = "unable to open file";
+        return false;
+    }
+
+    FLM_SAMPLE_LOG_HEADER header;
+    if ((fread(&header, sizeof(header), 1, file) != 1) || (header.version > FLM_SAMPLE_LOG_VERSION) || (header.recordSize != sizeof(FLM_SAMPLE_RECORD)) ||
+        (header.ticksPerSecond <= 0) || (header.metadataSize > FLM_SAMPLE_MAX_METADATA))
+    {
+        fclose(file);
+        summary.error = "unsupported sample log";
+        return false;
+    }
+
+    // "key = value" lines, version 1 logs have none
+    std::string metadata(header.metadataSize, '\0');
+    if ((header.metadataSize > 0) && (fread(&metadata[0], 1, metadata.size(), file) != metadata.size()))
+    {
+        fclose(file);
+        summary.error = "truncated sample log";
+        return false;
+    }
+    std::string_view text = metadata;
+    while (!text.empty())
+    {
+        size_t           end   = std::min(text.find('\n'), text.size());
+        std::string_view line  = text.substr(0, end);
+        size_t           equal = line.find('=');
+        if (equal != std::string_view::npos)
+            summary.metadata.emplace_back(std::string(FlmTrim(line.substr(0, equal))), std::string(FlmTrim(line.substr(equal + 1))));
+        text.remove_prefix(std::min(end + 1, text.size()));
+    }
+
+    double ticksPerMS = (double)header.ticksPerSecond / 1000.0;
+
+    std::vector<FLM_SAMPLE_RECORD> records(FLM_READ_CHUNK);
+    size_t                         numRead;
+    while ((numRead = fread(records.data(), sizeof(FLM_SAMPLE_RECORD), records.size(), file)) > 0)
+    {
+        for (size_t i = 0; i < numRead; i++)
+        {
+            const FLM_SAMPLE_RECORD& r = records[i];
+            if (r.flags & FLM_SAMPLE_FLAG_MEASUREMENT)
+                AddLatency(r.latencyMS);
+            AddFrame(r.presentTime, r.frameIdx, ticksPerMS);
+        }
+    }
+
+    fclose(file);
+    return true;
+}
+
+void FLM_Session_Analyzer::AddLatency(double latencyMS)
+{
+    m_latency.Add(latencyMS);
+    m_latencyHistogram.Add(latencyMS);
+    if (m_samples != NULL)
+        m_samples->push_back((float)latencyMS);
+
+    if (m_bRowsFromFile)
+        return;
+
+    m_fRowSum += latencyMS;
+    if (++m_iRowCount == m_iRowSize)
+    {
+        AddRow(m_fRowSum / m_iRowCount);
+        m_fRowSum   = 0.0;
+        m_iRowCount = 0;
+    }
+}
+
+void FLM_Session_Analyzer::AddRow(double rowLatencyMS)
+{
+    m_drift.Add((double)m_drift.Count(), rowLatencyMS);
+}
+
+void FLM_Session_Analyzer::AddFrame(int64_t presentTime, int64_t frameIdx, double ticksPerMS)
+{
+    if (frameIdx == m_iiPrevFrameIdx)
+    {
+        m_repeatedFrames++;
+        return;
+    }
+
+    if (m_iiPrevFrameIdx >= 0)
+    {
+        if (frameIdx > m_iiPrevFrameIdx + 1)
+            m_droppedFrames += frameIdx - m_iiPrevFrameIdx - 1;
+
+        double intervalMS = (double)(presentTime - m_iiPrevPresentTime) / ticksPerMS;
+        if ((intervalMS > 0.0) && (intervalMS < FLM_MAX_FRAME_INTERVAL_MS))
+        {
+            m_frameInterval.Add(intervalMS);
+            m_frameIntervalHistogram.Add(intervalMS);
+            if (m_fPrevIntervalMS >= 0.0)
+                m_frameJitter.Add(fabs(intervalMS - m_fPrevIntervalMS));
+            m_fPrevIntervalMS = intervalMS;
+        }
+        else
+            m_fPrevIntervalMS = -1.0;  // Capture was paused between measurements
+    }
+
+    m_frames++;
+    m_iiPrevFrameIdx    = frameIdx;
+    m_iiPrevPresentTime = presentTime;
+}
+
+void FLM_Session_Analyzer::Finish(FLM_SESSION_SUMMARY& summary)
+{
+    summary.measurements = m_latency.Count();
+    summary.mean         = m_latency.Mean();
+    summary.stdDev       = m_latency.StdDev();
+    summary.min          = m_latency.Min();
+    summary.max          = m_latency.Max();
+    summary.meanCILow    = summary.mean - FLM_Z_95 * m_latency.StdError();
+    summary.meanCIHigh   = summary.mean + FLM_Z_95 * m_latency.StdError();
+    m_latencyHistogram.PercentileCI(50.0, summary.medianCILow, summary.medianCIHigh);
+    for (int i = 0; i < FLM_NUM_REPORT_PERCENTILES; i++)
+        summary.percentiles[i] = m_latencyHistogram.Percentile(g_flmReportPercentiles[i]);
+
+    if (m_frameInterval.Count() > 0)
+    {
+        summary.frameIntervalMean   = m_frameInterval.Mean();
+        summary.frameIntervalStdDev = m_frameInterval.StdDev();
+        summary.frameIntervalP50    = m_frameIntervalHistogram.Percentile(50.0);
+        summary.frameIntervalP99    = m_frameIntervalHistogram.Percentile(99.0);
+        summary.frameJitter         = m_frameJitter.Mean();
+        summary.stutters            = m_frameIntervalHistogram.CountAbove(FLM_STUTTER_FACTOR * summary.frameIntervalP50);
+        summary.fpsMean             = 1000.0 / summary.frameIntervalMean;
+        summary.fpsMin              = 1000.0 / m_frameInterval.Max();
+    }
+    else if (m_fps.Count() > 0)
+    {
+        summary.fpsMean = m_fps.Mean();
+        summary.fpsMin  = m_fps.Min();
+    }
+    summary.frames         = m_frames;
+    summary.repeatedFrames = m_repeatedFrames;
+    summary.droppedFrames  = m_droppedFrames;
+
+    summary.rows          = m_drift.Count();
+    summary.driftPerRow   = m_drift.Slope();
+    summary.driftStdError = m_drift.SlopeStdError();
+    summary.driftTotal    = (summary.rows > 1) ? summary.driftPerRow * (double)(summary.rows - 1) : 0.0;
+    summary.driftR2       = m_drift.RSquared();
+}
+
+//------------------------------------------------------------------------------------------
+// Report output
+//------------------------------------------------------------------------------------------
+
+static const char* InputTypeName(FLM_INPUT_TYPE type)
+{
+    switch (type)
+    {
+    case FLM_INPUT_TYPE::TELEMETRY_CSV:
+        return "telemetry csv";
+    case FLM_INPUT_TYPE::SAMPLE_CSV:
+        return "sample log csv";
+    case FLM_INPUT_TYPE::SAMPLE_LOG:
+        return "sample log";
+    default:
+        return "unknown";
+    }
+}
+
+const char* FlmGetSessionMetadata(const FLM_SESSION_SUMMARY& summary, const char* key)
+{
+    for (const std::pair<std::string, std::string>& entry : summary.metadata)
+        if (entry.first == key)
+            return entry.second.c_str();
+    return "";
+}
+
+// Metadata columns of the summary, so results can be grouped by configuration
+static const char* g_flmSummaryMetadata[] = {"flm_version",
+                                             "start_time",
+                                             "codec",
+                                             "vendor",
+                                             "display_width",
+                                             "display_height",
+                                             "refresh_rate",
+                                             "PIPELINE.MouseEventType",
+                                             "PIPELINE.GameUsesFrameGeneration",
+                                             "PIPELINE.MeasurementsPerLine"};
+
+// first and second joined by separator, or the one of them that is present
+static std::string JoinMetadata(const char* first, const char* separator, const char* second)
+{
+    if ((*first == 0) || (*second == 0))
+        return std::string(first) + second;
+    return std::string(first) + separator + second;
+}
+
+static void AppendSessionPart(std::string& session, const std::string& part)
+{
+    if (part.empty())
+        return;
+    if (!session.empty())
+        session += ", ";
+    session += part;
+}
+
+// "FLM 1.2, AMF on AMD, 2560x1440 at 144 Hz, started ..." with the parts whose keys are present, files of older
+// versions and converted logs lack some of them
+static std::string FormatSessionLine(const FLM_SESSION_SUMMARY& summary)
+{
+    const char* version = FlmGetSessionMetadata(summary, "flm_version");
+    const char* width   = FlmGetSessionMetadata(summary, "display_width");
+    const char* height  = FlmGetSessionMetadata(summary, "display_height");
+    const char* rate    = FlmGetSessionMetadata(summary, "refresh_rate");
+    const char* start   = FlmGetSessionMetadata(summary, "start_time");
+
+    std::string mode = ((*width != 0) && (*height != 0)) ? std::string(width) + "x" + height : "";
+    if (*rate != 0)
+        mode = JoinMetadata(mode.c_str(), " at ", rate) + " Hz";
+
+    std::string session;
+    AppendSessionPart(session, (*version != 0) ? std::string("FLM ") + version : "");
+    AppendSessionPart(session, JoinMetadata(FlmGetSessionMetadata(summary, "codec"), " on ", FlmGetSessionMetadata(summary, "vendor")));
+    AppendSessionPart(session, mode);
+    AppendSessionPart(session, (*start != 0) ? std::string("started ") + start : "");
+    return session;
+}
+
+void FlmWriteReport(FILE* output, const FLM_SESSION_SUMMARY& summary)
+{
+    fprintf(output, "%s\n", summary.fileName.c_str());
+    if (!summary.error.empty())
+    {
+        fprintf(output, "  error               : %s\n\n", summary.error.c_str());
+        return;
+    }
+
+    fprintf(output, "  input               : %s\n", InputTypeName(summary.type));
+    std::string session = FormatSessionLine(summary);
+    if (!session.empty())
+        fprintf(output, "  session             : %s\n", session.c_str());
+    fprintf(output, "  measurements        : %llu\n", (unsigned long long)summary.measurements);
+    if (summary.measurements > 0)
+    {
+        fprintf(output, "  latency mean        : %.2f ms (95%% CI %.2f .. %.2f)\n", summary.mean, summary.meanCILow, summary.meanCIHigh);
+        fprintf(output, "  latency median      : %.2f ms (95%% CI %.2f .. %.2f)\n", summary.percentiles[3], summary.medianCILow, summary.medianCIHigh);
+        fprintf(output, "  latency std dev     : %.2f ms\n", summary.stdDev);
+        fprintf(output, "  latency min .. max  : %.2f .. %.2f ms\n", summary.min, summary.max);
+        fprintf(output, "  percentiles [ms]    :");
+        for (int i = 0; i < FLM_NUM_REPORT_PERCENTILES; i++)
+            fprintf(output, " p%g=%.2f", g_flmReportPercentiles[i], summary.percentiles[i]);
+        fprintf(output, "\n");
+    }
+
+    if (summary.fpsMean > 0.0)
+        fprintf(output, "  fps mean / min      : %.1f / %.1f\n", summary.fpsMean, summary.fpsMin);
+    if (summary.frames > 0)
+    {
+        fprintf(output, "  frames              : %llu, %llu repeated captures, %llu dropped\n",
+                (unsigned long long)summary.frames, (unsigned long long)summary.repeatedFrames, (unsigned long long)summary.droppedFrames);
+        fprintf(output, "  frame interval      : mean %.2f ms, std dev %.2f ms, p50 %.2f ms, p99 %.2f ms\n",
+                summary.frameIntervalMean, summary.frameIntervalStdDev, summary.frameIntervalP50, summary.frameIntervalP99);
+        fprintf(output, "  frame pacing        : jitter %.2f ms, %llu stutters (> %.0fx median interval)\n",
+                summary.frameJitter, (unsigned long long)summary.stutters, FLM_STUTTER_FACTOR);
+    }
+
+    if (summary.rows > 1)
+        fprintf(output, "  per row drift       : %+.4f ms/row (std error %.4f, R2 %.3f), %+.2f ms over %llu rows\n",
+                summary.driftPerRow, summary.driftStdError, summary.driftR2, summary.driftTotal, (unsigned long long)summary.rows);
+
+    fprintf(output, "\n");
+}
+
+void FlmWriteSummaryHeader(FILE* output)
+{
+    fprintf(output, "file,input,error,measurements,mean,mean_ci_low,mean_ci_high,std_dev,min,max,median_ci_low,median_ci_high");
+    for (int i = 0; i < FLM_NUM_REPORT_PERCENTILES; i++)
+        fprintf(output, ",p%g", g_flmReportPercentiles[i]);
+    fprintf(output, ",fps_mean,fps_min,frames,repeated_frames,dropped_frames,frame_interval_mean,frame_interval_std_dev,frame_interval_p50,"
+                    "frame_interval_p99,frame_jitter,stutters,rows,drift_per_row,drift_std_error,drift_total,drift_r2");
+    for (const char* key : g_flmSummaryMetadata)
+        fprintf(output, ",%s", key);
+    fprintf(output, "\n");
+}
+
+void FlmWriteSummaryRow(FILE* output, const FLM_SESSION_SUMMARY& summary)
+{
+    fprintf(output, "\"%s\",%s,%s,%llu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f",
+            summary.fileName.c_str(),
+            InputTypeName(summary.type),
+            summary.error.c_str(),
+            (unsigned long long)summary.measurements,
+            summary.mean,
+            summary.meanCILow,
+            summary.meanCIHigh,
+            summary.stdDev,
+            summary.min,
+            summary.max,
+            summary.medianCILow,
+            summary.medianCIHigh);
+    for (int i = 0; i < FLM_NUM_REPORT_PERCENTILES; i++)
+        fprintf(output, ",%.3f", summary.percentiles[i]);
+    fprintf(output, ",%.2f,%.2f,%llu,%llu,%llu,%.3f,%.3f,%.3f,%.3f,%.3f,%llu,%llu,%.4f,%.4f,%.3f,%.3f",
+            summary.fpsMean,
+            summary.fpsMin,
+            (unsigned long long)summary.frames,
+            (unsigned long long)summary.repeatedFrames,
+            (unsigned long long)summary.droppedFrames,
+            summary.frameIntervalMean,
+            summary.frameIntervalStdDev,
+            summary.frameIntervalP50,
+            summary.frameIntervalP99,
+            summary.frameJitter,
+            (unsigned long long)summary.stutters,
+            (unsigned long long)summary.rows,
+            summary.driftPerRow,
+            summary.driftStdError,
+            summary.driftTotal,
+            summary.driftR2);
+    for (const char* key : g_flmSummaryMetadata)
+        fprintf(output, ",\"%s\"", FlmGetSessionMetadata(summary, key));
+    fprintf(output, "\n");
+}
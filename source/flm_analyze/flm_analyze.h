@@ -0,0 +1,122 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_analyze.h
+/// @brief  Offline analysis of recorded FLM sessions
+//=============================================================================
+
+#ifndef FLM_ANALYZE_H
+#define FLM_ANALYZE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "flm_statistics.h"
+
+enum class FLM_INPUT_TYPE
+{
+    UNKNOWN       = 0,
+    TELEMETRY_CSV = 1,  // OutputFileName written by CreateCSV / SaveTelemetryCSV
+    SAMPLE_CSV    = 2,  // Sample log converted with flm -convert
+    SAMPLE_LOG    = 3,  // Binary sample log, SaveSampleLog in flm.ini
+};
+
+#define FLM_NUM_REPORT_PERCENTILES 9
+static const double g_flmReportPercentiles[FLM_NUM_REPORT_PERCENTILES] = {1, 5, 25, 50, 75, 90, 95, 99, 99.9};
+
+struct FLM_SESSION_SUMMARY
+{
+    std::string    fileName;
+    FLM_INPUT_TYPE type = FLM_INPUT_TYPE::UNKNOWN;
+    std::string    error;  // Empty if the file was analyzed
+
+    // Session metadata written by FLM at the start of the file, empty for files of older versions
+    std::vector<std::pair<std::string, std::string>> metadata;
+
+    // Latency [ms]
+    uint64_t measurements  = 0;
+    double   mean          = 0.0;
+    double   stdDev        = 0.0;
+    double   min           = 0.0;
+    double   max           = 0.0;
+    double   meanCILow     = 0.0;  // 95% confidence interval of the mean
+    double   meanCIHigh    = 0.0;
+    double   medianCILow   = 0.0;  // 95% confidence interval of the median
+    double   medianCIHigh  = 0.0;
+    double   percentiles[FLM_NUM_REPORT_PERCENTILES] = {};
+
+    // Frame pacing, frame intervals [ms] are only available from sample logs
+    double   fpsMean             = 0.0;
+    double   fpsMin              = 0.0;
+    uint64_t frames              = 0;    // Frames with a new frame index
+    uint64_t repeatedFrames      = 0;    // Captures without a new frame
+    uint64_t droppedFrames       = 0;    // Gaps in the frame index
+    double   frameIntervalMean   = 0.0;
+    double   frameIntervalStdDev = 0.0;
+    double   frameIntervalP50    = 0.0;
+    double   frameIntervalP99    = 0.0;
+    double   frameJitter         = 0.0;  // Mean absolute change between consecutive frame intervals
+    uint64_t stutters            = 0;    // Frame intervals above twice the median
+
+    // Per row drift, slope of the row average latency over the row index
+    uint64_t rows          = 0;
+    double   driftPerRow   = 0.0;  // [ms / row]
+    double   driftStdError = 0.0;
+    double   driftTotal    = 0.0;  // [ms] from the first to the last row
+    double   driftR2       = 0.0;
+};
+
+// Streams one input at a time, memory does not depend on the input size.
+// One analyzer per thread, an analyzer can be reused for any number of files.
+class FLM_Session_Analyzer
+{
+public:
+    // Sample logs have no rows, rowSize measurements are grouped into a row
+    FLM_Session_Analyzer(int rowSize);
+
+    bool Analyze(const std::string& fileName, FLM_SESSION_SUMMARY& summary);
+
+    // Every latency of the following Analyze() calls is also appended here, NULL to stop
+    void SetSampleSink(std::vector<float>* samples) { m_samples = samples; }
+
+private:
+    void Reset();
+    bool AnalyzeCSV(const std::string& fileName, FLM_SESSION_SUMMARY& summary);
+    bool AnalyzeSampleLog(const std::string& fileName, FLM_SESSION_SUMMARY& summary);
+    void AddLatency(double latencyMS);
+    void AddRow(double rowLatencyMS);
+    void AddFrame(int64_t presentTime, int64_t frameIdx, double ticksPerMS);
+    void Finish(FLM_SESSION_SUMMARY& summary);
+
+    int m_iRowSize;
+
+    FLM_Running_Stats     m_latency;
+    FLM_Histogram         m_latencyHistogram;
+    FLM_Running_Stats     m_fps;
+    FLM_Running_Stats     m_frameInterval;
+    FLM_Histogram         m_frameIntervalHistogram;
+    FLM_Running_Stats     m_frameJitter;
+    FLM_Linear_Regression m_drift;
+    std::vector<float>*   m_samples = NULL;
+
+    bool     m_bRowsFromFile     = false;  // Telemetry CSV rows are used as is
+    int      m_iRowCount         = 0;      // Measurements in the current grouped row
+    double   m_fRowSum           = 0.0;
+    int64_t  m_iiPrevPresentTime = 0;
+    int64_t  m_iiPrevFrameIdx    = -1;
+    double   m_fPrevIntervalMS   = -1.0;
+    uint64_t m_frames            = 0;
+    uint64_t m_repeatedFrames    = 0;
+    uint64_t m_droppedFrames     = 0;
+};
+
+// Empty string if the key is not in the metadata
+const char* FlmGetSessionMetadata(const FLM_SESSION_SUMMARY& summary, const char* key);
+
+void FlmWriteReport(FILE* output, const FLM_SESSION_SUMMARY& summary);
+void FlmWriteSummaryHeader(FILE* output);
+void FlmWriteSummaryRow(FILE* output, const FLM_SESSION_SUMMARY& summary);
+
+#endif
@@ -0,0 +1,271 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_compare.cpp
+/// @brief  Statistical comparison of two sets of latency samples
+//=============================================================================
+
+#include "flm_compare.h"
+
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+static const char* g_flmCompareStatNames[FLM_COMPARE_STATS] = {"mean", "p50", "p90", "p99"};
+
+// splitmix64, fast and good enough for resampling
+static inline uint64_t NextRandom(uint64_t& state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z          = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z          = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Two indices uniform in [0, n) from one random number, the bias for n < 2^32 is far below the bootstrap noise
+static inline void NextIndexPair(uint64_t& state, uint32_t n, uint32_t& i0, uint32_t& i1)
+{
+    uint64_t random = NextRandom(state);
+    i0              = (uint32_t)(((random >> 32) * n) >> 32);
+    i1              = (uint32_t)(((random & 0xFFFFFFFFULL) * n) >> 32);
+}
+
+template <typename T>
+static double SortedPercentile(const std::vector<T>& sorted, double p)
+{
+    double rank = p / 100.0 * (double)(sorted.size() - 1);
+    size_t low  = (size_t)rank;
+    size_t high = std::min(low + 1, sorted.size() - 1);
+    return sorted[low] + (rank - (double)low) * (sorted[high] - sorted[low]);
+}
+
+// Statistics of one bootstrap resample of sorted.
+// Indices are counted instead of copying and sorting the resample, which keeps a resample O(n).
+static void ResampleStats(const std::vector<float>& sorted, uint64_t& rng, std::vector<uint32_t>& counts, double stats[FLM_COMPARE_STATS])
+{
+    uint32_t n = (uint32_t)sorted.size();
+    std::fill(counts.begin(), counts.end(), 0);
+
+    uint32_t i0, i1;
+    for (uint32_t j = 0; j + 1 < n; j += 2)
+    {
+        NextIndexPair(rng, n, i0, i1);
+        counts[i0]++;
+        counts[i1]++;
+    }
+    if (n & 1)
+    {
+        NextIndexPair(rng, n, i0, i1);
+        counts[i0]++;
+    }
+
+    // Ranks bracketing each percentile, in increasing order
+    const int numRanks = 2 * (FLM_COMPARE_STATS - 1);
+    uint64_t  ranks[numRanks];
+    double    fractions[FLM_COMPARE_STATS - 1];
+    double    values[numRanks];
+    for (int k = 0; k < FLM_COMPARE_STATS - 1; k++)
+    {
+        double rank      = g_flmComparePercentiles[k] / 100.0 * (double)(n - 1);
+        ranks[2 * k]     = (uint64_t)rank;
+        ranks[2 * k + 1] = std::min<uint64_t>(ranks[2 * k] + 1, n - 1);
+        fractions[k]     = rank - (double)ranks[2 * k];
+    }
+
+    uint64_t cumulative = 0;
+    int      r          = 0;
+    for (uint32_t i = 0; (i < n) && (r < numRanks); i++)
+    {
+        cumulative += counts[i];
+        while ((r < numRanks) && (ranks[r] < cumulative))
+            values[r++] = sorted[i];
+    }
+
+    // Independent partial sums let the compiler vectorize
+    double   partial[4] = {};
+    uint32_t i          = 0;
+    for (; i + 4 <= n; i += 4)
+        for (int k = 0; k < 4; k++)
+            partial[k] += (double)counts[i + k] * sorted[i + k];
+    double sum = partial[0] + partial[1] + partial[2] + partial[3];
+    for (; i < n; i++)
+        sum += (double)counts[i] * sorted[i];
+    stats[0] = sum / (double)n;
+
+    for (int k = 0; k < FLM_COMPARE_STATS - 1; k++)
+        stats[k + 1] = values[2 * k] + fractions[k] * (values[2 * k + 1] - values[2 * k]);
+}
+
+static void BootstrapThread(const std::vector<float>& a,
+                            const std::vector<float>& b,
+                            uint64_t                  seed,
+                            int                       first,
+                            int                       last,
+                            std::vector<double>*      differences)
+{
+    std::vector<uint32_t> countsA(a.size());
+    std::vector<uint32_t> countsB(b.size());
+    double                statsA[FLM_COMPARE_STATS];
+    double                statsB[FLM_COMPARE_STATS];
+
+    for (int i = first; i < last; i++)
+    {
+        // Seeded per resample, so the result does not depend on the number of threads
+        uint64_t rng = seed ^ (0xD1B54A32D192ED03ULL * (uint64_t)(i + 1));
+        ResampleStats(a, rng, countsA, statsA);
+        ResampleStats(b, rng, countsB, statsB);
+        for (int s = 0; s < FLM_COMPARE_STATS; s++)
+            differences[s][i] = statsB[s] - statsA[s];
+    }
+}
+
+// Both inputs sorted
+static void MannWhitney(const std::vector<float>& a, const std::vector<float>& b, FLM_COMPARE_RESULT& result)
+{
+    double nA = (double)a.size();
+    double nB = (double)b.size();
+    double n  = nA + nB;
+
+    // Sum of the ranks of a, ties get the average rank of their group
+    double rankSumA = 0.0;
+    double tieSum   = 0.0;
+    double rank     = 1.0;
+    size_t i        = 0;
+    size_t j        = 0;
+    while ((i < a.size()) || (j < b.size()))
+    {
+        float  value  = (j >= b.size()) ? a[i] : (i >= a.size()) ? b[j] : std::min(a[i], b[j]);
+        double countA = 0.0;
+        double countB = 0.0;
+        while ((i < a.size()) && (a[i] == value))
+        {
+            countA++;
+            i++;
+        }
+        while ((j < b.size()) && (b[j] == value))
+        {
+            countB++;
+            j++;
+        }
+
+        double t = countA + countB;
+        rankSumA += countA * (rank + (t - 1.0) / 2.0);
+        tieSum += t * t * t - t;
+        rank += t;
+    }
+
+    double uA       = rankSumA - nA * (nA + 1.0) / 2.0;
+    double uB       = nA * nB - uA;
+    double mean     = nA * nB / 2.0;
+    double variance = nA * nB / 12.0 * ((n + 1.0) - tieSum / (n * (n - 1.0)));
+
+    result.u            = uB;
+    result.probBGreater = uB / (nA * nB);
+    if (variance > 0.0)
+    {
+        double delta     = uB - mean;
+        double corrected = (delta > 0.5) ? delta - 0.5 : (delta < -0.5) ? delta + 0.5 : 0.0;  // Continuity correction
+        result.z         = corrected / sqrt(variance);
+        result.pValue    = erfc(fabs(result.z) / sqrt(2.0));
+    }
+    else
+    {
+        // Every sample has the same value
+        result.z      = 0.0;
+        result.pValue = 1.0;
+    }
+    result.significant = result.pValue < FLM_COMPARE_ALPHA;
+}
+
+bool FlmCompareSamples(std::vector<float>& a, std::vector<float>& b, const FLM_COMPARE_SETTINGS& settings, FLM_COMPARE_RESULT& result)
+{
+    result      = FLM_COMPARE_RESULT();
+    result.numA = a.size();
+    result.numB = b.size();
+    if ((a.size() < FLM_COMPARE_MIN_SAMPLES) || (b.size() < FLM_COMPARE_MIN_SAMPLES))
+        return false;
+
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+
+    // Point estimates
+    double meanA = 0.0;
+    double meanB = 0.0;
+    for (float value : a)
+        meanA += value;
+    for (float value : b)
+        meanB += value;
+    result.stats[0].valueA = meanA / (double)a.size();
+    result.stats[0].valueB = meanB / (double)b.size();
+    for (int s = 1; s < FLM_COMPARE_STATS; s++)
+    {
+        result.stats[s].valueA = SortedPercentile(a, g_flmComparePercentiles[s - 1]);
+        result.stats[s].valueB = SortedPercentile(b, g_flmComparePercentiles[s - 1]);
+    }
+
+    MannWhitney(a, b, result);
+
+    // Bootstrap, resamples are split evenly over the threads
+    auto start = std::chrono::steady_clock::now();
+
+    int numResamples = std::max(100, settings.numResamples);
+    int numThreads   = (settings.numThreads > 0) ? settings.numThreads : (int)std::max(1u, std::thread::hardware_concurrency());
+    numThreads       = std::min(numThreads, numResamples);
+
+    result.numResamples = numResamples;
+
+    std::vector<double> differences[FLM_COMPARE_STATS];
+    for (int s = 0; s < FLM_COMPARE_STATS; s++)
+        differences[s].resize(numResamples);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; t++)
+    {
+        int first = (int)((int64_t)numResamples * t / numThreads);
+        int last  = (int)((int64_t)numResamples * (t + 1) / numThreads);
+        threads.emplace_back(BootstrapThread, std::cref(a), std::cref(b), settings.seed, first, last, differences);
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    for (int s = 0; s < FLM_COMPARE_STATS; s++)
+    {
+        FLM_COMPARE_STAT& stat = result.stats[s];
+        std::sort(differences[s].begin(), differences[s].end());
+        stat.name        = g_flmCompareStatNames[s];
+        stat.difference  = stat.valueB - stat.valueA;
+        stat.ciLow       = SortedPercentile(differences[s], 100.0 * FLM_COMPARE_ALPHA / 2.0);
+        stat.ciHigh      = SortedPercentile(differences[s], 100.0 * (1.0 - FLM_COMPARE_ALPHA / 2.0));
+        stat.significant = (stat.ciLow > 0.0) || (stat.ciHigh < 0.0);
+    }
+
+    result.elapsedSecond = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+void FlmWriteComparison(FILE* output, const char* nameA, const char* nameB, const FLM_COMPARE_RESULT& result)
+{
+    fprintf(output, "A: %s (%llu samples)\n", nameA, (unsigned long long)result.numA);
+    fprintf(output, "B: %s (%llu samples)\n\n", nameB, (unsigned long long)result.numB);
+
+    fprintf(output, "  %-6s %10s %10s %10s   %-24s\n", "[ms]", "A", "B", "B - A", "95% CI of B - A");
+    for (int s = 0; s < FLM_COMPARE_STATS; s++)
+    {
+        const FLM_COMPARE_STAT& stat = result.stats[s];
+        fprintf(output, "  %-6s %10.2f %10.2f %+10.2f   %+.2f .. %+.2f%s\n",
+                stat.name, stat.valueA, stat.valueB, stat.difference, stat.ciLow, stat.ciHigh, stat.significant ? "  *" : "");
+    }
+
+    fprintf(output, "\n  Mann-Whitney U = %.0f, z = %.2f, p = %.4g, P(B > A) = %.3f\n", result.u, result.z, result.pValue, result.probBGreater);
+
+    const FLM_COMPARE_STAT& median = result.stats[1];
+    if (result.significant)
+        fprintf(output, "  Verdict: B is %s than A, median %+.2f ms (95%% CI %+.2f .. %+.2f), p = %.4g\n",
+                (result.probBGreater > 0.5) ? "slower" : "faster", median.difference, median.ciLow, median.ciHigh, result.pValue);
+    else
+        fprintf(output, "  Verdict: no significant difference at the %.0f%% level, p = %.4g\n", 100.0 * (1.0 - FLM_COMPARE_ALPHA), result.pValue);
+
+    fprintf(output, "  * confidence interval excludes 0\n");
+    fprintf(output, "  Bootstrap with %d resamples took %.2f s\n", result.numResamples, result.elapsedSecond);
+}
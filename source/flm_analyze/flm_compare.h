@@ -0,0 +1,60 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_compare.h
+/// @brief  Statistical comparison of two sets of latency samples
+//=============================================================================
+
+#ifndef FLM_COMPARE_H
+#define FLM_COMPARE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#define FLM_COMPARE_STATS       4     // Mean and the percentiles in g_flmComparePercentiles
+#define FLM_COMPARE_ALPHA       0.05  // Significance level, the confidence intervals are 1 - alpha
+#define FLM_COMPARE_MIN_SAMPLES 2
+
+static const double g_flmComparePercentiles[FLM_COMPARE_STATS - 1] = {50, 90, 99};
+
+struct FLM_COMPARE_SETTINGS
+{
+    int      numResamples = 10000;
+    int      numThreads   = 0;  // 0 uses all CPU cores
+    uint64_t seed         = 1;  // Same seed and thread count give the same intervals
+};
+
+struct FLM_COMPARE_STAT
+{
+    const char* name;
+    double      valueA;
+    double      valueB;
+    double      difference;  // B - A
+    double      ciLow;       // Bootstrap confidence interval of the difference
+    double      ciHigh;
+    bool        significant;  // Interval does not contain 0
+};
+
+struct FLM_COMPARE_RESULT
+{
+    uint64_t         numA = 0;
+    uint64_t         numB = 0;
+    FLM_COMPARE_STAT stats[FLM_COMPARE_STATS] = {};
+
+    // Mann-Whitney U test, two sided, normal approximation with tie correction
+    double u             = 0.0;
+    double z             = 0.0;
+    double pValue        = 1.0;
+    double probBGreater  = 0.5;  // P(b > a) + P(b == a) / 2 for random samples a, b
+    bool   significant   = false;
+    int    numResamples  = 0;
+    double elapsedSecond = 0.0;  // Bootstrap time
+};
+
+// Samples are sorted in place
+bool FlmCompareSamples(std::vector<float>& a, std::vector<float>& b, const FLM_COMPARE_SETTINGS& settings, FLM_COMPARE_RESULT& result);
+
+void FlmWriteComparison(FILE* output, const char* nameA, const char* nameB, const FLM_COMPARE_RESULT& result);
+
+#endif
@@ -0,0 +1,245 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_csv_reader.cpp
+/// @brief  Streaming CSV reader for FLM output files
+//=============================================================================
+
+#include "flm_csv_reader.h"
+
+#include <ctype.h>
+#include <string.h>
+#include <charconv>
+
+std::string_view FlmTrim(std::string_view str)
+{
+    while ((str.size() > 0) && ((str.front() == ' ') || (str.front() == '\t')))
+        str.remove_prefix(1);
+    while ((str.size() > 0) && ((str.back() == ' ') || (str.back() == '\t') || (str.back() == '\r')))
+        str.remove_suffix(1);
+    return str;
+}
+
+static bool EqualNoCase(std::string_view a, std::string_view b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++)
+        if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i]))
+            return false;
+    return true;
+}
+
+FLM_Csv_Reader::~FLM_Csv_Reader()
+{
+    Close();
+}
+
+bool FLM_Csv_Reader::Open(const char* fileName)
+{
+    Close();
+
+    m_file = fopen(fileName, "rb");
+    if (m_file == NULL)
+        return false;
+
+    m_buffer.resize(BUFFER_SIZE);
+    m_begin      = 0;
+    m_end        = 0;
+    m_bEof          = false;
+    m_bSkipping     = false;
+    m_lineNumber    = 0;
+    m_firstLongLine = 0;
+    m_numLongLines  = 0;
+    m_columns.clear();
+    m_metadata.clear();
+
+    // Everything up to the header line
+    std::string_view line;
+    while (NextLine(line))
+    {
+        line = FlmTrim(line);
+        if (line.empty())
+            continue;
+
+        if (line.front() == '#')
+        {
+            ParseComment(line);
+            continue;
+        }
+
+        SplitLine(line);
+        for (std::string_view field : m_fields)
+            m_columns.push_back(std::string(FlmTrim(field)));
+        return true;
+    }
+
+    Close();
+    return false;
+}
+
+void FLM_Csv_Reader::Close()
+{
+    if (m_file != NULL)
+    {
+        fclose(m_file);
+        m_file = NULL;
+    }
+    m_fields.clear();
+}
+
+bool FLM_Csv_Reader::NextLine(std::string_view& line)
+{
+    for (;;)
+    {
+        const char* data    = m_buffer.data();
+        const char* newLine = (const char*)memchr(data + m_begin, '\n', m_end - m_begin);
+        if (newLine != NULL)
+        {
+            size_t length = newLine - (data + m_begin);
+            line          = std::string_view(data + m_begin, length);
+            m_begin += length + 1;
+            m_lineNumber++;
+            if (m_bSkipping)
+            {
+                // The rest of a line that did not fit, not the start of a row
+                m_bSkipping = false;
+                continue;
+            }
+            return true;
+        }
+
+        if (m_bEof)
+        {
+            if (m_bSkipping)
+            {
+                m_bSkipping = false;
+                m_begin     = m_end;
+                m_lineNumber++;
+                return false;
+            }
+
+            // Last line without a new line
+            if (m_begin < m_end)
+            {
+                line    = std::string_view(data + m_begin, m_end - m_begin);
+                m_begin = m_end;
+                m_lineNumber++;
+                return true;
+            }
+            return false;
+        }
+
+        // Move the partial line to the front and refill
+        if (m_begin > 0)
+        {
+            memmove(m_buffer.data(), data + m_begin, m_end - m_begin);
+            m_end -= m_begin;
+            m_begin = 0;
+        }
+
+        if (m_end == m_buffer.size())
+        {
+            // Line longer than the buffer, skipped up to its new line
+            if (m_bSkipping == false)
+            {
+                if (m_numLongLines == 0)
+                    m_firstLongLine = m_lineNumber + 1;
+                m_numLongLines++;
+                m_bSkipping = true;
+            }
+            m_end = 0;
+            continue;
+        }
+
+        size_t numRead = (m_file != NULL) ? fread(m_buffer.data() + m_end, 1, m_buffer.size() - m_end, m_file) : 0;
+        m_end += numRead;
+        m_bEof = (numRead == 0);
+    }
+}
+
+void FLM_Csv_Reader::SplitLine(std::string_view line)
+{
+    m_fields.clear();
+
+    size_t start = 0;
+    for (;;)
+    {
+        size_t comma = line.find(',', start);
+        if (comma == std::string_view::npos)
+        {
+            m_fields.push_back(line.substr(start));
+            break;
+        }
+        m_fields.push_back(line.substr(start, comma - start));
+        start = comma + 1;
+    }
+
+    // SaveTelemetryCSV ends some lines with ", "
+    if ((m_fields.size() > 1) && FlmTrim(m_fields.back()).empty())
+        m_fields.pop_back();
+}
+
+void FLM_Csv_Reader::ParseComment(std::string_view line)
+{
+    line.remove_prefix(1);
+    size_t equal = line.find('=');
+    if (equal == std::string_view::npos)
+        return;
+
+    std::string_view key = FlmTrim(line.substr(0, equal));
+    if (!key.empty())
+        m_metadata.emplace_back(std::string(key), std::string(FlmTrim(line.substr(equal + 1))));
+}
+
+bool FLM_Csv_Reader::ReadRow()
+{
+    std::string_view line;
+    while (NextLine(line))
+    {
+        if (line.empty() || (line.front() == '#') || (line.front() == '\r'))
+            continue;
+
+        SplitLine(line);
+        return true;
+    }
+
+    m_fields.clear();
+    return false;
+}
+
+bool FLM_Csv_Reader::GetDouble(int index, double& value) const
+{
+    std::string_view field = FlmTrim(Field(index));
+    if (field.empty())
+        return false;
+
+    std::from_chars_result result = std::from_chars(field.data(), field.data() + field.size(), value);
+    return (result.ec == std::errc()) && (result.ptr == field.data() + field.size());
+}
+
+bool FLM_Csv_Reader::GetInt64(int index, int64_t& value) const
+{
+    std::string_view field = FlmTrim(Field(index));
+    if (field.empty())
+        return false;
+
+    std::from_chars_result result = std::from_chars(field.data(), field.data() + field.size(), value);
+    return (result.ec == std::errc()) && (result.ptr == field.data() + field.size());
+}
+
+int FLM_Csv_Reader::FindColumn(const char* name) const
+{
+    for (size_t i = 0; i < m_columns.size(); i++)
+        if (EqualNoCase(m_columns[i], name))
+            return (int)i;
+    return -1;
+}
+
+const char* FLM_Csv_Reader::GetMetadata(const char* key) const
+{
+    for (const std::pair<std::string, std::string>& entry : m_metadata)
+        if (EqualNoCase(entry.first, key))
+            return entry.second.c_str();
+    return NULL;
+}
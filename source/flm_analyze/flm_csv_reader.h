@@ -0,0 +1,72 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_csv_reader.h
+/// @brief  Streaming CSV reader for FLM output files
+//=============================================================================
+
+#ifndef FLM_CSV_READER_H
+#define FLM_CSV_READER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Reads a CSV file row by row through a fixed size buffer, memory use does not depend on the file size.
+// Lines starting with '#' are comments, "# key = value" comments before the header are kept as metadata.
+// The first other line is the header, columns are looked up by name.
+class FLM_Csv_Reader
+{
+public:
+    ~FLM_Csv_Reader();
+
+    bool Open(const char* fileName);
+    void Close();
+
+    // Returns false at the end of the file. Fields are valid until the next call.
+    bool ReadRow();
+
+    int              NumFields() const { return (int)m_fields.size(); }
+    std::string_view Field(int index) const { return ((index >= 0) && (index < (int)m_fields.size())) ? m_fields[index] : std::string_view(); }
+    bool             GetDouble(int index, double& value) const;
+    bool             GetInt64(int index, int64_t& value) const;
+
+    // Case insensitive, surrounding spaces are ignored. -1 if there is no such column.
+    int                             FindColumn(const char* name) const;
+    const std::vector<std::string>& Columns() const { return m_columns; }
+
+    const char* GetMetadata(const char* key) const;
+    const std::vector<std::pair<std::string, std::string>>& Metadata() const { return m_metadata; }
+    uint64_t    GetLineNumber() const { return m_lineNumber; }
+
+    // Lines longer than the buffer are skipped whole, 0 if there was none
+    uint64_t GetFirstLongLine() const { return m_firstLongLine; }
+    uint64_t GetNumLongLines() const { return m_numLongLines; }
+
+private:
+    bool NextLine(std::string_view& line);
+    void SplitLine(std::string_view line);
+    void ParseComment(std::string_view line);
+
+    static const size_t BUFFER_SIZE = 1 << 20;  // Longest supported line
+
+    FILE*                                            m_file = NULL;
+    std::vector<char>                                m_buffer;
+    size_t                                           m_begin         = 0;  // Start of unread data in m_buffer
+    size_t                                           m_end           = 0;  // End of valid data in m_buffer
+    bool                                             m_bEof          = false;
+    bool                                             m_bSkipping     = false;  // Inside a line longer than the buffer
+    uint64_t                                         m_lineNumber    = 0;
+    uint64_t                                         m_firstLongLine = 0;
+    uint64_t                                         m_numLongLines  = 0;
+    std::vector<std::string_view>                    m_fields;
+    std::vector<std::string>                         m_columns;
+    std::vector<std::pair<std::string, std::string>> m_metadata;
+};
+
+std::string_view FlmTrim(std::string_view str);
+
+#endif
@@ -0,0 +1,176 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_statistics.cpp
+/// @brief  Constant memory statistics for streamed latency samples
+//=============================================================================
+
+#include "flm_statistics.h"
+
+#include <math.h>
+#include <algorithm>
+
+//------------------------------------------------------------------------------------------
+// FLM_Running_Stats
+//------------------------------------------------------------------------------------------
+
+void FLM_Running_Stats::Reset()
+{
+    *this = FLM_Running_Stats();
+}
+
+void FLM_Running_Stats::Add(double value)
+{
+    if (m_count == 0)
+    {
+        m_min = value;
+        m_max = value;
+    }
+    else
+    {
+        m_min = std::min(m_min, value);
+        m_max = std::max(m_max, value);
+    }
+
+    m_count++;
+    double delta = value - m_mean;
+    m_mean += delta / (double)m_count;
+    m_m2 += delta * (value - m_mean);
+}
+
+double FLM_Running_Stats::StdDev() const
+{
+    return sqrt(Variance());
+}
+
+double FLM_Running_Stats::StdError() const
+{
+    return (m_count > 1) ? sqrt(Variance() / (double)m_count) : 0.0;
+}
+
+//------------------------------------------------------------------------------------------
+// FLM_Histogram
+//------------------------------------------------------------------------------------------
+
+FLM_Histogram::FLM_Histogram(double binWidth, double maxValue)
+    : m_binWidth(binWidth)
+    , m_bins((size_t)(maxValue / binWidth) + 1, 0)
+{
+}
+
+void FLM_Histogram::Reset()
+{
+    std::fill(m_bins.begin(), m_bins.end(), 0);
+    m_count = 0;
+    m_max   = 0.0;
+}
+
+void FLM_Histogram::Add(double value)
+{
+    if (!(value >= 0.0))  // Also catches NaN
+        value = 0.0;
+
+    size_t bin = std::min((size_t)(value / m_binWidth), m_bins.size() - 1);
+    m_bins[bin]++;
+    m_max = (m_count == 0) ? value : std::max(m_max, value);
+    m_count++;
+}
+
+double FLM_Histogram::ValueAtRank(double rank) const
+{
+    if (m_count == 0)
+        return 0.0;
+
+    rank = std::clamp(rank, 0.0, (double)(m_count - 1));
+
+    uint64_t below = 0;
+    for (size_t i = 0; i < m_bins.size(); i++)
+    {
+        uint64_t inBin = m_bins[i];
+        if ((inBin > 0) && (rank < (double)(below + inBin)))
+        {
+            if (i == m_bins.size() - 1)
+                return m_max;
+
+            // Samples are assumed to be spread evenly inside the bin
+            double fraction = (rank - (double)below + 0.5) / (double)inBin;
+            return std::min(((double)i + fraction) * m_binWidth, m_max);
+        }
+        below += inBin;
+    }
+
+    return m_max;
+}
+
+double FLM_Histogram::Percentile(double p) const
+{
+    return ValueAtRank(p / 100.0 * (double)(m_count - 1));
+}
+
+void FLM_Histogram::PercentileCI(double p, double& low, double& high) const
+{
+    double q      = p / 100.0;
+    double n      = (double)m_count;
+    double spread = FLM_Z_95 * sqrt(n * q * (1.0 - q));
+
+    low  = ValueAtRank(floor(n * q - spread) - 1.0);
+    high = ValueAtRank(ceil(n * q + spread) - 1.0);
+}
+
+uint64_t FLM_Histogram::CountAbove(double value) const
+{
+    size_t   first = (value < 0.0) ? 0 : std::min((size_t)(value / m_binWidth) + 1, m_bins.size());
+    uint64_t count = 0;
+    for (size_t i = first; i < m_bins.size(); i++)
+        count += m_bins[i];
+    return count;
+}
+
+//------------------------------------------------------------------------------------------
+// FLM_Linear_Regression
+//------------------------------------------------------------------------------------------
+
+void FLM_Linear_Regression::Reset()
+{
+    *this = FLM_Linear_Regression();
+}
+
+void FLM_Linear_Regression::Add(double x, double y)
+{
+    // Co-moments are updated like Welford's variance, so long runs do not lose precision
+    m_count++;
+    double dx = x - m_meanX;
+    double dy = y - m_meanY;
+    m_meanX += dx / (double)m_count;
+    m_meanY += dy / (double)m_count;
+    m_sxx += dx * (x - m_meanX);
+    m_syy += dy * (y - m_meanY);
+    m_sxy += dx * (y - m_meanY);
+}
+
+double FLM_Linear_Regression::Slope() const
+{
+    return (m_sxx > 0.0) ? m_sxy / m_sxx : 0.0;
+}
+
+double FLM_Linear_Regression::Intercept() const
+{
+    return m_meanY - Slope() * m_meanX;
+}
+
+double FLM_Linear_Regression::SlopeStdError() const
+{
+    if ((m_count < 3) || (m_sxx <= 0.0))
+        return 0.0;
+
+    double residual = std::max(0.0, m_syy - Slope() * m_sxy);
+    return sqrt(residual / (double)(m_count - 2) / m_sxx);
+}
+
+double FLM_Linear_Regression::RSquared() const
+{
+    if ((m_sxx <= 0.0) || (m_syy <= 0.0))
+        return 0.0;
+
+    return (m_sxy * m_sxy) / (m_sxx * m_syy);
+}
@@ -0,0 +1,96 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_statistics.h
+/// @brief  Constant memory statistics for streamed latency samples
+//=============================================================================
+
+#ifndef FLM_STATISTICS_H
+#define FLM_STATISTICS_H
+
+#include <stdint.h>
+#include <vector>
+
+#define FLM_Z_95 1.959964  // Two sided 95% normal quantile
+
+// Mean, variance and range in a single pass (Welford)
+class FLM_Running_Stats
+{
+public:
+    void Reset();
+    void Add(double value);
+
+    uint64_t Count() const { return m_count; }
+    double   Mean() const { return m_mean; }
+    double   Variance() const { return (m_count > 1) ? m_m2 / (double)(m_count - 1) : 0.0; }
+    double   StdDev() const;
+    double   StdError() const;  // Of the mean
+    double   Min() const { return m_min; }
+    double   Max() const { return m_max; }
+
+private:
+    uint64_t m_count = 0;
+    double   m_mean  = 0.0;
+    double   m_m2    = 0.0;
+    double   m_min   = 0.0;
+    double   m_max   = 0.0;
+};
+
+// Fixed bin histogram, memory does not grow with the number of samples.
+// Values above the range are counted in the last bin and still reported exactly by Max().
+class FLM_Histogram
+{
+public:
+    FLM_Histogram(double binWidth = 0.01, double maxValue = 2000.0);
+
+    void Reset();
+    void Add(double value);
+
+    uint64_t Count() const { return m_count; }
+    double   Max() const { return m_max; }
+    double   BinWidth() const { return m_binWidth; }
+
+    // Value at rank, 0 based, interpolated inside the bin
+    double ValueAtRank(double rank) const;
+
+    // p in [0, 100]
+    double Percentile(double p) const;
+
+    // 95% confidence interval of a percentile from the binomial distribution of order statistics
+    void PercentileCI(double p, double& low, double& high) const;
+
+    // Number of samples strictly above value, at bin resolution
+    uint64_t CountAbove(double value) const;
+
+    const std::vector<uint64_t>& Bins() const { return m_bins; }
+
+private:
+    double                m_binWidth;
+    std::vector<uint64_t> m_bins;
+    uint64_t              m_count = 0;
+    double                m_max   = 0.0;
+};
+
+// Ordinary least squares fit of y = intercept + slope * x, updated one point at a time
+class FLM_Linear_Regression
+{
+public:
+    void Reset();
+    void Add(double x, double y);
+
+    uint64_t Count() const { return m_count; }
+    double   Slope() const;
+    double   Intercept() const;
+    double   SlopeStdError() const;
+    double   RSquared() const;
+
+private:
+    uint64_t m_count = 0;
+    double   m_meanX = 0.0;
+    double   m_meanY = 0.0;
+    double   m_sxx   = 0.0;
+    double   m_syy   = 0.0;
+    double   m_sxy   = 0.0;
+};
+
+#endif
@@ -0,0 +1,239 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file main.cpp
+/// @brief  Offline analyzer for FLM output files
+//=============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "flm_analyze.h"
+#include "flm_compare.h"
+#include "version.h"
+
+static const std::vector<std::string> flm_analyze_help = {
+    {"Usage: flm_analyze [options] <input> ..."},
+    {"       flm_analyze [options] -compare <inputs A> <inputs B>"},
+    {""},
+    {"   <input>              : A CSV written by FLM (OutputFileName), a sample log (SaveSampleLog) or the"},
+    {"                          CSV converted from it. A directory adds all .csv and .bin files in it and"},
+    {"                          @file adds the files listed in file, one per line."},
+    {"   -o <file>            : Write the report to file instead of the console"},
+    {"   -summary <file>      : Write one CSV row of results per input, for batch processing"},
+    {"   -rowsize <n>         : Measurements per row for the drift of sample logs, default 10"},
+    {"   -threads <n>         : Inputs analyzed in parallel, default is the number of CPU cores"},
+    {""},
+    {"   -compare <A> <B>     : Compare the latencies of two runs, for example Anti-Lag off (A) and on (B)."},
+    {"                          A and B are inputs as above, all latencies of a directory or @file are pooled."},
+    {"                          Reports mean and percentile differences with bootstrap confidence intervals"},
+    {"                          and a Mann-Whitney U test"},
+    {"   -resamples <n>       : Bootstrap resamples for -compare, default 10000"},
+    {"   -seed <n>            : Bootstrap random seed for -compare, default 1"},
+};
+
+struct FLM_ANALYZE_OPTIONS
+{
+    std::vector<std::string> inputs;
+    std::vector<std::string> compareA;  // Only set for -compare
+    std::vector<std::string> compareB;
+    std::string              compareNameA;
+    std::string              compareNameB;
+    FLM_COMPARE_SETTINGS     compare;
+    std::string              reportFile;
+    std::string              summaryFile;
+    int                      rowSize    = 10;
+    int                      numThreads = 0;
+};
+
+static void AddInput(const std::string& input, std::vector<std::string>& files)
+{
+    std::error_code error;
+    if (std::filesystem::is_directory(input, error))
+    {
+        std::vector<std::string> dirFiles;
+        for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(input, error))
+        {
+            std::string extension = entry.path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+            if (entry.is_regular_file() && ((extension == ".csv") || (extension == ".bin")))
+                dirFiles.push_back(entry.path().string());
+        }
+        std::sort(dirFiles.begin(), dirFiles.end());
+        files.insert(files.end(), dirFiles.begin(), dirFiles.end());
+    }
+    else if ((input.size() > 1) && (input[0] == '@'))
+    {
+        FILE* list = fopen(input.c_str() + 1, "r");
+        if (list == NULL)
+        {
+            printf("Error: Unable to open %s\n", input.c_str() + 1);
+            return;
+        }
+
+        char line[4096];
+        while (fgets(line, sizeof(line), list) != NULL)
+        {
+            line[strcspn(line, "\r\n")] = 0;
+            if (line[0] != 0)
+                files.push_back(line);
+        }
+        fclose(list);
+    }
+    else
+        files.push_back(input);
+}
+
+static bool ParseCommandLine(int argCount, char* args[], FLM_ANALYZE_OPTIONS& options)
+{
+    for (int i = 1; i < argCount; ++i)
+    {
+        std::string cmd_arg = args[i];
+        std::transform(cmd_arg.begin(), cmd_arg.end(), cmd_arg.begin(), ::tolower);
+
+        if ((cmd_arg.compare("-o") == 0) && (i + 1 < argCount))
+            options.reportFile = args[++i];
+        else if ((cmd_arg.compare("-summary") == 0) && (i + 1 < argCount))
+            options.summaryFile = args[++i];
+        else if ((cmd_arg.compare("-rowsize") == 0) && (i + 1 < argCount))
+            options.rowSize = std::max(1, atoi(args[++i]));
+        else if ((cmd_arg.compare("-threads") == 0) && (i + 1 < argCount))
+            options.numThreads = std::max(1, atoi(args[++i]));
+        else if ((cmd_arg.compare("-compare") == 0) && (i + 2 < argCount))
+        {
+            options.compareNameA = args[++i];
+            AddInput(options.compareNameA, options.compareA);
+            options.compareNameB = args[++i];
+            AddInput(options.compareNameB, options.compareB);
+        }
+        else if ((cmd_arg.compare("-resamples") == 0) && (i + 1 < argCount))
+            options.compare.numResamples = atoi(args[++i]);
+        else if ((cmd_arg.compare("-seed") == 0) && (i + 1 < argCount))
+            options.compare.seed = strtoull(args[++i], NULL, 10);
+        else if ((cmd_arg[0] == '-') && (cmd_arg.size() > 1))
+        {
+            printf("Unknown command: %s\n", args[i]);
+            return false;
+        }
+        else
+            AddInput(args[i], options.inputs);
+    }
+
+    options.compare.numThreads = options.numThreads;
+    return (options.inputs.size() > 0) || ((options.compareA.size() > 0) && (options.compareB.size() > 0));
+}
+
+// Pools the latencies of all files, false if a file can not be analyzed
+static bool CollectSamples(const std::vector<std::string>& files, int rowSize, std::vector<float>& samples)
+{
+    FLM_Session_Analyzer analyzer(rowSize);
+    FLM_SESSION_SUMMARY  summary;
+    analyzer.SetSampleSink(&samples);
+
+    bool bRes = true;
+    for (const std::string& file : files)
+    {
+        if (!analyzer.Analyze(file, summary))
+        {
+            printf("Error: %s: %s\n", file.c_str(), summary.error.c_str());
+            bRes = false;
+        }
+    }
+    return bRes;
+}
+
+static int RunComparison(const FLM_ANALYZE_OPTIONS& options)
+{
+    std::vector<float> samplesA;
+    std::vector<float> samplesB;
+    if (!CollectSamples(options.compareA, options.rowSize, samplesA) || !CollectSamples(options.compareB, options.rowSize, samplesB))
+        return -1;
+
+    FLM_COMPARE_RESULT result;
+    if (!FlmCompareSamples(samplesA, samplesB, options.compare, result))
+    {
+        printf("Error: Not enough latency samples to compare, A has %llu and B has %llu\n", (unsigned long long)samplesA.size(), (unsigned long long)samplesB.size());
+        return -1;
+    }
+
+    FILE* report = options.reportFile.empty() ? stdout : fopen(options.reportFile.c_str(), "w");
+    if (report == NULL)
+    {
+        printf("Error: Unable to open %s\n", options.reportFile.c_str());
+        return -1;
+    }
+    FlmWriteComparison(report, options.compareNameA.c_str(), options.compareNameB.c_str(), result);
+    if (report != stdout)
+        fclose(report);
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    FLM_ANALYZE_OPTIONS options;
+    if (!ParseCommandLine(argc, argv, options))
+    {
+        printf("flm_analyze v%s\n\n", VERSION_TEXT);
+        for (const std::string& line : flm_analyze_help)
+            printf("%s\n", line.c_str());
+        return -1;
+    }
+
+    if (options.compareA.size() > 0)
+        return RunComparison(options);
+
+    // Each thread takes the next input, results are written in input order
+    std::vector<FLM_SESSION_SUMMARY> summaries(options.inputs.size());
+    std::atomic<size_t>              nextInput = 0;
+
+    int numThreads = (options.numThreads > 0) ? options.numThreads : (int)std::max(1u, std::thread::hardware_concurrency());
+    numThreads     = std::min(numThreads, (int)options.inputs.size());
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; t++)
+    {
+        threads.emplace_back([&]() {
+            FLM_Session_Analyzer analyzer(options.rowSize);
+            for (size_t i = nextInput++; i < options.inputs.size(); i = nextInput++)
+                analyzer.Analyze(options.inputs[i], summaries[i]);
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    FILE* report = options.reportFile.empty() ? stdout : fopen(options.reportFile.c_str(), "w");
+    if (report == NULL)
+    {
+        printf("Error: Unable to open %s\n", options.reportFile.c_str());
+        return -1;
+    }
+    for (const FLM_SESSION_SUMMARY& summary : summaries)
+        FlmWriteReport(report, summary);
+    if (report != stdout)
+        fclose(report);
+
+    if (!options.summaryFile.empty())
+    {
+        FILE* summaryFile = fopen(options.summaryFile.c_str(), "w");
+        if (summaryFile == NULL)
+        {
+            printf("Error: Unable to open %s\n", options.summaryFile.c_str());
+            return -1;
+        }
+        FlmWriteSummaryHeader(summaryFile);
+        for (const FLM_SESSION_SUMMARY& summary : summaries)
+            FlmWriteSummaryRow(summaryFile, summary);
+        fclose(summaryFile);
+    }
+
+    int numFailed = (int)std::count_if(summaries.begin(), summaries.end(), [](const FLM_SESSION_SUMMARY& s) { return !s.error.empty(); });
+    return (numFailed > 0) ? 1 : 0;
+}
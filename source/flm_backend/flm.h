@@ -38,9 +38,10 @@ enum class FLM_GPU_VENDOR_TYPE
 
 enum class FLM_CAPTURE_CODEC_TYPE
 {
-    AUTO    = 0,
-    AMF     = 1,
-    DXGI    = 2,
+    AUTO      = 0,
+    AMF       = 1,
+    DXGI      = 2,
+    SYNTHETIC = 3,  // Generated frames with scripted latencies, used by flm_bench -e2e
 };
 
 enum class FLM_PRINT_LEVEL
@@ -148,9 +149,17 @@ struct FLM_RUNTIME_OPTIONS
     bool  autoBias           = false;
     int   monitorRefreshRate = 60;      // Default 60Hz
 
+    // Estimated from captured frame timestamps, on VRR displays this follows the game frame rate
+    float estimatedRefreshRate = 0.0f;  // 0 until enough frames have been captured
+    bool  vrrDetected          = false;
+
     // Threshold values used to end the measurement cycle of the mouse to frame latency measurement
     float thresholdCoefficient[MOUSE_EVENT_TYPE_SIZE] = {0.0f, 0.0f};
 
+    // Target probability that a frame without input motion triggers, the threshold then follows the noise of the
+    // scene and thresholdCoefficient only filters the motion out of the noise estimate. 0 uses thresholdCoefficient.
+    float falseTriggerRate = 0.0f;
+
     bool showOptions = false;
     bool minimizeApp = false;
     bool gameUsesFrameGeneration = false;     // enable this to add extra wait time delay when using the mouse move option
@@ -190,6 +199,9 @@ public:
 // Class Factory Interface
 extern "C" FLM_Context* CreateFLMContext();
 
+// Converts a binary sample log saved using SaveSampleLog to CSV (.csv output extension) or to a columnar binary file (any other extension)
+FLM_STATUS FlmConvertSampleLog(const char* inputFile, const char* outputFile);
+
 #define CAPTURE_FRAMES_ON_SEPARATE_THREAD 1
 
 #endif
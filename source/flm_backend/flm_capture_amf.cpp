@@ -8,11 +8,17 @@
 #include "flm_capture_amf.h"
 #include "flm_user_interface.h"
 #include "flm_utils.h"
-#include <intrin.h>
+#include "flm_sad.h"
+
+#include <mutex>
 
 // AMF debug macros, enable as needed
 #define AMF_DEBUG_PRINT_STACK()  //printf(__FUNCTION__ "\n");
 
+#define AMF_FORMAT_POLL_MS       2      // QueryOutput() polling while waiting for the first frame
+#define AMF_FORMAT_FIRST_DOT_MS  500    // Failures before this are expected right after Init()
+#define AMF_FORMAT_TIMEOUT_MS    10000
+
 // ===================== Public Interface =======================
 
 //CRITICAL_SECTION g_criticalSection;
@@ -88,8 +94,6 @@ FLM_STATUS FLM_Capture_AMF::InitCaptureDevice(unsigned int OutputAdapter, FLM_Ti
         return FLM_STATUS::FAILED;
     }
 
-    Sleep(500);  // Sleep a bit to avoid unnecessary error messages...
-
     res = UpdateFormat();
     if (res != AMF_OK)
     {
@@ -135,6 +139,7 @@ FLM_STATUS FLM_Capture_AMF::GetFrame()
     amf_int64       iiFrameIdx;
     AMF_RESULT      res;
 
+    FLM_Stage_Timer acquireTimer(m_pStageTimings, FLM_STAGE::ACQUIRE_WAIT);
     for (;;)  // Get access to the back buffer
     {
         {
@@ -164,6 +169,8 @@ FLM_STATUS FLM_Capture_AMF::GetFrame()
         }
     };
 
+    acquireTimer.Stop();
+
     // Extract the frame flip time and the frame index, update the average fps.
     if (res == AMF_OK)
     {
@@ -231,6 +238,7 @@ FLM_STATUS FLM_Capture_AMF::GetFrame()
 #endif
 
         // 3. Convert using the 0-th converter
+        FLM_Stage_Timer convertTimer(m_pStageTimings, FLM_STAGE::GPU_COPY);
         res = m_ppConverters[0]->SubmitInput(pDisplayCaptureSurface);
         if (res != AMF_OK)
         {
@@ -242,6 +250,7 @@ FLM_STATUS FLM_Capture_AMF::GetFrame()
         {
             return FLM_STATUS::FAILED;
         }
+        convertTimer.Stop();
 
 #ifdef FLM_DEBUG_CODE
         if (0)  // Debug: Check converted surface
@@ -348,12 +357,10 @@ void FLM_Capture_AMF::SaveCaptureSurface(uint32_t file_counter)
     AMF_SaveImage(filename.c_str(), m_pHostSurface0->GetPlaneAt(0));
 }
 
-int FLM_Capture_AMF::CalculateSAD()
+bool FLM_Capture_AMF::GetSADInput(FLM_SAD_INPUT& input)
 {
-    AMF_DEBUG_PRINT_STACK()
-
-    if (m_bHostSurfaceInit == false)
-        return 0;
+    if ((m_bHostSurfaceInit == false) || (m_iHostSurfaceFrames < 2))
+        return false;
 
     int iWidth  = m_pHostSurface0->GetPlaneAt(0)->GetWidth();
     int iHeight = m_pHostSurface0->GetPlaneAt(0)->GetHeight();
@@ -364,71 +371,39 @@ int FLM_Capture_AMF::CalculateSAD()
     int iPitch1  = m_pHostSurface1->GetPlaneAt(0)->GetHPitch();
 
     if ((iWidth != iWidth1) || (iHeight != iHeight1) || (iPitch != iPitch1))
-        return 0;  // This is not a valid case for calculating SAD - the sizes need to be identical
+        return false;  // This is not a valid case for calculating SAD - the sizes need to be identical
 
     unsigned char* pData0 = reinterpret_cast<unsigned char*>(m_pHostSurface0->GetPlaneAt(0)->GetNative());
     unsigned char* pData1 = reinterpret_cast<unsigned char*>(m_pHostSurface1->GetPlaneAt(0)->GetNative());
 
     if ((pData0 == 0) || (pData1 == 0))
-        return 0;  // Both surfaces need to be in host memory...
+        return false;  // Both surfaces need to be in host memory...
 
-    bool bSkipFilmGrainFiltering = (m_setting.iFilmGrainThreshold == 0) ? true : false;
+    input.pData0              = pData0;
+    input.pData1              = pData1;
+    input.iWidth              = iWidth;
+    input.iHeight             = iHeight;
+    input.iPitch              = iPitch;
+    input.iFilmGrainThreshold = m_setting.iFilmGrainThreshold;
+    input.bAveraged4          = false;  // The host surfaces are already downscaled
+    input.bData1Latest        = m_bLatestSurfaceIs1;
 
     if (g_ui.runtimeOptions->printLevel == FLM_PRINT_LEVEL::PRINT_DEBUG)
         if (KEY_DOWN(VK_LSHIFT))
-            bSkipFilmGrainFiltering = true;
-
-    __int64 iiSAD = 0;
-
-    const __m128i film_grain_thresh128 = _mm_set1_epi8(m_setting.iFilmGrainThreshold); // ignore small deltas - helps filtering out film grain
-    const __m128i zero128              = _mm_set1_epi8(0); // == {0}, == _mm_setzero_si128(); 
-
-    const int iHCount = iWidth * 4 / 16; // each pixel is 4 bytes, and there are 16 bytes in one __m128i register
-
-    for (int y = 0; y < iHeight; y++)
-    {
-        __m128i* pMM0         = (__m128i*)pData0;
-        __m128i* pMM1         = (__m128i*)pData1;
-        __m128i  mm_line_2sad = zero128;
-        __m128i  mm_2sad;
-
-        if (bSkipFilmGrainFiltering == false)
-        {
-            for (int i = iHCount - 1; i >= 0; i--)
-            {
-                const __m128i mm0     = _mm_load_si128(pMM0++);
-                const __m128i mm1     = _mm_load_si128(pMM1++);
+            input.iFilmGrainThreshold = 0;  // Skip film grain filtering
 
-                const __m128i diff            = _mm_sub_epi8(mm0, mm1);
-                const __m128i abs_diff        = _mm_abs_epi8(diff);
-                const __m128i thresh_abs_diff = _mm_subs_epu8(abs_diff, film_grain_thresh128);
-                mm_2sad = _mm_sad_epu8(thresh_abs_diff, zero128); // A hack: sum of absolute differences with zero ==> just a sum...
-
-                mm_line_2sad = _mm_add_epi64(mm_line_2sad, mm_2sad);  // Accumulate
-            }
-        }
-        else
-        {
-            for (int i = iHCount - 1; i >= 0; i--)
-            {
-                const __m128i mm0     = _mm_load_si128(pMM0++);
-                const __m128i mm1     = _mm_load_si128(pMM1++);
-
-                mm_2sad = _mm_sad_epu8(mm0, mm1); // Sum the absolute differences of packed unsigned 8-bit integers, 2 values representing 8 SADs each.
-
-                mm_line_2sad = _mm_add_epi64(mm_line_2sad, mm_2sad);  // Accumulate
-            }
-        }
-
-        iiSAD += _mm_extract_epi64(mm_line_2sad,0) + _mm_extract_epi64(mm_line_2sad,1);
+    return true;
+}
 
-        pData0 += iPitch;
-        pData1 += iPitch;
-    }
+int FLM_Capture_AMF::CalculateSAD()
+{
+    AMF_DEBUG_PRINT_STACK()
 
-    iiSAD = iiSAD * 10 / (iHeight * iWidth * 3);  // Average change per pixel, multiplied by 10...
+    FLM_SAD_INPUT input;
+    if (GetSADInput(input) == false)
+        return 0;
 
-    return (int)iiSAD;
+    return FlmCalculateSAD(input);
 }
 
 bool FLM_Capture_AMF::GetConverterOutput(int64_t* pTimeStamp, int64_t* pFrameIdx)
@@ -454,6 +429,7 @@ bool FLM_Capture_AMF::GetConverterOutput(int64_t* pTimeStamp, int64_t* pFrameIdx
 
         // Do the cascading downscale using the converters:
         amf::AMFSurfacePtr converterOutput = amf::AMFSurfacePtr(m_ppConverterOutputs[0]);
+        FLM_Stage_Timer    convertTimer(m_pStageTimings, FLM_STAGE::GPU_COPY);
         for (int i = 1; i < m_iNumConverters; i++)  // Starting from 1! The 0-th converter is used in Pipeline::Capture_GetFrame()
         {
             amf::AMFSurfacePtr converterInput = amf::AMFSurfacePtr(m_ppConverterOutputs[i - 1]);
@@ -478,6 +454,7 @@ bool FLM_Capture_AMF::GetConverterOutput(int64_t* pTimeStamp, int64_t* pFrameIdx
 #endif
             converterInput = converterOutput;
         }
+        convertTimer.Stop();
 
         if (converterOutput)
         {
@@ -485,8 +462,14 @@ bool FLM_Capture_AMF::GetConverterOutput(int64_t* pTimeStamp, int64_t* pFrameIdx
             m_bLatestSurfaceIs1  = !m_bLatestSurfaceIs1;  // Toggle target
             m_pTargetHostSurface = m_bLatestSurfaceIs1 ? m_pHostSurface1 : m_pHostSurface0;
 
-            res = converterOutput->CopySurfaceRegion(
-                m_pTargetHostSurface, 0, 0, 0, 0, converterOutput->GetPlaneAt(0)->GetWidth(), converterOutput->GetPlaneAt(0)->GetHeight());
+            // The host surface readback includes the map, AMF has no separate map stage
+            {
+                FLM_Stage_Timer copyTimer(m_pStageTimings, FLM_STAGE::HOST_COPY);
+                res = converterOutput->CopySurfaceRegion(
+                    m_pTargetHostSurface, 0, 0, 0, 0, converterOutput->GetPlaneAt(0)->GetWidth(), converterOutput->GetPlaneAt(0)->GetHeight());
+            }
+            if ((res == AMF_OK) && (m_iHostSurfaceFrames < 2))
+                m_iHostSurfaceFrames++;
 
 #ifdef FLM_DEBUG_CODE
             if (0)  // Debug: Check we have a target surface
@@ -513,14 +496,36 @@ bool FLM_Capture_AMF::GetConverterOutput(int64_t* pTimeStamp, int64_t* pFrameIdx
     return (res == AMF_OK);
 }
 
+// The display capture and the context do not depend on the region, only the converter chain and the host surfaces do
+FLM_STATUS FLM_Capture_AMF::ResizeCaptureRegion()
+{
+    AMF_DEBUG_PRINT_STACK()
+
+    if ((m_pDisplayCapture.GetPtr() == nullptr) || (m_iNumConverters == 0))
+        return FLM_STATUS::FAILED;
+
+    ReleaseSurfaces();
+    ReleaseConverters();
+
+    AMF_RESULT res = InitConverters();
+    if (res == AMF_OK)
+        res = InitSurfaces();
+
+    if (res != AMF_OK)
+    {
+        FlmPrintError("ResizeCaptureRegion [%d]", res);
+        return FLM_STATUS::FAILED;
+    }
+    return FLM_STATUS::OK;
+}
+
 void FLM_Capture_AMF::Release()
 {
     AMF_DEBUG_PRINT_STACK()
 
     if (m_bDoCaptureFrames)
     {
-        m_bDoCaptureFrames = false;
-        Sleep(100);  // Delay for for capture thread to terminate
+        StopCapturingFrames();
 
         ReleaseSurfaces();
         ReleaseConverters();
@@ -543,7 +548,12 @@ bool FLM_Capture_AMF::InitContext(FLM_GPU_VENDOR_TYPE vendor)
     m_vendor = vendor;
     if (vendor == FLM_GPU_VENDOR_TYPE::AMD)
     {
-        res = g_AMFFactory.Init();
+        // The outputs are initialized on concurrent startup threads, the factory loads the runtime on its first Init()
+        static std::mutex factoryMutex;
+        {
+            std::lock_guard<std::mutex> lock(factoryMutex);
+            res = g_AMFFactory.Init();
+        }
         if (res != AMF_OK)
         {
             FlmPrintError("AMF Failed to initialize [%d]", res);
@@ -628,32 +638,36 @@ AMF_RESULT FLM_Capture_AMF::UpdateFormat()
 
     AMF_RESULT res = AMF_FAIL;
 
-    int numRetries = 10;
+    // Polled until the first frame is ready instead of sleeping ahead of it. Failures are normal for a short while
+    // after Init(), a '.' is printed for each second of them.
+    ULONGLONG iiStart    = GetTickCount64();
+    ULONGLONG iiNextDot  = iiStart + AMF_FORMAT_FIRST_DOT_MS;
+    bool      bPrinted   = false;
     for(;;)
     {
         res = m_pDisplayCapture->QueryOutput(&pTempCaptureData);
         if (res == AMF_OK)
             break;
-        else
-        if (res == AMF_REPEAT)
-            Sleep(100);
-        else
-        if (res == AMF_FAIL)
-        {
-            printf("."); // will be appended to the message "Rebuilding pipeline - please wait............."
+        if ((res != AMF_REPEAT) && (res != AMF_FAIL))
+            break; // this never happens
 
-            if (--numRetries == 0)
-            {
-                printf("\n");
-                break;
-            }
+        ULONGLONG iiNow = GetTickCount64();
+        if (iiNow - iiStart >= AMF_FORMAT_TIMEOUT_MS)
+            break;
 
-            Sleep(1000);
+        if ((res == AMF_FAIL) && (iiNow >= iiNextDot))
+        {
+            printf("."); // will be appended to the message "Rebuilding pipeline - please wait............."
+            bPrinted  = true;
+            iiNextDot = iiNow + 1000;
         }
-        else
-            break; // this never happens
+
+        Sleep(AMF_FORMAT_POLL_MS);
     }
 
+    if (bPrinted)
+        printf("\n");
+
     if (res == AMF_OK)
     {
         amf::AMFSurfacePtr pTempCaptureSurface(pTempCaptureData);
@@ -776,8 +790,11 @@ void FLM_Capture_AMF::ReleaseConverters()
     {
         amf::AMFComponentPtr& pConverter = m_ppConverters[i];  // name aliasing
 
-        pConverter->Drain();
-        pConverter->Terminate();
+        if (pConverter != NULL)  // InitConverters() can fail part way
+        {
+            pConverter->Drain();
+            pConverter->Terminate();
+        }
         pConverter              = NULL;
         m_ppConverterOutputs[i] = 0;
     }
@@ -811,7 +828,8 @@ AMF_RESULT FLM_Capture_AMF::InitSurfaces()
         m_bHostSurfaceInit = true;
     }
 
-    m_bLatestSurfaceIs1 = false;
+    m_bLatestSurfaceIs1  = false;
+    m_iHostSurfaceFrames = 0;
 
     return iRes;
 }
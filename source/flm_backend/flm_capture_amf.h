@@ -36,12 +36,14 @@ public:
     unsigned int GetImageFormat();
     bool         GetConverterOutput(int64_t* pTimeStamp, int64_t* pFrameIdx);
     FLM_STATUS   GetFrame();
+    bool         GetSADInput(FLM_SAD_INPUT& input);
     FLM_STATUS   GetFrameBuffer(FLM_PIXEL_DATA& pixelData);
     FLM_STATUS   InitCaptureDevice(unsigned int OutputAdapter, FLM_Timer_AMF* timer);
     bool         InitContext(FLM_GPU_VENDOR_TYPE vendor);
     void         Release();
     FLM_STATUS   ReleaseFrameBuffer(FLM_PIXEL_DATA& pixelData);
     void         SaveCaptureSurface(uint32_t file_counter);
+    FLM_STATUS   ResizeCaptureRegion();
 
 private:
     void       AMF_SaveImage(const char* filename, amf::AMFPlane* plane);
@@ -59,10 +61,11 @@ private:
     amf::AMFContextPtr   m_pContext;
     amf::AMFComponentPtr m_pDisplayCapture;
 
-    const static int MAX_CONVERTERS     = 16;  // Up to 16 converters
-    int              m_iNumConverters    = MAX_CONVERTERS;
-    bool             m_bLatestSurfaceIs1 = false;
-    bool             m_bHostSurfaceInit  = false;
+    const static int MAX_CONVERTERS       = 16;  // Up to 16 converters
+    int              m_iNumConverters     = MAX_CONVERTERS;
+    bool             m_bLatestSurfaceIs1  = false;
+    bool             m_bHostSurfaceInit   = false;
+    int              m_iHostSurfaceFrames = 0;  // Frames copied to the host surfaces since InitSurfaces(), the SAD needs 2
 
     amf::AMFComponentPtr m_ppConverters[MAX_CONVERTERS];
     amf::AMFDataPtr      m_ppConverterOutputs[MAX_CONVERTERS];
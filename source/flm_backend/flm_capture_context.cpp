@@ -7,9 +7,11 @@
 
 #include "flm_capture_context.h"
 #include "flm_utils.h"
+#include "flm_trace.h"
 
 #ifdef _WIN32
 #include "wingdi.h"
+#include "dxgi.h"
 #endif
 
 #include <fstream>
@@ -159,49 +161,41 @@ float FLM_Capture_Context::CalculateFilterAlpha(int iNumIterations)
     return fAlpha;
 }
 
-int FLM_Capture_Context::GetThresholdedSAD(int64_t frameIdx, int iSAD, float fThresholdMultiplierCoeff)
+int FLM_Capture_Context::GetThresholdedSAD(int64_t frameIdx, int iSAD, float fThresholdMultiplierCoeff, float fFalseTriggerRate, bool bInputPending)
 {
-    // 1. Calculate the thresholded SAD
-    // First - calculate the thresh hold value
-    int iThreshold      = (int)(m_fBackgroundSAD * fThresholdMultiplierCoeff);
-    int iThresholdedSAD = std::max<int>(0, iSAD - iThreshold);
-
-    // 2. Printout SAD values for each frame - very useful as a sanity check
+    // Printout SAD values for each frame - very useful as a sanity check
     if( frameIdx != 0 ) // It will be non-zero only for FLM_PRINT_LEVEL::PRINT_DEBUG
         if( KEY_DOWN(VK_LMENU) )
             FlmPrint( frameIdx % 32 == 0 ? "%i \n" : "%i ", iSAD);
-    
-    // 3. Estimate the "background SAD" - these will be unrelated to mouse click/movement, and are usually due
-    //    to in-game animations and/or film grain noise effect happening in the monitored region.
-    {
-        static int iPrevSAD         = 0;
-        static int iPrevPrevSAD     = 0;
-        static int iPrevPrevPrevSAD = 0;
-
-        // A workaround for situations where the SAD for even frames is significantly different from SAD for odd frames.
-        // For example, a pathological framegen case where every frame is duplicated, therefore every other SAD is zero.
-        iSAD =  iSAD + iPrevSAD / 4; // Note: the way this works is not straightforward to understand...................
 
-        // iSAD needs to be at least 1 to avoid quantization problems
-        iSAD = std::max<int>(1, iSAD);
-
-        // Second - update statistics. Filter out the large SADs caused by the mouse move
-        if ((iSAD <= iPrevSAD         * fThresholdMultiplierCoeff) &&
-            (iSAD <= iPrevPrevSAD     * fThresholdMultiplierCoeff) &&
-            (iSAD <= iPrevPrevPrevSAD * fThresholdMultiplierCoeff))
-        {
-            m_fBackgroundSAD = m_fBackgroundSAD * m_fAVGFilterAlpha + (1 - m_fAVGFilterAlpha) * iSAD;
-        }
+    return m_background.Update(iSAD, fThresholdMultiplierCoeff, m_fAVGFilterAlpha, fFalseTriggerRate, bInputPending);
+}
 
-        // Advance history
-        iPrevPrevPrevSAD = iPrevPrevSAD;
-        iPrevPrevSAD     = iPrevSAD;
-        iPrevSAD         = iSAD;
+int FLM_Capture_Context::GetRefreshRate()
+{
+    // The GDI device name comes from the DXGI output, DISPLAYn is 1 based and does not have to follow the output index.
+    // Outputs of the main adapter, as captured by AMF.
+    int            refreshRate = 0;
+    IDXGIFactory1* pFactory    = NULL;
+    IDXGIAdapter1* pAdapter    = NULL;
+    IDXGIOutput*   pOutput     = NULL;
+    if (SUCCEEDED(CreateDXGIFactory1(__uuidof(IDXGIFactory1), (void**)&pFactory)) && SUCCEEDED(pFactory->EnumAdapters1(0, &pAdapter)) &&
+        SUCCEEDED(pAdapter->EnumOutputs(m_iOutputAdapter, &pOutput)))
+    {
+        DXGI_OUTPUT_DESC outputDesc;
+        DEVMODEW         deviceMode = {};
+        deviceMode.dmSize           = sizeof(deviceMode);
+        if (SUCCEEDED(pOutput->GetDesc(&outputDesc)) && EnumDisplaySettingsW(outputDesc.DeviceName, ENUM_CURRENT_SETTINGS, &deviceMode))
+            refreshRate = (int)deviceMode.dmDisplayFrequency;
     }
 
-
-    // Return the thresh hold result
-    return iThresholdedSAD;
+    if (pOutput != NULL)
+        pOutput->Release();
+    if (pAdapter != NULL)
+        pAdapter->Release();
+    if (pFactory != NULL)
+        pFactory->Release();
+    return refreshRate;
 }
 
 bool FLM_Capture_Context::InitCapture(FLM_Timer_AMF& m_timer)
@@ -211,11 +205,76 @@ bool FLM_Capture_Context::InitCapture(FLM_Timer_AMF& m_timer)
     if (m_hEventFrameReady == 0)
         m_hEventFrameReady = CreateEvent(NULL, TRUE, FALSE, NULL);
 
+    if (m_hEventCapturePaused == 0)
+        m_hEventCapturePaused = CreateEvent(NULL, FALSE, FALSE, NULL);
+
     FLM_STATUS res = InitCaptureDevice(m_iUserSetOutputAdapter, &m_timer);
 
     return (res == FLM_STATUS::OK);
 }
 
+FLM_STATUS FLM_Capture_Context::ResizeCaptureRegion()
+{
+    return FLM_STATUS::FAILED;
+}
+
+bool FLM_Capture_Context::ReconfigureCaptureRegion(int iOriginX, int iOriginY, int iWidth, int iHeight)
+{
+    if (m_bNeedToRebuildPipeline || (m_hEventCapturePaused == 0) || (m_iBackBufferWidth == 0) || (m_iBackBufferHeight == 0))
+        return false;
+
+    // The staging surfaces are cut from the back buffer of the current display mode
+    if ((iOriginX < 0) || (iOriginY < 0) || (iWidth <= 0) || (iHeight <= 0) || (iOriginX + iWidth > (int)m_iBackBufferWidth) ||
+        (iOriginY + iHeight > (int)m_iBackBufferHeight))
+        return false;
+
+    ResetEvent(m_hEventCapturePaused);
+    m_bPauseCaptureThread = true;
+    if (WaitForSingleObject(m_hEventCapturePaused, CAPTURE_PAUSE_TIMEOUT) != WAIT_OBJECT_0)
+    {
+        m_bPauseCaptureThread = false;
+        return false;
+    }
+
+    m_iCaptureOriginX = iOriginX;
+    m_iCaptureOriginY = iOriginY;
+    m_iCaptureWidth   = iWidth;
+    m_iCaptureHeight  = iHeight;
+
+    // Same fractions as saved to flm.ini, so that the settings match the region until the next rebuild loads them
+    m_setting.fStartX        = (float)iOriginX / m_iBackBufferWidth;
+    m_setting.fStartY        = (float)iOriginY / m_iBackBufferHeight;
+    m_setting.fCaptureWidth  = (float)iWidth / m_iBackBufferWidth;
+    m_setting.fCaptureHeight = (float)iHeight / m_iBackBufferHeight;
+
+    FLM_STATUS res = ResizeCaptureRegion();
+    if (res == FLM_STATUS::OK)
+    {
+        // A frame captured for the previous region is not converted, the SAD waits for two frames of the new one.
+        // The SAD is a per pixel average, so the background estimate carries over to the new region as is.
+        ResetEvent(m_hEventFrameReady);
+        ResetState();
+    }
+    else
+        m_bNeedToRebuildPipeline = true;
+
+    m_bPauseCaptureThread = false;
+    return (res == FLM_STATUS::OK);
+}
+
+void FLM_Capture_Context::StopCapturingFrames()
+{
+    m_bDoCaptureFrames = false;
+    if ((m_bCaptureThreadRunning == false) || (m_hEventCapturePaused == 0))
+        return;
+
+    // The thread pauses at the top of its loop, after the GetFrame() it may be in
+    ResetEvent(m_hEventCapturePaused);
+    m_bPauseCaptureThread = true;
+    WaitForSingleObject(m_hEventCapturePaused, CAPTURE_PAUSE_TIMEOUT);
+    m_bPauseCaptureThread = false;
+}
+
 void FLM_Capture_Context::ResetState()
 {
     m_fCumulativeFrameTimesMS        = 0.0f;
@@ -306,38 +365,48 @@ void FLM_Capture_Context::SaveAsBitmap(const char* filename, FLM_PIXEL_DATA pixe
     }
 }
 
-void FLM_Capture_Context::DisplayThreadFunction()
+void FLM_Capture_Context::DisplayThreadFunction(const FLM_Stop_Token& stop)
 {
-    m_bExitCaptureThread = false;
-    for (; m_bTerminateCaptureThread == false;)
+    FlmTraceSetThreadName("Capture");
+    m_bExitCaptureThread    = false;
+    m_bCaptureThreadRunning = true;
+    while (stop.StopRequested() == false)
     {
-        // If the pipeline was just rebuilt - throw out 1 remnant frame from the previous pipeline
+        // ReconfigureCaptureRegion() swaps the surfaces used by GetFrame()
+        if (m_bPauseCaptureThread)
         {
-            static bool prev_bNeedToRebuildPipeline = true;
+            SetEvent(m_hEventCapturePaused);
+            stop.SleepFor(1);
+            continue;
+        }
 
+        // If the pipeline was just rebuilt - throw out 1 remnant frame from the previous pipeline
+        {
             if (m_bDoCaptureFrames == true)
-                if ((m_bNeedToRebuildPipeline == false) && (prev_bNeedToRebuildPipeline == true))
+                if ((m_bNeedToRebuildPipeline == false) && (m_bPrevNeedToRebuildPipeline == true))
                     GetFrame(); // Throw out 1 remnant frame from the previous pipeline
 
-            prev_bNeedToRebuildPipeline = m_bNeedToRebuildPipeline;
+            m_bPrevNeedToRebuildPipeline = m_bNeedToRebuildPipeline;
         }
 
         // Capture a new frame
         if ((m_bDoCaptureFrames == true) && (m_bNeedToRebuildPipeline == false))
         {
+            FLM_TRACE_SCOPE("GetFrame");
             if (GetFrame() == FLM_STATUS::CAPTURE_PROCESS_FRAME)
                 SetEvent(m_hEventFrameReady);
         }
         else
-            Sleep(1);
+            stop.SleepFor(1);
     }
-    m_bExitCaptureThread = true;
+    m_bCaptureThreadRunning = false;
+    m_bExitCaptureThread    = true;
 }
 
 void FLM_Capture_Context::UpdateAverageFrameTime(int64_t iiTimeStamp, int64_t iiFrameIdx)
 {
-    static int64_t iiPrevTimeStamp = 0;
-    static int64_t iiPrevFrameIdx  = 0;
+    int64_t& iiPrevTimeStamp = m_iiPrevFrameTimeStamp;
+    int64_t& iiPrevFrameIdx  = m_iiPrevFrameIdx;
 
     // Update m_fMovingAverageFrameTimeMS
     if (iiFrameIdx != iiPrevFrameIdx)                              // Not a repeating frame
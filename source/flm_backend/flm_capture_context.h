@@ -11,11 +11,16 @@
 #include "flm.h"
 #include "flm_utils.h"
 #include "flm_timer.h"
+#include "flm_sad.h"
+#include "flm_stage_timings.h"
+#include "flm_thread.h"
 
 #include "ini/SimpleIni.h"
 
 extern ProgressCallback* g_pUserCallBack;
 
+#define CAPTURE_PAUSE_TIMEOUT 250  // ms, GetFrame() returns within a frame or the DXGI acquire time out
+
 struct FLM_CAPTURE_SETTINGS
 {
     float       fStartX             = 0.25f;
@@ -33,14 +38,18 @@ public:
     virtual int          CalculateSAD()                                                      = 0;
     virtual bool         GetConverterOutput(int64_t* pTimeStamp, int64_t* pFrameIdx)         = 0;
     virtual FLM_STATUS   GetFrame()                                                          = 0;
+    virtual bool         GetSADInput(FLM_SAD_INPUT& input)                                   = 0;  // False when there are not two frames to compare
     virtual unsigned int GetImageFormat()                                                    = 0;
     virtual FLM_STATUS   InitCaptureDevice(unsigned int OutputAdapter, FLM_Timer_AMF* timer) = 0;
     virtual bool         InitContext(FLM_GPU_VENDOR_TYPE vendor)                             = 0;
     virtual void         Release()                                                           = 0;
     virtual FLM_STATUS   ReleaseFrameBuffer(FLM_PIXEL_DATA& pixelData)                       = 0;
     virtual void         SaveCaptureSurface(uint32_t file_counter)                           = 0;
+    virtual int          GetRefreshRate();  // Current display mode of the captured output in Hz, 0 if unknown
+    virtual FLM_STATUS   ResizeCaptureRegion();  // Staging surfaces for the m_iCapture* region on the current device, FAILED needs a rebuild
 
     FLM_RUNTIME_OPTIONS* m_pRuntimeOptions = nullptr;
+    FLM_Stage_Timings*   m_pStageTimings   = nullptr;  // Set when ReportStageTimings is enabled
     FLM_CAPTURE_SETTINGS m_setting;
 
     bool    m_bFrameLocked           = false;  // GetFrame() sets this to true, will not capture a new frame until flag is reset by CopyImage
@@ -64,16 +73,21 @@ public:
     std::string m_displayName              = "";
     HANDLE      m_hEventFrameReady         = 0;
     HDC         m_screenHDC                = 0;
-    float       m_fBackgroundSAD           = 0.0f;
-    bool        m_bDoCaptureFrames         = true;
+    FLM_SAD_BACKGROUND m_background;           // Of the whole capture region
+    std::atomic<bool> m_bDoCaptureFrames   = true;
 
     float       m_fCumulativeFrameTimesMS        = 0.0f;
     int         m_iCumulativeFrameTimeSamples    = 0;
     float       m_fMovingAverageFrameTimeMS      = 0.0f; // not strictly a moving average - it is implemented via IIR rather than FIR filter
     float       m_fMovingAverageOddFramesTimeMS  = 0.0f; // not strictly a moving average - it is implemented via IIR rather than FIR filter
     float       m_fMovingAverageEvenFramesTimeMS = 0.0f; // not strictly a moving average - it is implemented via IIR rather than FIR filter
-    bool        m_bTerminateCaptureThread  = false;
-    bool        m_bExitCaptureThread       = false;
+    std::atomic<bool> m_bExitCaptureThread = false;
+    std::atomic<bool> m_bCaptureThreadRunning = false;  // DisplayThreadFunction() runs, it is not started for additional outputs
+    std::atomic<bool> m_bPauseCaptureThread = false;  // Set by ReconfigureCaptureRegion() while it swaps the staging surfaces
+    HANDLE      m_hEventCapturePaused      = 0;      // DisplayThreadFunction() is outside of GetFrame()
+    bool        m_bPrevNeedToRebuildPipeline     = true;  // DisplayThreadFunction() throws out the first frame after a rebuild
+    int64_t     m_iiPrevFrameTimeStamp           = 0;     // UpdateAverageFrameTime() of the previous frame
+    int64_t     m_iiPrevFrameIdx                 = 0;
 
     //samples are needed to get within 1% of the final value
     float m_fAVGFilterAlpha   = 0.0f;  // Result of CalculateFilterAlpha() for m_iAVGFilterFrames
@@ -82,9 +96,16 @@ public:
     bool AcquireFrameAndDownscaleToHost(int64_t* pTimeStamp, int64_t* pFrameIdx);
     void ClearCaptureRegion();
     void RedrawMainScreen();
-    void DisplayThreadFunction();
-    int  GetThresholdedSAD(int64_t frameIdx, int iSAD, float fThresholdMultiplierCoeff);
+    void DisplayThreadFunction(const FLM_Stop_Token& stop);
+    int  GetThresholdedSAD(int64_t frameIdx, int iSAD, float fThresholdMultiplierCoeff, float fFalseTriggerRate, bool bInputPending = false);
     bool InitCapture(FLM_Timer_AMF& m_timer);
+
+    // Moves or resizes the capture region in pixels without recreating the capture device. The capture thread is paused
+    // while the codec swaps its staging surfaces. Returns false when the region needs a full rebuild.
+    bool ReconfigureCaptureRegion(int iOriginX, int iOriginY, int iWidth, int iHeight);
+
+    // Stops capturing and returns once the capture thread is outside of GetFrame(), so the codec can release its surfaces
+    void StopCapturingFrames();
     void InitSettings();
     void ResetState();
     void TextDC(int x, int y, const char* Format, ...);
@@ -92,10 +113,11 @@ public:
     void ShowCaptureRegion(COLORREF color);
     void UpdateAverageFrameTime(int64_t iiTimeStamp, int64_t iiFrameIdx);
 
-private:
-    FLM_STATUS   LoadUserSettings();
-    FLM_STATUS   SaveUserSettings();
     static float CalculateFilterAlpha(int iNumIterations);
+
+private:
+    FLM_STATUS LoadUserSettings();
+    FLM_STATUS SaveUserSettings();
 };
 
 #endif
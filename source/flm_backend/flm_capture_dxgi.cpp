@@ -14,7 +14,7 @@
 
 #include "FLM_capture_dxgi.h"
 #include "flm_user_interface.h"
-#include <intrin.h>
+#include "flm_sad.h"
 
 #pragma comment(lib, "d3d11.lib")
 
@@ -228,8 +228,6 @@ FLM_STATUS FLM_Capture_DXGI::InitCaptureDevice(unsigned int OutputAdapter, FLM_T
         }
     }
 
-    Sleep(50);
-
     m_bNeedToRebuildPipeline = false;
     m_bDoCaptureFrames       = false;
 
@@ -259,7 +257,11 @@ FLM_STATUS FLM_Capture_DXGI::GetFrame()
     }
 
     // Get new frame
-    HRESULT hr = m_pDXGIOutputDuplication->AcquireNextFrame(ACQUIRE_FRAME_CAPTURE_TIMEOUT, &m_frameInfo, &m_pDesktopResource);
+    HRESULT hr;
+    {
+        FLM_Stage_Timer stageTimer(m_pStageTimings, FLM_STAGE::ACQUIRE_WAIT);
+        hr = m_pDXGIOutputDuplication->AcquireNextFrame(ACQUIRE_FRAME_CAPTURE_TIMEOUT, &m_frameInfo, &m_pDesktopResource);
+    }
     if (hr == DXGI_ERROR_WAIT_TIMEOUT)
     {
         DXGI_DEBUG_PRINT_GetFrame("[GF:TimeOut %d]", m_iGetFrameInstance);
@@ -283,14 +285,13 @@ FLM_STATUS FLM_Capture_DXGI::GetFrame()
     }
 
     // check incremental time stamp
-    static int64_t lastTimeStamp = 0;
-    int64_t        lapTime       = m_frameInfo.LastPresentTime.QuadPart - lastTimeStamp;
+    int64_t lapTime = m_frameInfo.LastPresentTime.QuadPart - m_iiLastPresentTime;
 
     // No change in frame
     if (lapTime == 0)
         return FLM_STATUS::CAPTURE_RETRY;
 
-    lastTimeStamp = m_frameInfo.LastPresentTime.QuadPart;
+    m_iiLastPresentTime = m_frameInfo.LastPresentTime.QuadPart;
 
     DXGI_DEBUG_PRINT_GetFrame("%-38s frame %d [%I64d]\n", __FUNCTION__, m_iCurrentFrame,lapTime);
 
@@ -352,147 +353,70 @@ void FLM_Capture_DXGI::SaveCaptureSurface(uint32_t file_counter)
     }
 }
 
-int FLM_Capture_DXGI::CalculateSAD()
+bool FLM_Capture_DXGI::GetSADInput(FLM_SAD_INPUT& input)
 {
     if ((m_pixelData[0].data == NULL) || (m_pixelData[1].data == NULL))
-        return 0;
+        return false;
 
     if ((m_pixelData[0].timestamp == 0) || (m_pixelData[1].timestamp == 0))
-        return 0;
+        return false;
 
     int iWidth  = m_pixelData[0].width;
     int iHeight = m_pixelData[0].height;
     int iPitch  = m_pixelData[0].pitchH;
 
     if ((iWidth != m_pixelData[1].width) || (iHeight != m_pixelData[1].height) || (iPitch != m_pixelData[1].pitchH))
-        return 0;  // This is not a valid case for calculating SAD - the sizes need to be identical
-
-    unsigned char* pData0 = m_pixelData[0].data;
-    unsigned char* pData1 = m_pixelData[1].data;
+        return false;  // This is not a valid case for calculating SAD - the sizes need to be identical
 
-    bool bSkipFilmGrainFiltering = (m_setting.iFilmGrainThreshold == 0) ? true : false;
+    input.pData0              = m_pixelData[0].data;
+    input.pData1              = m_pixelData[1].data;
+    input.iWidth              = iWidth;
+    input.iHeight             = iHeight;
+    input.iPitch              = iPitch;
+    input.iFilmGrainThreshold = m_setting.iFilmGrainThreshold;
+    input.bAveraged4          = true;  // Full resolution, blocks of 4 pixels are averaged
+    input.bData1Latest        = (m_pixelData[1].timestamp > m_pixelData[0].timestamp);
 
     if (g_ui.runtimeOptions->printLevel == FLM_PRINT_LEVEL::PRINT_DEBUG)
         if (KEY_DOWN(VK_LSHIFT))
-            bSkipFilmGrainFiltering = true;
-
-    __int64 iiSAD = 0;
-
-    const __m128i film_grain_thresh128 = _mm_set1_epi8(m_setting.iFilmGrainThreshold); // ignore small deltas - helps filtering out film grain
-    const __m128i zero128              = _mm_set1_epi8(0); // == {0}, == _mm_setzero_si128(); 
-
-    iWidth = iWidth / 4;                 // To reduce sensitivity to random noise (film grain), we are going to be averaging 4 adjacent pixel blocks...
-    const int iHCount = iWidth * 4 / 16; // each pixel is 4 bytes, and there are 16 bytes in one __m128i register
-
-    for (int y = 0; y < iHeight; y++)
-    {
-        __m128i* pMM0         = (__m128i*)pData0;
-        __m128i* pMM1         = (__m128i*)pData1;
-        __m128i  mm_line_2sad = zero128;
-        __m128i  mm_2sad;
-
-        if (bSkipFilmGrainFiltering == false)
-        {
-            for (int i = iHCount - 1; i >= 0; i--)
-            {
-                const __m128i mm0a = _mm_load_si128(pMM0++);
-                const __m128i mm0b = _mm_load_si128(pMM0++);
-                const __m128i mm0c = _mm_load_si128(pMM0++);
-                const __m128i mm0d = _mm_load_si128(pMM0++);
-
-                const __m128i mm1a = _mm_load_si128(pMM1++);
-                const __m128i mm1b = _mm_load_si128(pMM1++);
-                const __m128i mm1c = _mm_load_si128(pMM1++);
-                const __m128i mm1d = _mm_load_si128(pMM1++);
-
-                const __m128i mm0x = _mm_avg_epu8(mm0a, mm0b);
-                const __m128i mm0y = _mm_avg_epu8(mm0c, mm0d);
-
-                const __m128i mm1x = _mm_avg_epu8(mm1a, mm1b);
-                const __m128i mm1y = _mm_avg_epu8(mm1c, mm1d);
-
-                const __m128i mm0  = _mm_avg_epu8(mm0x, mm0y);
-                const __m128i mm1  = _mm_avg_epu8(mm1x, mm1y);
+            input.iFilmGrainThreshold = 0;  // Skip film grain filtering
 
-                //const __m128i mm0 = _mm_load_si128(pMM0++);
-                //const __m128i mm1 = _mm_load_si128(pMM1++);
-
-                const __m128i diff            = _mm_sub_epi8(mm0, mm1);
-                const __m128i abs_diff        = _mm_abs_epi8(diff);
-                const __m128i thresh_abs_diff = _mm_subs_epu8(abs_diff, film_grain_thresh128);
-                mm_2sad = _mm_sad_epu8(thresh_abs_diff, zero128); // A hack: sum of absolute differences with zero ==> just a sum...
-
-                mm_line_2sad = _mm_add_epi64(mm_line_2sad, mm_2sad);  // Accumulate
-            }
-        }
-        else
-        {
-            for (int i = iHCount - 1; i >= 0; i--)
-            {
-                const __m128i mm0a = _mm_load_si128(pMM0++);
-                const __m128i mm0b = _mm_load_si128(pMM0++);
-                const __m128i mm0c = _mm_load_si128(pMM0++);
-                const __m128i mm0d = _mm_load_si128(pMM0++);
-
-                const __m128i mm1a = _mm_load_si128(pMM1++);
-                const __m128i mm1b = _mm_load_si128(pMM1++);
-                const __m128i mm1c = _mm_load_si128(pMM1++);
-                const __m128i mm1d = _mm_load_si128(pMM1++);
-
-                const __m128i mm0x = _mm_avg_epu8(mm0a, mm0b);
-                const __m128i mm0y = _mm_avg_epu8(mm0c, mm0d);
-
-                const __m128i mm1x = _mm_avg_epu8(mm1a, mm1b);
-                const __m128i mm1y = _mm_avg_epu8(mm1c, mm1d);
-
-                const __m128i mm0  = _mm_avg_epu8(mm0x, mm0y);
-                const __m128i mm1  = _mm_avg_epu8(mm1x, mm1y);
-
-                //const __m128i mm0 = _mm_load_si128(pMM0++);
-                //const __m128i mm1 = _mm_load_si128(pMM1++);
-
-                mm_2sad = _mm_sad_epu8(mm0, mm1); // Sum the absolute differences of packed unsigned 8-bit integers, 2 values representing 8 SADs each.
-
-                mm_line_2sad = _mm_add_epi64(mm_line_2sad, mm_2sad);  // Accumulate
-            }
-        }
-
-        iiSAD += _mm_extract_epi64(mm_line_2sad,0) + _mm_extract_epi64(mm_line_2sad,1);
+    return true;
+}
 
-        pData0 += iPitch;
-        pData1 += iPitch;
-    }
+int FLM_Capture_DXGI::CalculateSAD()
+{
+    FLM_SAD_INPUT input;
+    if (GetSADInput(input) == false)
+        return 0;
 
-    iiSAD = iiSAD * 10 / (iHeight * iWidth * 3);  // Average change per pixel, multiplied by 10...
+    int iSAD = FlmCalculateSAD(input);
 
     DXGI_DEBUG_PRINT_CalculateSAD("%-38s frame 0 [%I64d] - frame 1 [%I64d]: iSAD = %d Current Frame %d\n",
                                   __FUNCTION__,
                                   m_pixelData[0].timestamp,
                                   m_pixelData[1].timestamp,
-                                  (int)iiSAD,
+                                  iSAD,
                                   m_currentFrame);
 
-    return (int)iiSAD;
+    return iSAD;
 }
 
 bool FLM_Capture_DXGI::GetConverterOutput(int64_t* pTimeStamp, int64_t* pFrameIdx)
 {
-    static int64_t frameIDX      = 0;
-    static int64_t lastTimeStamp = 0;
-
     if (pTimeStamp)
     {
         *pTimeStamp = (int64_t)m_frameInfo.LastPresentTime.QuadPart;
-        if (lastTimeStamp != *pTimeStamp)
+        if (m_iiConverterTimeStamp != *pTimeStamp)
         {
-            lastTimeStamp = *pTimeStamp;
-            frameIDX++;
+            m_iiConverterTimeStamp = *pTimeStamp;
+            m_iiConverterFrameIdx++;
         }
 
-        UpdateAverageFrameTime(*pTimeStamp, frameIDX);
+        UpdateAverageFrameTime(*pTimeStamp, m_iiConverterFrameIdx);
 
         if (pFrameIdx)
-            *pFrameIdx = frameIDX;
+            *pFrameIdx = m_iiConverterFrameIdx;
     }
 
     DXGI_DEBUG_PRINT_GetConverterOutput("%-38s frame %d [%I64d]\n", __FUNCTION__, m_iCurrentFrame, *pTimeStamp);
@@ -500,6 +424,45 @@ bool FLM_Capture_DXGI::GetConverterOutput(int64_t* pTimeStamp, int64_t* pFrameId
     return CopyImage(m_pixelData[m_iCurrentFrame]);
 }
 
+// The device and the duplication do not depend on the region, only the CPU accessible copies of it do
+FLM_STATUS FLM_Capture_DXGI::ResizeCaptureRegion()
+{
+    DXGI_DEBUG_PRINT_STACK();
+
+    if ((m_pD3D11Device == nullptr) || (m_pDestGPUCopy[0] == nullptr))
+        return FLM_STATUS::FAILED;
+
+    D3D11_TEXTURE2D_DESC texture2d_descriptor;
+    m_pDestGPUCopy[0]->GetDesc(&texture2d_descriptor);
+    texture2d_descriptor.Width  = m_iCaptureWidth;
+    texture2d_descriptor.Height = m_iCaptureHeight;
+
+    // Both copies are created before any is replaced, on a failure the previous ones stay until the rebuild
+    ID3D11Texture2D* pDestGPUCopy[2] = {nullptr, nullptr};
+    for (int i = 0; i < 2; i++)
+    {
+        HRESULT hr = m_pD3D11Device->CreateTexture2D(&texture2d_descriptor, NULL, &pDestGPUCopy[i]);
+        if (FAILED(hr) || (pDestGPUCopy[i] == nullptr))
+        {
+            SAFE_RELEASE(pDestGPUCopy[0]);
+            SAFE_RELEASE(pDestGPUCopy[1]);
+            ProcessFailure(nullptr, "Creating a cpu accessible texture failed.", hr);
+            return FLM_STATUS::CAPTURE_ERROR_UNEXPECTED;
+        }
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        SAFE_RELEASE(m_pDestGPUCopy[i]);
+        m_pDestGPUCopy[i] = pDestGPUCopy[i];
+
+        // CopyImage() reallocates the host copy on a size change, GetSADInput() waits for both frames of the new region
+        m_pixelData[i].timestamp = 0;
+    }
+
+    return FLM_STATUS::OK;
+}
+
 // Release resources in dependency order
 void FLM_Capture_DXGI::Release()
 {
@@ -558,26 +521,25 @@ bool FLM_Capture_DXGI::CopyImage(FLM_PIXEL_DATA& pixelData)
     }
 
     D3D11_BOX SrcBox;
-    if ((m_setting.fStartX > 0.0f) && (m_setting.fStartX <= 1.0f))
-        SrcBox.left = UINT(m_iBackBufferWidth * m_setting.fStartX);
-    else
-        SrcBox.left = UINT(m_setting.fStartX);
-
-    if ((m_setting.fStartY > 0.0f) && (m_setting.fStartY <= 1.0f))
-        SrcBox.top = UINT(m_iBackBufferHeight * m_setting.fStartY);
-    else
-        SrcBox.top = UINT(m_setting.fStartY);
-
+    SrcBox.left   = UINT(m_iCaptureOriginX);
+    SrcBox.top    = UINT(m_iCaptureOriginY);
     SrcBox.right  = SrcBox.left + destText.Width;
     SrcBox.bottom = SrcBox.top + destText.Height;
     SrcBox.front  = 0;
     SrcBox.back   = 1;
 
-    m_pD3D11DeviceContext->CopySubresourceRegion(m_pDestGPUCopy[m_iCurrentFrame], 0, 0, 0, 0, m_pAcquiredDesktopImage[m_iCurrentFrame], 0, &SrcBox);
+    {
+        FLM_Stage_Timer stageTimer(m_pStageTimings, FLM_STAGE::GPU_COPY);
+        m_pD3D11DeviceContext->CopySubresourceRegion(m_pDestGPUCopy[m_iCurrentFrame], 0, 0, 0, 0, m_pAcquiredDesktopImage[m_iCurrentFrame], 0, &SrcBox);
+    }
 
+    // Map waits for the GPU copy to complete
     D3D11_MAPPED_SUBRESOURCE resource;
     UINT                     subresource = D3D11CalcSubresource(0, 0, 0);
-    m_pD3D11DeviceContext->Map(m_pDestGPUCopy[m_iCurrentFrame], subresource, D3D11_MAP_READ, 0, &resource);
+    {
+        FLM_Stage_Timer stageTimer(m_pStageTimings, FLM_STAGE::MAP);
+        m_pD3D11DeviceContext->Map(m_pDestGPUCopy[m_iCurrentFrame], subresource, D3D11_MAP_READ, 0, &resource);
+    }
 
     BYTE* sptr = reinterpret_cast<BYTE*>(resource.pData);
 
@@ -611,7 +573,10 @@ bool FLM_Capture_DXGI::CopyImage(FLM_PIXEL_DATA& pixelData)
     pixelData.pitchH           = m_iImagePitch;
     pixelData.timestamp        = (int64_t)m_frameInfo.LastPresentTime.QuadPart;
 
-    memcpy_s(pixelData.data, dsSize, sptr, dsSize);
+    {
+        FLM_Stage_Timer stageTimer(m_pStageTimings, FLM_STAGE::HOST_COPY);
+        memcpy_s(pixelData.data, dsSize, sptr, dsSize);
+    }
 
     m_pD3D11DeviceContext->Unmap(m_pDestGPUCopy[m_iCurrentFrame], subresource);
 
@@ -623,6 +588,16 @@ bool FLM_Capture_DXGI::CopyImage(FLM_PIXEL_DATA& pixelData)
     return true;
 }
 
+int FLM_Capture_DXGI::GetRefreshRate()
+{
+    // The output knows its GDI device name, the DISPLAYn numbering does not have to follow the output index
+    DEVMODEW deviceMode = {};
+    deviceMode.dmSize   = sizeof(deviceMode);
+    if ((m_outputDescriptor.DeviceName[0] != 0) && EnumDisplaySettingsW(m_outputDescriptor.DeviceName, ENUM_CURRENT_SETTINGS, &deviceMode))
+        return (int)deviceMode.dmDisplayFrequency;
+    return FLM_Capture_Context::GetRefreshRate();
+}
+
 unsigned int FLM_Capture_DXGI::GetImageFormat()
 {
     DXGI_DEBUG_PRINT_STACK();
@@ -28,7 +28,7 @@
 #include "flm_utils.h"
 #include "flm_capture_context.h"
 
-#define ACQUIRE_FRAME_CAPTURE_TIMEOUT 1000
+#define ACQUIRE_FRAME_CAPTURE_TIMEOUT 50  // Short, so that the capture thread notices a stop when the desktop does not change
 
 extern HRESULT SystemTransitionsExpectedErrors[];
 extern HRESULT CreateDuplicationExpectedErrors[];
@@ -50,16 +50,22 @@ public:
     FLM_STATUS   InitCaptureDevice(unsigned int MonitorToCapture, FLM_Timer_AMF* timer);
     unsigned int GetImageFormat();
     int          CalculateSAD();
+    bool         GetSADInput(FLM_SAD_INPUT& input);
     bool         GetConverterOutput(int64_t* pTimeSmp, int64_t* pFrameIdx);
     void         Release();
     void         SaveCaptureSurface(uint32_t file_counter);
     bool         InitContext(FLM_GPU_VENDOR_TYPE vendor);
+    int          GetRefreshRate();
+    FLM_STATUS   ResizeCaptureRegion();
 
 private:
     DXGI_OUTDUPL_FRAME_INFO m_frameInfo;  // Current captured frame info obtained from GetFrame()
     FLM_PIXEL_DATA          m_pixelData[2]             = {};
     int                     m_iGetFrameInstance        = 0;  // Tracks AcquireNextFrame increments on success
     int64_t                 m_iiFreqCountPerSecond     = 0;
+    int64_t                 m_iiLastPresentTime        = 0;  // Of the last frame returned by GetFrame()
+    int64_t                 m_iiConverterFrameIdx      = 0;  // Counts the distinct present times seen by GetConverterOutput()
+    int64_t                 m_iiConverterTimeStamp     = 0;
     int32_t                 m_iImagePitch              = 0;
     IDXGIResource*          m_pDesktopResource         = nullptr;
     ID3D11Device*           m_pD3D11Device             = nullptr;             // DirectX adapter object created to interface with GPU
@@ -0,0 +1,410 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_capture_synthetic.cpp
+/// @brief  FLM generated frame source with scripted input to photon latencies
+//=============================================================================
+
+#include "flm_capture_synthetic.h"
+#include "flm_sad.h"
+
+#include <algorithm>
+
+// Synthetic debug macros, enable as needed
+#define SYNTHETIC_DEBUG_PRINT_STACK()             //printf("%-38s\n",__FUNCTION__)
+#define SYNTHETIC_DEBUG_PRINT_GetFrame(f, ...)    //printf((f), __VA_ARGS__)
+
+#define SYNTHETIC_DISPLAY_WIDTH  1920
+#define SYNTHETIC_DISPLAY_HEIGHT 1080
+#define SYNTHETIC_FORMAT_BGRA    87  // DXGI_FORMAT_B8G8R8A8_UNORM, the format the other codecs capture
+
+// xorshift, the same sequence for the same seed
+static uint32_t NextRandom(uint32_t& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+FLM_Capture_Synthetic::FLM_Capture_Synthetic(FLM_RUNTIME_OPTIONS* pRuntimeOptions, const FLM_SYNTHETIC_SCRIPT& script)
+    : m_script(script)
+{
+    m_pRuntimeOptions      = pRuntimeOptions;
+    m_script.refreshRate   = std::clamp(m_script.refreshRate, 24, 1000);
+    m_iRandomState         = (m_script.seed != 0) ? m_script.seed : 1;  // xorshift is stuck at 0
+}
+
+FLM_Capture_Synthetic::~FLM_Capture_Synthetic()
+{
+    Release();
+}
+
+FLM_STATUS FLM_Capture_Synthetic::InitCaptureDevice(unsigned int OutputAdapter, FLM_Timer_AMF* timer)
+{
+    SYNTHETIC_DEBUG_PRINT_STACK();
+
+    if ((timer == nullptr) || (QueryPerformanceFrequency((LARGE_INTEGER*)&m_iiFreqCountPerSecond) == false))
+    {
+        FlmPrintError("Error:Synthetic get performance frequency failed");
+        return FLM_STATUS::TIMER_INIT_FAILED;
+    }
+    // Own sleeper, the generator sleeps must not change the calibration and the statistics of the mouse thread
+    if (m_sleeper.Init() == false)
+    {
+        FlmPrintError("Error:Synthetic sleep timer init failed");
+        return FLM_STATUS::TIMER_INIT_FAILED;
+    }
+    m_iOutputAdapter = OutputAdapter;
+
+    // Virtual display, the capture region is set the same way as for a real one
+    m_iBackBufferWidth  = SYNTHETIC_DISPLAY_WIDTH;
+    m_iBackBufferHeight = SYNTHETIC_DISPLAY_HEIGHT;
+    m_iBackBufferFormat = SYNTHETIC_FORMAT_BGRA;
+
+    if ((m_setting.fCaptureWidth > 0.0f) && (m_setting.fCaptureWidth <= 1.0f))
+        m_iCaptureWidth = int(float(m_iBackBufferWidth) * m_setting.fCaptureWidth);
+    else
+        m_iCaptureWidth = int(m_setting.fCaptureWidth);
+
+    if ((m_setting.fStartX > 0.0f) && (m_setting.fStartX <= 1.0f))
+        m_iCaptureOriginX = (int)(float(m_iBackBufferWidth) * m_setting.fStartX);
+    else
+        m_iCaptureOriginX = int(m_setting.fStartX);
+
+    if ((m_setting.fCaptureHeight > 0.0f) && (m_setting.fCaptureHeight <= 1.0f))
+        m_iCaptureHeight = int(float(m_iBackBufferHeight) * m_setting.fCaptureHeight);
+    else
+        m_iCaptureHeight = int(m_setting.fCaptureHeight);
+
+    if ((m_setting.fStartY > 0.0f) && (m_setting.fStartY <= 1.0f))
+        m_iCaptureOriginY = (int)(float(m_iBackBufferHeight) * m_setting.fStartY);
+    else
+        m_iCaptureOriginY = (int)(m_setting.fStartY);
+
+    FLM_STATUS res = InitFrameBuffers();
+    if (res != FLM_STATUS::OK)
+        return res;
+
+    m_iiFramePeriod = m_iiFreqCountPerSecond / m_script.refreshRate;
+    QueryPerformanceCounter((LARGE_INTEGER*)&m_iiStartTime);
+    m_iiVsyncCount = 0;
+
+    m_bNeedToRebuildPipeline = false;
+    m_bDoCaptureFrames       = false;
+
+    return FLM_STATUS::OK;
+}
+
+FLM_STATUS FLM_Capture_Synthetic::ResizeCaptureRegion()
+{
+    SYNTHETIC_DEBUG_PRINT_STACK();
+
+    // The virtual display keeps running, GetConverterOutput() copies from the scenes of the new size
+    return InitFrameBuffers();
+}
+
+// Scenes and frame buffers of the capture region size
+FLM_STATUS FLM_Capture_Synthetic::InitFrameBuffers()
+{
+    // FlmCalculateSADAveraged4() processes blocks of 16 pixels
+    m_iCaptureWidth  = std::clamp(m_iCaptureWidth & ~15, 16, SYNTHETIC_DISPLAY_WIDTH);
+    m_iCaptureHeight = std::clamp(m_iCaptureHeight, 1, SYNTHETIC_DISPLAY_HEIGHT);
+    m_iImagePitch    = (m_iCaptureWidth * 4 + 63) & ~63;
+
+    GenerateScenes();
+
+    for (int i = 0; i < 2; i++)
+    {
+        ReleaseFrameBuffer(m_pixelData[i]);
+        m_pixelData[i].data = new (std::nothrow) uint8_t[(size_t)m_iImagePitch * m_iCaptureHeight];
+        if (m_pixelData[i].data == NULL)
+        {
+            FlmPrintError("unable to allocate memory for pixel data");
+            return FLM_STATUS::MEMORY_ALLOCATION_ERROR;
+        }
+        m_pixelData[i].format           = SYNTHETIC_FORMAT_BGRA;
+        m_pixelData[i].pixelSizeInBytes = 4;
+        m_pixelData[i].height           = m_iCaptureHeight;
+        m_pixelData[i].width            = m_iCaptureWidth;
+        m_pixelData[i].pitchH           = m_iImagePitch;
+        m_pixelData[i].timestamp        = 0;
+    }
+
+    return FLM_STATUS::OK;
+}
+
+// Scene 0 and 1 are the game view before and after a mouse move, scene 2 is the frame interpolated between them
+void FLM_Capture_Synthetic::GenerateScenes()
+{
+    const int iShift = std::max(16, m_iCaptureWidth / 16);  // Horizontal view shift of one mouse move
+
+    uint32_t state = (m_script.seed != 0) ? m_script.seed : 1;
+    for (int noise = 0; noise < NOISE_COUNT; noise++)
+    {
+        for (int scene = 0; scene < SCENE_COUNT; scene++)
+            m_scenes[scene][noise].assign((size_t)m_iImagePitch * m_iCaptureHeight, 0);
+
+        for (int y = 0; y < m_iCaptureHeight; y++)
+        {
+            uint8_t* row0 = m_scenes[0][noise].data() + (size_t)y * m_iImagePitch;
+            uint8_t* row1 = m_scenes[1][noise].data() + (size_t)y * m_iImagePitch;
+            uint8_t* row2 = m_scenes[2][noise].data() + (size_t)y * m_iImagePitch;
+            for (int x = 0; x < m_iCaptureWidth; x++)
+            {
+                for (int c = 0; c < 4; c++)
+                {
+                    // Film grain, small enough to be filtered by the default FilmGrainThreshold
+                    int grain = (int)(NextRandom(state) & 7) - 3;
+                    int v0    = 48 + (((x / 24 + y / 24) & 1) * 96) + c * 16;
+                    int v1    = 48 + ((((x + iShift) / 24 + y / 24) & 1) * 96) + c * 16;
+
+                    row0[x * 4 + c] = (uint8_t)std::clamp(v0 + grain, 0, 255);
+                    row1[x * 4 + c] = (uint8_t)std::clamp(v1 + grain, 0, 255);
+                    row2[x * 4 + c] = (uint8_t)std::clamp((v0 + v1) / 2 + grain, 0, 255);
+                }
+            }
+        }
+    }
+}
+
+float FLM_Capture_Synthetic::NextLatencyMS()
+{
+    float fLatencyMS = m_script.latencyMS;
+
+    if (m_script.type == FLM_SYNTHETIC_LATENCY::BIMODAL)
+    {
+        float fRandom = (NextRandom(m_iRandomState) >> 8) / 16777216.0f;
+        if (fRandom < m_script.probability)
+            fLatencyMS = m_script.latency2MS;
+    }
+
+    if (m_script.jitterMS > 0.0f)
+    {
+        float fRandom = (NextRandom(m_iRandomState) >> 8) / 16777216.0f;
+        fLatencyMS += (fRandom * 2.0f - 1.0f) * m_script.jitterMS;
+    }
+
+    return std::max(0.0f, fLatencyMS);
+}
+
+void FLM_Capture_Synthetic::InjectInput(int64_t iiInjectTime, bool bCounted)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    FLM_SYNTHETIC_INJECTION injection;
+    injection.iiInjectTime   = iiInjectTime;
+    injection.iiResponseTime = iiInjectTime + (int64_t)(NextLatencyMS() * m_iiFreqCountPerSecond / 1000.0);
+    injection.bCounted       = bCounted;
+
+    m_pending.push_back({injection.iiResponseTime, m_injections.size()});
+    m_injections.push_back(injection);
+}
+
+void FLM_Capture_Synthetic::AddMeasurement(int64_t iiInjectTime, float fLatencyMS)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // The injection is almost always the last one
+    for (size_t i = m_injections.size(); i > 0; i--)
+    {
+        if (m_injections[i - 1].iiInjectTime == iiInjectTime)
+        {
+            m_injections[i - 1].fMeasuredMS = fLatencyMS;
+            m_injections[i - 1].bMeasured   = true;
+            return;
+        }
+    }
+}
+
+std::vector<FLM_SYNTHETIC_INJECTION> FLM_Capture_Synthetic::GetInjections()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_injections;
+}
+
+FLM_STATUS FLM_Capture_Synthetic::GetFrame()
+{
+    // Wait for the next refresh of the virtual display, refreshes missed while the thread was stalled are skipped
+    int64_t iiNow;
+    QueryPerformanceCounter((LARGE_INTEGER*)&iiNow);
+    m_iiVsyncCount = std::max(m_iiVsyncCount, (iiNow - m_iiStartTime) / m_iiFramePeriod) + 1;
+
+    int64_t iiPresentTime = m_iiStartTime + m_iiVsyncCount * m_iiFramePeriod;
+    {
+        FLM_Stage_Timer stageTimer(m_pStageTimings, FLM_STAGE::ACQUIRE_WAIT);
+        m_sleeper.SleepUntil(iiPresentTime);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const bool bFrameGeneration = (m_script.type == FLM_SYNTHETIC_LATENCY::FRAME_GENERATION);
+    const bool bGeneratedFrame  = bFrameGeneration && (m_iiVsyncCount & 1);
+
+    // A rendered frame shows all responses rendered by its present time. With frame generation the interpolated
+    // frame before it already shows half of the movement, that is when the response becomes visible.
+    int64_t iiRenderedBy = bGeneratedFrame ? iiPresentTime + m_iiFramePeriod : iiPresentTime;
+    int     iMoves       = 0;
+
+    for (auto it = m_pending.begin(); it != m_pending.end();)
+    {
+        if (it->iiResponseTime <= iiRenderedBy)
+        {
+            FLM_SYNTHETIC_INJECTION& injection = m_injections[it->injection];
+            if (injection.iiPresentTime == 0)
+            {
+                injection.iiPresentTime = iiPresentTime;
+                injection.fTrueMS       = (float)((iiPresentTime - injection.iiInjectTime) * 1000.0 / m_iiFreqCountPerSecond);
+            }
+
+            if (bGeneratedFrame)
+                ++it;  // Applied on the next rendered frame
+            else
+            {
+                iMoves++;
+                it = m_pending.erase(it);
+            }
+        }
+        else
+            ++it;
+    }
+
+    if (bGeneratedFrame)
+    {
+        // Moves done by the next rendered frame, an even number ends up where it started
+        for (const PENDING_RESPONSE& pending : m_pending)
+            if (pending.iiResponseTime <= iiRenderedBy)
+                iMoves++;
+        m_iPresentedScene = (iMoves & 1) ? 2 : m_iSceneState;
+    }
+    else
+    {
+        m_iSceneState     = (iMoves & 1) ? (1 - m_iSceneState) : m_iSceneState;
+        m_iPresentedScene = m_iSceneState;
+    }
+
+    m_iPresentedNoise   = (int)(m_iiVsyncCount % NOISE_COUNT);
+    m_iiPresentTime     = iiPresentTime;
+    m_iiPresentFrameIdx = m_iiVsyncCount;
+
+    SYNTHETIC_DEBUG_PRINT_GetFrame("%-38s frame %I64d scene %d\n", __FUNCTION__, m_iiVsyncCount, m_iPresentedScene);
+
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+    {
+        int64_t iiCPUTime = (((int64_t)kernelTime.dwHighDateTime << 32) | kernelTime.dwLowDateTime) +
+                            (((int64_t)userTime.dwHighDateTime << 32) | userTime.dwLowDateTime);
+        m_iiGeneratorCPUTime.store(iiCPUTime, std::memory_order_relaxed);
+    }
+
+    return FLM_STATUS::CAPTURE_PROCESS_FRAME;
+}
+
+bool FLM_Capture_Synthetic::GetConverterOutput(int64_t* pTimeStamp, int64_t* pFrameIdx)
+{
+    if ((m_bDoCaptureFrames == false) || (m_pixelData[m_iCurrentFrame].data == NULL))
+        return false;
+
+    FLM_PIXEL_DATA& pixelData = m_pixelData[m_iCurrentFrame];
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_iiPresentTime == 0)
+            return false;
+
+        FLM_Stage_Timer stageTimer(m_pStageTimings, FLM_STAGE::HOST_COPY);
+        memcpy(pixelData.data, m_scenes[m_iPresentedScene][m_iPresentedNoise].data(), (size_t)m_iImagePitch * m_iCaptureHeight);
+        pixelData.timestamp = m_iiPresentTime;
+    }
+
+    if (pTimeStamp)
+    {
+        *pTimeStamp = pixelData.timestamp;
+
+        UpdateAverageFrameTime(*pTimeStamp, m_iiPresentFrameIdx);
+
+        if (pFrameIdx)
+            *pFrameIdx = m_iiPresentFrameIdx;
+    }
+
+    m_iCurrentFrame = (m_iCurrentFrame == 0) ? 1 : 0;
+
+    return true;
+}
+
+bool FLM_Capture_Synthetic::GetSADInput(FLM_SAD_INPUT& input)
+{
+    if ((m_pixelData[0].timestamp == 0) || (m_pixelData[1].timestamp == 0))
+        return false;
+
+    // Same processing as the DXGI captures, which are also at full resolution
+    input.pData0              = m_pixelData[0].data;
+    input.pData1              = m_pixelData[1].data;
+    input.iWidth              = m_iCaptureWidth;
+    input.iHeight             = m_iCaptureHeight;
+    input.iPitch              = m_iImagePitch;
+    input.iFilmGrainThreshold = m_setting.iFilmGrainThreshold;
+    input.bAveraged4          = true;
+    input.bData1Latest        = (m_pixelData[1].timestamp > m_pixelData[0].timestamp);
+    return true;
+}
+
+int FLM_Capture_Synthetic::CalculateSAD()
+{
+    FLM_SAD_INPUT input;
+    if (GetSADInput(input) == false)
+        return 0;
+
+    return FlmCalculateSAD(input);
+}
+
+FLM_STATUS FLM_Capture_Synthetic::ReleaseFrameBuffer(FLM_PIXEL_DATA& pixelData)
+{
+    SYNTHETIC_DEBUG_PRINT_STACK();
+
+    if (pixelData.data)
+    {
+        delete[] pixelData.data;
+        pixelData.data = NULL;
+    }
+    return FLM_STATUS::OK;
+}
+
+bool FLM_Capture_Synthetic::InitContext(FLM_GPU_VENDOR_TYPE vendor)
+{
+    SYNTHETIC_DEBUG_PRINT_STACK();
+    return true;
+}
+
+void FLM_Capture_Synthetic::SaveCaptureSurface(uint32_t file_counter)
+{
+    SYNTHETIC_DEBUG_PRINT_STACK();
+    if (m_pixelData[m_iCurrentFrame].data != NULL)
+    {
+        char bmp_file_name[MAX_PATH];
+        if (file_counter == 0)
+            sprintf_s(bmp_file_name, "%s.bmp", m_setting.captureFileName.c_str());
+        else
+            sprintf_s(bmp_file_name, "%s_%03d.bmp", m_setting.captureFileName.c_str(), file_counter);
+        SaveAsBitmap(bmp_file_name, m_pixelData[m_iCurrentFrame], true);
+    }
+}
+
+int FLM_Capture_Synthetic::GetRefreshRate()
+{
+    return m_script.refreshRate;
+}
+
+unsigned int FLM_Capture_Synthetic::GetImageFormat()
+{
+    return SYNTHETIC_FORMAT_BGRA;
+}
+
+void FLM_Capture_Synthetic::Release()
+{
+    SYNTHETIC_DEBUG_PRINT_STACK();
+
+    m_bDoCaptureFrames = false;
+
+    for (int i = 0; i < 2; i++)
+        ReleaseFrameBuffer(m_pixelData[i]);
+}
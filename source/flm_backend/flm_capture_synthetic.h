@@ -0,0 +1,137 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_capture_synthetic.h
+/// @brief  FLM generated frame source with scripted input to photon latencies
+//=============================================================================
+
+#ifndef FLM_CAPTURE_SYNTHETIC_H
+#define FLM_CAPTURE_SYNTHETIC_H
+
+#include <Windows.h>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "flm.h"
+#include "flm_utils.h"
+#include "flm_capture_context.h"
+#include "flm_precision_sleeper.h"
+
+enum class FLM_SYNTHETIC_LATENCY
+{
+    FIXED,             // Every response after latencyMS
+    JITTER,            // latencyMS +- up to jitterMS, uniformly distributed
+    BIMODAL,           // latency2MS with probability probability, else latencyMS
+    FRAME_GENERATION,  // Game renders at half the refresh rate, every other frame is interpolated
+};
+
+struct FLM_SYNTHETIC_SCRIPT
+{
+    FLM_SYNTHETIC_LATENCY type        = FLM_SYNTHETIC_LATENCY::FIXED;
+    int                   refreshRate = 144;    // Virtual display refresh rate in Hz
+    float                 latencyMS   = 20.0f;  // Input to render latency of the simulated game, the display adds the wait for the next refresh
+    float                 jitterMS    = 0.0f;   // Added to every latency, uniformly distributed in +-jitterMS
+    float                 latency2MS  = 40.0f;  // Second mode of BIMODAL
+    float                 probability = 0.0f;   // Probability of latency2MS
+    uint32_t              seed        = 0x12345678;  // The latencies and the film grain are the same on every run
+};
+
+// One injected mouse move and what FLM measured for it
+struct FLM_SYNTHETIC_INJECTION
+{
+    int64_t iiInjectTime   = 0;      // QPC time stamp used by the pipeline for the latency
+    int64_t iiResponseTime = 0;      // QPC time the simulated game has rendered its response
+    int64_t iiPresentTime  = 0;      // QPC present time of the first frame showing the response, 0 until presented
+    float   fTrueMS        = 0.0f;   // iiPresentTime - iiInjectTime
+    float   fMeasuredMS    = 0.0f;
+    bool    bMeasured      = false;
+    bool    bCounted       = true;   // false for the moves returning the mouse while not measuring
+};
+
+//
+// Generates the capture region of a virtual display at the script refresh rate. Each injected
+// mouse move swaps the scene after the scripted latency, the exact present time of the response
+// is recorded so that the latencies FLM measures can be compared with the truth.
+//
+class FLM_Capture_Synthetic : public FLM_Capture_Context
+{
+public:
+    FLM_Capture_Synthetic(FLM_RUNTIME_OPTIONS* runtimeOptions, const FLM_SYNTHETIC_SCRIPT& script);
+    ~FLM_Capture_Synthetic();
+
+    FLM_STATUS   GetFrame();
+    FLM_STATUS   ReleaseFrameBuffer(FLM_PIXEL_DATA& pixelData);
+    FLM_STATUS   InitCaptureDevice(unsigned int MonitorToCapture, FLM_Timer_AMF* timer);
+    unsigned int GetImageFormat();
+    int          CalculateSAD();
+    bool         GetSADInput(FLM_SAD_INPUT& input);
+    bool         GetConverterOutput(int64_t* pTimeSmp, int64_t* pFrameIdx);
+    void         Release();
+    void         SaveCaptureSurface(uint32_t file_counter);
+    bool         InitContext(FLM_GPU_VENDOR_TYPE vendor);
+    int          GetRefreshRate();
+    FLM_STATUS   ResizeCaptureRegion();
+
+    // Called by the pipeline in place of sending the mouse move to the OS
+    void InjectInput(int64_t iiInjectTime, bool bCounted);
+
+    // Called by the pipeline for every measurement, iiInjectTime identifies the injection
+    void AddMeasurement(int64_t iiInjectTime, float fLatencyMS);
+
+    // Copy of all injections so far
+    std::vector<FLM_SYNTHETIC_INJECTION> GetInjections();
+
+    const FLM_SYNTHETIC_SCRIPT& GetScript() const { return m_script; }
+
+    // CPU time of the capture thread generating the frames in 100 ns units, it is not part of the FLM overhead
+    int64_t GetGeneratorCPUTime() const { return m_iiGeneratorCPUTime.load(std::memory_order_relaxed); }
+
+private:
+    enum
+    {
+        SCENE_COUNT = 3,  // Mouse at the left, at the right and the interpolated frame in between
+        NOISE_COUNT = 4,  // Film grain variations, cycled through on every frame
+    };
+
+    struct PENDING_RESPONSE
+    {
+        int64_t iiResponseTime;
+        size_t  injection;
+    };
+
+    float      NextLatencyMS();
+    void       GenerateScenes();
+    FLM_STATUS InitFrameBuffers();
+
+    FLM_SYNTHETIC_SCRIPT m_script;
+    int64_t              m_iiFreqCountPerSecond = 0;
+    int64_t              m_iiFramePeriod       = 0;  // QPC ticks per refresh
+    int64_t              m_iiStartTime         = 0;
+    int64_t              m_iiVsyncCount        = 0;
+    uint32_t             m_iRandomState        = 0;
+    std::atomic<int64_t> m_iiGeneratorCPUTime  = 0;
+
+    FLM_Precision_Sleeper m_sleeper;  // Paces the virtual display refreshes
+
+    std::vector<uint8_t> m_scenes[SCENE_COUNT][NOISE_COUNT];
+    int32_t              m_iImagePitch = 0;
+
+    // Shared by the capture thread, the mouse thread and Process()
+    std::mutex                           m_mutex;
+    std::vector<FLM_SYNTHETIC_INJECTION> m_injections;
+    std::vector<PENDING_RESPONSE>        m_pending;
+    int                                  m_iSceneState       = 0;  // Scene of the last rendered response, 0 or 1
+    int                                  m_iPresentedScene   = 0;
+    int                                  m_iPresentedNoise   = 0;
+    int64_t                              m_iiPresentTime     = 0;
+    int64_t                              m_iiPresentFrameIdx = 0;
+
+    FLM_PIXEL_DATA m_pixelData[2] = {};
+
+protected:
+    FLM_Capture_Synthetic();  // hide the default constructor
+};
+
+#endif
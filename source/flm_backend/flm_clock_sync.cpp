@@ -0,0 +1,168 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_clock_sync.cpp
+/// @brief  Continuous correlation of two clock domains
+//=============================================================================
+
+#include "flm_clock_sync.h"
+
+#include <algorithm>
+#include <math.h>
+
+FLM_Clock_Correlator::~FLM_Clock_Correlator()
+{
+    Stop();
+}
+
+void FLM_Clock_Correlator::Init(FLM_CLOCK_READ_FUNC pReadReference,
+                                void*               pReferenceContext,
+                                int64_t             iiReferenceTicksPerSecond,
+                                FLM_CLOCK_READ_FUNC pReadTarget,
+                                void*               pTargetContext,
+                                int64_t             iiTargetTicksPerSecond,
+                                int                 iSampleIntervalMS)
+{
+    m_pReadReference            = pReadReference;
+    m_pReferenceContext         = pReferenceContext;
+    m_pReadTarget               = pReadTarget;
+    m_pTargetContext            = pTargetContext;
+    m_iiReferenceTicksPerSecond = std::max<int64_t>(1, iiReferenceTicksPerSecond);
+    m_dNominalSlope             = double(m_iiReferenceTicksPerSecond) / double(std::max<int64_t>(1, iiTargetTicksPerSecond));
+    m_iSampleIntervalMS         = std::max<int>(10, iSampleIntervalMS);
+    m_iNumPairs                 = 0;
+    m_iWritePos                 = 0;
+    m_iRejectedInRow            = 0;
+    m_model.Store(FLM_CLOCK_MODEL());
+}
+
+bool FLM_Clock_Correlator::Start()
+{
+    if ((m_pReadReference == NULL) || (m_pReadTarget == NULL))
+        return false;
+
+    if (m_thread.IsRunning())
+        return true;
+
+    TakeSample();
+    return m_thread.Start([this](const FLM_Stop_Token& stop) { SamplingThreadFunction(stop); });
+}
+
+void FLM_Clock_Correlator::Stop()
+{
+    m_thread.Stop();
+}
+
+void FLM_Clock_Correlator::SamplingThreadFunction(const FLM_Stop_Token& stop)
+{
+    while (stop.SleepFor(m_iSampleIntervalMS))
+        TakeSample();
+}
+
+void FLM_Clock_Correlator::TakeSample()
+{
+    // The bracket with the smallest width has the least chance of a context switch or interrupt between the reads
+    int64_t iiBestRef       = 0;
+    int64_t iiBestTarget    = 0;
+    int64_t iiBestHalfWidth = INT64_MAX;
+
+    for (int i = 0; i < BURST_SIZE; i++)
+    {
+        int64_t iiRef0   = m_pReadReference(m_pReferenceContext);
+        int64_t iiTarget = m_pReadTarget(m_pTargetContext);
+        int64_t iiRef1   = m_pReadReference(m_pReferenceContext);
+
+        int64_t iiHalfWidth = (iiRef1 - iiRef0 + 1) / 2;
+        if ((iiRef1 >= iiRef0) && (iiHalfWidth < iiBestHalfWidth))
+        {
+            iiBestRef       = iiRef0 + iiHalfWidth;
+            iiBestTarget    = iiTarget;
+            iiBestHalfWidth = iiHalfWidth;
+        }
+    }
+
+    if (iiBestHalfWidth == INT64_MAX)
+        return;
+
+    // Drop samples that were disturbed for the whole burst, unless the system stays busy and wider brackets are all we get
+    if ((m_iNumPairs > 0) && (m_iRejectedInRow < MAX_REJECTED_IN_ROW))
+    {
+        int64_t iiMinHalfWidth = *std::min_element(m_iiHalfWidth, m_iiHalfWidth + m_iNumPairs);
+        if (iiBestHalfWidth > 4 * std::max<int64_t>(1, iiMinHalfWidth))
+        {
+            m_iRejectedInRow++;
+            return;
+        }
+    }
+    m_iRejectedInRow = 0;
+
+    m_iiRefTime[m_iWritePos]    = iiBestRef;
+    m_iiTargetTime[m_iWritePos] = iiBestTarget;
+    m_iiHalfWidth[m_iWritePos]  = iiBestHalfWidth;
+    m_iWritePos                 = (m_iWritePos + 1) % MAX_PAIRS;
+    m_iNumPairs                 = std::min<int>(m_iNumPairs + 1, MAX_PAIRS);
+
+    UpdateModel();
+}
+
+void FLM_Clock_Correlator::UpdateModel()
+{
+    // Fit relative to the latest pair, removing the nominal rate first, to keep the regression well conditioned
+    int     iLatest       = (m_iWritePos + MAX_PAIRS - 1) % MAX_PAIRS;
+    int64_t iiRefLast     = m_iiRefTime[iLatest];
+    int64_t iiTargetLast  = m_iiTargetTime[iLatest];
+    double  dSumX         = 0.0;
+    double  dSumY         = 0.0;
+    double  dSumXX        = 0.0;
+    double  dSumXY        = 0.0;
+    double  dSumHalfWidth = 0.0;
+
+    for (int i = 0; i < m_iNumPairs; i++)
+    {
+        double x = double(m_iiTargetTime[i] - iiTargetLast);
+        double y = double(m_iiRefTime[i] - iiRefLast) - m_dNominalSlope * x;
+        dSumX += x;
+        dSumY += y;
+        dSumXX += x * x;
+        dSumXY += x * y;
+        dSumHalfWidth += double(m_iiHalfWidth[i]);
+    }
+
+    double n      = double(m_iNumPairs);
+    double dDenom = n * dSumXX - dSumX * dSumX;
+    double b      = (dDenom > 0.0) ? (n * dSumXY - dSumX * dSumY) / dDenom : 0.0;
+    double a      = (dSumY - b * dSumX) / n;
+
+    double dSumResidual2 = 0.0;
+    for (int i = 0; i < m_iNumPairs; i++)
+    {
+        double x        = double(m_iiTargetTime[i] - iiTargetLast);
+        double y        = double(m_iiRefTime[i] - iiRefLast) - m_dNominalSlope * x;
+        double residual = y - (a + b * x);
+        dSumResidual2 += residual * residual;
+    }
+
+    double dTicksToUS = 1000000.0 / double(m_iiReferenceTicksPerSecond);
+
+    FLM_CLOCK_MODEL model;
+    model.refBase       = iiRefLast + (int64_t)llround(a);
+    model.targetBase    = iiTargetLast;
+    model.slope         = m_dNominalSlope + b;
+    model.driftPPM      = b / m_dNominalSlope * 1000000.0;
+    model.residualUS    = sqrt(dSumResidual2 / n) * dTicksToUS;
+    model.uncertaintyUS = dSumHalfWidth / n * dTicksToUS;
+    model.numPairs      = m_iNumPairs;
+
+    m_model.Store(model);
+}
+
+int64_t FLM_Clock_Correlator::TranslateToReference(int64_t iiTargetTime) const
+{
+    FLM_CLOCK_MODEL model = m_model.Load();
+    return model.refBase + (int64_t)llround(model.slope * double(iiTargetTime - model.targetBase));
+}
+
+FLM_CLOCK_MODEL FLM_Clock_Correlator::GetModel() const
+{
+    return m_model.Load();
+}
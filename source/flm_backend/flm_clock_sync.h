@@ -0,0 +1,82 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_clock_sync.h
+/// @brief  Continuous correlation of two clock domains
+//=============================================================================
+
+#ifndef FLM_CLOCK_SYNC_H
+#define FLM_CLOCK_SYNC_H
+
+#include <Windows.h>
+#include <stdint.h>
+
+#include "flm_seqlock.h"
+#include "flm_thread.h"
+
+typedef int64_t (*FLM_CLOCK_READ_FUNC)(void* pContext);
+
+// Maps target clock time to reference clock time:
+//   reference = refBase + slope * (target - targetBase)
+struct FLM_CLOCK_MODEL
+{
+    int64_t refBase       = 0;
+    int64_t targetBase    = 0;
+    double  slope         = 1.0;  // Reference ticks per target tick
+    double  driftPPM      = 0.0;  // Deviation of slope from the nominal frequency ratio
+    double  residualUS    = 0.0;  // RMS error of the sample pairs against the fitted model
+    double  uncertaintyUS = 0.0;  // Average half width of the reference reads bracketing each target read
+    int     numPairs      = 0;    // 0 if no samples have been taken yet
+};
+
+// Tracks offset and skew between a reference clock and a target clock.
+// A background thread periodically reads the target clock bracketed by two reference clock reads, keeps the tightest
+// bracket of each burst and fits offset and skew over a sliding window of pairs by linear regression.
+// The fitted model is published through a sequence lock so translations never block on the sampling thread.
+class FLM_Clock_Correlator
+{
+public:
+    ~FLM_Clock_Correlator();
+
+    void Init(FLM_CLOCK_READ_FUNC pReadReference,
+              void*               pReferenceContext,
+              int64_t             iiReferenceTicksPerSecond,
+              FLM_CLOCK_READ_FUNC pReadTarget,
+              void*               pTargetContext,
+              int64_t             iiTargetTicksPerSecond,
+              int                 iSampleIntervalMS = 1000);
+    bool Start();  // Takes the first sample and starts the sampling thread
+    void Stop();
+    void TakeSample();
+
+    int64_t         TranslateToReference(int64_t iiTargetTime) const;
+    FLM_CLOCK_MODEL GetModel() const;
+
+private:
+    void SamplingThreadFunction(const FLM_Stop_Token& stop);
+    void UpdateModel();
+
+    static const int BURST_SIZE          = 16;  // Bracketed reads per sample, the tightest one is kept
+    static const int MAX_PAIRS           = 64;  // Sliding window used for the fit
+    static const int MAX_REJECTED_IN_ROW = 3;   // Accept a wide bracket after this many rejected samples
+
+    FLM_CLOCK_READ_FUNC m_pReadReference            = NULL;
+    void*               m_pReferenceContext         = NULL;
+    FLM_CLOCK_READ_FUNC m_pReadTarget               = NULL;
+    void*               m_pTargetContext            = NULL;
+    int64_t             m_iiReferenceTicksPerSecond = 1;
+    double              m_dNominalSlope             = 1.0;
+    int                 m_iSampleIntervalMS         = 1000;
+
+    int64_t m_iiRefTime[MAX_PAIRS]    = {};
+    int64_t m_iiTargetTime[MAX_PAIRS] = {};
+    int64_t m_iiHalfWidth[MAX_PAIRS]  = {};
+    int     m_iNumPairs               = 0;
+    int     m_iWritePos               = 0;
+    int     m_iRejectedInRow          = 0;
+
+    FLM_SeqLock<FLM_CLOCK_MODEL> m_model;
+    FLM_Thread                   m_thread;
+};
+
+#endif
@@ -0,0 +1,171 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_detection.cpp
+/// @brief  State machine that decides which detected motion measures an input event
+//=============================================================================
+
+#include "flm_detection.h"
+
+const char* FlmGetDetectionStateName(FLM_DETECTION_STATE state)
+{
+    switch (state)
+    {
+    case FLM_DETECTION_STATE::IDLE:
+        return "idle";
+    case FLM_DETECTION_STATE::SETTLING:
+        return "settling";
+    case FLM_DETECTION_STATE::ARMED:
+        return "armed";
+    case FLM_DETECTION_STATE::INJECTED:
+        return "injected";
+    case FLM_DETECTION_STATE::DETECTED:
+        return "detected";
+    default:
+        return "unknown";
+    }
+}
+
+const char* FlmGetDetectionEventName(FLM_DETECTION_EVENT event)
+{
+    switch (event)
+    {
+    case FLM_DETECTION_EVENT::START:
+        return "start";
+    case FLM_DETECTION_EVENT::STOP:
+        return "stop";
+    case FLM_DETECTION_EVENT::INJECT:
+        return "inject";
+    case FLM_DETECTION_EVENT::MOTION:
+        return "motion";
+    case FLM_DETECTION_EVENT::STILL:
+        return "still";
+    default:
+        return "unknown";
+    }
+}
+
+enum class FLM_DETECTION_GUARD
+{
+    ALWAYS,
+    SETTLED,    // At least settleFrames frames without motion, counting a still frame being processed
+    UNSETTLED,
+    WARMUP,     // Warm-up detections are left
+};
+
+struct FLM_DETECTION_RULE
+{
+    FLM_DETECTION_STATE  state;  // COUNT matches any state but IDLE
+    FLM_DETECTION_EVENT  event;
+    FLM_DETECTION_GUARD  guard;
+    FLM_DETECTION_STATE  next;
+    FLM_DETECTION_ACTION action;
+    const char*          reason;
+};
+
+using S = FLM_DETECTION_STATE;
+using E = FLM_DETECTION_EVENT;
+using G = FLM_DETECTION_GUARD;
+using A = FLM_DETECTION_ACTION;
+
+// In order of precedence, the first row that matches is taken
+static const FLM_DETECTION_RULE g_detectionRules[] = {
+    {S::COUNT,    E::STOP,   G::ALWAYS,    S::IDLE,     A::NONE,    "measurements stopped"},
+    {S::IDLE,     E::START,  G::ALWAYS,    S::SETTLING, A::NONE,    "measurements started"},
+
+    {S::SETTLING, E::STILL,  G::SETTLED,   S::ARMED,    A::NONE,    "scene settled"},
+    {S::SETTLING, E::INJECT, G::ALWAYS,    S::INJECTED, A::NONE,    "input injected while settling"},
+
+    {S::ARMED,    E::INJECT, G::ALWAYS,    S::INJECTED, A::NONE,    "input injected"},
+    {S::ARMED,    E::MOTION, G::ALWAYS,    S::SETTLING, A::NONE,    "motion without input"},
+
+    {S::INJECTED, E::INJECT, G::ALWAYS,    S::INJECTED, A::NONE,    "input injected again before its motion"},
+    {S::INJECTED, E::MOTION, G::UNSETTLED, S::INJECTED, A::NONE,    "motion before the scene settled, motion blur"},
+    {S::INJECTED, E::MOTION, G::WARMUP,    S::DETECTED, A::SKIP,    "warm-up detection skipped"},
+    {S::INJECTED, E::MOTION, G::ALWAYS,    S::DETECTED, A::MEASURE, "motion after input"},
+
+    {S::DETECTED, E::STILL,  G::SETTLED,   S::ARMED,    A::NONE,    "scene settled"},
+    {S::DETECTED, E::STILL,  G::ALWAYS,    S::SETTLING, A::NONE,    "waiting for more frames without motion"},
+    {S::DETECTED, E::MOTION, G::ALWAYS,    S::SETTLING, A::NONE,    "motion continues after the detection"},
+    {S::DETECTED, E::INJECT, G::ALWAYS,    S::INJECTED, A::NONE,    "input injected right after the detection"},
+};
+
+FLM_DETECTION_ACTION FLM_Detection_State_Machine::Dispatch(FLM_DETECTION_EVENT event, int64_t iiFrameIdx, int64_t iiInjectTime)
+{
+    for (const FLM_DETECTION_RULE& rule : g_detectionRules)
+    {
+        if (rule.event != event)
+            continue;
+        if ((rule.state == S::COUNT) ? (m_state == S::IDLE) : (rule.state != m_state))
+            continue;
+
+        bool bSettled = (m_iStillFrames >= m_settings.settleFrames);
+        if (((rule.guard == G::SETTLED) && (bSettled == false)) || ((rule.guard == G::UNSETTLED) && bSettled) ||
+            ((rule.guard == G::WARMUP) && (m_iWarmupLeft <= 0)))
+            continue;
+
+        // An input event is waited for once a row takes it
+        if (event == E::INJECT)
+            m_iiInjectTime = iiInjectTime;
+
+        FLM_DETECTION_TRANSITION& transition = m_history[m_iTransitionCount & (FLM_DETECTION_HISTORY - 1)];
+        transition.iiFrameIdx   = iiFrameIdx;
+        transition.iiInjectTime = m_iiInjectTime;
+        transition.from         = m_state;
+        transition.to           = rule.next;
+        transition.event        = event;
+        transition.reason       = rule.reason;
+        m_iTransitionCount++;
+
+        m_state = rule.next;
+        if (rule.action == A::SKIP)
+            m_iWarmupLeft--;
+        if ((rule.action == A::SKIP) || (rule.action == A::MEASURE))
+        {
+            m_iiDetectedTime = m_iiInjectTime;
+            m_iiInjectTime   = 0;
+        }
+        if (m_state == S::IDLE)
+            m_iiInjectTime = 0;
+        return rule.action;
+    }
+    return A::NONE;
+}
+
+void FLM_Detection_State_Machine::SetSession(int iSession, const FLM_DETECTION_SETTINGS& settings, int64_t iiFrameIdx)
+{
+    if (iSession == m_iSession)
+        return;
+    m_iSession = iSession;
+
+    Dispatch(E::STOP, iiFrameIdx);
+    if (iSession == 0)
+        return;
+
+    m_settings     = settings;
+    m_iStillFrames = 0;
+    m_iWarmupLeft  = settings.warmupDetections;
+    Dispatch(E::START, iiFrameIdx);
+}
+
+void FLM_Detection_State_Machine::Inject(int64_t iiInjectTime, int64_t iiFrameIdx)
+{
+    if ((iiInjectTime == 0) || (iiInjectTime == m_iiLastInject))
+        return;
+    m_iiLastInject = iiInjectTime;
+    Dispatch(E::INJECT, iiFrameIdx, iiInjectTime);
+}
+
+FLM_DETECTION_ACTION FLM_Detection_State_Machine::Frame(bool bMotion, int64_t iiFrameIdx)
+{
+    if (bMotion)
+    {
+        FLM_DETECTION_ACTION action = Dispatch(E::MOTION, iiFrameIdx);
+        m_iStillFrames              = 0;
+        return action;
+    }
+
+    if (m_iStillFrames < (1 << 30))
+        m_iStillFrames++;
+    return Dispatch(E::STILL, iiFrameIdx);
+}
@@ -0,0 +1,108 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_detection.h
+/// @brief  State machine that decides which detected motion measures an input event
+//=============================================================================
+
+#ifndef FLM_DETECTION_H
+#define FLM_DETECTION_H
+
+#include <stdint.h>
+
+#define FLM_DETECTION_HISTORY 64  // Power of 2, transitions kept for GetTransition()
+
+enum class FLM_DETECTION_STATE
+{
+    IDLE,      // Not measuring
+    SETTLING,  // Waiting for frames without motion
+    ARMED,     // The scene is still, waiting for an input event
+    INJECTED,  // An input event is waiting for its motion
+    DETECTED,  // The frame just processed showed the motion of the input event
+    COUNT
+};
+
+enum class FLM_DETECTION_EVENT
+{
+    START,   // A measurement session started
+    STOP,    // The session stopped
+    INJECT,  // A new input event
+    MOTION,  // A captured frame with motion
+    STILL,   // A captured frame without motion
+    COUNT
+};
+
+enum class FLM_DETECTION_ACTION
+{
+    NONE,
+    SKIP,     // A detection that is not measured, the input thread continues as for a measurement
+    MEASURE,  // The frame measures the latency of the input event
+};
+
+// Hysteresis of one trigger type
+struct FLM_DETECTION_SETTINGS
+{
+    int settleFrames     = 1;  // Frames without motion before a motion is detected, 0 detects every motion
+    int warmupDetections = 1;  // Detections at the start of a session that are skipped
+};
+
+struct FLM_DETECTION_TRANSITION
+{
+    int64_t             iiFrameIdx   = 0;
+    int64_t             iiInjectTime = 0;  // Input event the machine waited for, 0 if none
+    FLM_DETECTION_STATE from         = FLM_DETECTION_STATE::IDLE;
+    FLM_DETECTION_STATE to           = FLM_DETECTION_STATE::IDLE;
+    FLM_DETECTION_EVENT event        = FLM_DETECTION_EVENT::START;
+    const char*         reason       = "";  // String literal of the transition table
+};
+
+const char* FlmGetDetectionStateName(FLM_DETECTION_STATE state);
+const char* FlmGetDetectionEventName(FLM_DETECTION_EVENT event);
+
+//
+// Detection of the motion caused by an input event: idle -> settling -> armed -> injected -> detected -> settling.
+// The transitions are a table of state, event and guard, the first matching row is taken and recorded with its
+// reason. Events without a matching row are ignored. The guards are the hysteresis: a motion only measures after
+// settleFrames frames without motion, so motion blur and the tail of an animation do not measure the next input event,
+// and the first warmupDetections detections of a session are skipped.
+//
+// The machine has no system dependencies and is driven from a single thread, the other threads publish session
+// and input event values that are passed in, so recorded frame sequences can be replayed through it.
+//
+class FLM_Detection_State_Machine
+{
+public:
+    // iSession is 0 while not measuring, a new value stops the current session and starts a new one
+    void SetSession(int iSession, const FLM_DETECTION_SETTINGS& settings, int64_t iiFrameIdx);
+
+    // Input event at iiInjectTime, 0 and repeated values are ignored
+    void Inject(int64_t iiInjectTime, int64_t iiFrameIdx);
+
+    // A captured frame, bMotion when its SAD is above the threshold
+    FLM_DETECTION_ACTION Frame(bool bMotion, int64_t iiFrameIdx);
+
+    FLM_DETECTION_STATE GetState() const { return m_state; }
+    int64_t             GetInjectTime() const { return m_iiInjectTime; }          // Waiting for its motion, else 0
+    int64_t             GetDetectedInjectTime() const { return m_iiDetectedTime; }  // Of the latest detection
+
+    // Every transition since the start, only the latest FLM_DETECTION_HISTORY can be read
+    uint64_t                        GetTransitionCount() const { return m_iTransitionCount; }
+    const FLM_DETECTION_TRANSITION& GetTransition(uint64_t index) const { return m_history[index & (FLM_DETECTION_HISTORY - 1)]; }
+
+private:
+    FLM_DETECTION_ACTION Dispatch(FLM_DETECTION_EVENT event, int64_t iiFrameIdx, int64_t iiInjectTime = 0);
+
+    FLM_DETECTION_SETTINGS m_settings;
+    FLM_DETECTION_STATE    m_state            = FLM_DETECTION_STATE::IDLE;
+    int                    m_iSession         = 0;
+    int                    m_iStillFrames     = 0;
+    int                    m_iWarmupLeft      = 0;
+    int64_t                m_iiLastInject     = 0;  // Latest value passed to Inject()
+    int64_t                m_iiInjectTime     = 0;
+    int64_t                m_iiDetectedTime   = 0;
+
+    FLM_DETECTION_TRANSITION m_history[FLM_DETECTION_HISTORY];
+    uint64_t                 m_iTransitionCount = 0;
+};
+
+#endif
@@ -0,0 +1,362 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_event_stream.cpp
+/// @brief  Newline delimited JSON event output for live monitoring
+//=============================================================================
+
+#include "flm_event_stream.h"
+#include "flm_utils.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------------------
+// FLM_Json_Line
+//------------------------------------------------------------------------------------------
+
+void FLM_Json_Line::Begin(const char* eventName)
+{
+    m_iLength    = 0;
+    m_iRoom      = FLM_JSON_LINE_SIZE - FLM_JSON_LINE_RESERVED;
+    m_bTruncated = false;
+
+    // Wall clock time in milliseconds since 1970, so events can be lined up with other tools
+    FILETIME fileTime;
+    GetSystemTimePreciseAsFileTime(&fileTime);
+    int64_t iiTime = ((int64_t(fileTime.dwHighDateTime) << 32) | fileTime.dwLowDateTime) - 116444736000000000LL;
+
+    Append("{", 1);
+    Add("event", eventName);
+    Add("t", (double)iiTime / 10000.0, 3);
+}
+
+void FLM_Json_Line::Key(const char* key)
+{
+    AppendFormat(",\"%s\":", key);
+}
+
+// A key without its complete value would not be valid JSON, the whole value is removed
+void FLM_Json_Line::Rollback(int iStart)
+{
+    if (m_bTruncated)
+        m_iLength = iStart;
+}
+
+void FLM_Json_Line::Add(const char* key, const char* value)
+{
+    int iStart = m_iLength;
+    if (m_iLength > 1)
+        Append(",", 1);
+    AppendFormat("\"%s\":\"", key);
+    AppendEscaped(value);
+    Append("\"", 1);
+    Rollback(iStart);
+}
+
+void FLM_Json_Line::Add(const char* key, int64_t value)
+{
+    int iStart = m_iLength;
+    Key(key);
+    AppendFormat("%lld", (long long)value);
+    Rollback(iStart);
+}
+
+void FLM_Json_Line::Add(const char* key, double value, int precision)
+{
+    int iStart = m_iLength;
+    Key(key);
+    if (value != value)  // JSON has no NaN
+        Append("null", 4);
+    else
+        AppendFormat("%.*f", precision, value);
+    Rollback(iStart);
+}
+
+void FLM_Json_Line::Add(const char* key, bool value)
+{
+    int iStart = m_iLength;
+    Key(key);
+    if (value)
+        Append("true", 4);
+    else
+        Append("false", 5);
+    Rollback(iStart);
+}
+
+void FLM_Json_Line::AddArray(const char* key, const float* values, int count, int precision)
+{
+    int iStart = m_iLength;
+    Key(key);
+    Append("[", 1);
+    for (int i = 0; i < count; i++)
+        AppendFormat((i == 0) ? "%.*f" : ",%.*f", precision, values[i]);
+    Append("]", 1);
+    Rollback(iStart);
+}
+
+void FLM_Json_Line::AddObject(const char* key, const FLM_Session_Metadata& metadata)
+{
+    int iStart = m_iLength;
+    Key(key);
+    Append("{", 1);
+
+    bool bFirst = true;
+    for (const std::pair<std::string, std::string>& entry : metadata.Entries())
+    {
+        if (!bFirst)
+            Append(",", 1);
+        bFirst = false;
+        Append("\"", 1);
+        AppendEscaped(entry.first.c_str());
+        Append("\":\"", 3);
+        AppendEscaped(entry.second.c_str());
+        Append("\"", 1);
+    }
+    Append("}", 1);
+    Rollback(iStart);
+}
+
+void FLM_Json_Line::End()
+{
+    // Room for these characters is never used by the Add functions
+    if (m_bTruncated)
+    {
+        static const char truncated[] = ",\"truncated\":true";
+        int               iSkip       = (m_iLength > 1) ? 0 : 1;  // No comma after the opening brace
+        memcpy(m_buffer + m_iLength, truncated + iSkip, sizeof(truncated) - 1 - iSkip);
+        m_iLength += sizeof(truncated) - 1 - iSkip;
+    }
+    m_buffer[m_iLength++] = '}';
+    m_buffer[m_iLength++] = '\n';
+}
+
+void FLM_Json_Line::Append(const char* str, int length)
+{
+    if (m_bTruncated)
+        return;
+    if (m_iLength + length > m_iRoom)
+    {
+        m_bTruncated = true;
+        return;
+    }
+
+    memcpy(m_buffer + m_iLength, str, length);
+    m_iLength += length;
+}
+
+void FLM_Json_Line::AppendEscaped(const char* str)
+{
+    for (; *str; str++)
+    {
+        char c = *str;
+        if ((c == '"') || (c == '\\'))
+        {
+            char escaped[2] = {'\\', c};
+            Append(escaped, 2);
+        }
+        else if ((unsigned char)c < 0x20)
+            AppendFormat("\\u%04x", (unsigned char)c);
+        else
+            Append(&c, 1);
+    }
+}
+
+void FLM_Json_Line::AppendFormat(const char* format, ...)
+{
+    char    buff[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buff, sizeof(buff), format, args);
+    va_end(args);
+
+    if (length >= (int)sizeof(buff))
+        m_bTruncated = true;
+    else
+    if (length > 0)
+        Append(buff, length);
+}
+
+//------------------------------------------------------------------------------------------
+// FLM_Event_Stream
+//------------------------------------------------------------------------------------------
+
+FLM_Event_Stream::FLM_Event_Stream()
+{
+    InitializeCriticalSection(&m_lock);
+}
+
+FLM_Event_Stream::~FLM_Event_Stream()
+{
+    Close();
+    DeleteCriticalSection(&m_lock);
+}
+
+bool FLM_Event_Stream::Open(const char* path)
+{
+    Close();
+
+    // A named pipe must already be created by the reader, a file is created or truncated
+    bool bPipe = (_strnicmp(path, "\\\\.\\pipe\\", 9) == 0);
+
+    HANDLE hFile = CreateFileA(path, GENERIC_WRITE, FILE_SHARE_READ, NULL, bPipe ? OPEN_EXISTING : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        FlmPrint("Warning: Unable to open event stream %s\n", path);
+        return false;
+    }
+
+    EnterCriticalSection(&m_lock);
+    m_hFile = hFile;
+    LeaveCriticalSection(&m_lock);
+    return true;
+}
+
+void FLM_Event_Stream::Close()
+{
+    EnterCriticalSection(&m_lock);
+    if (m_hFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_hFile);
+        m_hFile = INVALID_HANDLE_VALUE;
+    }
+    LeaveCriticalSection(&m_lock);
+}
+
+void FLM_Event_Stream::Write(FLM_Json_Line& line)
+{
+    line.End();
+
+    EnterCriticalSection(&m_lock);
+    if (m_hFile != INVALID_HANDLE_VALUE)
+    {
+        DWORD dwWritten = 0;
+        if (WriteFile(m_hFile, line.GetBuffer(), (DWORD)line.GetLength(), &dwWritten, NULL) == FALSE)
+        {
+            // Reader went away, stop streaming rather than failing on every event
+            CloseHandle(m_hFile);
+            m_hFile = INVALID_HANDLE_VALUE;
+        }
+    }
+    LeaveCriticalSection(&m_lock);
+}
+
+void FLM_Event_Stream::WriteSessionStart(const char* codec, const char* mouseEventType, int refreshRate, bool frameGeneration, const FLM_Session_Metadata& metadata)
+{
+    FLM_Json_Line line;
+    line.Begin("start");
+    line.Add("codec", codec);
+    line.Add("mouse_event", mouseEventType);
+    line.Add("refresh_hz", refreshRate);
+    line.Add("frame_generation", frameGeneration);
+    line.AddObject("metadata", metadata);
+    Write(line);
+}
+
+void FLM_Event_Stream::WriteSessionStop(int numMeasurements, const FLM_TELEMETRY_DATA& telemetry)
+{
+    FLM_Json_Line line;
+    line.Begin("stop");
+    line.Add("measurements", numMeasurements);
+    line.Add("acc_latency_ms", (double)telemetry.accLatency);
+    line.Add("acc_frames", (double)telemetry.accFrames);
+    line.Add("acc_fps", (double)telemetry.accFps, 1);
+    Write(line);
+}
+
+void FLM_Event_Stream::WriteMeasurement(int index, float latencyMS, float frames, float fps, int64_t frameIdx, int64_t presentTime)
+{
+    FLM_Json_Line line;
+    line.Begin("measurement");
+    line.Add("index", index);
+    line.Add("latency_ms", (double)latencyMS);
+    line.Add("frames", (double)frames, 2);
+    line.Add("fps", (double)fps, 1);
+    line.Add("frame_idx", frameIdx);
+    line.Add("present_time", presentTime);
+    Write(line);
+}
+
+void FLM_Event_Stream::WriteRegionMeasurement(const char* region, int index, float latencyMS, int64_t frameIdx, int64_t presentTime)
+{
+    FLM_Json_Line line;
+    line.Begin("region_measurement");
+    line.Add("region", region);
+    line.Add("index", index);
+    line.Add("latency_ms", (double)latencyMS);
+    line.Add("frame_idx", frameIdx);
+    line.Add("present_time", presentTime);
+    Write(line);
+}
+
+void FLM_Event_Stream::WriteOutputMeasurement(int output, int index, float latencyMS, int64_t frameIdx, int64_t presentTime)
+{
+    FLM_Json_Line line;
+    line.Begin("output_measurement");
+    line.Add("output", output);
+    line.Add("index", index);
+    line.Add("latency_ms", (double)latencyMS);
+    line.Add("frame_idx", frameIdx);
+    line.Add("present_time", presentTime);
+    Write(line);
+}
+
+void FLM_Event_Stream::WriteRow(const FLM_TELEMETRY_DATA& telemetry)
+{
+    FLM_Json_Line line;
+    line.Begin("row");
+    line.Add("fps", (double)telemetry.fps, 1);
+    line.Add("fps_odd", (double)telemetry.fpsOdd, 1);
+    line.Add("fps_even", (double)telemetry.fpsEven, 1);
+    line.Add("latency_ms", (double)telemetry.rowLatency);
+    line.Add("frames", (double)telemetry.rowFrames, 2);
+    line.Add("acc_latency_ms", (double)telemetry.accLatency);
+    line.Add("acc_frames", (double)telemetry.accFrames, 2);
+    line.AddArray("latencies_ms", telemetry.lMeasurementMS.data(), (int)telemetry.lMeasurementMS.size());
+    Write(line);
+}
+
+void FLM_Event_Stream::WriteRebuild(bool success)
+{
+    FLM_Json_Line line;
+    line.Begin("rebuild");
+    line.Add("success", success);
+    Write(line);
+}
+
+void FLM_Event_Stream::WriteRegionChange(int x, int y, int width, int height, float elapsedMS)
+{
+    FLM_Json_Line line;
+    line.Begin("region_change");
+    line.Add("x", x);
+    line.Add("y", y);
+    line.Add("width", width);
+    line.Add("height", height);
+    line.Add("elapsed_ms", (double)elapsedMS);
+    Write(line);
+}
+
+void FLM_Event_Stream::WriteTimeout(int64_t injectTime, int waitedMS)
+{
+    FLM_Json_Line line;
+    line.Begin("timeout");
+    line.Add("inject_time", injectTime);
+    line.Add("waited_ms", waitedMS);
+    Write(line);
+}
+
+void FLM_Event_Stream::WriteDetection(const char* source, const char* from, const char* to, const char* event, const char* reason, int64_t frameIdx,
+                                      int64_t injectTime)
+{
+    FLM_Json_Line line;
+    line.Begin("detection");
+    line.Add("source", source);
+    line.Add("from", from);
+    line.Add("to", to);
+    line.Add("event", event);
+    line.Add("reason", reason);
+    line.Add("frame_idx", frameIdx);
+    line.Add("inject_time", injectTime);
+    Write(line);
+}
@@ -0,0 +1,82 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_event_stream.h
+/// @brief  Newline delimited JSON event output for live monitoring
+//=============================================================================
+
+#ifndef FLM_EVENT_STREAM_H
+#define FLM_EVENT_STREAM_H
+
+#include <Windows.h>
+#include <stdint.h>
+
+#include "flm.h"
+#include "flm_session_metadata.h"
+
+#define FLM_JSON_LINE_SIZE     8192
+#define FLM_JSON_LINE_RESERVED 19  // ,"truncated":true}\n
+
+// Formats a single JSON object into a fixed size buffer, no heap allocations.
+// A value that does not fit is dropped whole with every value after it, and the object is closed with "truncated":true.
+class FLM_Json_Line
+{
+public:
+    void Begin(const char* eventName);
+    void Add(const char* key, const char* value);
+    void Add(const char* key, int64_t value);
+    void Add(const char* key, int value) { Add(key, (int64_t)value); }
+    void Add(const char* key, double value, int precision = 3);
+    void Add(const char* key, bool value);
+    void AddArray(const char* key, const float* values, int count, int precision = 1);
+    void AddObject(const char* key, const FLM_Session_Metadata& metadata);  // Values are written as strings
+    void End();
+
+    const char* GetBuffer() const { return m_buffer; }
+    int         GetLength() const { return m_iLength; }
+
+private:
+    void Key(const char* key);
+    void Rollback(int iStart);
+    void Append(const char* str, int length);
+    void AppendEscaped(const char* str);
+    void AppendFormat(const char* format, ...);
+
+    char m_buffer[FLM_JSON_LINE_SIZE];
+    int  m_iLength    = 0;
+    int  m_iRoom      = FLM_JSON_LINE_SIZE - FLM_JSON_LINE_RESERVED;  // Space for the closing of a truncated line is always reserved
+    bool m_bTruncated = false;
+};
+
+// Writes one JSON object per line to a file or to a named pipe (\\.\pipe\name) created by the reader.
+// Every line is written with a single WriteFile so readers tailing the output only ever see complete lines.
+// Events may be written from any pipeline thread.
+class FLM_Event_Stream
+{
+public:
+    FLM_Event_Stream();
+    ~FLM_Event_Stream();
+
+    bool Open(const char* path);
+    void Close();
+    bool IsOpen() const { return m_hFile != INVALID_HANDLE_VALUE; }
+
+    void WriteSessionStart(const char* codec, const char* mouseEventType, int refreshRate, bool frameGeneration, const FLM_Session_Metadata& metadata);
+    void WriteSessionStop(int numMeasurements, const FLM_TELEMETRY_DATA& telemetry);
+    void WriteMeasurement(int index, float latencyMS, float frames, float fps, int64_t frameIdx, int64_t presentTime);
+    void WriteRegionMeasurement(const char* region, int index, float latencyMS, int64_t frameIdx, int64_t presentTime);
+    void WriteOutputMeasurement(int output, int index, float latencyMS, int64_t frameIdx, int64_t presentTime);
+    void WriteRow(const FLM_TELEMETRY_DATA& telemetry);
+    void WriteRebuild(bool success);
+    void WriteRegionChange(int x, int y, int width, int height, float elapsedMS);
+    void WriteTimeout(int64_t injectTime, int waitedMS);
+    void WriteDetection(const char* source, const char* from, const char* to, const char* event, const char* reason, int64_t frameIdx, int64_t injectTime);
+
+private:
+    void Write(FLM_Json_Line& line);
+
+    HANDLE           m_hFile = INVALID_HANDLE_VALUE;
+    CRITICAL_SECTION m_lock;
+};
+
+#endif
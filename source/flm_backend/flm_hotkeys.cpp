@@ -0,0 +1,120 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_hotkeys.cpp
+/// @brief  Matches registered key combinations against a stream of key transitions
+//=============================================================================
+
+#include "flm_hotkeys.h"
+
+// Windows virtual key codes of the modifiers, VK_SHIFT, VK_LSHIFT, VK_RSHIFT and so on
+#define FLM_VK_SHIFT     0x10
+#define FLM_VK_CONTROL   0x11
+#define FLM_VK_MENU      0x12
+#define FLM_VK_LSHIFT    0xA0
+#define FLM_VK_RSHIFT    0xA1
+#define FLM_VK_LCONTROL  0xA2
+#define FLM_VK_RCONTROL  0xA3
+#define FLM_VK_LMENU     0xA4
+#define FLM_VK_RMENU     0xA5
+
+int FLM_Hotkey_Matcher::Register(const uint8_t keys[FLM_HOTKEY_KEYS])
+{
+    bool bAnyKey = false;
+    for (int k = 0; k < FLM_HOTKEY_KEYS; k++)
+        bAnyKey |= (keys[k] != 0);
+    if (bAnyKey == false)
+        return -1;
+
+    for (int id = 0; id < m_iCombinationCount; id++)
+    {
+        bool bSame = true;
+        for (int k = 0; k < FLM_HOTKEY_KEYS; k++)
+            bSame &= (m_combination[id][k] == keys[k]);
+        if (bSame)
+            return id;
+    }
+
+    if (m_iCombinationCount >= FLM_HOTKEY_MAX_COMBINATIONS)
+        return -1;
+
+    int id = m_iCombinationCount++;
+    for (int k = 0; k < FLM_HOTKEY_KEYS; k++)
+        m_combination[id][k] = keys[k];
+
+    if (IsCombinationDown(id))
+        m_iPressedMask |= (1u << id);  // Keys held while registering do not fire
+    return id;
+}
+
+void FLM_Hotkey_Matcher::Clear()
+{
+    m_iCombinationCount = 0;
+    m_iPressedMask      = 0;
+}
+
+bool FLM_Hotkey_Matcher::IsKeyDown(uint8_t vkCode) const
+{
+    switch (vkCode)
+    {
+    case FLM_VK_SHIFT:   return m_bKeyDown[FLM_VK_SHIFT] || m_bKeyDown[FLM_VK_LSHIFT] || m_bKeyDown[FLM_VK_RSHIFT];
+    case FLM_VK_CONTROL: return m_bKeyDown[FLM_VK_CONTROL] || m_bKeyDown[FLM_VK_LCONTROL] || m_bKeyDown[FLM_VK_RCONTROL];
+    case FLM_VK_MENU:    return m_bKeyDown[FLM_VK_MENU] || m_bKeyDown[FLM_VK_LMENU] || m_bKeyDown[FLM_VK_RMENU];
+    }
+    return m_bKeyDown[vkCode];
+}
+
+bool FLM_Hotkey_Matcher::IsCombinationDown(int id) const
+{
+    for (int k = 0; k < FLM_HOTKEY_KEYS; k++)
+    {
+        if ((m_combination[id][k] != 0) && (IsKeyDown(m_combination[id][k]) == false))
+            return false;
+    }
+    return true;
+}
+
+uint32_t FLM_Hotkey_Matcher::OnKey(uint8_t vkCode, bool bDown)
+{
+    // Auto repeat sends key downs without key ups in between
+    if (m_bKeyDown[vkCode] == bDown)
+        return 0;
+    m_bKeyDown[vkCode] = bDown;
+
+    uint32_t pressedMask = 0;
+    for (int id = 0; id < m_iCombinationCount; id++)
+    {
+        if (IsCombinationDown(id))
+            pressedMask |= (1u << id);
+    }
+
+    uint32_t firedMask = pressedMask & ~m_iPressedMask;
+    m_iPressedMask     = pressedMask;
+    return firedMask;
+}
+
+void FLM_Hotkey_Matcher::ReleaseAll()
+{
+    for (bool& bKeyDown : m_bKeyDown)
+        bKeyDown = false;
+    m_iPressedMask = 0;
+}
+
+int FLM_Hotkey_Matcher::GetRegisteredKeys(uint8_t keys[FLM_HOTKEY_MAX_COMBINATIONS * FLM_HOTKEY_KEYS]) const
+{
+    bool bListed[256] = {};
+    int  count        = 0;
+    for (int id = 0; id < m_iCombinationCount; id++)
+    {
+        for (int k = 0; k < FLM_HOTKEY_KEYS; k++)
+        {
+            uint8_t key = m_combination[id][k];
+            if ((key != 0) && (bListed[key] == false))
+            {
+                bListed[key]  = true;
+                keys[count++] = key;
+            }
+        }
+    }
+    return count;
+}
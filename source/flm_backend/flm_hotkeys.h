@@ -0,0 +1,57 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_hotkeys.h
+/// @brief  Matches registered key combinations against a stream of key transitions
+//=============================================================================
+
+#ifndef FLM_HOTKEYS_H
+#define FLM_HOTKEYS_H
+
+#include <stdint.h>
+
+#define FLM_HOTKEY_KEYS              3   // Keys per combination, as parsed by FLM_Keyboard::SetKeys
+#define FLM_HOTKEY_MAX_COMBINATIONS  32  // One bit per combination in the masks returned by OnKey()
+
+//
+// Keeps the down state of every virtual key from key down and key up transitions and reports the combinations
+// that became fully pressed with a transition. A combination fires once when its last key goes down and again
+// only after one of its keys was released, auto repeated key downs do not fire it again.
+//
+// ALT, CTRL and SHIFT in a combination match either the left or the right key, so combinations parsed from
+// "ALT+T" match the VK_LMENU and VK_RMENU codes sent by low level hooks.
+//
+// There is no Windows dependency, the virtual key codes are plain numbers here. Not thread safe, one thread
+// registers the combinations before feeding the transitions.
+//
+class FLM_Hotkey_Matcher
+{
+public:
+    // Returns the id of the combination, -1 if it has no keys or all FLM_HOTKEY_MAX_COMBINATIONS ids are in use.
+    // Unused keys are 0, registering the same keys twice returns the same id.
+    int  Register(const uint8_t keys[FLM_HOTKEY_KEYS]);
+    void Clear();
+
+    // Returns one bit per combination id that became fully pressed with this transition
+    uint32_t OnKey(uint8_t vkCode, bool bDown);
+
+    // Releases all keys without firing, for example when the key state source changes
+    void ReleaseAll();
+
+    bool     IsKeyDown(uint8_t vkCode) const;
+    uint32_t GetPressedMask() const { return m_iPressedMask; }
+    int      GetCombinationCount() const { return m_iCombinationCount; }
+
+    // Distinct keys of all combinations, to poll when there are no key transition events. Returns the count.
+    int GetRegisteredKeys(uint8_t keys[FLM_HOTKEY_MAX_COMBINATIONS * FLM_HOTKEY_KEYS]) const;
+
+private:
+    bool IsCombinationDown(int id) const;
+
+    bool     m_bKeyDown[256]                                           = {};
+    uint8_t  m_combination[FLM_HOTKEY_MAX_COMBINATIONS][FLM_HOTKEY_KEYS] = {};
+    int      m_iCombinationCount                                       = 0;
+    uint32_t m_iPressedMask                                            = 0;  // Combinations fully pressed now
+};
+
+#endif
@@ -7,6 +7,11 @@
 
 #include "flm_keyboard.h"
 #include "flm_utils.h"
+#include "flm_trace.h"
+
+#include <climits>
+
+static FLM_Keyboard* g_pKeyboardHookOwner = NULL;  // The hook procedures have no user data
 
 VK_KEY_PAIRS vk_key_pairs[VK_KEY_PAIRS_SIZE] = {{VK_MENU, "ALT"},      {VK_CONTROL, "CTRL"},   {VK_SHIFT, "SHIFT"},    {VK_LMENU, "LALT"},
                                                 {VK_RMENU, "RALT"},    {VK_LCONTROL, "LCTRL"}, {VK_RCONTROL, "RCTRL"}, {VK_LSHIFT, "LSHIFT"},
@@ -16,6 +21,15 @@ VK_KEY_PAIRS vk_key_pairs[VK_KEY_PAIRS_SIZE] = {{VK_MENU, "ALT"},      {VK_CONTR
                                                 {VK_F5, "F5"},         {VK_F6, "F6"},          {VK_F7, "F7"},          {VK_F8, "F8"},
                                                 {VK_F9, "F9"},         {VK_F10, "F10"},        {VK_F11, "F11"},        {VK_F12, "F12"}};
 
+FLM_Keyboard::~FLM_Keyboard()
+{
+    StopHotkeyNotifications();
+    if (m_hHotkeyEvent != NULL)
+        CloseHandle(m_hHotkeyEvent);
+    if (m_hHookReady != NULL)
+        CloseHandle(m_hHookReady);
+}
+
 std::string FLM_Keyboard::GetErrorMessage()
 {
     return m_errorMessage;
@@ -178,3 +192,237 @@ bool FLM_Keyboard::AnyKeyboardHit()
 {
     return _kbhit() > 0;
 }
+
+uint32_t FLM_Keyboard::RegisterHotkey(const uint8_t keys[3], bool bPollMouseButtons)
+{
+    int id = m_hotkeys.Register(keys);
+    if (id < 0)
+        return 0;
+
+    for (int k = 0; k < 3; k++)
+    {
+        int button = (keys[k] == VK_LBUTTON) ? 0 : (keys[k] == VK_MBUTTON) ? 1 : (keys[k] == VK_RBUTTON) ? 2 : -1;
+        if (button < 0)
+            continue;
+
+        if (bPollMouseButtons)
+            m_bPollButton[button] = true;
+        else
+            m_bHookMouseButtons = true;
+    }
+    return (1u << id);
+}
+
+void FLM_Keyboard::ClearHotkeys()
+{
+    m_hotkeys.Clear();
+    m_bHookMouseButtons = false;
+    m_iPendingHotkeys   = 0;
+    for (bool& bPoll : m_bPollButton)
+        bPoll = false;
+}
+
+bool FLM_Keyboard::StartHotkeyNotifications()
+{
+    if (m_hookThread.IsRunning())
+        return m_bHookInstalled;
+
+    if (g_pKeyboardHookOwner != NULL)
+    {
+        PrintMessage("Hotkey notifications are already in use");
+        return false;
+    }
+
+    if (m_hHotkeyEvent == NULL)
+        m_hHotkeyEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (m_hHookReady == NULL)
+        m_hHookReady = CreateEvent(NULL, FALSE, FALSE, NULL);
+
+    // Keys already held do not fire when the hook reports their release and press
+    m_hotkeys.ReleaseAll();
+    uint8_t keys[FLM_HOTKEY_MAX_COMBINATIONS * FLM_HOTKEY_KEYS];
+    int     keyCount = m_hotkeys.GetRegisteredKeys(keys);
+    for (int i = 0; i < keyCount; i++)
+        m_hotkeys.OnKey(keys[i], KEY_DOWN(keys[i]));
+    m_iPendingHotkeys = 0;
+
+    g_pKeyboardHookOwner = this;
+    if (m_hookThread.Start([this](const FLM_Stop_Token& stop) { HookThreadFunction(stop); }) == false)
+    {
+        g_pKeyboardHookOwner = NULL;
+        PrintMessage("Failed to create keyboard hook thread");
+        return false;
+    }
+
+    WaitForSingleObject(m_hHookReady, 1000);
+    if (m_bHookInstalled == false)
+    {
+        StopHotkeyNotifications();
+        PrintMessage("Failed to install the keyboard hook, polling the hotkeys");
+    }
+
+    return m_bHookInstalled;
+}
+
+void FLM_Keyboard::StopHotkeyNotifications()
+{
+    if (m_hookThread.IsRunning())
+    {
+        // The message loop does not wait on the stop token, WM_QUIT ends it
+        m_hookThread.RequestStop();
+        PostThreadMessage(GetThreadId(m_hookThread.GetNativeHandle()), WM_QUIT, 0, 0);
+        m_hookThread.Stop();
+        g_pKeyboardHookOwner = NULL;
+    }
+    m_bHookInstalled = false;
+}
+
+void FLM_Keyboard::HookThreadFunction(const FLM_Stop_Token& stop)
+{
+    FlmTraceSetThreadName("KeyboardHook");
+
+    // Every key stroke of the desktop waits for the hook procedure, and Windows removes hooks that are too slow
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+
+    // Creates the message queue, so WM_QUIT from StopHotkeyNotifications() is not lost. A stop requested before the
+    // queue existed is seen by the loop below.
+    MSG msg;
+    PeekMessage(&msg, NULL, WM_USER, WM_USER, PM_NOREMOVE);
+
+    HHOOK hKeyboardHook = SetWindowsHookEx(WH_KEYBOARD_LL, FLM_Keyboard::LowLevelKeyboardProc, GetModuleHandle(NULL), 0);
+    HHOOK hMouseHook    = NULL;
+    if ((hKeyboardHook != NULL) && m_bHookMouseButtons)
+    {
+        hMouseHook = SetWindowsHookEx(WH_MOUSE_LL, FLM_Keyboard::LowLevelMouseProc, GetModuleHandle(NULL), 0);
+        if (hMouseHook == NULL)
+        {
+            UnhookWindowsHookEx(hKeyboardHook);
+            hKeyboardHook = NULL;
+        }
+    }
+
+    m_bHookInstalled = (hKeyboardHook != NULL);
+    SetEvent(m_hHookReady);
+
+    if (hKeyboardHook == NULL)
+        return;
+
+    // Buttons that are not hooked are polled on this thread, which owns m_hotkeys
+    bool     bPoll   = (hMouseHook == NULL) && (m_bPollButton[0] || m_bPollButton[1] || m_bPollButton[2]);
+    UINT_PTR timerId = bPoll ? SetTimer(NULL, 0, FLM_KEYBOARD_POLL_MS, NULL) : 0;
+
+    // Low level hooks are called from the message loop of the thread that installed them
+    while ((stop.StopRequested() == false) && (GetMessage(&msg, NULL, 0, 0) > 0))
+    {
+        if ((msg.message == WM_TIMER) && (msg.hwnd == NULL))
+        {
+            PollMouseButtons();
+            continue;
+        }
+        TranslateMessage(&msg);
+        DispatchMessage(&msg);
+    }
+
+    if (timerId != 0)
+        KillTimer(NULL, timerId);
+    if (hMouseHook != NULL)
+        UnhookWindowsHookEx(hMouseHook);
+    UnhookWindowsHookEx(hKeyboardHook);
+    m_bHookInstalled = false;
+}
+
+void FLM_Keyboard::OnHookKey(uint8_t vkCode, bool bDown)
+{
+    uint32_t fired = m_hotkeys.OnKey(vkCode, bDown);
+    if (fired != 0)
+    {
+        m_iPendingHotkeys.fetch_or(fired);
+        SetEvent(m_hHotkeyEvent);
+    }
+}
+
+LRESULT CALLBACK FLM_Keyboard::LowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam)
+{
+    FLM_Keyboard* pKeyboard = g_pKeyboardHookOwner;
+    if ((nCode == HC_ACTION) && (pKeyboard != NULL))
+    {
+        const KBDLLHOOKSTRUCT* pKey = (const KBDLLHOOKSTRUCT*)lParam;
+        switch (wParam)
+        {
+        case WM_KEYDOWN:
+        case WM_SYSKEYDOWN: pKeyboard->OnHookKey((uint8_t)pKey->vkCode, true);  break;
+        case WM_KEYUP:
+        case WM_SYSKEYUP:   pKeyboard->OnHookKey((uint8_t)pKey->vkCode, false); break;
+        }
+    }
+    return CallNextHookEx(NULL, nCode, wParam, lParam);
+}
+
+LRESULT CALLBACK FLM_Keyboard::LowLevelMouseProc(int nCode, WPARAM wParam, LPARAM lParam)
+{
+    FLM_Keyboard* pKeyboard = g_pKeyboardHookOwner;
+    if ((nCode == HC_ACTION) && (pKeyboard != NULL))
+    {
+        switch (wParam)
+        {
+        case WM_LBUTTONDOWN: pKeyboard->OnHookKey(VK_LBUTTON, true);  break;
+        case WM_LBUTTONUP:   pKeyboard->OnHookKey(VK_LBUTTON, false); break;
+        case WM_MBUTTONDOWN: pKeyboard->OnHookKey(VK_MBUTTON, true);  break;
+        case WM_MBUTTONUP:   pKeyboard->OnHookKey(VK_MBUTTON, false); break;
+        case WM_RBUTTONDOWN: pKeyboard->OnHookKey(VK_RBUTTON, true);  break;
+        case WM_RBUTTONUP:   pKeyboard->OnHookKey(VK_RBUTTON, false); break;
+        }
+    }
+    return CallNextHookEx(NULL, nCode, wParam, lParam);
+}
+
+void FLM_Keyboard::PollMouseButtons()
+{
+    const uint8_t buttons[3] = {VK_LBUTTON, VK_MBUTTON, VK_RBUTTON};
+    for (int i = 0; i < 3; i++)
+    {
+        if (m_bPollButton[i])
+            OnHookKey(buttons[i], KEY_DOWN(buttons[i]));
+    }
+}
+
+uint32_t FLM_Keyboard::PollHotkeys()
+{
+    uint8_t  keys[FLM_HOTKEY_MAX_COMBINATIONS * FLM_HOTKEY_KEYS];
+    int      keyCount = m_hotkeys.GetRegisteredKeys(keys);
+    uint32_t fired    = 0;
+    for (int i = 0; i < keyCount; i++)
+        fired |= m_hotkeys.OnKey(keys[i], KEY_DOWN(keys[i]));
+    return fired;
+}
+
+uint32_t FLM_Keyboard::WaitForHotkeys(DWORD timeoutMS, HANDLE hAbortEvent)
+{
+    ULONGLONG deadline = (timeoutMS == INFINITE) ? ULLONG_MAX : GetTickCount64() + timeoutMS;
+
+    for (;;)
+    {
+        uint32_t fired = m_bHookInstalled ? m_iPendingHotkeys.exchange(0) : PollHotkeys();
+        if (fired != 0)
+            return fired;
+
+        ULONGLONG now = GetTickCount64();
+        if (now >= deadline)
+            return 0;
+
+        if (m_bHookInstalled)
+        {
+            DWORD  waitMS     = (timeoutMS == INFINITE) ? INFINITE : (DWORD)(deadline - now);
+            HANDLE handles[2] = {m_hHotkeyEvent, hAbortEvent};
+            if (WaitForMultipleObjects((hAbortEvent != NULL) ? 2 : 1, handles, FALSE, waitMS) == WAIT_OBJECT_0 + 1)
+                return 0;
+        }
+        else if (hAbortEvent != NULL)
+        {
+            if (WaitForSingleObject(hAbortEvent, 1) == WAIT_OBJECT_0)
+                return 0;
+        }
+        else
+            Sleep(1);
+    }
+}
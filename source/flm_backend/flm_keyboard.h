@@ -10,9 +10,13 @@
 
 #include <Windows.h>
 #include <algorithm>
+#include <atomic>
 #include <conio.h>
 #include <string>
 
+#include "flm_hotkeys.h"
+#include "flm_thread.h"
+
 struct VK_KEY_PAIRS
 {
     uint8_t     key;
@@ -20,10 +24,13 @@ struct VK_KEY_PAIRS
 };
 
 #define VK_KEY_PAIRS_SIZE 28
+#define FLM_KEYBOARD_POLL_MS 10  // Polling interval of the mouse buttons of hotkeys registered with bPollMouseButtons
 
 class FLM_Keyboard
 {
 public:
+    ~FLM_Keyboard();
+
     bool        AnyKeyboardHit();
     bool        AssignKey(std::string token, uint8_t& key);
     void        ClearKeyboardBuffer();
@@ -32,11 +39,46 @@ public:
     bool        KeyCombinationPressed(uint8_t keys[3]);
     bool        SetKeys(std::string userKey, uint8_t key[3]);
 
+    // Hotkeys are combinations set by SetKeys(), mouse buttons are accepted as keys as well.
+    // Register them before StartHotkeyNotifications(), the return value is the bit of the combination
+    // in the masks of WaitForHotkeys(), 0 if it was not registered.
+    // Mouse buttons are read from a low level mouse hook, which every mouse event of the desktop waits for, the game
+    // input and the injected mouse moves included. With bPollMouseButtons the buttons of the combination are polled
+    // every FLM_KEYBOARD_POLL_MS instead, the hook is only installed for the combinations of the user settings.
+    uint32_t RegisterHotkey(const uint8_t keys[3], bool bPollMouseButtons = false);
+    void     ClearHotkeys();
+
+    // Key transitions from low level keyboard and mouse hooks on their own thread. Without them WaitForHotkeys()
+    // polls the registered keys every millisecond. Only one FLM_Keyboard can have the notifications running.
+    bool StartHotkeyNotifications();
+    void StopHotkeyNotifications();
+
+    // Returns the mask of the hotkeys pressed since the last call, 0 on timeout or when hAbortEvent is set
+    uint32_t WaitForHotkeys(DWORD timeoutMS, HANDLE hAbortEvent = NULL);
+
 private:
     std::string m_errorMessage;
 
     std::string GetVKCodeKeyName(uint8_t vkCode);
     void        PrintMessage(const char* Format, ...);
+
+    static LRESULT CALLBACK LowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam);
+    static LRESULT CALLBACK LowLevelMouseProc(int nCode, WPARAM wParam, LPARAM lParam);
+    void                    HookThreadFunction(const FLM_Stop_Token& stop);
+    void                    OnHookKey(uint8_t vkCode, bool bDown);
+    uint32_t                PollHotkeys();
+    void                    PollMouseButtons();
+
+    // Owned by the hook thread while it runs, else by the thread calling WaitForHotkeys()
+    FLM_Hotkey_Matcher    m_hotkeys;
+    bool                  m_bHookMouseButtons = false;  // A hotkey uses a mouse button
+    bool                  m_bPollButton[3]    = {};     // Left, middle and right button polled by the hook thread
+
+    FLM_Thread            m_hookThread;
+    HANDLE                m_hHookReady        = NULL;
+    HANDLE                m_hHotkeyEvent      = NULL;   // Auto reset, set by the hook when a hotkey was pressed
+    std::atomic<bool>     m_bHookInstalled    = false;
+    std::atomic<uint32_t> m_iPendingHotkeys   = 0;
 };
 
 #endif
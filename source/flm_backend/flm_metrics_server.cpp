@@ -0,0 +1,191 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_metrics_server.cpp
+/// @brief  Local HTTP endpoint serving live metrics in OpenMetrics text format
+//=============================================================================
+
+// winsock2 must be included before Windows.h
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#include "flm_metrics_server.h"
+#include "flm_utils.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#pragma comment(lib, "Ws2_32.lib")
+
+FLM_Metrics_Server::~FLM_Metrics_Server()
+{
+    Stop();
+}
+
+bool FLM_Metrics_Server::Start(int port)
+{
+    if (m_thread.IsRunning())
+        return true;
+
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+        return false;
+
+    SOCKET listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listenSocket == INVALID_SOCKET)
+    {
+        WSACleanup();
+        return false;
+    }
+
+    // Only local clients, a lab scraper on another machine should go through a local agent
+    sockaddr_in address     = {};
+    address.sin_family      = AF_INET;
+    address.sin_port        = htons((u_short)port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if ((bind(listenSocket, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR) || (listen(listenSocket, 4) == SOCKET_ERROR))
+    {
+        FlmPrint("Warning: Unable to listen on metrics port %d\n", port);
+        closesocket(listenSocket);
+        WSACleanup();
+        return false;
+    }
+
+    m_iPort  = port;
+    m_listen = (uintptr_t)listenSocket;
+    if (m_thread.Start([this](const FLM_Stop_Token& stop) { ServerThreadFunction(stop); }) == false)
+    {
+        Stop();
+        return false;
+    }
+
+    return true;
+}
+
+void FLM_Metrics_Server::Stop()
+{
+    m_thread.Stop();
+
+    if ((SOCKET)m_listen != INVALID_SOCKET)
+    {
+        closesocket((SOCKET)m_listen);
+        m_listen = (uintptr_t)INVALID_SOCKET;
+        WSACleanup();
+    }
+}
+
+void FLM_Metrics_Server::ServerThreadFunction(const FLM_Stop_Token& stop)
+{
+    SOCKET listenSocket = (SOCKET)m_listen;
+    char   request[2048];
+    char   body[RESPONSE_SIZE];
+    char   header[256];
+
+    while (stop.StopRequested() == false)
+    {
+        // Wait for a connection with a timeout so a stop request is seen
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(listenSocket, &readSet);
+        timeval timeout = {0, POLL_TIMEOUT_MS * 1000};
+        if (select(0, &readSet, NULL, NULL, &timeout) <= 0)
+            continue;
+
+        SOCKET client = accept(listenSocket, NULL, NULL);
+        if (client == INVALID_SOCKET)
+            continue;
+
+        DWORD dwRecvTimeoutMS = 1000;
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, (const char*)&dwRecvTimeoutMS, sizeof(dwRecvTimeoutMS));
+
+        // Read the request line and headers, the body of a GET is empty
+        int length = 0;
+        while (length < (int)sizeof(request) - 1)
+        {
+            int received = recv(client, request + length, (int)sizeof(request) - 1 - length, 0);
+            if (received <= 0)
+                break;
+            length += received;
+            request[length] = 0;
+            if (strstr(request, "\r\n\r\n") != NULL)
+                break;
+        }
+        request[length] = 0;
+
+        int  headerLength;
+        int  bodyLength = 0;
+        bool bMetrics   = (strncmp(request, "GET /metrics ", 13) == 0) || (strncmp(request, "GET / ", 6) == 0);
+        if (bMetrics)
+        {
+            bodyLength   = FormatMetrics(body, sizeof(body));
+            headerLength = snprintf(header,
+                                    sizeof(header),
+                                    "HTTP/1.1 200 OK\r\n"
+                                    "Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+                                    "Content-Length: %d\r\n"
+                                    "Connection: close\r\n\r\n",
+                                    bodyLength);
+        }
+        else
+            headerLength = snprintf(header, sizeof(header), "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+
+        send(client, header, headerLength, 0);
+        if (bodyLength > 0)
+            send(client, body, bodyLength, 0);
+
+        shutdown(client, SD_SEND);
+        closesocket(client);
+    }
+}
+
+static void AppendMetric(char* buffer, int bufferSize, int& length, const char* format, ...)
+{
+    if (length >= bufferSize)
+        return;
+
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(buffer + length, bufferSize - length, format, args);
+    va_end(args);
+
+    if (written > 0)
+        length = (length + written < bufferSize) ? length + written : bufferSize - 1;
+}
+
+int FLM_Metrics_Server::FormatMetrics(char* buffer, int bufferSize)
+{
+    FLM_METRICS_SNAPSHOT s      = m_snapshot.Load();
+    int                  length = 0;
+
+    AppendMetric(buffer, bufferSize, length, "# TYPE flm_measuring gauge\n# HELP flm_measuring 1 while latency measurements are running\nflm_measuring %d\n", s.measuring ? 1 : 0);
+    AppendMetric(buffer, bufferSize, length, "# TYPE flm_fps gauge\n# HELP flm_fps Moving average frame rate\nflm_fps %.2f\n", s.fps);
+    AppendMetric(buffer, bufferSize, length, "# TYPE flm_fps_odd gauge\nflm_fps_odd %.2f\n", s.fpsOdd);
+    AppendMetric(buffer, bufferSize, length, "# TYPE flm_fps_even gauge\nflm_fps_even %.2f\n", s.fpsEven);
+    AppendMetric(buffer, bufferSize, length, "# TYPE flm_latency_latest_ms gauge\nflm_latency_latest_ms %.3f\n", s.latestLatency);
+    AppendMetric(buffer, bufferSize, length, "# TYPE flm_latency_accumulated_ms gauge\n# HELP flm_latency_accumulated_ms Average latency since measurements started\nflm_latency_accumulated_ms %.3f\n", s.accLatency);
+    AppendMetric(buffer, bufferSize, length, "# TYPE flm_latency_accumulated_frames gauge\nflm_latency_accumulated_frames %.3f\n", s.accFrames);
+    AppendMetric(buffer, bufferSize, length, "# TYPE flm_latency_row_ms gauge\n# HELP flm_latency_row_ms Average latency of the last completed row\nflm_latency_row_ms %.3f\n", s.rowLatency);
+    AppendMetric(buffer, bufferSize, length, "# TYPE flm_latency_row_frames gauge\nflm_latency_row_frames %.3f\n", s.rowFrames);
+    AppendMetric(buffer, bufferSize, length, "# TYPE flm_background_sad gauge\nflm_background_sad %.2f\n", s.backgroundSAD);
+    AppendMetric(buffer, bufferSize, length, "# TYPE flm_sad_threshold gauge\nflm_sad_threshold %.2f\n", s.threshold);
+    AppendMetric(buffer, bufferSize, length, "# TYPE flm_false_trigger_probability gauge\n# HELP flm_false_trigger_probability Estimated probability that a frame without input motion triggers\nflm_false_trigger_probability %.5f\n", s.falseTriggerRate);
+    AppendMetric(buffer, bufferSize, length, "# TYPE flm_frames_captured counter\nflm_frames_captured_total %llu\n", (unsigned long long)s.framesCaptured);
+    AppendMetric(buffer, bufferSize, length, "# TYPE flm_frames_dropped counter\n# HELP flm_frames_dropped Frames missed by the capture\nflm_frames_dropped_total %llu\n", (unsigned long long)s.framesDropped);
+    AppendMetric(buffer, bufferSize, length, "# TYPE flm_pipeline_rebuilds counter\nflm_pipeline_rebuilds_total %llu\n", (unsigned long long)s.rebuilds);
+
+    AppendMetric(buffer, bufferSize, length, "# TYPE flm_latency_ms histogram\n# HELP flm_latency_ms Measured latencies\n");
+    uint64_t cumulative = 0;
+    for (int i = 0; i < FLM_METRICS_LATENCY_BUCKETS - 1; i++)
+    {
+        cumulative += s.latencyBuckets[i];
+        AppendMetric(buffer, bufferSize, length, "flm_latency_ms_bucket{le=\"%.1f\"} %llu\n", g_flmMetricsLatencyBucketsMS[i], (unsigned long long)cumulative);
+    }
+    cumulative += s.latencyBuckets[FLM_METRICS_LATENCY_BUCKETS - 1];
+    AppendMetric(buffer, bufferSize, length, "flm_latency_ms_bucket{le=\"+Inf\"} %llu\n", (unsigned long long)cumulative);
+    AppendMetric(buffer, bufferSize, length, "flm_latency_ms_count %llu\nflm_latency_ms_sum %.3f\n", (unsigned long long)s.latencyCount, s.latencySumMS);
+
+    AppendMetric(buffer, bufferSize, length, "# EOF\n");
+    return length;
+}
@@ -0,0 +1,80 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_metrics_server.h
+/// @brief  Local HTTP endpoint serving live metrics in OpenMetrics text format
+//=============================================================================
+
+#ifndef FLM_METRICS_SERVER_H
+#define FLM_METRICS_SERVER_H
+
+#include <Windows.h>
+#include <stdint.h>
+
+#include "flm_seqlock.h"
+#include "flm_thread.h"
+
+#define FLM_METRICS_LATENCY_BUCKETS 16  // Including the +Inf bucket
+
+// Upper bounds [ms] of the latency histogram buckets, the last bucket is +Inf
+static const float g_flmMetricsLatencyBucketsMS[FLM_METRICS_LATENCY_BUCKETS - 1] = {5, 10, 15, 20, 25, 30, 40, 50, 60, 80, 100, 150, 200, 300, 500};
+
+struct FLM_METRICS_SNAPSHOT
+{
+    bool     measuring        = false;
+    float    fps              = 0.0f;
+    float    fpsOdd           = 0.0f;
+    float    fpsEven          = 0.0f;
+    float    latestLatency    = 0.0f;
+    float    accLatency       = 0.0f;
+    float    accFrames        = 0.0f;
+    float    rowLatency       = 0.0f;
+    float    rowFrames        = 0.0f;
+    float    backgroundSAD    = 0.0f;
+    float    threshold        = 0.0f;  // SAD threshold applied to the next frame
+    float    falseTriggerRate = 0.0f;  // Estimated probability that a frame without input motion triggers
+    uint64_t framesCaptured   = 0;  // New frames seen by Process()
+    uint64_t framesDropped    = 0;  // Gaps in the captured frame index
+    uint64_t rebuilds         = 0;  // Capture pipeline rebuilds
+    uint64_t latencyBuckets[FLM_METRICS_LATENCY_BUCKETS] = {};  // Not cumulative, summed when served
+    uint64_t latencyCount     = 0;
+    double   latencySumMS     = 0.0;
+
+    void AddLatency(float fLatencyMS)
+    {
+        int bucket = 0;
+        while ((bucket < FLM_METRICS_LATENCY_BUCKETS - 1) && (fLatencyMS > g_flmMetricsLatencyBucketsMS[bucket]))
+            bucket++;
+        latencyBuckets[bucket]++;
+        latencyCount++;
+        latencySumMS += fLatencyMS;
+    }
+};
+
+// Serves GET /metrics on 127.0.0.1 from its own thread.
+// The pipeline publishes snapshots through a sequence lock, so the measurement thread never waits on a scrape.
+class FLM_Metrics_Server
+{
+public:
+    ~FLM_Metrics_Server();
+
+    bool Start(int port);
+    void Stop();
+    bool IsRunning() const { return m_thread.IsRunning(); }
+    void Publish(const FLM_METRICS_SNAPSHOT& snapshot) { m_snapshot.Store(snapshot); }
+
+private:
+    void ServerThreadFunction(const FLM_Stop_Token& stop);
+    int  FormatMetrics(char* buffer, int bufferSize);
+
+    static const int POLL_TIMEOUT_MS = 250;   // How often the server thread checks for stop
+    static const int RESPONSE_SIZE   = 8192;
+
+    FLM_SeqLock<FLM_METRICS_SNAPSHOT> m_snapshot;
+
+    int        m_iPort  = 0;
+    uintptr_t  m_listen = ~(uintptr_t)0;  // SOCKET, kept as an integer to keep winsock out of this header
+    FLM_Thread m_thread;
+};
+
+#endif
@@ -7,6 +7,25 @@
 
 #include "flm_mouse.h"
 #include "flm_utils.h"
+#include "flm_trace.h"
+
+static FLM_Mouse* g_pMouseHookOwner = NULL;  // The hook procedure has no user data
+
+static int ButtonIndex(uint8_t key)
+{
+    if (key == MOUSE_LEFT_BUTTON)
+        return 0;
+    if (key == MOUSE_MIDDLE_BUTTON)
+        return 1;
+    if (key == MOUSE_RIGHT_BUTTON)
+        return 2;
+    return -1;
+}
+
+FLM_Mouse::~FLM_Mouse()
+{
+    StopButtonNotifications();
+}
 
 
 std::string FLM_Mouse::GetErrorMessage()
@@ -35,6 +54,11 @@ void FLM_Mouse::PrintMessage(const char* Format, ...)
 
 bool FLM_Mouse::IsButtonDown(uint8_t key)
 {
+    // The async key state is updated only after the hook procedure returns
+    int index = ButtonIndex(key);
+    if (m_bHookInstalled && (index >= 0))
+        return m_bButtonDown[index];
+
     if (KEY_DOWN(key))
         return true;
     return false;
@@ -49,3 +73,166 @@ bool FLM_Mouse::IsButtonPressed(uint8_t key)
     }
     return false;
 }
+
+bool FLM_Mouse::StartButtonNotifications()
+{
+    if (m_hookThread.IsRunning())
+        return m_bHookInstalled;
+
+    if (g_pMouseHookOwner != NULL)
+    {
+        PrintMessage("Mouse button notifications are already in use");
+        return false;
+    }
+
+    if (m_hButtonEvent == NULL)
+        m_hButtonEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (m_hHookReady == NULL)
+        m_hHookReady = CreateEvent(NULL, FALSE, FALSE, NULL);
+
+    // A button held while the hook starts has no down time, it is reported down from its next press
+    for (int i = 0; i < 3; i++)
+    {
+        m_bButtonDown[i]      = false;
+        m_iiButtonDownTime[i] = 0;
+    }
+
+    g_pMouseHookOwner = this;
+    if (m_hookThread.Start([this](const FLM_Stop_Token& stop) { HookThreadFunction(stop); }) == false)
+    {
+        g_pMouseHookOwner = NULL;
+        PrintMessage("Failed to create mouse hook thread");
+        return false;
+    }
+
+    WaitForSingleObject(m_hHookReady, 1000);
+    if (m_bHookInstalled == false)
+        PrintMessage("Failed to install the mouse hook, polling the mouse buttons");
+
+    return m_bHookInstalled;
+}
+
+void FLM_Mouse::StopButtonNotifications()
+{
+    if (m_hookThread.IsRunning())
+    {
+        // The message loop does not wait on the stop token, WM_QUIT ends it
+        m_hookThread.RequestStop();
+        PostThreadMessage(GetThreadId(m_hookThread.GetNativeHandle()), WM_QUIT, 0, 0);
+        m_hookThread.Stop();
+        g_pMouseHookOwner = NULL;
+    }
+    m_bHookInstalled = false;
+}
+
+void FLM_Mouse::HookThreadFunction(const FLM_Stop_Token& stop)
+{
+    FlmTraceSetThreadName("MouseHook");
+
+    // Every mouse message of the desktop waits for the hook procedure, and Windows removes hooks that are too slow
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+
+    // Creates the message queue, so WM_QUIT from StopButtonNotifications() is not lost. A stop requested before the
+    // queue existed is seen by the loop below.
+    MSG msg;
+    PeekMessage(&msg, NULL, WM_USER, WM_USER, PM_NOREMOVE);
+
+    HHOOK hHook      = SetWindowsHookEx(WH_MOUSE_LL, FLM_Mouse::LowLevelMouseProc, GetModuleHandle(NULL), 0);
+    m_bHookInstalled = (hHook != NULL);
+    SetEvent(m_hHookReady);
+
+    if (hHook == NULL)
+        return;
+
+    // Low level hooks are called from the message loop of the thread that installed them
+    while ((stop.StopRequested() == false) && (GetMessage(&msg, NULL, 0, 0) > 0))
+    {
+        TranslateMessage(&msg);
+        DispatchMessage(&msg);
+    }
+
+    UnhookWindowsHookEx(hHook);
+    m_bHookInstalled = false;
+}
+
+LRESULT CALLBACK FLM_Mouse::LowLevelMouseProc(int nCode, WPARAM wParam, LPARAM lParam)
+{
+    FLM_Mouse* pMouse = g_pMouseHookOwner;
+    if ((nCode == HC_ACTION) && (pMouse != NULL))
+    {
+        int  index = -1;
+        bool bDown = false;
+        switch (wParam)
+        {
+        case WM_LBUTTONDOWN: index = 0; bDown = true;  break;
+        case WM_LBUTTONUP:   index = 0; bDown = false; break;
+        case WM_MBUTTONDOWN: index = 1; bDown = true;  break;
+        case WM_MBUTTONUP:   index = 1; bDown = false; break;
+        case WM_RBUTTONDOWN: index = 2; bDown = true;  break;
+        case WM_RBUTTONUP:   index = 2; bDown = false; break;
+        }
+
+        if (index >= 0)
+        {
+            if (bDown)
+            {
+                LARGE_INTEGER now;
+                QueryPerformanceCounter(&now);
+                pMouse->m_iiButtonDownTime[index] = now.QuadPart;
+            }
+            pMouse->m_bButtonDown[index] = bDown;
+            SetEvent(pMouse->m_hButtonEvent);
+        }
+    }
+    return CallNextHookEx(NULL, nCode, wParam, lParam);
+}
+
+bool FLM_Mouse::WaitForButtonDown(uint8_t key, DWORD timeoutMS, int64_t* pDownTime, HANDLE hAbortEvent)
+{
+    return WaitForButtonState(key, true, timeoutMS, pDownTime, hAbortEvent);
+}
+
+bool FLM_Mouse::WaitForButtonUp(uint8_t key, DWORD timeoutMS, HANDLE hAbortEvent)
+{
+    return WaitForButtonState(key, false, timeoutMS, NULL, hAbortEvent);
+}
+
+bool FLM_Mouse::WaitForButtonState(uint8_t key, bool bDown, DWORD timeoutMS, int64_t* pDownTime, HANDLE hAbortEvent)
+{
+    int       index    = ButtonIndex(key);
+    bool      bHook    = m_bHookInstalled && (index >= 0);
+    ULONGLONG deadline = GetTickCount64() + timeoutMS;
+
+    for (;;)
+    {
+        if (IsButtonDown(key) == bDown)
+        {
+            if (pDownTime)
+            {
+                if (bHook)
+                    *pDownTime = m_iiButtonDownTime[index];
+                else
+                    QueryPerformanceCounter((LARGE_INTEGER*)pDownTime);
+            }
+            return true;
+        }
+
+        ULONGLONG now = GetTickCount64();
+        if (now >= deadline)
+            return false;
+
+        if (bHook)
+        {
+            HANDLE handles[2] = {m_hButtonEvent, hAbortEvent};
+            if (WaitForMultipleObjects((hAbortEvent != NULL) ? 2 : 1, handles, FALSE, (DWORD)(deadline - now)) == WAIT_OBJECT_0 + 1)
+                return false;
+        }
+        else if (hAbortEvent != NULL)
+        {
+            if (WaitForSingleObject(hAbortEvent, 1) == WAIT_OBJECT_0)
+                return false;
+        }
+        else
+            Sleep(1);
+    }
+}
@@ -10,9 +10,12 @@
 
 #include <Windows.h>
 #include <algorithm>
+#include <atomic>
 #include <conio.h>
 #include <string>
 
+#include "flm_thread.h"
+
 #define MOUSE_LEFT_BUTTON    VK_LBUTTON
 #define MOUSE_MIDDLE_BUTTON  VK_MBUTTON
 #define MOUSE_RIGHT_BUTTON   VK_RBUTTON
@@ -21,13 +24,36 @@
 class FLM_Mouse
 {
 public:
+    ~FLM_Mouse();
+
     bool IsButtonDown(uint8_t key);
     bool IsButtonPressed(uint8_t key);
     std::string GetErrorMessage();
 
+    // Button state from a low level mouse hook on its own thread. Without it the waits below poll the
+    // button state every millisecond. Only one FLM_Mouse can have the notifications running.
+    // A button that is already held is reported down from its next press, it has no down time.
+    bool StartButtonNotifications();
+    void StopButtonNotifications();
+
+    // Return false on timeout or when hAbortEvent is set, pDownTime receives the QueryPerformanceCounter time of the button down event
+    bool WaitForButtonDown(uint8_t key, DWORD timeoutMS, int64_t* pDownTime = NULL, HANDLE hAbortEvent = NULL);
+    bool WaitForButtonUp(uint8_t key, DWORD timeoutMS, HANDLE hAbortEvent = NULL);
+
 private:
     std::string m_errorMessage;
     void PrintMessage(const char* Format, ...);
+
+    static LRESULT CALLBACK LowLevelMouseProc(int nCode, WPARAM wParam, LPARAM lParam);
+    void HookThreadFunction(const FLM_Stop_Token& stop);
+    bool WaitForButtonState(uint8_t key, bool bDown, DWORD timeoutMS, int64_t* pDownTime, HANDLE hAbortEvent);
+
+    FLM_Thread           m_hookThread;
+    HANDLE               m_hHookReady           = NULL;
+    HANDLE               m_hButtonEvent         = NULL;   // Auto reset, set by the hook on every button change
+    std::atomic<bool>    m_bHookInstalled       = false;
+    std::atomic<bool>    m_bButtonDown[3]       = {};     // Left, middle, right
+    std::atomic<int64_t> m_iiButtonDownTime[3]  = {};
 };
 
 #endif
@@ -0,0 +1,368 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_output_sessions.cpp
+/// @brief  Concurrent capture of additional outputs measured from the same input events
+//=============================================================================
+
+#include "flm_output_sessions.h"
+#include "flm_trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#define FLM_OUTPUT_FRAME_TIME_ALPHA  0.95f  // IIR filter of the average frame time
+#define FLM_OUTPUT_REBUILD_RETRY_MS  1000   // Wait before retrying a failed rebuild of a capture
+
+bool FlmParseOutputs(const std::string& text, int iPrimaryOutput, std::vector<int>& outputs, std::string& error)
+{
+    outputs.clear();
+
+    const char* p = text.c_str();
+    while (*p != 0)
+    {
+        while ((*p == ' ') || (*p == '\t') || (*p == ','))
+            p++;
+        if (*p == 0)
+            break;
+
+        char* pEnd;
+        long  output = strtol(p, &pEnd, 10);
+        if ((pEnd == p) || (output < 0) || (output > 15))
+        {
+            error = "[" + text + "] is not a comma separated list of outputs from 0 to 15";
+            return false;
+        }
+        p = pEnd;
+
+        if (output == iPrimaryOutput)
+        {
+            error = "output " + std::to_string(output) + " is the primary output";
+            return false;
+        }
+        if (std::find(outputs.begin(), outputs.end(), (int)output) != outputs.end())
+        {
+            error = "output " + std::to_string(output) + " is listed twice";
+            return false;
+        }
+        if (outputs.size() >= FLM_MAX_OUTPUTS)
+        {
+            error = "more than " + std::to_string(FLM_MAX_OUTPUTS) + " additional outputs";
+            return false;
+        }
+
+        outputs.push_back((int)output);
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------------------
+
+FLM_Capture_Frame_Source::FLM_Capture_Frame_Source(FLM_Capture_Context* pCapture, FLM_Timer_AMF& timer)
+    : m_pCapture(pCapture)
+    , m_timer(timer)
+{
+}
+
+FLM_Capture_Frame_Source::~FLM_Capture_Frame_Source()
+{
+    if (m_pCapture != NULL)
+    {
+        m_pCapture->Release();
+        delete m_pCapture;
+        m_pCapture = NULL;
+    }
+}
+
+bool FLM_Capture_Frame_Source::NextFrame(FLM_OUTPUT_FRAME& frame, const FLM_Stop_Token& stop)
+{
+    // Rebuilt on the session thread, the other outputs keep capturing
+    if (m_pCapture->m_bNeedToRebuildPipeline)
+    {
+        FLM_TRACE_INSTANT("Rebuild");
+        m_pCapture->Release();
+        if (m_pCapture->InitCapture(m_timer))
+            m_pCapture->m_bDoCaptureFrames = true;
+        else
+            stop.SleepFor(FLM_OUTPUT_REBUILD_RETRY_MS);
+        return false;
+    }
+
+    {
+        FLM_TRACE_SCOPE("GetFrame");
+        if (m_pCapture->GetFrame() != FLM_STATUS::CAPTURE_PROCESS_FRAME)
+            return false;
+    }
+
+    if (m_pCapture->GetConverterOutput(&frame.iiTimeStamp, &frame.iiFrameIdx) == false)
+        return false;
+
+    FLM_TRACE_SCOPE("CalculateSAD");
+    FLM_RUNTIME_OPTIONS* pOptions = m_pCapture->m_pRuntimeOptions;
+    frame.iSAD                    = m_pCapture->CalculateSAD();
+    frame.iThSAD                  = m_pCapture->GetThresholdedSAD(0, frame.iSAD, pOptions->thresholdCoefficient[pOptions->mouseEventType], pOptions->falseTriggerRate);
+    return true;
+}
+
+int FLM_Capture_Frame_Source::GetRefreshRate()
+{
+    return m_pCapture->GetRefreshRate();
+}
+
+//------------------------------------------------------------------------------------------
+
+bool FLM_Output_Session::Start(FLM_Frame_Source* pSource, int iOutput)
+{
+    m_pSource = pSource;
+    m_iOutput = iOutput;
+    m_writePos.store(0, std::memory_order_relaxed);
+    m_readPos.store(0, std::memory_order_relaxed);
+    m_iiOverflows.store(0, std::memory_order_relaxed);
+
+    if (m_thread.Start([this](const FLM_Stop_Token& stop) { ThreadFunction(stop); }) == false)
+    {
+        Stop();
+        return false;
+    }
+    return true;
+}
+
+void FLM_Output_Session::Stop()
+{
+    m_thread.Stop();
+    if (m_pSource != NULL)
+    {
+        delete m_pSource;
+        m_pSource = NULL;
+    }
+}
+
+void FLM_Output_Session::ThreadFunction(const FLM_Stop_Token& stop)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "Capture %d", m_iOutput);
+    FlmTraceSetThreadName(name);
+
+    FLM_OUTPUT_FRAME frame;
+    while (stop.StopRequested() == false)
+    {
+        if (m_pSource->NextFrame(frame, stop))
+            Push(frame);
+    }
+}
+
+void FLM_Output_Session::Push(const FLM_OUTPUT_FRAME& frame)
+{
+    uint64_t writePos = m_writePos.load(std::memory_order_relaxed);
+    if (writePos - m_readPos.load(std::memory_order_acquire) >= FLM_OUTPUT_RING_SIZE)
+    {
+        m_iiOverflows.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    m_ring[writePos & (FLM_OUTPUT_RING_SIZE - 1)] = frame;
+    m_writePos.store(writePos + 1, std::memory_order_release);
+}
+
+bool FLM_Output_Session::Pop(FLM_OUTPUT_FRAME& frame)
+{
+    uint64_t readPos = m_readPos.load(std::memory_order_relaxed);
+    if (readPos == m_writePos.load(std::memory_order_acquire))
+        return false;
+
+    frame = m_ring[readPos & (FLM_OUTPUT_RING_SIZE - 1)];
+    m_readPos.store(readPos + 1, std::memory_order_release);
+    return true;
+}
+
+//------------------------------------------------------------------------------------------
+
+bool FLM_Output_Session_Set::Add(FLM_Frame_Source* pSource, int iOutput)
+{
+    if (m_iCount >= FLM_MAX_OUTPUTS)
+    {
+        delete pSource;
+        return false;
+    }
+
+    int index                   = m_iCount;
+    m_stats[index]              = FLM_OUTPUT_STATS();
+    m_stats[index].refreshRate  = pSource->GetRefreshRate();
+    m_iiPrevFrameIdx[index]     = 0;
+    m_iiPrevTimeStamp[index]    = 0;
+    m_iiInjected[index]         = 0;
+    m_iiLastMeasured[index]     = 0;
+    m_detection[index]          = FLM_Detection_State_Machine();
+    m_iiOverflowsAtReset[index] = 0;
+
+    if (m_sessions[index].Start(pSource, iOutput) == false)
+        return false;
+
+    m_iCount++;
+    return true;
+}
+
+void FLM_Output_Session_Set::Stop()
+{
+    // All threads stop in parallel, the joins take about as long as the slowest capture
+    for (int i = 0; i < m_iCount; i++)
+        m_sessions[i].RequestStop();
+    for (int i = 0; i < m_iCount; i++)
+        m_sessions[i].Stop();
+    m_iCount = 0;
+}
+
+void FLM_Output_Session_Set::SetSession(int iSession, const FLM_DETECTION_SETTINGS& settings)
+{
+    m_iSession          = iSession;
+    m_detectionSettings = settings;
+}
+
+void FLM_Output_Session_Set::AddInjection(int64_t iiInjectTime)
+{
+    if (iiInjectTime == 0)
+        return;
+    if ((m_iInjectionCount > 0) && (iiInjectTime <= m_injections[(m_iInjectionCount - 1) % FLM_OUTPUT_INJECTIONS].iiInjectTime))
+        return;
+
+    INJECTION& injection   = m_injections[m_iInjectionCount % FLM_OUTPUT_INJECTIONS];
+    injection              = INJECTION();
+    injection.iiInjectTime = iiInjectTime;
+    m_iInjectionCount++;
+}
+
+void FLM_Output_Session_Set::SetReferenceLatency(int64_t iiInjectTime, float fLatencyMS)
+{
+    uint64_t first = (m_iInjectionCount > FLM_OUTPUT_INJECTIONS) ? m_iInjectionCount - FLM_OUTPUT_INJECTIONS : 0;
+    for (uint64_t i = m_iInjectionCount; i > first; i--)
+    {
+        INJECTION& injection = m_injections[(i - 1) % FLM_OUTPUT_INJECTIONS];
+        if (injection.iiInjectTime == iiInjectTime)
+        {
+            injection.fReferenceMS = fLatencyMS;
+            CompareWithReference(injection);
+            return;
+        }
+    }
+}
+
+void FLM_Output_Session_Set::CompareWithReference(INJECTION& injection)
+{
+    if (injection.fReferenceMS < 0.0f)
+        return;
+
+    for (int i = 0; i < m_iCount; i++)
+    {
+        uint32_t bit = 1u << i;
+        if (((injection.measuredMask & bit) == 0) || (injection.comparedMask & bit))
+            continue;
+
+        FLM_OUTPUT_STATS& stats = m_stats[i];
+        float             delta = injection.fLatencyMS[i] - injection.fReferenceMS;
+        stats.deltaAverageMS    = (stats.deltaAverageMS * stats.deltaCount + delta) / (stats.deltaCount + 1);
+        stats.deltaCount++;
+        injection.comparedMask |= bit;
+    }
+}
+
+bool FLM_Output_Session_Set::ProcessFrame(int index, const FLM_OUTPUT_FRAME& frame, int64_t iiTicksPerMS)
+{
+    FLM_OUTPUT_STATS& stats = m_stats[index];
+
+    int64_t iiPrevFrameIdx = m_iiPrevFrameIdx[index];
+    bool    bNewFrame      = (frame.iiFrameIdx != iiPrevFrameIdx);
+    if (bNewFrame)
+    {
+        stats.framesCaptured++;
+        if ((iiPrevFrameIdx != 0) && (frame.iiFrameIdx > iiPrevFrameIdx))
+        {
+            stats.framesDropped += frame.iiFrameIdx - iiPrevFrameIdx - 1;
+
+            float fFrameTimeMS = (float)(frame.iiTimeStamp - m_iiPrevTimeStamp[index]) / (float)iiTicksPerMS / (float)(frame.iiFrameIdx - iiPrevFrameIdx);
+            if (fFrameTimeMS > 0.0f)
+                stats.frameTimeMS = (stats.frameTimeMS > 0.0f) ? stats.frameTimeMS * FLM_OUTPUT_FRAME_TIME_ALPHA + (1.0f - FLM_OUTPUT_FRAME_TIME_ALPHA) * fFrameTimeMS : fFrameTimeMS;
+        }
+        m_iiPrevFrameIdx[index]  = frame.iiFrameIdx;
+        m_iiPrevTimeStamp[index] = frame.iiTimeStamp;
+    }
+
+    FLM_Detection_State_Machine& detection = m_detection[index];
+    detection.SetSession(m_iSession, m_detectionSettings, frame.iiFrameIdx);
+
+    // The input events before the frame that the output has not been given yet, in time order
+    uint64_t first = (m_iInjectionCount > FLM_OUTPUT_INJECTIONS) ? m_iInjectionCount - FLM_OUTPUT_INJECTIONS : 0;
+    for (uint64_t i = first; i < m_iInjectionCount; i++)
+    {
+        int64_t iiInjectTime = m_injections[i % FLM_OUTPUT_INJECTIONS].iiInjectTime;
+        if ((iiInjectTime <= m_iiInjected[index]) || (iiInjectTime >= frame.iiTimeStamp))
+            continue;
+        detection.Inject(iiInjectTime, frame.iiFrameIdx);
+        m_iiInjected[index] = iiInjectTime;
+    }
+
+    // A repeated frame is not counted as a frame without motion
+    if ((bNewFrame == false) || (detection.Frame(frame.iThSAD != 0, frame.iiFrameIdx) != FLM_DETECTION_ACTION::MEASURE))
+        return false;
+
+    // The measured input event, unless newer events pushed it out of the ring
+    INJECTION* pInjection = NULL;
+    for (uint64_t i = first; i < m_iInjectionCount; i++)
+    {
+        INJECTION& injection = m_injections[i % FLM_OUTPUT_INJECTIONS];
+        if (injection.iiInjectTime == detection.GetDetectedInjectTime())
+        {
+            pInjection = &injection;
+            break;
+        }
+    }
+    if (pInjection == NULL)
+        return false;
+
+    float fLatencyMS        = (float)(frame.iiTimeStamp - pInjection->iiInjectTime) / (float)iiTicksPerMS;
+    m_iiLastMeasured[index] = pInjection->iiInjectTime;
+
+    stats.latestMS  = fLatencyMS;
+    stats.minMS     = (stats.count == 0) ? fLatencyMS : std::min(stats.minMS, fLatencyMS);
+    stats.maxMS     = (stats.count == 0) ? fLatencyMS : std::max(stats.maxMS, fLatencyMS);
+    stats.averageMS = (stats.averageMS * stats.count + fLatencyMS) / (stats.count + 1);
+    stats.count++;
+
+    m_iiMeasuredFrameIdx[index]  = frame.iiFrameIdx;
+    m_iiMeasuredTimeStamp[index] = frame.iiTimeStamp;
+
+    pInjection->fLatencyMS[index] = fLatencyMS;
+    pInjection->measuredMask |= (1u << index);
+    CompareWithReference(*pInjection);
+    return true;
+}
+
+uint32_t FLM_Output_Session_Set::Process(int64_t iiTicksPerMS)
+{
+    uint32_t measured = 0;
+    for (int i = 0; i < m_iCount; i++)
+    {
+        FLM_OUTPUT_FRAME frame;
+        while (m_sessions[i].Pop(frame))
+        {
+            if (ProcessFrame(i, frame, iiTicksPerMS))
+                measured |= (1u << i);
+        }
+        m_stats[i].ringOverflows = m_sessions[i].GetOverflowCount() - m_iiOverflowsAtReset[i];
+    }
+    return measured;
+}
+
+void FLM_Output_Session_Set::ResetStats()
+{
+    for (int i = 0; i < m_iCount; i++)
+    {
+        int refreshRate         = m_stats[i].refreshRate;
+        m_stats[i]              = FLM_OUTPUT_STATS();
+        m_stats[i].refreshRate  = refreshRate;
+        m_iiInjected[i]         = 0;
+        m_iiLastMeasured[i]     = 0;
+        m_iiOverflowsAtReset[i] = m_sessions[i].GetOverflowCount();
+    }
+    m_iInjectionCount = 0;
+}
@@ -0,0 +1,208 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_output_sessions.h
+/// @brief  Concurrent capture of additional outputs measured from the same input events
+//=============================================================================
+
+#ifndef FLM_OUTPUT_SESSIONS_H
+#define FLM_OUTPUT_SESSIONS_H
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "flm_capture_context.h"
+#include "flm_detection.h"
+#include "flm_thread.h"
+
+#define FLM_MAX_OUTPUTS           4    // Additional outputs, the primary output is captured by the pipeline itself
+#define FLM_OUTPUT_RING_SIZE      256  // Power of 2, about a second at 240 Hz, Process() waits up to a second for a primary frame
+#define FLM_OUTPUT_INJECTIONS     16   // Recent input events an output frame can be matched with
+
+// Parses the comma separated output indices set in flm.ini "AdditionalOutputs", an empty text has none.
+// iPrimaryOutput is captured by the pipeline and can not be listed. Returns false with a description in error.
+bool FlmParseOutputs(const std::string& text, int iPrimaryOutput, std::vector<int>& outputs, std::string& error);
+
+// One captured frame of an output, iiTimeStamp is in the same clock as the input event times
+struct FLM_OUTPUT_FRAME
+{
+    int64_t iiFrameIdx  = 0;
+    int64_t iiTimeStamp = 0;
+    int     iSAD        = 0;
+    int     iThSAD      = 0;  // SAD above the threshold, 0 when no motion was detected
+};
+
+//
+// Frames of one output. NextFrame() is called in a loop on the session thread of the output, so a source
+// can block on its capture device. The capture codecs are wrapped by FLM_Capture_Frame_Source, flm_bench
+// uses generated stand in sources.
+//
+class FLM_Frame_Source
+{
+public:
+    virtual ~FLM_Frame_Source() {}
+
+    // Returns false when there was no new frame, for example on a time out or while the source is rebuilt
+    virtual bool NextFrame(FLM_OUTPUT_FRAME& frame, const FLM_Stop_Token& stop) = 0;
+
+    // Current refresh rate of the output in Hz, 0 if unknown
+    virtual int GetRefreshRate() = 0;
+};
+
+// Captures with one of the codecs, differences and thresholds each frame on the session thread
+class FLM_Capture_Frame_Source : public FLM_Frame_Source
+{
+public:
+    // Takes ownership of pCapture, which has been initialized by InitCapture(timer)
+    FLM_Capture_Frame_Source(FLM_Capture_Context* pCapture, FLM_Timer_AMF& timer);
+    ~FLM_Capture_Frame_Source();
+
+    bool NextFrame(FLM_OUTPUT_FRAME& frame, const FLM_Stop_Token& stop);
+    int  GetRefreshRate();
+
+private:
+    FLM_Capture_Context* m_pCapture = NULL;
+    FLM_Timer_AMF&       m_timer;  // Of the pipeline, all outputs and the input events use the same clock
+};
+
+// Latencies of one output since ResetStats()
+struct FLM_OUTPUT_STATS
+{
+    int     refreshRate    = 0;
+    int64_t framesCaptured = 0;
+    int64_t framesDropped  = 0;     // Gaps in the frame index
+    int64_t ringOverflows  = 0;     // Frames lost because Process() fell behind
+    float   frameTimeMS    = 0.0f;  // Average time between captured frames
+
+    int   count     = 0;
+    float latestMS  = 0.0f;
+    float minMS     = 0.0f;
+    float maxMS     = 0.0f;
+    float averageMS = 0.0f;
+
+    // Compared with the primary output for the input events both measured
+    int   deltaCount     = 0;
+    float deltaAverageMS = 0.0f;  // Average of this output latency - primary output latency
+};
+
+//
+// Capture thread and frame ring of one output. The session thread pushes the frames of its source into a lock free
+// single producer, single consumer ring drained by the Process() thread, if Process() falls behind frames are dropped
+// and counted instead of blocking the capture.
+//
+class FLM_Output_Session
+{
+public:
+    ~FLM_Output_Session() { Stop(); }
+
+    // Takes ownership of pSource
+    bool Start(FLM_Frame_Source* pSource, int iOutput);
+    void RequestStop() { m_thread.RequestStop(); }
+    void Stop();
+
+    // Consumer side, returns false when the ring is empty
+    bool Pop(FLM_OUTPUT_FRAME& frame);
+
+    int               GetOutput() const { return m_iOutput; }
+    FLM_Frame_Source* GetSource() { return m_pSource; }
+    HANDLE            GetThreadHandle() { return m_thread.GetNativeHandle(); }
+    int64_t           GetOverflowCount() const { return m_iiOverflows.load(std::memory_order_relaxed); }
+
+private:
+    void ThreadFunction(const FLM_Stop_Token& stop);
+    void Push(const FLM_OUTPUT_FRAME& frame);
+
+    FLM_Frame_Source*     m_pSource = NULL;
+    int                   m_iOutput = 0;
+    FLM_Thread            m_thread;
+    FLM_OUTPUT_FRAME      m_ring[FLM_OUTPUT_RING_SIZE];
+    std::atomic<uint64_t> m_writePos    = 0;
+    std::atomic<uint64_t> m_readPos     = 0;
+    std::atomic<int64_t>  m_iiOverflows = 0;
+};
+
+//
+// Additional outputs captured concurrently with the primary output. Every output runs its own capture thread and
+// frame ring, the latencies are measured on the Process() thread from the input events of the pipeline.
+//
+// Every output has its own detection state machine with the session and settings of the primary output. It is given
+// the input events in time order once a frame of the output is captured after them, so the outputs do not need to be
+// in step with each other or with the primary output, and settle, warm up and pair motion with input events as the
+// primary output does.
+//
+// All methods but Start() and Stop() are called from the Process() thread.
+//
+class FLM_Output_Session_Set
+{
+public:
+    ~FLM_Output_Session_Set() { Stop(); }
+
+    // Starts the session thread of the output, takes ownership of pSource. Returns false when FLM_MAX_OUTPUTS are in use.
+    bool Add(FLM_Frame_Source* pSource, int iOutput);
+
+    // Stops all session threads at once and deletes the sources
+    void Stop();
+
+    int     GetCount() const { return m_iCount; }
+    int     GetOutput(int index) const { return m_sessions[index].GetOutput(); }
+    HANDLE  GetThreadHandle(int index) { return m_sessions[index].GetThreadHandle(); }
+    const FLM_OUTPUT_STATS& GetStats(int index) const { return m_stats[index]; }
+
+    // Session and detection settings of the primary output, iSession is 0 while not measuring
+    void SetSession(int iSession, const FLM_DETECTION_SETTINGS& settings);
+
+    // iiInjectTime is the time of the latest input event, repeated values are ignored
+    void AddInjection(int64_t iiInjectTime);
+
+    // Latency measured on the primary output for the input event at iiInjectTime
+    void SetReferenceLatency(int64_t iiInjectTime, float fLatencyMS);
+
+    // Drains the frame rings, returns a bit per output that measured a latency
+    uint32_t Process(int64_t iiTicksPerMS);
+
+    // Input event, frame index and time stamp of the latest latency measured by the output
+    int64_t GetMeasuredInjectTime(int index) const { return m_iiLastMeasured[index]; }
+    int64_t GetMeasuredFrameIdx(int index) const { return m_iiMeasuredFrameIdx[index]; }
+    int64_t GetMeasuredTimeStamp(int index) const { return m_iiMeasuredTimeStamp[index]; }
+
+    const FLM_Detection_State_Machine& GetDetection(int index) const { return m_detection[index]; }
+
+    void ResetStats();
+
+private:
+    struct INJECTION
+    {
+        int64_t  iiInjectTime                = 0;
+        float    fReferenceMS                = -1.0f;  // Latency of the primary output, < 0 until measured
+        float    fLatencyMS[FLM_MAX_OUTPUTS] = {};
+        uint32_t measuredMask                = 0;
+        uint32_t comparedMask                = 0;      // Outputs whose delta to the primary output was counted
+    };
+
+    bool ProcessFrame(int index, const FLM_OUTPUT_FRAME& frame, int64_t iiTicksPerMS);
+    void CompareWithReference(INJECTION& injection);
+
+    FLM_Output_Session m_sessions[FLM_MAX_OUTPUTS];
+    FLM_OUTPUT_STATS   m_stats[FLM_MAX_OUTPUTS];
+    int                m_iCount = 0;
+
+    // Per output detection state
+    int64_t m_iiPrevFrameIdx[FLM_MAX_OUTPUTS]      = {};
+    int64_t m_iiPrevTimeStamp[FLM_MAX_OUTPUTS]     = {};
+    int64_t m_iiInjected[FLM_MAX_OUTPUTS]          = {};  // Inject time of the latest input event given to m_detection
+    int64_t m_iiLastMeasured[FLM_MAX_OUTPUTS]      = {};  // Inject time of the latest measured input event
+    int64_t m_iiMeasuredFrameIdx[FLM_MAX_OUTPUTS]  = {};
+    int64_t m_iiMeasuredTimeStamp[FLM_MAX_OUTPUTS] = {};
+    int64_t m_iiOverflowsAtReset[FLM_MAX_OUTPUTS]  = {};
+
+    FLM_Detection_State_Machine m_detection[FLM_MAX_OUTPUTS];
+    FLM_DETECTION_SETTINGS      m_detectionSettings;
+    int                         m_iSession = 0;
+
+    INJECTION m_injections[FLM_OUTPUT_INJECTIONS];
+    uint64_t  m_iInjectionCount = 0;
+};
+
+#endif
@@ -7,11 +7,14 @@
 
 #include "flm_pipeline.h"
 #include "flm_user_interface.h"
+#include "version.h"
+#include <time.h>
 #include <fstream>
 
 #define CLEAR_CONSOLE_TO_END_OF_LINE "\033[s\033[0K\033[u"  // used if console virtual terminal feature is available else use console buffer API
 #define FLM_MOUSE_CLICK_UPPER_LIMIT 300 // adjust as needed: ToDo make this user programmable 
 #define FLM_MOUSE_CLICK_ADJUST_BIAS_FOR_NOISE 1.00f // adjust as needed: ToDo make this user programmable 
+#define FLM_DETECTION_TIMEOUT_MS 1000  // WaitForFrameDetection() gives up on the motion of a mouse move after this
 
 #define PIPELINE_DEBUG_PRINT_STACK()                           // printf(__FUNCTION__"\n");
 #define PIPELINE_DEBUG_PRINT_MouseEventThreadFunction(f, ...)  // printf((f), __VA_ARGS__);
@@ -30,13 +33,6 @@ void FLM_Pipeline::SetUserProcessCallback(ProgressCallback Info)
     g_pUserCallBack = Info;
 }
 
-DWORD WINAPI FLM_Pipeline::CaptureDisplayThreadFunctionStub(LPVOID lpParameter)
-{
-    FLM_Pipeline* p = reinterpret_cast<FLM_Pipeline*>(lpParameter);
-    p->m_capture->DisplayThreadFunction();
-    return 0;
-}
-
 FLM_STATUS FLM_Pipeline::saveUserSettings()
 {
     const char* section = "PIPELINE";
@@ -76,6 +72,7 @@ FLM_STATUS FLM_Pipeline::saveUserSettings()
 
     ini.SetDoubleValue(section, "ThresholdCoefficientMove", m_runtimeOptions.thresholdCoefficient[FLM_MOUSE_EVENT_TYPE::MOUSE_MOVE]);
     ini.SetDoubleValue(section, "ThresholdCoefficientClick", m_runtimeOptions.thresholdCoefficient[FLM_MOUSE_EVENT_TYPE::MOUSE_CLICK]);
+    ini.SetDoubleValue(section, "FalseTriggerRate", m_runtimeOptions.falseTriggerRate);
 
     const char* sectionCapture = "CAPTURE";
 
@@ -129,6 +126,7 @@ FLM_STATUS FLM_Pipeline::loadUserSettings()
         m_runtimeOptions.mouseEventType   = (FLM_MOUSE_EVENT_TYPE)(int)ini.GetLongValue(section, "MouseEventType", (int)m_runtimeOptions.mouseEventType?1:0);
         m_runtimeOptions.thresholdCoefficient[FLM_MOUSE_EVENT_TYPE::MOUSE_MOVE]  = (float)ini.GetDoubleValue(section, "ThresholdCoefficientMove", m_runtimeOptions.thresholdCoefficient[FLM_MOUSE_EVENT_TYPE::MOUSE_MOVE]);
         m_runtimeOptions.thresholdCoefficient[FLM_MOUSE_EVENT_TYPE::MOUSE_CLICK] = (float)ini.GetDoubleValue(section, "ThresholdCoefficientClick", m_runtimeOptions.thresholdCoefficient[FLM_MOUSE_EVENT_TYPE::MOUSE_CLICK]);
+        m_runtimeOptions.falseTriggerRate = (float)ini.GetDoubleValue(section, "FalseTriggerRate", m_runtimeOptions.falseTriggerRate);
         m_runtimeOptions.initAMFUsingDX12 = (int)ini.GetLongValue(section, "InitAMFUsingDX12", m_runtimeOptions.initAMFUsingDX12);
 
 
@@ -148,10 +146,34 @@ FLM_STATUS FLM_Pipeline::loadUserSettings()
         m_setting.iNumDequantizationPhases = std::clamp((int)ini.GetLongValue(section, "NumDequantizingPhases", m_setting.iNumDequantizationPhases), 1, 3);
         m_setting.outputFileName           = ini.GetValue(section, "OutputFile", m_setting.outputFileName.c_str());
         m_setting.saveToFile               = ini.GetBoolValue(section, "SaveToFile", m_setting.saveToFile);
+        m_setting.saveSampleLog            = ini.GetBoolValue(section, "SaveSampleLog", m_setting.saveSampleLog);
+        m_setting.sampleLogFileName        = ini.GetValue(section, "SampleLogFile", m_setting.sampleLogFileName.c_str());
+        m_setting.eventStream              = ini.GetValue(section, "EventStream", m_setting.eventStream.c_str());
+        m_setting.metricsPort              = std::clamp((int)ini.GetLongValue(section, "MetricsPort", m_setting.metricsPort), 0, 65535);
+        m_setting.sharedTelemetry          = ini.GetBoolValue(section, "SharedTelemetry", m_setting.sharedTelemetry);
+        m_setting.traceFile                = ini.GetValue(section, "TraceFile", m_setting.traceFile.c_str());
+        m_setting.traceKeys                = ini.GetValue(section, "TraceKeys", m_setting.traceKeys.c_str());
+        m_setting.reportStageTimings       = ini.GetBoolValue(section, "ReportStageTimings", m_setting.reportStageTimings);
         m_setting.showAdvancedMeasurements = ini.GetBoolValue(section, "ShowAdvancedMeasurements", m_setting.showAdvancedMeasurements);
         m_setting.showBoundingBox          = ini.GetBoolValue(section, "ShowBoundingBox", m_setting.showBoundingBox);
         m_setting.validateCaptureKeys      = ini.GetValue(section, "ValidateCaptureKeys", m_setting.validateCaptureKeys.c_str());
         m_setting.validateCaptureNumOfFrames = std::clamp((int)ini.GetLongValue(section, "ValidateCaptureNumOfFrames", m_setting.validateCaptureNumOfFrames), 1, 999);
+        m_setting.estimateRefreshRate      = ini.GetBoolValue(section, "EstimateRefreshRate", m_setting.estimateRefreshRate);
+        m_setting.projectionDetector       = ini.GetBoolValue(section, "ProjectionDetector", m_setting.projectionDetector);
+        m_setting.projectionLearnPolarity  = ini.GetBoolValue(section, "ProjectionLearnPolarity", m_setting.projectionLearnPolarity);
+        m_setting.settleFrames             = std::clamp((int)ini.GetLongValue(section, "SettleFrames", m_setting.settleFrames), 0, 16);
+        m_setting.settleFramesClick        = std::clamp((int)ini.GetLongValue(section, "SettleFramesClick", m_setting.settleFramesClick), 0, 16);
+        m_setting.warmupDetections         = std::clamp((int)ini.GetLongValue(section, "WarmupDetections", m_setting.warmupDetections), 0, 16);
+        m_setting.autoAffinityCores        = std::clamp((int)ini.GetLongValue(section, "AutoAffinityCores", m_setting.autoAffinityCores), 1, 64);
+        m_setting.regions                  = ini.GetValue(section, "Regions", m_setting.regions.c_str());
+        m_setting.additionalOutputs        = ini.GetValue(section, "AdditionalOutputs", m_setting.additionalOutputs.c_str());
+
+        for (int role = 0; role < (int)FLM_THREAD_ROLE::COUNT; role++)
+        {
+            std::string name = FlmGetThreadRoleName((FLM_THREAD_ROLE)role);
+            m_setting.threadAffinity[role] = ini.GetValue(section, (name + "ThreadAffinity").c_str(), m_setting.threadAffinity[role].c_str());
+            m_setting.threadPriority[role] = ini.GetValue(section, (name + "ThreadPriority").c_str(), m_setting.threadPriority[role].c_str());
+        }
 
         // Check m_codec is at auto: user has not selected an override from command line
         // else use ini setting
@@ -169,6 +191,9 @@ FLM_STATUS FLM_Pipeline::loadUserSettings()
             if (codec.compare("dxgi") == 0)
                 m_codec = FLM_CAPTURE_CODEC_TYPE::DXGI;
             else
+            if (codec.compare("synthetic") == 0)
+                m_codec = FLM_CAPTURE_CODEC_TYPE::SYNTHETIC;
+            else
             {
                 FlmPrintError("Error reading flm.ini file codec %s is not supported",codec.c_str());
                 return FLM_STATUS::FAILED;
@@ -205,14 +230,9 @@ FLM_STATUS FLM_Pipeline::InitSettings()
     // Mouse
     m_runtimeOptions.mouseEventType = FLM_MOUSE_EVENT_TYPE::MOUSE_MOVE;
     m_iiMouseMoveEventTime          = 0L;
-    m_hMouseThread                  = NULL;
     m_iMeasurementPhaseCounter      = 0;
 
-    // Keyboard
-    m_hKbdThread = NULL;
-
     // Capture
-    m_hCaptureThread                = NULL;
     m_eventMovementDetected         = NULL;
     m_iDequantizingPhaseCounter     = 0;
     m_iiMotionDetectedFrameFlipTime = 0L;
@@ -249,6 +269,38 @@ FLM_STATUS FLM_Pipeline::InitSettings()
             FlmPrintError("Parsing flm.ini for ValidateCaptureKeys: %s", m_keyboard.GetErrorMessage().c_str());
             return FLM_STATUS::INIT_FAILED;
         }
+
+        if (m_keyboard.SetKeys(m_setting.traceKeys, m_traceKeys) == false)
+        {
+            FlmPrintError("Parsing flm.ini for TraceKeys: %s", m_keyboard.GetErrorMessage().c_str());
+            return FLM_STATUS::INIT_FAILED;
+        }
+
+        if (ResolveThreadPolicies() != FLM_STATUS::OK)
+            return FLM_STATUS::INIT_FAILED;
+
+        if ((m_runtimeOptions.falseTriggerRate < 0.0f) || (m_runtimeOptions.falseTriggerRate >= 0.5f))
+        {
+            FlmPrintError("Parsing flm.ini for FalseTriggerRate: %g is not 0 or a probability below 0.5", m_runtimeOptions.falseTriggerRate);
+            return FLM_STATUS::INIT_FAILED;
+        }
+
+        std::vector<FLM_REGION_SETTINGS> regions;
+        std::string                      regionError;
+        if (FlmParseRegions(m_setting.regions, regions, regionError) == false)
+        {
+            FlmPrintError("Parsing flm.ini for Regions: %s", regionError.c_str());
+            return FLM_STATUS::INIT_FAILED;
+        }
+        m_regions.Configure(regions);
+
+        // The primary output is the main display, output 0
+        std::string outputError;
+        if (FlmParseOutputs(m_setting.additionalOutputs, 0, m_additionalOutputs, outputError) == false)
+        {
+            FlmPrintError("Parsing flm.ini for AdditionalOutputs: %s", outputError.c_str());
+            return FLM_STATUS::INIT_FAILED;
+        }
     }
     else
         return FLM_STATUS::INIT_FAILED;
@@ -256,6 +308,55 @@ FLM_STATUS FLM_Pipeline::InitSettings()
     return FLM_STATUS::OK;
 }
 
+FLM_STATUS FLM_Pipeline::ResolveThreadPolicies()
+{
+    bool bAutoAffinity = false;
+
+    for (int role = 0; role < (int)FLM_THREAD_ROLE::COUNT; role++)
+    {
+        const char* name = FlmGetThreadRoleName((FLM_THREAD_ROLE)role);
+        if (FlmParseThreadAffinity(m_setting.threadAffinity[role], m_threadPolicy[role]) == false)
+        {
+            FlmPrintError("Parsing flm.ini for %sThreadAffinity: %s is not auto or a processor mask", name, m_setting.threadAffinity[role].c_str());
+            return FLM_STATUS::INIT_FAILED;
+        }
+        if (FlmParseThreadPriority(m_setting.threadPriority[role], m_threadPolicy[role]) == false)
+        {
+            FlmPrintError("Parsing flm.ini for %sThreadPriority: %s is not a thread priority", name, m_setting.threadPriority[role].c_str());
+            return FLM_STATUS::INIT_FAILED;
+        }
+        bAutoAffinity |= m_threadPolicy[role].bAutoAffinity;
+    }
+
+    if (bAutoAffinity == false)
+        return FLM_STATUS::OK;
+
+    // Short enough not to be noticed at start up, long enough to see the load of a running game
+    uint64_t iiAutoMask = FlmGetLeastLoadedCores(m_setting.autoAffinityCores, 250);
+    if (iiAutoMask == 0)
+        FlmPrint("Warning: Unable to read the processor load, the auto thread affinity keeps the OS default\n");
+
+    for (int role = 0; role < (int)FLM_THREAD_ROLE::COUNT; role++)
+    {
+        if (m_threadPolicy[role].bAutoAffinity)
+            m_threadPolicy[role].affinityMask = iiAutoMask;
+    }
+
+    return FLM_STATUS::OK;
+}
+
+void FLM_Pipeline::ApplyThreadPolicy(FLM_THREAD_ROLE role, HANDLE hThread)
+{
+    const FLM_THREAD_POLICY& policy = m_threadPolicy[(int)role];
+    if ((policy.affinityMask == 0) && (policy.priority == FLM_THREAD_PRIORITY_DEFAULT))
+        return;
+
+    if (FlmApplyThreadPolicy(hThread, policy))
+        FlmPrint("%s thread: %s\n", FlmGetThreadRoleName(role), FlmThreadPolicyToString(policy).c_str());
+    else
+        FlmPrint("Warning: Unable to set the %s thread affinity or priority to %s\n", FlmGetThreadRoleName(role), FlmThreadPolicyToString(policy).c_str());
+}
+
 // Feed back of processed data in Operational Mode
 // Optional output to a file stream is also provided
 void FLM_Pipeline::PrintStream(const char* Format, ...)
@@ -277,6 +378,100 @@ void FLM_Pipeline::PrintStream(const char* Format, ...)
         g_pUserCallBack(FLM_PROCESS_MESSAGE_TYPE::PRINT, buff);
 }
 
+void FLM_Pipeline::BuildSessionMetadata()
+{
+    static const char* vendorNames[] = {"unknown", "AMD", "Nvidia", "Intel"};
+
+    time_t    now = time(NULL);
+    struct tm utc;
+    gmtime_s(&utc, &now);
+    char startTime[32];
+    strftime(startTime, sizeof(startTime), "%Y-%m-%dT%H:%M:%SZ", &utc);
+
+    LARGE_INTEGER qpcFrequency = m_timer_performance.GetFrequency();
+
+    FLM_Session_Metadata& m = m_sessionMetadata;
+    m.Clear();
+
+    // Session
+    m.Add("flm_version", VERSION_TEXT);
+    m.Add("start_time", startTime);
+    m.Add("codec", GetCodecName());
+    m.Add("vendor", vendorNames[std::clamp((int)m_vendor, 0, 3)]);
+    m.Add("startup_ms", (double)m_fStartupMS);
+    m.Add("display_width", (int)m_capture->m_iBackBufferWidth);
+    m.Add("display_height", (int)m_capture->m_iBackBufferHeight);
+    m.Add("refresh_rate", m_runtimeOptions.monitorRefreshRate);
+    m.Add("estimated_refresh_rate", (double)m_runtimeOptions.estimatedRefreshRate);
+    m.Add("vrr", m_runtimeOptions.vrrDetected);
+    m.Add("capture_x", m_runtimeOptions.iCaptureX);
+    m.Add("capture_y", m_runtimeOptions.iCaptureY);
+    m.Add("capture_width", m_runtimeOptions.iCaptureWidth);
+    m.Add("capture_height", m_runtimeOptions.iCaptureHeight);
+    m.Add("ticks_per_second", (int64_t)AMF_SECOND);
+    m.Add("qpc_frequency", (int64_t)qpcFrequency.QuadPart);
+
+    // Runtime options and the settings they were loaded from, named as in flm.ini
+    m.Add("PIPELINE.MouseEventType", (int)m_runtimeOptions.mouseEventType);
+    m.Add("PIPELINE.ThresholdCoefficientMove", (double)m_runtimeOptions.thresholdCoefficient[FLM_MOUSE_EVENT_TYPE::MOUSE_MOVE]);
+    m.Add("PIPELINE.ThresholdCoefficientClick", (double)m_runtimeOptions.thresholdCoefficient[FLM_MOUSE_EVENT_TYPE::MOUSE_CLICK]);
+    m.Add("PIPELINE.FalseTriggerRate", (double)m_runtimeOptions.falseTriggerRate);
+    m.Add("PIPELINE.AutoBias", m_runtimeOptions.autoBias);
+    m.Add("PIPELINE.BiasOffset", (double)m_runtimeOptions.biasOffset);
+    m.Add("PIPELINE.PrintLevel", (int)m_runtimeOptions.printLevel);
+    m.Add("PIPELINE.GameUsesFrameGeneration", m_runtimeOptions.gameUsesFrameGeneration);
+    m.Add("PIPELINE.InitAMFUsingDX12", m_runtimeOptions.initAMFUsingDX12);
+    m.Add("PIPELINE.MinimizeApplication", m_runtimeOptions.minimizeApp);
+    m.Add("PIPELINE.MeasurementsPerLine", (int)m_setting.iNumMeasurementsPerLine);
+    m.Add("PIPELINE.NumDequantizingPhases", m_setting.iNumDequantizationPhases);
+    m.Add("PIPELINE.MouseHorizontalStep", m_setting.iMouseHorizontalStep);
+    m.Add("PIPELINE.ExtraWaitMilliseconds", (double)m_setting.extraWaitMilliseconds);
+    m.Add("PIPELINE.ExtraWaitFrames", m_setting.extraWaitFrames);
+    m.Add("PIPELINE.ExtraWaitMillisecondsFG", (double)m_setting.extraWaitMillisecondsFG);
+    m.Add("PIPELINE.ExtraWaitFramesFG", m_setting.extraWaitFramesFG);
+    m.Add("PIPELINE.ShowAdvancedMeasurements", m_setting.showAdvancedMeasurements);
+    m.Add("PIPELINE.EstimateRefreshRate", m_setting.estimateRefreshRate);
+    m.Add("PIPELINE.ProjectionDetector", m_setting.projectionDetector);
+    m.Add("PIPELINE.ProjectionLearnPolarity", m_setting.projectionLearnPolarity);
+    m.Add("PIPELINE.SettleFrames", m_setting.settleFrames);
+    m.Add("PIPELINE.SettleFramesClick", m_setting.settleFramesClick);
+    m.Add("PIPELINE.WarmupDetections", m_setting.warmupDetections);
+    m.Add("PIPELINE.MonitorCalibration_240Hz", (double)m_setting.monitorCalibration_240Hz);
+    m.Add("PIPELINE.MonitorCalibration_144Hz", (double)m_setting.monitorCalibration_144Hz);
+    m.Add("PIPELINE.MonitorCalibration_120Hz", (double)m_setting.monitorCalibration_120Hz);
+    m.Add("PIPELINE.MonitorCalibration_60Hz", (double)m_setting.monitorCalibration_60Hz);
+    m.Add("PIPELINE.MonitorCalibration_50Hz", (double)m_setting.monitorCalibration_50Hz);
+    m.Add("PIPELINE.MonitorCalibration_24Hz", (double)m_setting.monitorCalibration_24Hz);
+    m.Add("PIPELINE.SaveToFile", m_setting.saveToFile);
+    m.Add("PIPELINE.OutputFile", m_setting.outputFileName);
+    m.Add("PIPELINE.SaveSampleLog", m_setting.saveSampleLog);
+    m.Add("PIPELINE.SampleLogFile", m_setting.sampleLogFileName);
+    m.Add("PIPELINE.EventStream", m_setting.eventStream);
+    m.Add("PIPELINE.MetricsPort", m_setting.metricsPort);
+    m.Add("PIPELINE.SharedTelemetry", m_setting.sharedTelemetry);
+    m.Add("PIPELINE.ReportStageTimings", m_setting.reportStageTimings);
+    m.Add("PIPELINE.MeasurementKeys", m_setting.measurementKeys);
+    m.Add("PIPELINE.AutoAffinityCores", m_setting.autoAffinityCores);
+    m.Add("PIPELINE.Regions", m_setting.regions);
+    m.Add("PIPELINE.AdditionalOutputs", m_setting.additionalOutputs);
+    for (int i = 0; i < m_outputs.GetCount(); i++)
+        m.Add(("refresh_rate_output_" + std::to_string(m_outputs.GetOutput(i))).c_str(), m_outputs.GetStats(i).refreshRate);
+    for (int role = 0; role < (int)FLM_THREAD_ROLE::COUNT; role++)
+    {
+        // Resolved, so that the cores picked by the auto affinity are recorded
+        std::string key = std::string("PIPELINE.") + FlmGetThreadRoleName((FLM_THREAD_ROLE)role) + "Thread";
+        m.Add(key.c_str(), FlmThreadPolicyToString(m_threadPolicy[role]));
+    }
+
+    const FLM_CAPTURE_SETTINGS& capture = m_capture->m_setting;
+    m.Add("CAPTURE.StartX", (double)capture.fStartX);
+    m.Add("CAPTURE.StartY", (double)capture.fStartY);
+    m.Add("CAPTURE.CaptureWidth", (double)capture.fCaptureWidth);
+    m.Add("CAPTURE.CaptureHeight", (double)capture.fCaptureHeight);
+    m.Add("CAPTURE.AVGFilterFrames", capture.iAVGFilterFrames);
+    m.Add("CAPTURE.FilmGrainThreshold", capture.iFilmGrainThreshold);
+}
+
 void FLM_Pipeline::CreateCSV()
 {
     if (m_outputFile != NULL)
@@ -287,6 +482,8 @@ void FLM_Pipeline::CreateCSV()
     // Print CSV file header
     if (m_outputFile != NULL)
     {
+        m_sessionMetadata.WriteComments(m_outputFile);
+
         if (m_setting.showAdvancedMeasurements)
         {
             fprintf(m_outputFile, "FPS,Odd,Even,");
@@ -387,6 +584,9 @@ void FLM_Pipeline::PrintAverageTelemetry(float fFrameLatencyMS)
             // Save to CSV file telemetry data
             if (m_setting.saveToFile)
                 SaveTelemetryCSV();
+
+            if (m_eventStream.IsOpen())
+                m_eventStream.WriteRow(m_telemetry);
         }
     }
 
@@ -454,6 +654,9 @@ void FLM_Pipeline::PrintOperationalTelemetry(float fFrameLatencyMS, bool bFull)
             // Save to CSV file telemetry data
             if (m_setting.saveToFile)
                 SaveTelemetryCSV();
+
+            if (m_eventStream.IsOpen())
+                m_eventStream.WriteRow(m_telemetry);
         }
     }
 }
@@ -471,10 +674,19 @@ void FLM_Pipeline::PrintDebugTelemetry(float fFrameLatencyMS)
                 fFPS,
                 m_capture->m_fMovingAverageFrameTimeMS,
                 fPrintTimeMS,
-                (int)m_capture->m_fBackgroundSAD, m_iSAD, m_iThSAD,
+                (int)m_capture->m_background.fBackgroundSAD, m_iSAD, m_iThSAD,
                 fFrameLatencyMS,
                 fFrameLatencyMS / m_capture->m_fMovingAverageFrameTimeMS - 0.5f);
 
+    if (m_runtimeOptions.estimatedRefreshRate > 0.0f)
+        PrintStream("Hz =%5.1f%s ", m_runtimeOptions.estimatedRefreshRate, m_runtimeOptions.vrrDetected ? " VRR" : "");
+
+    // Shift and correlation of the profiles, or the estimated probability that a frame without input motion is detected as motion
+    if (m_setting.projectionDetector && (m_runtimeOptions.mouseEventType == FLM_MOUSE_EVENT_TYPE::MOUSE_MOVE))
+        PrintStream("Shift =%4d,%4d r =%5.2f ", m_projection.GetShiftX(), m_projection.GetShiftY(), m_projection.GetCorrelation());
+    else
+        PrintStream("FT =%6.4f ", m_capture->m_background.fFalseTriggerRate);
+
     if (m_iThSAD > 0)
         PrintStream(" ==> motion detected!");
 
@@ -492,6 +704,184 @@ void FLM_Pipeline::PrintDebugTelemetry(float fFrameLatencyMS)
         Sleep(10);
 }
 
+void FLM_Pipeline::LogSample(int64_t iiInjectTime, bool bMeasurement)
+{
+    FLM_SAMPLE_RECORD sample;
+    sample.injectTime     = iiInjectTime;
+    sample.presentTime    = m_iiFrameTimeStamp;
+    sample.frameIdx       = m_iiFrameIdx;
+    sample.sad            = m_iSAD;
+    sample.thresholdedSAD = m_iThSAD;
+    sample.latencyMS      = bMeasurement ? m_fLatestMeasuredLatencyMS : 0.0f;
+    sample.flags          = 0;
+
+    if (bMeasurement)
+        sample.flags |= FLM_SAMPLE_FLAG_MEASUREMENT;
+    if (m_iThSAD != 0)
+        sample.flags |= FLM_SAMPLE_FLAG_MOTION;
+    if (m_iiFrameIdx == m_iiFrameIdxPrev)
+        sample.flags |= FLM_SAMPLE_FLAG_REPEAT_FRAME;
+    if (m_runtimeOptions.mouseEventType == FLM_MOUSE_EVENT_TYPE::MOUSE_CLICK)
+        sample.flags |= FLM_SAMPLE_FLAG_MOUSE_CLICK;
+
+    m_sampleLog.Push(sample);
+}
+
+void FLM_Pipeline::PublishMetrics()
+{
+    m_metrics.measuring        = m_bMeasuringInProgress;
+    m_metrics.fps              = m_telemetry.fps;
+    m_metrics.fpsOdd           = m_telemetry.fpsOdd;
+    m_metrics.fpsEven          = m_telemetry.fpsEven;
+    m_metrics.accLatency       = m_telemetry.accLatency;
+    m_metrics.accFrames        = m_telemetry.accFrames;
+    m_metrics.rowLatency       = m_telemetry.rowLatency;
+    m_metrics.rowFrames        = m_telemetry.rowFrames;
+    m_metrics.backgroundSAD    = m_capture->m_background.fBackgroundSAD;
+    m_metrics.threshold        = m_capture->m_background.GetThreshold(m_runtimeOptions.thresholdCoefficient[m_runtimeOptions.mouseEventType], m_runtimeOptions.falseTriggerRate);
+    m_metrics.falseTriggerRate = m_capture->m_background.fFalseTriggerRate;
+
+    m_metricsServer.Publish(m_metrics);
+}
+
+void FLM_Pipeline::PublishSharedTelemetry()
+{
+    FLM_SHARED_TELEMETRY shared = {};
+    shared.measuring            = m_bMeasuringInProgress ? 1 : 0;
+    shared.fps                  = m_telemetry.fps;
+    shared.fpsOdd               = m_telemetry.fpsOdd;
+    shared.fpsEven              = m_telemetry.fpsEven;
+    shared.accLatency           = m_telemetry.accLatency;
+    shared.accFrames            = m_telemetry.accFrames;
+    shared.accFps               = m_telemetry.accFps;
+    shared.rowLatency           = m_telemetry.rowLatency;
+    shared.rowFrames            = m_telemetry.rowFrames;
+    shared.rowSize              = std::min<int32_t>((int32_t)m_telemetry.lMeasurementMS.size(), FLM_SHARED_TELEMETRY_MAX_ROW_SIZE);
+    for (int i = 0; i < shared.rowSize; i++)
+        shared.rowMeasurementMS[i] = m_telemetry.lMeasurementMS[i];
+
+    shared.latestLatency    = m_fLatestMeasuredLatencyMS;
+    shared.numMeasurements  = m_iCumulativeLatencySamples;
+    shared.frameIdx         = m_iiFrameIdx;
+    shared.frameTimeStamp   = m_iiFrameTimeStamp;
+    shared.sad              = m_iSAD;
+    shared.thresholdedSAD   = m_iThSAD;
+    shared.backgroundSAD    = m_capture->m_background.fBackgroundSAD;
+    shared.threshold        = m_capture->m_background.GetThreshold(m_runtimeOptions.thresholdCoefficient[m_runtimeOptions.mouseEventType], m_runtimeOptions.falseTriggerRate);
+    shared.falseTriggerRate = m_capture->m_background.fFalseTriggerRate;
+
+    m_sharedTelemetry.Publish(shared);
+}
+
+void FLM_Pipeline::ExportTrace()
+{
+    if (FlmTraceExport(m_setting.traceFile.c_str()))
+        PrintStream("\nTrace saved to %s\n", m_setting.traceFile.c_str());
+}
+
+void FLM_Pipeline::ProcessRegionMeasurements(int iSession, const FLM_DETECTION_SETTINGS& settings, int64_t iiInjectTime)
+{
+    uint32_t measured = m_regions.Detect(iSession, settings, iiInjectTime, m_iiFrameIdx, m_iiFrameTimeStamp, AMF_MILLISECOND);
+    for (int i = 0; i < m_regions.GetCount(); i++)
+    {
+        const FLM_REGION& region = m_regions.GetRegion(i);
+        if (region.detection.GetTransitionCount() != m_iReportedRegionTransitions[i])
+            ReportDetectionTransitions(region.detection, m_iReportedRegionTransitions[i], ("region:" + region.setting.name).c_str());
+        if ((measured & (1u << i)) == 0)
+            continue;
+
+        FLM_TRACE_INSTANT("RegionDetect");
+        if (m_eventStream.IsOpen())
+            m_eventStream.WriteRegionMeasurement(region.setting.name.c_str(), region.count, region.latestMS, m_iiFrameIdx, m_iiFrameTimeStamp);
+    }
+}
+
+void FLM_Pipeline::PrintRegionSummary()
+{
+    PrintStream("\nRegions: measurements   avg ms   min ms   max ms\n");
+    for (int i = 0; i < m_regions.GetCount(); i++)
+    {
+        const FLM_REGION& region = m_regions.GetRegion(i);
+        PrintStream("  %-12s %12d %8.2f %8.2f %8.2f\n", region.setting.name.c_str(), region.count, region.averageMS, region.minMS, region.maxMS);
+    }
+}
+
+void FLM_Pipeline::ProcessOutputMeasurements(int iSession, const FLM_DETECTION_SETTINGS& settings, int64_t iiInjectTime)
+{
+    m_outputs.SetSession(iSession, settings);
+    if (iSession != 0)
+        m_outputs.AddInjection(iiInjectTime);
+
+    uint32_t measured = m_outputs.Process(AMF_MILLISECOND);
+    for (int i = 0; i < m_outputs.GetCount(); i++)
+    {
+        const FLM_Detection_State_Machine& detection = m_outputs.GetDetection(i);
+        if (detection.GetTransitionCount() != m_iReportedOutputTransitions[i])
+        {
+            char source[32];
+            snprintf(source, sizeof(source), "output:%d", m_outputs.GetOutput(i));
+            ReportDetectionTransitions(detection, m_iReportedOutputTransitions[i], source);
+        }
+        if ((measured & (1u << i)) == 0)
+            continue;
+
+        const FLM_OUTPUT_STATS& stats = m_outputs.GetStats(i);
+        FLM_TRACE_INSTANT("OutputDetect");
+        if (i < (int)m_syntheticOutputs.size())
+            m_syntheticOutputs[i]->AddMeasurement(m_outputs.GetMeasuredInjectTime(i), stats.latestMS);
+        if (m_eventStream.IsOpen())
+            m_eventStream.WriteOutputMeasurement(m_outputs.GetOutput(i), stats.count, stats.latestMS, m_outputs.GetMeasuredFrameIdx(i), m_outputs.GetMeasuredTimeStamp(i));
+    }
+}
+
+void FLM_Pipeline::PrintOutputSummary()
+{
+    PrintStream("\nOutputs:  Hz  measurements   avg ms   min ms   max ms  vs primary ms    frames  dropped\n");
+    for (int i = 0; i < m_outputs.GetCount(); i++)
+    {
+        const FLM_OUTPUT_STATS& stats = m_outputs.GetStats(i);
+        PrintStream("  %-5d %4d %13d %8.2f %8.2f %8.2f %14.2f %9lld %8lld\n", m_outputs.GetOutput(i), stats.refreshRate, stats.count, stats.averageMS,
+                    stats.minMS, stats.maxMS, stats.deltaAverageMS, stats.framesCaptured, stats.framesDropped + stats.ringOverflows);
+    }
+}
+
+void FLM_Pipeline::PrintStageTimings()
+{
+    PrintStream("\nStage timings [us]   count      p50      p90      p99      max\n");
+    for (int s = 0; s < (int)FLM_STAGE::COUNT; s++)
+    {
+        FLM_STAGE stage = (FLM_STAGE)s;
+        uint64_t  count = m_stageTimings.GetCount(stage);
+        if (count == 0)
+            continue;
+
+        PrintStream("%-16s %9llu %8.1f %8.1f %8.1f %8.1f\n",
+                    FLM_Stage_Timings::GetName(stage),
+                    (unsigned long long)count,
+                    m_stageTimings.GetPercentileUS(stage, 50.0),
+                    m_stageTimings.GetPercentileUS(stage, 90.0),
+                    m_stageTimings.GetPercentileUS(stage, 99.0),
+                    m_stageTimings.GetMaxUS(stage));
+    }
+
+    // Precision of the mouse input time, it sets the floor of the measurement precision
+    FLM_SLEEP_STATS sleep = m_timer.GetSleepStats();
+    if (sleep.count > 0)
+    {
+        PrintStream("%-16s %9llu %8.1f %8.1f %8.1f %8.1f\n", "Sleep wake error", (unsigned long long)sleep.count, sleep.p50US, sleep.p90US, sleep.p99US, sleep.maxUS);
+        PrintStream("%s sleep timer, spin margin %.0f us\n", sleep.bHighResolution ? "High resolution" : "Standard", sleep.spinMarginUS);
+    }
+}
+
+const char* FLM_Pipeline::GetCodecName()
+{
+    if (m_codec == FLM_CAPTURE_CODEC_TYPE::AMF)
+        return "AMF";
+    if (m_codec == FLM_CAPTURE_CODEC_TYPE::SYNTHETIC)
+        return "SYNTHETIC";
+    return "DXGI";
+}
+
 void FLM_Pipeline::UpdateAverageLatency(float fLatencyMS)
 {
     PIPELINE_DEBUG_PRINT_STACK()
@@ -539,30 +929,71 @@ void FLM_send_mouse_move_event(int iHorzStep)
     //mouse_event(MOUSEEVENTF_MOVE, (DWORD)iHorzStep, 0, 0, 0); // too slow
 }
 
-DWORD WINAPI FLM_Pipeline::MouseEventThreadFunctionStub(LPVOID lpParameter)
+
+// Only signals the changes, Process() runs for every frame
+void FLM_Pipeline::UpdateSADSettled()
 {
-    PIPELINE_DEBUG_PRINT_STACK()
+    bool bSettled = (m_iSAD == 0);
+    if (bSettled == m_bSADSettled)
+        return;
 
-    FLM_Pipeline* p = reinterpret_cast<FLM_Pipeline*>(lpParameter);
-    p->MouseEventThreadFunction();
-    return 0;
+    m_bSADSettled = bSettled;
+    if (bSettled)
+        SetEvent(m_eventSADSettled);
+    else
+        ResetEvent(m_eventSADSettled);
 }
 
-// Wait for the game to respond
-bool FLM_Pipeline::WaitForFrameDetection()
+// Wakes the mouse thread in WaitForFrameDetection(), the next mouse move is timed from the flip of the detected frame
+void FLM_Pipeline::SignalDetection()
 {
-    ResetEvent(m_eventMovementDetected);
-    DWORD dwWaitResult;
-    for (int i = 0; i < 20; i++)
+    if (m_codec == FLM_CAPTURE_CODEC_TYPE::AMF)
+        m_iiMotionDetectedFrameFlipTime = m_timer.TranslateAmfTimeToPerformanceCounter(m_iiFrameTimeStamp);
+    else
+        m_iiMotionDetectedFrameFlipTime = m_iiFrameTimeStamp;
+
+    m_iiDetectSignalTime.store(GetTimeStamp().QuadPart, std::memory_order_relaxed);
+    SetEvent(m_eventMovementDetected);
+}
+
+// The transitions of detection since iReported on the trace time line and in the event stream, source names the
+// capture region, region or output the machine detects motion in
+void FLM_Pipeline::ReportDetectionTransitions(const FLM_Detection_State_Machine& detection, uint64_t& iReported, const char* source)
+{
+    uint64_t count = detection.GetTransitionCount();
+    if (count - iReported > FLM_DETECTION_HISTORY)
+        iReported = count - FLM_DETECTION_HISTORY;
+
+    for (; iReported < count; iReported++)
     {
-        dwWaitResult = WaitForSingleObject(m_eventMovementDetected, 50);  // 20*50ms == 1 sec
-        if (dwWaitResult != WAIT_TIMEOUT)
-            break;
+        const FLM_DETECTION_TRANSITION& transition = detection.GetTransition(iReported);
+        FLM_TRACE_INSTANT(transition.reason);
+        if (m_eventStream.IsOpen())
+            m_eventStream.WriteDetection(source,
+                                         FlmGetDetectionStateName(transition.from),
+                                         FlmGetDetectionStateName(transition.to),
+                                         FlmGetDetectionEventName(transition.event),
+                                         transition.reason,
+                                         transition.iiFrameIdx,
+                                         transition.iiInjectTime);
     }
+}
 
-    if (dwWaitResult == WAIT_TIMEOUT)
+// Wait for the game to respond
+bool FLM_Pipeline::WaitForFrameDetection()
+{
+    FLM_TRACE_SCOPE("WaitForFrameDetection");
+    ResetEvent(m_eventMovementDetected);
+    m_iiDetectSignalTime.store(0, std::memory_order_relaxed);
+    // Returns at once when the mouse thread is stopped
+    if (m_mouseThread.GetStopToken().Wait(m_eventMovementDetected, FLM_DETECTION_TIMEOUT_MS) == false)
         return false;
 
+    // Zero when the event was set by StopMeasurements()
+    int64_t iiSignalTime = m_iiDetectSignalTime.exchange(0, std::memory_order_relaxed);
+    if ((m_pStageTimings != NULL) && (iiSignalTime != 0))
+        m_pStageTimings->Add(FLM_STAGE::MOUSE_WAKEUP, GetTimeStamp().QuadPart - iiSignalTime);
+
     return true;
 }
 
@@ -572,8 +1003,13 @@ void FLM_Pipeline::SendMouseMove()
     const bool bAMF = (m_codec == FLM_CAPTURE_CODEC_TYPE::AMF) ? true : false;
 
     int64_t iiMouseEventTime0 = bAMF ? m_timer.now() : GetTimeStamp().QuadPart; // Used for sanity check only
-    FLM_send_mouse_move_event(m_setting.iMouseHorizontalStep);
+    if (m_pSynthetic == NULL)
+        FLM_send_mouse_move_event(m_setting.iMouseHorizontalStep);
+    m_iMouseMoveStep          = m_setting.iMouseHorizontalStep;
     m_iiMouseMoveEventTime    = bAMF ? m_timer.now() : GetTimeStamp().QuadPart; // Measure time after the slow(-ish) function returns...
+    if (m_pSynthetic != NULL)
+        InjectSyntheticInput(m_iiMouseMoveEventTime, true);
+    FLM_TRACE_INSTANT("Inject");
 
 #ifdef _DEBUG
     if ((m_iiMouseMoveEventTime - iiMouseEventTime0) > 5000)  // More than 50us?!
@@ -586,45 +1022,59 @@ void FLM_Pipeline::SendMouseMove()
     m_setting.iMouseHorizontalStep = -m_setting.iMouseHorizontalStep;
 }
 
-void FLM_Pipeline::MouseEventThreadFunction()
+// The virtual displays of all outputs show the same game
+void FLM_Pipeline::InjectSyntheticInput(int64_t iiInjectTime, bool bCounted)
+{
+    m_pSynthetic->InjectInput(iiInjectTime, bCounted);
+    for (FLM_Capture_Synthetic* pOutput : m_syntheticOutputs)
+        pOutput->InjectInput(iiInjectTime, bCounted);
+}
+
+void FLM_Pipeline::MouseEventThreadFunction(const FLM_Stop_Token& stop)
 {
     PIPELINE_DEBUG_PRINT_MouseEventThreadFunction("%-38s\n", __FUNCTION__);
-    m_bExitMouseThread   = false;
+    FlmTraceSetThreadName("Mouse");
     const int CYCLE_SIZE = m_setting.iNumMeasurementsPerLine;
-    for (; m_bTerminateMouseThread == false;)
+    while (stop.StopRequested() == false)
     {
         if (m_bMeasuringInProgress)
         {
             if (m_runtimeOptions.mouseEventType == FLM_MOUSE_EVENT_TYPE::MOUSE_CLICK)
             {
-                while (m_iSAD > 0)
-                {
-                    Sleep(0);
-                    if (m_bTerminateMouseThread)
-                        break;
-                }
+                // Wait for the motion of the previous click to settle. The waits are bounded so that
+                // stopping the measurements or the thread is noticed.
+                if (stop.Wait(m_eventSADSettled, 50) == false)
+                    continue;
 
-                if (m_mouse.IsButtonDown(MOUSE_LEFT_BUTTON))
+                int64_t iiButtonDownTime = 0;
+                if (m_mouse.WaitForButtonDown(MOUSE_LEFT_BUTTON, 50, &iiButtonDownTime, stop.GetEvent()))
                 {
                     m_bMouseClickDetected = false;
-                    m_timer_performance.Start();
+                    m_iiClickTime.store(iiButtonDownTime, std::memory_order_relaxed);
+                    m_timer_performance.Start(iiButtonDownTime);
                     if (WaitForFrameDetection())
                     {
                         // save latency result
                         m_fLatestMeasuredLatencyMS = (float)m_timer_performance.Stop_ms();
                         m_bMouseClickDetected      = true;
-                        while (m_mouse.IsButtonDown(MOUSE_LEFT_BUTTON))
-                        {
-                            if (m_bTerminateMouseThread)
-                                break;
-                        }
+                        while ((m_mouse.WaitForButtonUp(MOUSE_LEFT_BUTTON, 50, stop.GetEvent()) == false) && (stop.StopRequested() == false))
+                            ;
                     }
                 }
             }
             else if (m_runtimeOptions.mouseEventType == FLM_MOUSE_EVENT_TYPE::MOUSE_MOVE)
             {
                 SendMouseMove();
-                if (WaitForFrameDetection())
+                int64_t iiInjectTime = m_iiMouseMoveEventTime;
+                if (WaitForFrameDetection() == false)
+                {
+                    FLM_TRACE_INSTANT("Timeout");
+
+                    // The wait also returns early when the thread is stopped, that is not a timeout
+                    if (m_bMeasuringInProgress && m_eventStream.IsOpen() && (stop.StopRequested() == false))
+                        m_eventStream.WriteTimeout(iiInjectTime, FLM_DETECTION_TIMEOUT_MS);
+                }
+                else
                 {
                     // Wait a bit before launching the next mouse event
                     // We need to sleep for all portions of 1 frame time to work around the frame quantization effect.
@@ -651,7 +1101,8 @@ void FLM_Pipeline::MouseEventThreadFunction()
                     // The extra frame should prevent locking onto the double frequency and also prevent problems with motion blur. Half frame is not enough...
                     fTimeToSleepMS += extraWaitFrames * m_capture->m_fMovingAverageFrameTimeMS;
 
-                    m_timer.PrecisionSleepMS(fTimeToSleepMS, iiSleepStart);
+                    FLM_TRACE_SCOPE("PrecisionSleep");
+                    m_timer.PrecisionSleepMS(fTimeToSleepMS, iiSleepStart, stop.GetEvent());
                 }
             }
         }
@@ -661,15 +1112,16 @@ void FLM_Pipeline::MouseEventThreadFunction()
             {
                 if (m_setting.iMouseHorizontalStep < 0)  // Make sure we end up in the original position, ready for the next measurement.
                 {
-                    FLM_send_mouse_move_event(m_setting.iMouseHorizontalStep);
+                    if (m_pSynthetic != NULL)
+                        InjectSyntheticInput(GetTimeStamp().QuadPart, false);
+                    else
+                        FLM_send_mouse_move_event(m_setting.iMouseHorizontalStep);
                     m_setting.iMouseHorizontalStep = -m_setting.iMouseHorizontalStep;
                 }
             }
-            Sleep(10);
+            stop.SleepFor(10);
         }
     }
-
-    m_bExitMouseThread = true;
 }
 
 int FLM_Pipeline::GetBackBufferWidth()
@@ -698,14 +1150,6 @@ std::string FLM_Pipeline::GetAppExitKeyNames()
     return (m_keyboard.GetKeyName(m_appExitKeys[0]) + "+" + m_keyboard.GetKeyName(m_appExitKeys[1]));
 }
 
-DWORD WINAPI FLM_Pipeline::KeyboardListenThreadFunctionStub(LPVOID lpParameter)
-{
-    PIPELINE_DEBUG_PRINT_STACK()
-
-    FLM_Pipeline* p = reinterpret_cast<FLM_Pipeline*>(lpParameter);
-    p->KeyboardListenThreadFunction();
-    return 0;
-}
 
 bool FLM_Pipeline::isRunningOnPrimaryDisplay()
 {
@@ -720,7 +1164,9 @@ bool FLM_Pipeline::isRunningOnPrimaryDisplay()
 
 void FLM_Pipeline::StartMeasurements()
 {
+    FLM_TRACE_SCOPE("StartMeasurements");
     ResetState();
+    m_iMeasurementSession.fetch_add(1, std::memory_order_relaxed);  // Restarts m_detection on the next frame
 
     if (m_runtimeOptions.printLevel == FLM_PRINT_LEVEL::ACCUMULATED)
         PrintAverageTelemetry(-1);  // This will reset the printout state
@@ -739,22 +1185,86 @@ void FLM_Pipeline::StartMeasurements()
         ShowWindow(m_hWnd,SW_MINIMIZE);
     }
 
+    BuildSessionMetadata();
+
+    if (m_pStageTimings != NULL)
+    {
+        m_pStageTimings->Reset();
+        m_timer.ResetSleepStats();
+    }
+
+    m_regions.ResetStats();
+    m_outputs.ResetStats();
+    m_projection.Reset(m_setting.projectionLearnPolarity);
+
     if (m_setting.saveToFile)
         CreateCSV();
 
+    // Time stamps in the log use the same time base as the latency calculation
+    if (m_setting.saveSampleLog && (m_sampleLog.Open(m_setting.sampleLogFileName.c_str(), AMF_SECOND, m_sessionMetadata.ToText()) == false))
+    {
+        if (g_pUserCallBack)
+            g_pUserCallBack(FLM_PROCESS_MESSAGE_TYPE::ERROR_MESSAGE, "Unable to open sample log file");
+    }
+
+    if (m_eventStream.IsOpen())
+    {
+        m_eventStream.WriteSessionStart(GetCodecName(),
+                                        (m_runtimeOptions.mouseEventType == FLM_MOUSE_EVENT_TYPE::MOUSE_CLICK) ? "click" : "move",
+                                        m_runtimeOptions.monitorRefreshRate,
+                                        m_runtimeOptions.gameUsesFrameGeneration,
+                                        m_sessionMetadata);
+    }
+
+    // The click path waits for button notifications instead of polling the button
+    if ((m_runtimeOptions.mouseEventType == FLM_MOUSE_EVENT_TYPE::MOUSE_CLICK) && (m_mouse.StartButtonNotifications() == false))
+        PrintStream("\nWarning: %s\n", m_mouse.GetErrorMessage().c_str());
+
     m_bMeasuringInProgress = true;
 }
 
 void FLM_Pipeline::StopMeasurements()
 {
+    FLM_TRACE_SCOPE("StopMeasurements");
     m_bMeasuringInProgress = false;
 
+    m_mouse.StopButtonNotifications();
+
     // To avoid the 1 second wait on stop
     SetEvent(m_eventMovementDetected);
 
     if (m_setting.saveToFile)
         CloseCSV();
 
+    if (m_eventStream.IsOpen())
+        m_eventStream.WriteSessionStop(m_iCumulativeLatencySamples, m_telemetry);
+
+    if (m_sampleLog.IsOpen())
+    {
+        m_sampleLog.Close();
+        if (m_sampleLog.GetDroppedCount() > 0)
+            PrintStream("\nWarning: %llu samples were not saved to the sample log\n", m_sampleLog.GetDroppedCount());
+    }
+
+    if ((m_codec == FLM_CAPTURE_CODEC_TYPE::AMF) && (m_runtimeOptions.printLevel >= FLM_PRINT_LEVEL::OPERATIONAL))
+    {
+        FLM_CLOCK_MODEL clock = m_timer.GetClockModel();
+        PrintStream("\nClock sync: drift %+.3f ppm, residual %.2f us, read uncertainty %.2f us (%d samples)\n",
+                    clock.driftPPM,
+                    clock.residualUS,
+                    clock.uncertaintyUS,
+                    clock.numPairs);
+    }
+
+    if (m_pStageTimings != NULL)
+        PrintStageTimings();
+
+    if (m_regions.IsEnabled())
+        PrintRegionSummary();
+
+    if (m_outputs.GetCount() > 0)
+        PrintOutputSummary();
+
     if (m_runtimeOptions.minimizeApp && m_hWnd)
     {
         ShowWindow(m_hWnd,SW_RESTORE);
@@ -762,18 +1272,34 @@ void FLM_Pipeline::StopMeasurements()
 
 }
 
-void FLM_Pipeline::KeyboardListenThreadFunction()
+void FLM_Pipeline::KeyboardListenThreadFunction(const FLM_Stop_Token& stop)
 {
     PIPELINE_DEBUG_PRINT_STACK()
-    m_bExitKeyboardThread = false;
+    FlmTraceSetThreadName("Keyboard");
+
+    const uint8_t settingsMenuKeys[3] = {VK_RBUTTON, 0, 0};
+
+    m_keyboard.ClearHotkeys();
+    m_iAppExitHotkey         = m_keyboard.RegisterHotkey(m_appExitKeys);
+    m_iMeasurementHotkey     = m_keyboard.RegisterHotkey(m_measurementKeys);
+    m_iCaptureSurfaceHotkey  = m_keyboard.RegisterHotkey(m_captureSurfaceKeys);
+    m_iValidateCaptureHotkey = m_keyboard.RegisterHotkey(m_validateCaptureKeys);
+    m_iTraceHotkey           = m_keyboard.RegisterHotkey(m_traceKeys);
+    m_iSettingsMenuHotkey    = m_keyboard.RegisterHotkey(settingsMenuKeys, true);  // No mouse hook in the measured input path
 
-    while((m_bTerminateKeyboardThread == false) && (m_bExitApp == false))
+    // Without the hooks WaitForHotkeys() polls the keys, as this thread did before
+    if (m_keyboard.StartHotkeyNotifications() == false)
+        PrintStream("\nWarning: %s\n", m_keyboard.GetErrorMessage().c_str());
+
+    while (m_bExitApp == false)
     {
-        ProcessKeyboardCommands();
-        Sleep(1);
+        uint32_t hotkeys = m_keyboard.WaitForHotkeys(INFINITE, stop.GetEvent());
+        if (stop.StopRequested())
+            break;
+        ProcessKeyboardCommands(hotkeys);
     }
 
-    m_bExitKeyboardThread = true;
+    m_keyboard.StopHotkeyNotifications();
 }
 
 FLM_GPU_VENDOR_TYPE FLM_Pipeline::GetGPUVendorType()
@@ -852,86 +1378,246 @@ float FLM_Pipeline::CalculateAutoRefreshScanOffset()
     if (totalPixels > 0.0)
     {
         autoRefreshScanOffset = float(m_runtimeOptions.iCaptureX + (width * m_runtimeOptions.iCaptureY)) / totalPixels;
-        autoRefreshScanOffset = (1000 / m_runtimeOptions.monitorRefreshRate) * autoRefreshScanOffset;
+        autoRefreshScanOffset = m_fScanoutPeriodMS * autoRefreshScanOffset;
     }
 
     return autoRefreshScanOffset;
 }
 
+// Applies the region set in the options window to the running capture device, false when it needs a rebuild
+bool FLM_Pipeline::ReconfigureCaptureRegion()
+{
+    FLM_TRACE_SCOPE("ReconfigureRegion");
+    FLM_Performance_Timer timer;
+
+    if (m_capture->ReconfigureCaptureRegion(m_runtimeOptions.iCaptureX, m_runtimeOptions.iCaptureY, m_runtimeOptions.iCaptureWidth, m_runtimeOptions.iCaptureHeight) == false)
+        return false;
+
+    // The codec can align the size
+    m_runtimeOptions.iCaptureWidth  = m_capture->m_iCaptureWidth;
+    m_runtimeOptions.iCaptureHeight = m_capture->m_iCaptureHeight;
+    m_autoRefreshScanOffset         = CalculateAutoRefreshScanOffset();
+
+    float fElapsedMS = (float)timer.Stop_ms();
+    PrintStream("\nCapture region XY (%d,%d) WxH %dx%d set in %.1f ms\n",
+                m_capture->m_iCaptureOriginX,
+                m_capture->m_iCaptureOriginY,
+                m_capture->m_iCaptureWidth,
+                m_capture->m_iCaptureHeight,
+                fElapsedMS);
+
+    if (m_eventStream.IsOpen())
+        m_eventStream.WriteRegionChange(m_capture->m_iCaptureOriginX, m_capture->m_iCaptureOriginY, m_capture->m_iCaptureWidth, m_capture->m_iCaptureHeight, fElapsedMS);
+
+    return true;
+}
+
+float* FLM_Pipeline::GetMonitorCalibration(int refreshRate)
+{
+    // Use the closest calibrated refresh rate at or below the given rate
+    if (refreshRate >= 239)
+        return &m_setting.monitorCalibration_240Hz;
+    else if (refreshRate >= 143)
+        return &m_setting.monitorCalibration_144Hz;
+    else if (refreshRate >= 119)
+        return &m_setting.monitorCalibration_120Hz;
+    else if (refreshRate >= 59)
+        return &m_setting.monitorCalibration_60Hz;
+    else if (refreshRate >= 49)
+        return &m_setting.monitorCalibration_50Hz;
+    else if (refreshRate >= 23)
+        return &m_setting.monitorCalibration_24Hz;
+
+    return NULL;
+}
+
+void FLM_Pipeline::UpdateRefreshRateEstimate()
+{
+    if (m_refreshEstimator.AddPresentTimestamp(m_iiFrameTimeStamp, m_iiFrameIdx) == false)
+        return;
+
+    const FLM_REFRESH_ESTIMATE& estimate = m_refreshEstimator.GetEstimate();
+    if (estimate.confidence < 0.5f)
+        return;
+
+    m_runtimeOptions.estimatedRefreshRate = estimate.refreshRateHz;
+    m_runtimeOptions.vrrDetected          = estimate.isVRR;
+
+    // Position of the capture region in the scanout. The display mode rate and its calibration bias are kept, on VRR
+    // displays the estimate follows the game.
+    m_fScanoutPeriodMS      = estimate.scanoutPeriodMS;
+    m_autoRefreshScanOffset = CalculateAutoRefreshScanOffset();
+}
+
 FLM_STATUS FLM_Pipeline::Init(FLM_CAPTURE_CODEC_TYPE cli_codec)
 {
     PIPELINE_DEBUG_PRINT_STACK()
 
+    // The trace time line starts here, the settings tell whether tracing is enabled at all
+    FlmTraceSetOrigin();
+    LARGE_INTEGER initStart;
+    QueryPerformanceCounter(&initStart);
+    int64_t iiSettingsStartTSC = (int64_t)__rdtsc();
+
     FLM_STATUS status;
-    FLM_GPU_VENDOR_TYPE vendor  = GetGPUVendorType();
 
     // read config file, m_codec may be overwritten by ini file
     status = InitSettings();
     if (status != FLM_STATUS::OK)
         return status;
 
+    // Enabled first so the threads created below are traced from their start
+    if (m_setting.traceFile.size() > 0)
+    {
+        FlmTraceEnable(true);
+        FlmTraceSetThreadName("Process");
+        FlmTraceAddScope("InitSettings", iiSettingsStartTSC);
+    }
+
     // The cli setting for codec overrides the INI setting - if specified
     if( (int)cli_codec >= 0 )
         m_codec = cli_codec;
 
-    // codec is auto: set default codec based on vendor
-    if (m_codec == FLM_CAPTURE_CODEC_TYPE::AUTO)
-    {
-        if (vendor == FLM_GPU_VENDOR_TYPE::AMD)
-            m_codec = FLM_CAPTURE_CODEC_TYPE::AMF;
-        else
-            m_codec = FLM_CAPTURE_CODEC_TYPE::DXGI;
-    }
+    m_eventMovementDetected = CreateEvent(NULL, TRUE, FALSE, NULL);
+    m_eventSADSettled       = CreateEvent(NULL, TRUE, FALSE, NULL);
 
-    // Set the selected codec
-    if (m_codec == FLM_CAPTURE_CODEC_TYPE::AMF)
-        m_capture = new FLM_Capture_AMF(&m_runtimeOptions);
-    else
-        m_capture = new FLM_Capture_DXGI(&m_runtimeOptions);
+    ApplyThreadPolicy(FLM_THREAD_ROLE::PROCESS, GetCurrentThread());
 
-    if (m_capture == NULL)
-    {
-        FlmPrintError("Failed to create capture codec");
-        return FLM_STATUS::CAPTURE_INIT_FAILED;
-    }
+    // The capture devices, the timer calibration and the input threads do not depend on each other, most of the
+    // startup time is spent waiting on the drivers so they are initialized concurrently.
+    std::vector<FLM_Capture_Context*> outputCaptures(m_additionalOutputs.size(), NULL);
+    FLM_Startup_Graph                 startup;
 
-    if (m_capture->InitContext(vendor) == false)
-    {
-        FlmPrintError("Failed to initialize capture codec context");
-        return FLM_STATUS::INIT_FAILED;
-    }
+    int vendorTask = startup.Add("ProbeGPUVendor", [this]() {
+        m_vendor = GetGPUVendorType();
+        return FLM_STATUS::OK;
+    });
 
-    m_eventMovementDetected = CreateEvent(NULL, TRUE, FALSE, NULL);
+    int timerTask = startup.Add("InitTimer", [this]() {
+        if (m_timer.Init() == false)
+        {
+            FlmPrintError("Timer init failed");
+            return FLM_STATUS::TIMER_INIT_FAILED;
+        }
+        return FLM_STATUS::OK;
+    });
 
-    if (m_timer.Init() == false)
-    {
-        FlmPrintError("Timer init failed");
-        return FLM_STATUS::TIMER_INIT_FAILED;
-    }
+    int contextTask = startup.Add("InitCaptureContext", [this]() {
+        // codec is auto: set default codec based on vendor
+        if (m_codec == FLM_CAPTURE_CODEC_TYPE::AUTO)
+        {
+            if (m_vendor == FLM_GPU_VENDOR_TYPE::AMD)
+                m_codec = FLM_CAPTURE_CODEC_TYPE::AMF;
+            else
+                m_codec = FLM_CAPTURE_CODEC_TYPE::DXGI;
+        }
 
-    // This only needs to be done once, because both timers use the same system function - QueryPerformanceCounter()
-    if (m_codec == FLM_CAPTURE_CODEC_TYPE::AMF)
-        m_timer.UpdateAmfTimeToPerformanceCounterOffset();
+        // Set the selected codec
+        m_capture = CreateCapture(0, m_syntheticScript);
+        if (m_codec == FLM_CAPTURE_CODEC_TYPE::SYNTHETIC)
+            m_pSynthetic = (FLM_Capture_Synthetic*)m_capture;
+
+        if (m_capture == NULL)
+        {
+            FlmPrintError("Failed to create capture codec");
+            return FLM_STATUS::CAPTURE_INIT_FAILED;
+        }
+
+        if (m_capture->InitContext(m_vendor) == false)
+        {
+            FlmPrintError("Failed to initialize capture codec context");
+            return FLM_STATUS::INIT_FAILED;
+        }
+        return FLM_STATUS::OK;
+    }, {vendorTask});
+
+    startup.Add("InitCapture", [this]() {
+        if (m_capture->InitCapture(m_timer) == false)
+        {
+            FlmPrintError("m_capture->InitCapture failed");
+            return FLM_STATUS::TIMER_INIT_FAILED;
+        }
+        return FLM_STATUS::OK;
+    }, {timerTask, contextTask});
+
+    // Initial offset, then keep tracking it as the clocks may drift apart over long sessions
+    startup.Add("StartClockTracking", [this]() {
+        if (m_codec == FLM_CAPTURE_CODEC_TYPE::AMF)
+        {
+            m_timer.UpdateAmfTimeToPerformanceCounterOffset();
+            if (m_timer.StartClockTracking() == false)
+                FlmPrint("Warning: Unable to start clock tracking, using a fixed AMF time offset\n");
+        }
+        return FLM_STATUS::OK;
+    }, {timerTask, contextTask});
+
+    // The mouse thread reads the frame time of m_capture once measuring, it is created before the thread starts
+    startup.Add("StartInputThreads", [this]() {
+        if (m_mouseThread.Start([this](const FLM_Stop_Token& stop) { MouseEventThreadFunction(stop); }) == false)
+        {
+            FlmPrintError("Failed to create mouse thread");
+            return FLM_STATUS::CREATE_MOUSE_THREAD_FAILED;
+        }
+        ApplyThreadPolicy(FLM_THREAD_ROLE::MOUSE, m_mouseThread.GetNativeHandle());
+
+        if (m_keyboardThread.Start([this](const FLM_Stop_Token& stop) { KeyboardListenThreadFunction(stop); }) == false)
+        {
+            FlmPrintError("Failed to create keyboard thread");
+            return FLM_STATUS::CREATE_KEYBOARD_THREAD_FAILED;
+        }
+        ApplyThreadPolicy(FLM_THREAD_ROLE::KEYBOARD, m_keyboardThread.GetNativeHandle());
+        return FLM_STATUS::OK;
+    }, {contextTask});
 
-    m_hMouseThread = CreateThread(0, 0, FLM_Pipeline::MouseEventThreadFunctionStub, this, 0, NULL);
-    if (m_hMouseThread == NULL)
+    for (size_t i = 0; i < outputCaptures.size(); i++)
     {
-        FlmPrintError("Failed to create mouse thread");
-        return FLM_STATUS::CREATE_MOUSE_THREAD_FAILED;
+        startup.Add("InitOutputCapture", [this, i, &outputCaptures]() {
+            return InitOutputCapture(i, outputCaptures[i]);
+        }, {timerTask, contextTask});
     }
 
-    m_hKbdThread = CreateThread(0, 0, FLM_Pipeline::KeyboardListenThreadFunctionStub, this, 0, NULL);
-    if (m_hKbdThread == NULL)
+    // Optional parts, a failure is not fatal
+    startup.Add("OpenEventStream", [this]() {
+        if (m_setting.eventStream.size() > 0)
+            m_eventStream.Open(m_setting.eventStream.c_str());
+        return FLM_STATUS::OK;
+    });
+
+    startup.Add("StartMetricsServer", [this]() {
+        if ((m_setting.metricsPort > 0) && m_metricsServer.Start(m_setting.metricsPort))
+            FlmPrint("Serving metrics on http://127.0.0.1:%d/metrics\n", m_setting.metricsPort);
+        return FLM_STATUS::OK;
+    });
+
+    startup.Add("OpenSharedTelemetry", [this]() {
+        if (m_setting.sharedTelemetry)
+            m_sharedTelemetry.Open();
+        return FLM_STATUS::OK;
+    });
+
+    status = startup.Run();
+    if (status != FLM_STATUS::OK)
     {
-        FlmPrintError("Failed to create keyboard thread");
-        return FLM_STATUS::CREATE_KEYBOARD_THREAD_FAILED;
+        for (FLM_Capture_Context* capture : outputCaptures)
+        {
+            if (capture != NULL)
+            {
+                capture->Release();
+                delete capture;
+            }
+        }
+        return status;
     }
 
-    if (m_capture->InitCapture(m_timer) == false)
+    if (m_setting.reportStageTimings)
     {
-        FlmPrintError("m_capture->InitCapture failed");
-        return FLM_STATUS::TIMER_INIT_FAILED;
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        m_stageTimings.Init(frequency.QuadPart);
+        m_pStageTimings            = &m_stageTimings;
+        m_capture->m_pStageTimings = &m_stageTimings;
     }
+
     // Transfer some capture settings over to pipeline
     m_runtimeOptions.iCaptureX      = m_capture->m_iCaptureOriginX;
     m_runtimeOptions.iCaptureY      = m_capture->m_iCaptureOriginY;
@@ -939,12 +1625,12 @@ FLM_STATUS FLM_Pipeline::Init(FLM_CAPTURE_CODEC_TYPE cli_codec)
     m_runtimeOptions.iCaptureHeight = m_capture->m_iCaptureHeight;
 
 #ifdef CAPTURE_FRAMES_ON_SEPARATE_THREAD
-    m_hCaptureThread = CreateThread(0, 0, FLM_Pipeline::CaptureDisplayThreadFunctionStub, this, 0, NULL);
-    if (m_hCaptureThread == NULL)
+    if (m_captureThread.Start([this](const FLM_Stop_Token& stop) { m_capture->DisplayThreadFunction(stop); }) == false)
     {
         FlmPrintError("Failed to create capture thread");
         return FLM_STATUS::CREATE_CAPTURE_THREAD_FAILED;
     }
+    ApplyThreadPolicy(FLM_THREAD_ROLE::CAPTURE, m_captureThread.GetNativeHandle());
 #endif
     m_bVirtualTerminalEnabled = SetConsoleMode(FlmGetConsoleHandle(), ENABLE_PROCESSED_OUTPUT | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
 
@@ -954,52 +1640,120 @@ FLM_STATUS FLM_Pipeline::Init(FLM_CAPTURE_CODEC_TYPE cli_codec)
     m_capture->m_bDoCaptureFrames       = true;
     m_runtimeOptions.monitorRefreshRate = 60;
 
-    // Get device info for primary monitor
-    DWORD    iModeNum   = ENUM_CURRENT_SETTINGS;
-    DEVMODEA DeviceMode = {};
-    if (EnumDisplaySettingsA(NULL, iModeNum, &DeviceMode))
-    {
-        m_runtimeOptions.monitorRefreshRate = (int)DeviceMode.dmDisplayFrequency;
-        if (DeviceMode.dmDisplayFrequency >= 239)
-            m_runtimeOptions.biasOffset = m_setting.monitorCalibration_240Hz;
-        else if (DeviceMode.dmDisplayFrequency >= 143)
-            m_runtimeOptions.biasOffset = m_setting.monitorCalibration_144Hz;
-        else if (DeviceMode.dmDisplayFrequency >= 119)
-            m_runtimeOptions.biasOffset = m_setting.monitorCalibration_120Hz;
-        else if (DeviceMode.dmDisplayFrequency >= 59)
-            m_runtimeOptions.biasOffset = m_setting.monitorCalibration_60Hz;
-        else if (DeviceMode.dmDisplayFrequency >= 49)
-            m_runtimeOptions.biasOffset = m_setting.monitorCalibration_50Hz;
-        else if (DeviceMode.dmDisplayFrequency >= 23)
-            m_runtimeOptions.biasOffset = m_setting.monitorCalibration_24Hz;
-        else
-        {
-            m_runtimeOptions.biasOffset = 0.0f;
-        }
-        FlmPrint("Monitor refresh rate is at %3d Hz\n", DeviceMode.dmDisplayFrequency);
+    // Display mode of the captured output, the synthetic codec reports the rate of its virtual display
+    int refreshRate = m_capture->GetRefreshRate();
+    if (refreshRate > 0)
+    {
+        m_runtimeOptions.monitorRefreshRate = refreshRate;
+        float* pCalibration                 = GetMonitorCalibration(m_runtimeOptions.monitorRefreshRate);
+        m_runtimeOptions.biasOffset         = pCalibration ? *pCalibration : 0.0f;
+        FlmPrint("Monitor refresh rate is at %3d Hz\n", refreshRate);
     }
     else
         FlmPrint("Warning: Unable to get default monitor display settings,Mouse click Bias offset set to 0.0 ms\n");
 
+    status = StartOutputSessions(outputCaptures);
+    if (status != FLM_STATUS::OK)
+        return status;
+
+    // The display mode rate is used until the estimator has seen enough captured frames
+    m_fScanoutPeriodMS = 1000.0f / std::max<int>(1, m_runtimeOptions.monitorRefreshRate);
+    m_refreshEstimator.Init((float)m_runtimeOptions.monitorRefreshRate, AMF_MILLISECOND);
+
     // Adjust for capture frame position in monitor refresh
     m_autoRefreshScanOffset = CalculateAutoRefreshScanOffset();
 
+    LARGE_INTEGER initEnd, frequency;
+    QueryPerformanceCounter(&initEnd);
+    QueryPerformanceFrequency(&frequency);
+    m_fStartupMS = (float)((double)(initEnd.QuadPart - initStart.QuadPart) * 1000.0 / (double)frequency.QuadPart);
+    FlmPrint("Started in %.0f ms\n", m_fStartupMS);
+
     return FLM_STATUS::OK;
 }
 
-void FLM_Pipeline::ProcessKeyboardCommands()
+FLM_Capture_Context* FLM_Pipeline::CreateCapture(int iOutput, const FLM_SYNTHETIC_SCRIPT& script)
+{
+    FLM_Capture_Context* capture;
+    if (m_codec == FLM_CAPTURE_CODEC_TYPE::AMF)
+        capture = new FLM_Capture_AMF(&m_runtimeOptions);
+    else
+    if (m_codec == FLM_CAPTURE_CODEC_TYPE::SYNTHETIC)
+        capture = new FLM_Capture_Synthetic(&m_runtimeOptions, script);
+    else
+        capture = new FLM_Capture_DXGI(&m_runtimeOptions);
+
+    if (capture != NULL)
+        capture->m_iUserSetOutputAdapter = iOutput;
+    return capture;
+}
+
+// Each additional output gets its own codec instance and capture thread, all of them use m_timer.
+// Called on a startup thread, the outputs are initialized concurrently.
+FLM_STATUS FLM_Pipeline::InitOutputCapture(size_t index, FLM_Capture_Context*& capture)
+{
+    int                         iOutput = m_additionalOutputs[index];
+    const FLM_SYNTHETIC_SCRIPT& script  = (index < m_syntheticOutputScripts.size()) ? m_syntheticOutputScripts[index] : m_syntheticScript;
+
+    capture = CreateCapture(iOutput, script);
+    if ((capture == NULL) || (capture->InitContext(m_vendor) == false) || (capture->InitCapture(m_timer) == false))
+    {
+        FlmPrintError("Failed to initialize the capture of output %d", iOutput);
+        if (capture != NULL)
+        {
+            capture->Release();
+            delete capture;
+            capture = NULL;
+        }
+        return FLM_STATUS::CAPTURE_INIT_FAILED;
+    }
+    capture->m_bDoCaptureFrames = true;
+    return FLM_STATUS::OK;
+}
+
+// Starts the session threads in the order the outputs are listed, takes ownership of the captures
+FLM_STATUS FLM_Pipeline::StartOutputSessions(std::vector<FLM_Capture_Context*>& captures)
+{
+    for (size_t i = 0; i < captures.size(); i++)
+    {
+        int                  iOutput = m_additionalOutputs[i];
+        FLM_Capture_Context* capture = captures[i];
+        captures[i]                  = NULL;
+
+        if (m_outputs.Add(new FLM_Capture_Frame_Source(capture, m_timer), iOutput) == false)
+        {
+            FlmPrintError("Failed to create capture thread for output %d", iOutput);
+            for (size_t j = i + 1; j < captures.size(); j++)
+            {
+                captures[j]->Release();
+                delete captures[j];
+                captures[j] = NULL;
+            }
+            return FLM_STATUS::CREATE_CAPTURE_THREAD_FAILED;
+        }
+
+        int index = m_outputs.GetCount() - 1;
+        ApplyThreadPolicy(FLM_THREAD_ROLE::CAPTURE, m_outputs.GetThreadHandle(index));
+        if (m_codec == FLM_CAPTURE_CODEC_TYPE::SYNTHETIC)
+            m_syntheticOutputs.push_back((FLM_Capture_Synthetic*)capture);
+
+        FlmPrint("Output %d refresh rate is at %3d Hz\n", iOutput, m_outputs.GetStats(index).refreshRate);
+    }
+    return FLM_STATUS::OK;
+}
+
+void FLM_Pipeline::ProcessKeyboardCommands(uint32_t hotkeys)
 {
-    bool bDo = false; // needed for IF_CONDITION_BECOMES_TRUE macro
 
     // 1. Handle app exit
-    IF_CONDITION_BECOMES_TRUE( m_keyboard.KeyCombinationPressed(m_appExitKeys) )
+    if (hotkeys & m_iAppExitHotkey)
     {
         m_bExitApp = true;
         return;
     }
 
     // 2. Handle start/stop measurements
-    IF_CONDITION_BECOMES_TRUE( m_keyboard.KeyCombinationPressed(m_measurementKeys) )
+    if (hotkeys & m_iMeasurementHotkey)
     {
         if (m_bMeasuringInProgress == false)  // we are about to turn on the measurement
         {
@@ -1015,7 +1769,7 @@ void FLM_Pipeline::ProcessKeyboardCommands()
     }
 
     // 3. Handle capturing of surface image
-    IF_CONDITION_BECOMES_TRUE( m_keyboard.KeyCombinationPressed(m_captureSurfaceKeys) )
+    if (hotkeys & m_iCaptureSurfaceHotkey)
     {
         m_capture->SaveCaptureSurface(0);
         if (g_pUserCallBack)
@@ -1024,15 +1778,22 @@ void FLM_Pipeline::ProcessKeyboardCommands()
     }
 
     // 4. Handle capture loop validation
-    IF_CONDITION_BECOMES_TRUE( m_keyboard.KeyCombinationPressed(m_validateCaptureKeys) )
+    if (hotkeys & m_iValidateCaptureHotkey)
     {
         m_bValidateCaptureLoop = true;
         m_validateCounter      = 0;
         return;
     }
 
-    // 5. Handle showing/hiding of settings dialog box on right mouse button click
-    IF_CONDITION_BECOMES_TRUE( KEY_DOWN(VK_RBUTTON) )
+    // 5. Handle trace export
+    if ((hotkeys & m_iTraceHotkey) && FlmTraceEnabled())
+    {
+        ExportTrace();
+        return;
+    }
+
+    // 6. Handle showing/hiding of settings dialog box on right mouse button click
+    if (hotkeys & m_iSettingsMenuHotkey)
     {
         if( g_ui.ui_showing )
             g_user_interface.HideUI();
@@ -1063,9 +1824,9 @@ void FLM_Pipeline::ResetState()
     m_fAccumulatedFrameTimeMS      = 0;
     m_iMeasurementPhaseCounter     = 0;
     m_iiMouseMoveEventTime         = 0;
-    m_iSkipMeasurementsOnInitCount = 1; // = 2; // Skip a few initial measurements, just in case
     m_telemetry.Reset();
     m_capture->ResetState();
+    m_refreshEstimator.Reset();
 }
 
 void FLM_Pipeline::Close()
@@ -1075,41 +1836,18 @@ void FLM_Pipeline::Close()
     if (m_bMeasuringInProgress)
         StopMeasurements();
 
-    Sleep(200);
+    // Stop all threads at once, blocked waits return on the stop and the joins take about as long as the slowest thread
+    m_keyboardThread.RequestStop();
+    m_mouseThread.RequestStop();
+    m_captureThread.RequestStop();
 
-    // Wait on threads
-    if (m_hKbdThread != NULL)
-    {
-        m_bTerminateKeyboardThread = true;
-        while (m_bExitKeyboardThread == false)
-            Sleep(10);
-        WaitForSingleObject(m_hKbdThread, 1000);
-        CloseHandle(m_hKbdThread);
-        m_hKbdThread = NULL;
+    m_keyboardThread.Stop();
+    m_mouseThread.Stop();
+    m_captureThread.Stop();
 
-        if (m_hMouseThread != NULL)
-        {
-            m_bTerminateMouseThread = true;
-            while (m_bExitMouseThread == false)
-                Sleep(10);
-            WaitForSingleObject(m_hMouseThread, 1000);
-            CloseHandle(m_hMouseThread);
-            m_hMouseThread = NULL;
-
-            if (m_hCaptureThread != NULL)
-            {
-                if (m_capture)
-                {
-                    m_capture->m_bTerminateCaptureThread = true;
-                    while (m_capture->m_bExitCaptureThread == false)
-                        Sleep(10);
-                    WaitForSingleObject(m_hCaptureThread, 1000);
-                    CloseHandle(m_hCaptureThread);
-                    m_hCaptureThread = NULL;
-                }
-            }
-        }
-    }
+    // Deletes the codecs of the additional outputs
+    m_outputs.Stop();
+    m_syntheticOutputs.clear();
 
     if (m_capture)
     {
@@ -1117,7 +1855,24 @@ void FLM_Pipeline::Close()
         m_capture = NULL;
     }
 
+    // Frees the generated frames, flm_bench runs several synthetic pipelines in one process
+    if (m_pSynthetic)
+    {
+        delete m_pSynthetic;
+        m_pSynthetic = NULL;
+    }
+
     m_timer.Close();
+    m_eventStream.Close();
+    m_metricsServer.Stop();
+    m_sharedTelemetry.Close();
+
+    if (FlmTraceEnabled())
+    {
+        ExportTrace();
+        FlmTraceEnable(false);
+    }
+
     FlmClearErrorStr();
 }
 
@@ -1131,6 +1886,7 @@ FLM_PROCESS_STATUS FLM_Pipeline::Process()
     }
 
     //FLM_Profile_Timer profile_timer(__FUNCTION__);
+    FLM_TRACE_SCOPE("Process");
 
     static bool                  captureRegionChanged = false;
     static FLM_Performance_Timer m_lapTimer;
@@ -1169,32 +1925,112 @@ FLM_PROCESS_STATUS FLM_Pipeline::Process()
     {
         captureRegionChanged = false;
         saveUserSettings(); // This is needed as rebuild load window size settings
-        m_capture->m_bNeedToRebuildPipeline = true;
+        if (ReconfigureCaptureRegion() == false)
+            m_capture->m_bNeedToRebuildPipeline = true;
     }
 
     if (m_capture == NULL)
         return FLM_PROCESS_STATUS::CLOSE;
 
-    if (m_bTerminateMouseThread)
+    if (m_mouseThread.StopRequested())
         return FLM_PROCESS_STATUS::CLOSE;
 
     {
         m_iiFrameTimeStampPrev = m_iiFrameTimeStamp;
         m_iiFrameIdxPrev       = m_iiFrameIdx;
-        m_iThSADPrev           = m_iThSAD;
 
-        if (m_capture->AcquireFrameAndDownscaleToHost(&m_iiFrameTimeStamp, &m_iiFrameIdx))
+        bool bFrameAcquired;
+        {
+            FLM_TRACE_SCOPE("AcquireFrame");
+            bFrameAcquired = m_capture->AcquireFrameAndDownscaleToHost(&m_iiFrameTimeStamp, &m_iiFrameIdx);
+        }
+
+        // The keyboard and mouse threads only publish the session and the input events, m_detection is driven here
+        const bool             bClick = (m_runtimeOptions.mouseEventType == FLM_MOUSE_EVENT_TYPE::MOUSE_CLICK);
+        FLM_DETECTION_SETTINGS detectionSettings;
+        detectionSettings.settleFrames     = bClick ? m_setting.settleFramesClick : m_setting.settleFrames;
+        detectionSettings.warmupDetections = m_setting.warmupDetections;
+        int iSession = m_bMeasuringInProgress ? m_iMeasurementSession.load(std::memory_order_relaxed) : 0;
+        m_detection.SetSession(iSession, detectionSettings, m_iiFrameIdx);
+        m_detection.Inject(bClick ? m_iiClickTime.load(std::memory_order_relaxed) : m_iiMouseMoveEventTime, m_iiFrameIdx);
+        FLM_DETECTION_ACTION detection = FLM_DETECTION_ACTION::NONE;
+
+        // The regions and additional outputs run their own state machines with the same session, settings and input
+        // events, they measure mouse moves only
+        int iMoveSession = bClick ? 0 : iSession;
+
+        // Drained with every frame of the primary output, before any of the early returns below
+        if (m_outputs.GetCount() > 0)
+            ProcessOutputMeasurements(iMoveSession, detectionSettings, m_iiMouseMoveEventTime);
+        if (bFrameAcquired)
         {
-            m_iSAD          = m_capture->CalculateSAD();
-            m_iThSAD        = m_capture->GetThresholdedSAD(m_runtimeOptions.printLevel == FLM_PRINT_LEVEL::PRINT_DEBUG ? m_iiFrameIdx : 0,
-                                                           m_iSAD, m_runtimeOptions.thresholdCoefficient[m_runtimeOptions.mouseEventType]);
-            if (m_runtimeOptions.mouseEventType == FLM_MOUSE_EVENT_TYPE::MOUSE_CLICK)
             {
-                if (m_iThSAD != 0)
+                FLM_TRACE_SCOPE("CalculateSAD");
+                float fThresholdCoeff = m_runtimeOptions.thresholdCoefficient[m_runtimeOptions.mouseEventType];
+                bool  bProjection     = m_setting.projectionDetector && (m_runtimeOptions.mouseEventType == FLM_MOUSE_EVENT_TYPE::MOUSE_MOVE);
+
+                // The motion of an input event, before and just after its detection, is not background noise
+                FLM_DETECTION_STATE detectionState = m_detection.GetState();
+                bool                bInputPending  = (detectionState == FLM_DETECTION_STATE::INJECTED) || (detectionState == FLM_DETECTION_STATE::DETECTED);
                 {
-                    SetEvent(m_eventMovementDetected);
-                    return FLM_PROCESS_STATUS::PROCESSING;
+                    FLM_Stage_Timer stageTimer(m_pStageTimings, FLM_STAGE::SAD);
+                    if (bProjection)
+                    {
+                        // The regions keep their own SAD detection
+                        FLM_SAD_INPUT sadInput;
+                        bool          bInput = m_capture->GetSADInput(sadInput);
+                        if (bInput && m_regions.IsEnabled())
+                            m_regions.Process(sadInput, fThresholdCoeff, m_capture->m_fAVGFilterAlpha, m_runtimeOptions.falseTriggerRate, bInputPending);
+                        m_iSAD = bInput ? m_projection.Process(sadInput, m_iiFrameIdx) : 0;
+                    }
+                    else
+                    if (m_regions.IsEnabled())
+                    {
+                        // The regions and the whole capture region are differenced in the same pass
+                        FLM_SAD_INPUT sadInput;
+                        m_iSAD = m_capture->GetSADInput(sadInput) ? m_regions.Process(sadInput, fThresholdCoeff, m_capture->m_fAVGFilterAlpha, m_runtimeOptions.falseTriggerRate, bInputPending) : 0;
+                    }
+                    else
+                        m_iSAD = m_capture->CalculateSAD();
                 }
+                UpdateSADSettled();
+                FLM_Stage_Timer stageTimer(m_pStageTimings, FLM_STAGE::THRESHOLD);
+                if (bProjection)
+                    m_iThSAD = m_projection.Detect((m_detection.GetInjectTime() != 0) ? m_iMouseMoveStep : 0);  // Shift in pixels
+                else
+                    m_iThSAD = m_capture->GetThresholdedSAD(m_runtimeOptions.printLevel == FLM_PRINT_LEVEL::PRINT_DEBUG ? m_iiFrameIdx : 0,
+                                                            m_iSAD, fThresholdCoeff, m_runtimeOptions.falseTriggerRate, bInputPending);
+            }
+            FLM_TRACE_COUNTER("SAD", m_iSAD);
+
+            // Present time of new frames on the trace time line
+            if (FlmTraceEnabled() && (m_iiFrameIdx != m_iiFrameIdxPrev))
+            {
+                int64_t iiPresentQPC = (m_codec == FLM_CAPTURE_CODEC_TYPE::AMF) ? m_timer.TranslateAmfTimeToPerformanceCounter(m_iiFrameTimeStamp) : m_iiFrameTimeStamp;
+                FLM_TRACE_INSTANT_QPC("Present", iiPresentQPC);
+            }
+
+            if (m_setting.estimateRefreshRate && (m_iiFrameIdx != m_iiFrameIdxPrev))
+                UpdateRefreshRateEstimate();
+
+            if (m_iiFrameIdx != m_iiFrameIdxPrev)
+            {
+                m_metrics.framesCaptured++;
+                if ((m_iiFrameIdxPrev != 0) && (m_iiFrameIdx > m_iiFrameIdxPrev + 1))
+                    m_metrics.framesDropped += m_iiFrameIdx - m_iiFrameIdxPrev - 1;
+            }
+
+            // A repeated frame is not counted as a frame without motion
+            if (m_iiFrameIdx != m_iiFrameIdxPrev)
+                detection = m_detection.Frame(m_iThSAD != 0, m_iiFrameIdx);
+
+            // The mouse thread continues after a skipped detection as after a measurement. It measures the click latency
+            // itself, the measurement is taken below when it sets m_bMouseClickDetected.
+            if (detection != FLM_DETECTION_ACTION::NONE)
+            {
+                if (bClick)
+                    m_bRecordClick = (detection == FLM_DETECTION_ACTION::MEASURE);
+                SignalDetection();
             }
         }
         else
@@ -1202,12 +2038,14 @@ FLM_PROCESS_STATUS FLM_Pipeline::Process()
             // No frames captured, check if we need to rebuild pipeline
             m_iSAD   = 0;
             m_iThSAD = 0;
+            UpdateSADSettled();
 
             if (m_capture->m_bNeedToRebuildPipeline)
             {
                 bool hold_startMeasurements = m_bMeasuringInProgress;
                 bool hold_DoCaptureFrames   = m_capture->m_bDoCaptureFrames;
 
+                FLM_TRACE_INSTANT("Rebuild");
                 PrintStream("Rebuilding pipeline - please wait...");
                 if (hold_startMeasurements)
                     StopMeasurements();
@@ -1221,6 +2059,11 @@ FLM_PROCESS_STATUS FLM_Pipeline::Process()
                 else
                     PrintStream("\n");
 
+                if (m_eventStream.IsOpen())
+                    m_eventStream.WriteRebuild(bRes);
+
+                m_metrics.rebuilds++;
+
                 if (hold_startMeasurements)
                     StartMeasurements();
 
@@ -1230,15 +2073,23 @@ FLM_PROCESS_STATUS FLM_Pipeline::Process()
                 return (m_bMeasuringInProgress ? FLM_PROCESS_STATUS::PROCESSING : FLM_PROCESS_STATUS::WAIT_FOR_START);
         }
 
-        bool bGotMeasurement = (m_iThSAD != 0) && (m_iiMouseMoveEventTime != 0) && m_bMeasuringInProgress;  // This is an overkill
+        if (m_detection.GetTransitionCount() != m_iReportedTransitions)
+        {
+            ReportDetectionTransitions(m_detection, m_iReportedTransitions, "capture");
+            FLM_TRACE_COUNTER("DetectionState", (int64_t)m_detection.GetState());
+        }
+
+        // Input event of the frame, the one it measured or the one still waiting for its motion
+        int64_t iiInjectTime    = bClick ? 0 : ((detection != FLM_DETECTION_ACTION::NONE) ? m_detection.GetDetectedInjectTime() : m_detection.GetInjectTime());
+        bool    bGotMeasurement = (bClick == false) && (detection == FLM_DETECTION_ACTION::MEASURE);
 
-        if ((m_runtimeOptions.mouseEventType == FLM_MOUSE_EVENT_TYPE::MOUSE_CLICK) && m_bMouseClickDetected && m_bMeasuringInProgress)
+        if (bClick && m_bMouseClickDetected && m_bMeasuringInProgress)
         {
             if (m_runtimeOptions.autoBias)
                 m_runtimeOptions.biasOffset = laptime + m_autoRefreshScanOffset;
 
             m_fLatestMeasuredLatencyMS = m_fLatestMeasuredLatencyMS + m_runtimeOptions.biasOffset * FLM_MOUSE_CLICK_ADJUST_BIAS_FOR_NOISE;
-            if (m_fLatestMeasuredLatencyMS < FLM_MOUSE_CLICK_UPPER_LIMIT)
+            if (m_bRecordClick && (m_fLatestMeasuredLatencyMS < FLM_MOUSE_CLICK_UPPER_LIMIT))
                 bGotMeasurement = true;
             // FlmPrintStaticPos("[%d]", (int)m_fLatestMeasuredLatencyMS);
             m_bMouseClickDetected = false;
@@ -1271,40 +2122,46 @@ FLM_PROCESS_STATUS FLM_Pipeline::Process()
             bPrevRAltDown = bRAltDown;
         }
 
-        // We need to have at least one non-motion frame, otherwise GetThresholdedSAD() will get confused.
-        // Also, motion blur tends to cause two consecutive detections...
-        if ((m_iThSADPrev != 0) && (m_runtimeOptions.mouseEventType == FLM_MOUSE_EVENT_TYPE::MOUSE_MOVE))
-            bGotMeasurement = false; // Ignore the motion detection in the frame right after motion - this is probably "motion blur" effect...
-
-        if (bGotMeasurement && m_iSkipMeasurementsOnInitCount)
-        {
-            m_iSkipMeasurementsOnInitCount--;
-            bGotMeasurement = false;
-        }
+        // The regions measure the same mouse moves, independently of the detection in the whole capture region
+        if (bFrameAcquired && m_regions.IsEnabled())
+            ProcessRegionMeasurements(iMoveSession, detectionSettings, m_iiMouseMoveEventTime);
 
         if (bGotMeasurement) // check again
         {
+            FLM_TRACE_INSTANT("Detect");
             if (m_runtimeOptions.mouseEventType == FLM_MOUSE_EVENT_TYPE::MOUSE_MOVE)
-                m_fLatestMeasuredLatencyMS = (m_iiFrameTimeStamp - m_iiMouseMoveEventTime) / float(AMF_MILLISECOND);
+                m_fLatestMeasuredLatencyMS = (m_iiFrameTimeStamp - iiInjectTime) / float(AMF_MILLISECOND);
 
             UpdateAverageLatency(m_fLatestMeasuredLatencyMS);
+            m_metrics.latestLatency = m_fLatestMeasuredLatencyMS;
+            m_metrics.AddLatency(m_fLatestMeasuredLatencyMS);
 
-            m_iiMouseMoveEventTime = 0;
-            if (m_codec == FLM_CAPTURE_CODEC_TYPE::AMF)
-                m_iiMotionDetectedFrameFlipTime = m_timer.TranslateAmfTimeToPerformanceCounter(m_iiFrameTimeStamp);
-            else
-                m_iiMotionDetectedFrameFlipTime = m_iiFrameTimeStamp;
+            if ((m_pSynthetic != NULL) && (m_runtimeOptions.mouseEventType == FLM_MOUSE_EVENT_TYPE::MOUSE_MOVE))
+                m_pSynthetic->AddMeasurement(iiInjectTime, m_fLatestMeasuredLatencyMS);
 
-            if (m_runtimeOptions.mouseEventType == FLM_MOUSE_EVENT_TYPE::MOUSE_MOVE)
-                SetEvent(m_eventMovementDetected);
+            if ((m_outputs.GetCount() > 0) && (m_runtimeOptions.mouseEventType == FLM_MOUSE_EVENT_TYPE::MOUSE_MOVE))
+                m_outputs.SetReferenceLatency(iiInjectTime, m_fLatestMeasuredLatencyMS);
 
-            if (m_runtimeOptions.printLevel == FLM_PRINT_LEVEL::ACCUMULATED)
-                PrintAverageTelemetry(m_fLatestMeasuredLatencyMS);
-            else
-            if ((m_runtimeOptions.printLevel == FLM_PRINT_LEVEL::RUN) || (m_runtimeOptions.printLevel == FLM_PRINT_LEVEL::OPERATIONAL))
-                PrintOperationalTelemetry(m_fLatestMeasuredLatencyMS, m_runtimeOptions.printLevel == FLM_PRINT_LEVEL::OPERATIONAL);
-            else
-                PrintDebugTelemetry(m_fLatestMeasuredLatencyMS);
+            if (m_eventStream.IsOpen())
+            {
+                m_eventStream.WriteMeasurement(m_iCumulativeLatencySamples,
+                                               m_fLatestMeasuredLatencyMS,
+                                               m_fLatestMeasuredLatencyMS / m_capture->m_fMovingAverageFrameTimeMS - 0.5f,
+                                               m_telemetry.fps,
+                                               m_iiFrameIdx,
+                                               m_iiFrameTimeStamp);
+            }
+
+            {
+                FLM_Stage_Timer stageTimer(m_pStageTimings, FLM_STAGE::OUTPUT);
+                if (m_runtimeOptions.printLevel == FLM_PRINT_LEVEL::ACCUMULATED)
+                    PrintAverageTelemetry(m_fLatestMeasuredLatencyMS);
+                else
+                if ((m_runtimeOptions.printLevel == FLM_PRINT_LEVEL::RUN) || (m_runtimeOptions.printLevel == FLM_PRINT_LEVEL::OPERATIONAL))
+                    PrintOperationalTelemetry(m_fLatestMeasuredLatencyMS, m_runtimeOptions.printLevel == FLM_PRINT_LEVEL::OPERATIONAL);
+                else
+                    PrintDebugTelemetry(m_fLatestMeasuredLatencyMS);
+            }
 
             // Test validation of captured frames that were processed
             if (m_bValidateCaptureLoop)
@@ -1323,6 +2180,15 @@ FLM_PROCESS_STATUS FLM_Pipeline::Process()
                 }
             }
         }
+
+        if (bFrameAcquired && m_bMeasuringInProgress && m_sampleLog.IsOpen())
+            LogSample(iiInjectTime, bGotMeasurement);
+
+        if (m_metricsServer.IsRunning())
+            PublishMetrics();
+
+        if (m_sharedTelemetry.IsOpen())
+            PublishSharedTelemetry();
     }
 
     return m_bMeasuringInProgress ? FLM_PROCESS_STATUS::PROCESSING : FLM_PROCESS_STATUS::WAIT_FOR_START;
@@ -13,9 +13,24 @@
 #include "flm_timer.h"
 #include "flm_keyboard.h"
 #include "flm_mouse.h"
+#include "flm_refresh_estimator.h"
+#include "flm_sample_log.h"
+#include "flm_event_stream.h"
+#include "flm_metrics_server.h"
+#include "flm_shared_telemetry.h"
+#include "flm_session_metadata.h"
+#include "flm_trace.h"
+#include "flm_thread_policy.h"
+#include "flm_thread.h"
+#include "flm_regions.h"
+#include "flm_output_sessions.h"
+#include "flm_startup.h"
+#include "flm_projection.h"
+#include "flm_detection.h"
 
 #include "flm_capture_AMF.h"
 #include "flm_capture_DXGI.h"
+#include "flm_capture_synthetic.h"
 
 #include <inttypes.h>
 #include "ini/SimpleIni.h"
@@ -34,6 +49,14 @@ struct FLM_PIPELINE_SETTINGS
     std::string  validateCaptureKeys       = "LSHIFT+ENTER";  // Capture a sequence of frames numbered set in ValidateCaptureNumOfFrames to BMP files
     bool         saveToFile                = true;            // Sets saving measurements to a specified CSV file
     std::string  outputFileName            = "fml_latency.csv";  // File to save measurements
+    bool         saveSampleLog             = false;              // Save every captured frame to a binary sample log while measuring
+    std::string  sampleLogFileName         = "flm_samples.bin";  // File to save the binary sample log
+    std::string  eventStream               = "";                 // File or named pipe for NDJSON events, empty to disable
+    int          metricsPort               = 0;                  // Local port serving OpenMetrics on http://127.0.0.1:port/metrics, 0 to disable
+    bool         sharedTelemetry           = false;              // Publish live telemetry in shared memory FLM_SHARED_TELEMETRY_NAME
+    std::string  traceFile                 = "";                 // Chrome trace JSON written on traceKeys and on exit, empty to disable tracing
+    std::string  traceKeys                 = "ALT+R";            // Write the trace recorded so far to traceFile
+    bool         reportStageTimings        = false;              // Print percentiles of the time spent in each processing stage when measurements stop
     unsigned int iNumMeasurementsPerLine   = 16;                 // Number of measurements taken before averaging. Default 16 Range:1 to 32
     int          iNumDequantizationPhases  = 2;                  // This introduces a very small periodic phase shift to work around the quantization
     int          validateCaptureNumOfFrames = 32;                // Number of frames to capture
@@ -44,6 +67,17 @@ struct FLM_PIPELINE_SETTINGS
     float        monitorCalibration_60Hz    = 0.0;
     float        monitorCalibration_50Hz    = 0.0;
     float        monitorCalibration_24Hz    = 0.0;
+    bool         estimateRefreshRate        = true;              // Estimate the display refresh rate and VRR from captured frame timestamps
+    bool         projectionDetector         = false;             // Detect mouse moves from the shift of the row and column profiles instead of the SAD
+    bool         projectionLearnPolarity    = false;             // Let pans with the mouse reverse the camera direction, for an inverted camera axis
+    int          settleFrames               = 1;                 // Frames without motion before a mouse move is detected, the frame after a detection is usually motion blur
+    int          settleFramesClick          = 0;                 // Frames without motion before a mouse click is detected
+    int          warmupDetections           = 1;                 // Detections skipped at the start of every measurement session
+    std::string  threadAffinity[(int)FLM_THREAD_ROLE::COUNT];    // Per FLM thread: "" for the OS default, "auto" or a mask of logical processors
+    std::string  threadPriority[(int)FLM_THREAD_ROLE::COUNT];    // Per FLM thread: "" for the OS default, "normal", "above_normal", "highest", ...
+    int          autoAffinityCores          = 2;                 // Number of least loaded physical cores the "auto" affinity pins FLM threads to
+    std::string  regions                    = "";                // Named regions inside the capture region measured in the same pass, see FlmParseRegions()
+    std::string  additionalOutputs          = "";                // Comma separated outputs captured concurrently with the primary output, see FlmParseOutputs()
 };
 
 class FLM_Pipeline : public FLM_Context
@@ -62,13 +96,23 @@ public:
     std::string         GetAppExitKeyNames();
     int                 GetBackBufferWidth();
     int                 GetBackBufferHeight();
-    void                ProcessKeyboardCommands();
+    void                ProcessKeyboardCommands(uint32_t hotkeys);
     void                SendMouseMove();
     bool                WaitForFrameDetection();
     FLM_STATUS          loadUserSettings();
     FLM_STATUS          saveUserSettings();
+    void                StartMeasurements();
+    void                StopMeasurements();
+
+    // Only set for the SYNTHETIC codec
+    FLM_Capture_Synthetic* GetSynthetic() { return m_pSynthetic; }
+    FLM_Capture_Synthetic* GetSyntheticOutput(int index) { return m_syntheticOutputs[index]; }
+
+    const FLM_Output_Session_Set& GetOutputSessions() const { return m_outputs; }
 
     FLM_PIPELINE_SETTINGS m_setting;
+    FLM_SYNTHETIC_SCRIPT  m_syntheticScript;  // Used when Init() is called with the SYNTHETIC codec
+    std::vector<FLM_SYNTHETIC_SCRIPT> m_syntheticOutputScripts;  // Virtual displays of the additional outputs with the SYNTHETIC codec, m_syntheticScript for the rest
 
     HWND                 m_hWnd = GetConsoleWindow();
 
@@ -76,9 +120,24 @@ private:
     FLM_STATUS InitSettings();
     FLM_STATUS SetCodec(std::string codec);
     void       UpdateAverageLatency(float fLatencyMS);
-    void       StartMeasurements();
-    void       StopMeasurements();
+    const char* GetCodecName();
     float      CalculateAutoRefreshScanOffset();
+    bool       ReconfigureCaptureRegion();
+    float*     GetMonitorCalibration(int refreshRate);
+    void       UpdateRefreshRateEstimate();
+    void       UpdateSADSettled();
+    void       SignalDetection();
+    void       ReportDetectionTransitions(const FLM_Detection_State_Machine& detection, uint64_t& iReported, const char* source);
+    void       ProcessRegionMeasurements(int iSession, const FLM_DETECTION_SETTINGS& settings, int64_t iiInjectTime);
+    void       PrintRegionSummary();
+    FLM_Capture_Context* CreateCapture(int iOutput, const FLM_SYNTHETIC_SCRIPT& script);
+    FLM_STATUS InitOutputCapture(size_t index, FLM_Capture_Context*& capture);
+    FLM_STATUS StartOutputSessions(std::vector<FLM_Capture_Context*>& captures);
+    void       ProcessOutputMeasurements(int iSession, const FLM_DETECTION_SETTINGS& settings, int64_t iiInjectTime);
+    void       PrintOutputSummary();
+    void       InjectSyntheticInput(int64_t iiInjectTime, bool bCounted);
+    FLM_STATUS ResolveThreadPolicies();
+    void       ApplyThreadPolicy(FLM_THREAD_ROLE role, HANDLE hThread);
     bool       isRunningOnPrimaryDisplay();
 
     FLM_TELEMETRY_DATA     m_telemetry;
@@ -86,26 +145,32 @@ private:
     FLM_Timer_AMF          m_timer;
     FLM_Performance_Timer  m_timer_performance;
     FLM_Mouse              m_mouse;
+    FLM_Refresh_Estimator  m_refreshEstimator;
+    FLM_Region_Set         m_regions;
+    uint64_t               m_iReportedRegionTransitions[FLM_MAX_REGIONS] = {};
+    FLM_Projection_Detector m_projection;  // Used for mouse moves with projectionDetector
+    FLM_Detection_State_Machine m_detection;  // Driven by the Process() thread only
+    uint64_t                    m_iReportedTransitions = 0;
+    FLM_Output_Session_Set m_outputs;     // Additional outputs, each on its own capture thread
+    uint64_t               m_iReportedOutputTransitions[FLM_MAX_OUTPUTS] = {};
+    std::vector<int>       m_additionalOutputs;
+    std::vector<FLM_Capture_Synthetic*> m_syntheticOutputs;  // Owned by m_outputs, mouse moves are injected into them as well
+    FLM_THREAD_POLICY      m_threadPolicy[(int)FLM_THREAD_ROLE::COUNT];
     FLM_Capture_Context*   m_capture              = NULL;
+    FLM_Capture_Synthetic* m_pSynthetic           = NULL;  // m_capture when the codec is SYNTHETIC, mouse moves are injected into it
     FLM_CAPTURE_CODEC_TYPE m_codec                = FLM_CAPTURE_CODEC_TYPE::AUTO;
+    FLM_GPU_VENDOR_TYPE    m_vendor               = FLM_GPU_VENDOR_TYPE::UNKNOWN;
+    float                  m_fStartupMS           = 0.0f;  // Init() from the start to the first captured frame request
     bool                   m_bValidateCaptureLoop = false;  // when set will run a validation capture loop that save current captured latency frame used in SAD
     bool                   m_bVirtualTerminalEnabled = false;  // This is set to true if windows virtual terminal escape char is supported
 
-    // Thread termination
-    bool m_bTerminateMouseThread    = false;
-    bool m_bTerminateKeyboardThread = false;
-    bool m_bExitMouseThread         = false;
-    bool m_bExitKeyboardThread      = false;
-    bool m_bExitApp                 = false;
-
-    static DWORD WINAPI MouseEventThreadFunctionStub(LPVOID lpParameter);
-    static DWORD WINAPI KeyboardListenThreadFunctionStub(LPVOID lpParameter);
-    static DWORD WINAPI CaptureDisplayThreadFunctionStub(LPVOID lpParameter);
+    std::atomic<bool> m_bExitApp = false;  // Set by the keyboard thread on the exit keys
 
-    void MouseEventThreadFunction();
-    void KeyboardListenThreadFunction();
+    void MouseEventThreadFunction(const FLM_Stop_Token& stop);
+    void KeyboardListenThreadFunction(const FLM_Stop_Token& stop);
 
     // configurable outputs
+    void BuildSessionMetadata();
     void CreateCSV();
     void CloseCSV();
     void SaveTelemetryCSV();
@@ -113,20 +178,30 @@ private:
     void PrintAverageTelemetry(float fFrameLatencyMS);
     void PrintOperationalTelemetry(float fFrameLatencyMS, bool bFull);
     void PrintDebugTelemetry(float fFrameLatencyMS);
+    void LogSample(int64_t iiInjectTime, bool bMeasurement);
+    void PublishMetrics();
+    void PublishSharedTelemetry();
+    void ExportTrace();
+    void PrintStageTimings();
 
     int     m_iUserSetVendorType            = 0;
     float   m_fCumulativeLatencyTimesMS     = 0.0f;
     int     m_iCumulativeLatencySamples     = 0;
     float   m_fAccumulatedLatencyMS         = 0.0f;
     float   m_fAccumulatedFrameTimeMS       = 0.0f;
-    bool    m_bMeasuringInProgress          = false;  // State of latency measurements
+    std::atomic<bool> m_bMeasuringInProgress = false;  // State of latency measurements
     HANDLE  m_eventMovementDetected         = NULL;
+    HANDLE  m_eventSADSettled               = NULL;   // Set while m_iSAD is 0, the click path waits on it before the next click
+    bool    m_bSADSettled                   = false;
     bool    m_bMouseClickDetected           = false;
-    int64_t m_iiMouseMoveEventTime          = 0;
+    int64_t m_iiMouseMoveEventTime          = 0;      // Latest mouse move, set by the mouse thread
+    std::atomic<int64_t> m_iiClickTime      = 0;      // Button down time of the latest mouse click, set by the mouse thread
+    std::atomic<int>     m_iMeasurementSession = 0;   // Incremented by StartMeasurements()
+    bool    m_bRecordClick                  = false;  // The detected click was not a warm-up detection
+    int     m_iMouseMoveStep                = 0;      // Horizontal step of the latest mouse move, the sign is the direction
     int     m_iMeasurementPhaseCounter      = 0;
     int     m_iDequantizingPhaseCounter     = 0;
     int64_t m_iiMotionDetectedFrameFlipTime = 0;
-    int     m_iSkipMeasurementsOnInitCount  = 0;
 
     // set by user as defined in FLM_PIPELINE_SETTINGS and override from json
     int           m_iSetVendor             = 0;  //  0 using GetGPUVendorType else set vendor to FLM_GPU_VENDOR_TYPE (1 = AMD 2 = Nvidia 3 = Intel)
@@ -134,8 +209,31 @@ private:
     unsigned char m_appExitKeys[3]         = {0, 0, 0};
     unsigned char m_captureSurfaceKeys[3]  = {0, 0, 0};
     unsigned char m_validateCaptureKeys[3] = {0, 0, 0};
+    unsigned char m_traceKeys[3]           = {0, 0, 0};
+
+    // Bits of the combinations above in the masks of FLM_Keyboard::WaitForHotkeys(), registered by the keyboard thread
+    uint32_t m_iAppExitHotkey         = 0;
+    uint32_t m_iMeasurementHotkey     = 0;
+    uint32_t m_iCaptureSurfaceHotkey  = 0;
+    uint32_t m_iValidateCaptureHotkey = 0;
+    uint32_t m_iTraceHotkey           = 0;
+    uint32_t m_iSettingsMenuHotkey    = 0;
     FILE*         m_outputFile             = NULL;
 
+    FLM_Sample_Log   m_sampleLog;    // Per frame binary log, written on its own thread
+    FLM_Event_Stream m_eventStream;  // NDJSON measurement and session events
+
+    FLM_Metrics_Server   m_metricsServer;
+    FLM_METRICS_SNAPSHOT m_metrics;  // Owned by the Process() thread, published to m_metricsServer
+
+    FLM_Shared_Telemetry m_sharedTelemetry;
+
+    FLM_Session_Metadata m_sessionMetadata;  // Written at the start of every output, rebuilt for each measurement session
+
+    FLM_Stage_Timings    m_stageTimings;
+    FLM_Stage_Timings*   m_pStageTimings = NULL;  // &m_stageTimings when reportStageTimings is set, else NULL to skip the timers
+    std::atomic<int64_t> m_iiDetectSignalTime = 0;  // QPC time of the last SetEvent(m_eventMovementDetected) by Process()
+
     // testCapture Options
     int m_validateCounter = 0;
 
@@ -149,14 +247,13 @@ private:
     float m_fLatestMeasuredLatencyMS = 0.0f;
     int   m_iSAD                     = 0;
     int   m_iThSAD                   = 0;
-    int   m_iThSADPrev               = 0;
     float m_autoRefreshScanOffset    = 0.0f;
+    float m_fScanoutPeriodMS         = 1000.0f / 60.0f;  // Display scanout period, updated by m_refreshEstimator
 
     // Threads
-
-    HANDLE m_hMouseThread   = NULL;
-    HANDLE m_hKbdThread     = NULL;
-    HANDLE m_hCaptureThread = NULL;
+    FLM_Thread m_mouseThread;
+    FLM_Thread m_keyboardThread;
+    FLM_Thread m_captureThread;
 };
 
 #endif
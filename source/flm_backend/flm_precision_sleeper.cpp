@@ -0,0 +1,193 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_precision_sleeper.cpp
+/// @brief  Self calibrating sleep until a QueryPerformanceCounter time stamp
+//=============================================================================
+
+#include "flm_precision_sleeper.h"
+
+#include <algorithm>
+
+#pragma comment(lib, "Winmm.lib")
+
+#define FLM_SLEEP_CALIBRATION_COUNT   16     // Timer waits of FLM_SLEEP_CALIBRATION_US in Init()
+#define FLM_SLEEP_CALIBRATION_US      1000
+#define FLM_SLEEP_MIN_MARGIN_US       20
+#define FLM_SLEEP_MAX_MARGIN_US       4000
+#define FLM_SLEEP_UPDATE_INTERVAL     16     // Overshoot samples between margin updates
+#define FLM_SLEEP_DECAY_COUNT         1024   // The overshoot history is halved at this count
+
+FLM_Precision_Sleeper::~FLM_Precision_Sleeper()
+{
+    Close();
+}
+
+bool FLM_Precision_Sleeper::Init()
+{
+    QueryPerformanceFrequency((LARGE_INTEGER*)&m_iiFreqCountPerSecond);
+    m_iiCountPerUS = std::max<int64_t>(1, m_iiFreqCountPerSecond / 1000000);
+
+    // High resolution timers are available from Windows 10 1803
+    m_hTimer          = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    m_bHighResolution = (m_hTimer != NULL);
+    if (m_hTimer == NULL)
+        m_hTimer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+    if (m_hTimer == NULL)
+        return false;
+
+    // Start conservative, the calibration brings the margin down
+    m_iiSpinMargin = (m_bHighResolution ? FLM_SLEEP_START_MARGIN_US : FLM_SLEEP_START_MARGIN_LOW_RES_US) * m_iiCountPerUS;
+
+    // Past the margin, so that the timer is armed and its overshoot is sampled
+    for (int i = 0; i < FLM_SLEEP_CALIBRATION_COUNT; i++)
+        SleepUntil(Now() + m_iiSpinMargin.load(std::memory_order_relaxed) + FLM_SLEEP_CALIBRATION_US * m_iiCountPerUS);
+    UpdateSpinMargin();
+    ResetStats();
+
+    return true;
+}
+
+void FLM_Precision_Sleeper::Close()
+{
+    if (m_hTimer != NULL)
+    {
+        CloseHandle(m_hTimer);
+        m_hTimer = NULL;
+    }
+}
+
+int64_t FLM_Precision_Sleeper::Now() const
+{
+    int64_t iiNow;
+    QueryPerformanceCounter((LARGE_INTEGER*)&iiNow);
+    return iiNow;
+}
+
+bool FLM_Precision_Sleeper::SleepUntil(int64_t iiSleepEnd, HANDLE hAbortEvent)
+{
+    int64_t iiNow       = Now();
+    int64_t iiWakeTime  = iiSleepEnd - m_iiSpinMargin.load(std::memory_order_relaxed);
+
+    if ((m_hTimer != NULL) && (iiWakeTime > iiNow))
+    {
+        LARGE_INTEGER dueTime;
+        dueTime.QuadPart = -((iiWakeTime - iiNow) * 10000000 / m_iiFreqCountPerSecond);  // Relative, in 100 ns units
+
+        if (m_bHighResolution == false)
+            timeBeginPeriod(1);
+
+        DWORD result = WAIT_OBJECT_0;
+        if (SetWaitableTimer(m_hTimer, &dueTime, 0, NULL, NULL, FALSE))
+        {
+            HANDLE handles[2] = {m_hTimer, hAbortEvent};
+            result            = WaitForMultipleObjects((hAbortEvent != NULL) ? 2 : 1, handles, FALSE, INFINITE);
+            iiNow             = Now();
+            if (result == WAIT_OBJECT_0)
+                AddOvershoot(iiNow - iiWakeTime);
+        }
+
+        if (m_bHighResolution == false)
+            timeEndPeriod(1);
+
+        if (result != WAIT_OBJECT_0)
+        {
+            CancelWaitableTimer(m_hTimer);
+            return false;
+        }
+    }
+
+    while (iiNow < iiSleepEnd)
+    {
+        YieldProcessor();
+        iiNow = Now();
+    }
+
+    int64_t iiWakeError = iiNow - iiSleepEnd;
+    int     bucket      = (int)std::min<int64_t>(iiWakeError / m_iiCountPerUS, FLM_SLEEP_HISTOGRAM_BUCKETS - 1);
+    m_wakeError[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    int64_t iiMax = m_iiMaxWakeError.load(std::memory_order_relaxed);
+    if (iiWakeError > iiMax)
+        m_iiMaxWakeError.store(iiWakeError, std::memory_order_relaxed);
+
+    return true;
+}
+
+void FLM_Precision_Sleeper::AddOvershoot(int64_t iiTicks)
+{
+    int bucket = (int)std::clamp<int64_t>(iiTicks / m_iiCountPerUS, 0, FLM_SLEEP_HISTOGRAM_BUCKETS - 1);
+    m_overshoot[bucket]++;
+    m_iOvershootCount++;
+
+    if ((m_iOvershootCount % FLM_SLEEP_UPDATE_INTERVAL) == 0)
+        UpdateSpinMargin();
+
+    // Forget old samples so the margin follows the current system load
+    if (m_iOvershootCount >= FLM_SLEEP_DECAY_COUNT)
+    {
+        m_iOvershootCount = 0;
+        for (uint32_t& count : m_overshoot)
+        {
+            count = count / 2;
+            m_iOvershootCount += count;
+        }
+    }
+}
+
+void FLM_Precision_Sleeper::UpdateSpinMargin()
+{
+    if (m_iOvershootCount == 0)
+        return;
+
+    uint32_t rank  = (m_iOvershootCount * 99 + 99) / 100;
+    uint32_t count = 0;
+    int      bucket = 0;
+    for (; bucket < FLM_SLEEP_HISTOGRAM_BUCKETS - 1; bucket++)
+    {
+        count += m_overshoot[bucket];
+        if (count >= rank)
+            break;
+    }
+
+    int64_t iiMarginUS = std::clamp<int64_t>(bucket + 1, FLM_SLEEP_MIN_MARGIN_US, FLM_SLEEP_MAX_MARGIN_US);
+    m_iiSpinMargin.store(iiMarginUS * m_iiCountPerUS, std::memory_order_relaxed);
+}
+
+FLM_SLEEP_STATS FLM_Precision_Sleeper::GetStats() const
+{
+    FLM_SLEEP_STATS stats;
+    stats.bHighResolution = m_bHighResolution;
+    stats.spinMarginUS    = (double)m_iiSpinMargin.load(std::memory_order_relaxed) / m_iiCountPerUS;
+    stats.maxUS           = (double)m_iiMaxWakeError.load(std::memory_order_relaxed) * 1000000.0 / m_iiFreqCountPerSecond;
+
+    uint32_t buckets[FLM_SLEEP_HISTOGRAM_BUCKETS];
+    for (int i = 0; i < FLM_SLEEP_HISTOGRAM_BUCKETS; i++)
+    {
+        buckets[i] = m_wakeError[i].load(std::memory_order_relaxed);
+        stats.count += buckets[i];
+    }
+    if (stats.count == 0)
+        return stats;
+
+    // Upper bound of the bucket holding the percentile
+    const double percentiles[3] = {50.0, 90.0, 99.0};
+    double*      results[3]     = {&stats.p50US, &stats.p90US, &stats.p99US};
+
+    uint64_t count = 0;
+    int      next  = 0;
+    for (int i = 0; (i < FLM_SLEEP_HISTOGRAM_BUCKETS) && (next < 3); i++)
+    {
+        count += buckets[i];
+        while ((next < 3) && ((double)count >= percentiles[next] / 100.0 * (double)stats.count))
+            *results[next++] = i + 1;
+    }
+    return stats;
+}
+
+void FLM_Precision_Sleeper::ResetStats()
+{
+    for (std::atomic<uint32_t>& bucket : m_wakeError)
+        bucket.store(0, std::memory_order_relaxed);
+    m_iiMaxWakeError.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,72 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_precision_sleeper.h
+/// @brief  Self calibrating sleep until a QueryPerformanceCounter time stamp
+//=============================================================================
+
+#ifndef FLM_PRECISION_SLEEPER_H
+#define FLM_PRECISION_SLEEPER_H
+
+#include <Windows.h>
+#include <stdint.h>
+#include <atomic>
+
+#define FLM_SLEEP_HISTOGRAM_BUCKETS        4096  // 1 us buckets, the last one collects everything above
+#define FLM_SLEEP_START_MARGIN_US          1000  // Before the calibration in Init(), of a high resolution timer
+#define FLM_SLEEP_START_MARGIN_LOW_RES_US  2000  // Of a standard timer
+
+struct FLM_SLEEP_STATS
+{
+    uint64_t count           = 0;
+    double   p50US           = 0.0;
+    double   p90US           = 0.0;
+    double   p99US           = 0.0;
+    double   maxUS           = 0.0;
+    double   spinMarginUS    = 0.0;    // Current calibrated margin spun before the deadline
+    bool     bHighResolution = false;  // High resolution waitable timer, else a standard timer with timeBeginPeriod(1)
+};
+
+//
+// Sleeps on a waitable timer until a calibrated margin before the deadline and spins only for that margin.
+// The margin is the 99th percentile of the timer wake up overshoot, learned from every sleep and from a short
+// calibration in Init(). The overshoot history decays so the margin follows changes of the system load.
+//
+// SleepUntil() must be called from one thread only, GetStats() and ResetStats() can be called from any thread.
+//
+class FLM_Precision_Sleeper
+{
+public:
+    ~FLM_Precision_Sleeper();
+
+    bool Init();
+    void Close();
+
+    // Returns false if hAbortEvent was set before iiSleepEnd
+    bool SleepUntil(int64_t iiSleepEnd, HANDLE hAbortEvent = NULL);
+
+    // Histogram of the wake up error: time of return - iiSleepEnd
+    FLM_SLEEP_STATS GetStats() const;
+    void            ResetStats();
+
+private:
+    int64_t Now() const;
+    void    AddOvershoot(int64_t iiTicks);
+    void    UpdateSpinMargin();
+
+    HANDLE  m_hTimer               = NULL;
+    bool    m_bHighResolution      = false;
+    int64_t m_iiFreqCountPerSecond = 10000000;
+    int64_t m_iiCountPerUS         = 10;
+
+    // Calibration, owned by the sleeping thread
+    uint32_t m_overshoot[FLM_SLEEP_HISTOGRAM_BUCKETS] = {};
+    uint32_t m_iOvershootCount                        = 0;
+    std::atomic<int64_t> m_iiSpinMargin               = 0;
+
+    // Statistics
+    std::atomic<uint32_t> m_wakeError[FLM_SLEEP_HISTOGRAM_BUCKETS] = {};
+    std::atomic<int64_t>  m_iiMaxWakeError                         = 0;
+};
+
+#endif
@@ -0,0 +1,256 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_projection.cpp
+/// @brief  Motion detection from the row and column profiles of the captured frames
+//=============================================================================
+
+#include "flm_projection.h"
+
+#include <intrin.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+void FlmCalculateProjections(const uint8_t* pData, int iWidth, int iHeight, int iPitch, int32_t* pColumns, int32_t* pRows)
+{
+    const __m128i weights = _mm_set1_epi32(0x00010101);  // B, G and R of each pixel, not A
+    const __m128i ones    = _mm_set1_epi16(1);
+
+    memset(pColumns, 0, sizeof(int32_t) * iWidth);
+
+    for (int y = 0; y < iHeight; y++)
+    {
+        const __m128i* pPixels = (const __m128i*)(pData + (int64_t)y * iPitch);
+        __m128i        rowSum  = _mm_setzero_si128();
+
+        int x = 0;
+        for (; x < (iWidth & ~3); x += 4)
+        {
+            // B+G+R of 4 pixels as 32 bit sums
+            const __m128i pixels  = _mm_load_si128(pPixels++);
+            const __m128i sums    = _mm_madd_epi16(_mm_maddubs_epi16(pixels, weights), ones);
+            __m128i*      pColumn = (__m128i*)(pColumns + x);
+            _mm_storeu_si128(pColumn, _mm_add_epi32(_mm_loadu_si128(pColumn), sums));
+            rowSum = _mm_add_epi32(rowSum, sums);
+        }
+
+        rowSum   = _mm_add_epi32(rowSum, _mm_shuffle_epi32(rowSum, _MM_SHUFFLE(1, 0, 3, 2)));
+        rowSum   = _mm_add_epi32(rowSum, _mm_shuffle_epi32(rowSum, _MM_SHUFFLE(2, 3, 0, 1)));
+        pRows[y] = _mm_cvtsi128_si32(rowSum);
+
+        // The last pixels of a width that is not a multiple of 4
+        const uint8_t* pTail = (const uint8_t*)pPixels;
+        for (; x < iWidth; x++, pTail += 4)
+        {
+            int32_t sum  = pTail[0] + pTail[1] + pTail[2];
+            pColumns[x] += sum;
+            pRows[y]    += sum;
+        }
+    }
+}
+
+float FlmCorrelateProfilesAt(const float* pPrevious, const float* pLatest, int iCount, int iShift)
+{
+    int iStart = std::max(1, 1 + iShift);
+    int iEnd   = std::min(iCount, iCount + iShift);
+    int n      = iEnd - iStart;
+    if (n < 2)
+        return 0.0f;
+
+    double sumP = 0.0, sumL = 0.0, sumPP = 0.0, sumLL = 0.0, sumPL = 0.0;
+    for (int i = iStart; i < iEnd; i++)
+    {
+        double p = pPrevious[i - iShift] - pPrevious[i - iShift - 1];
+        double l = pLatest[i] - pLatest[i - 1];
+        sumP  += p;
+        sumL  += l;
+        sumPP += p * p;
+        sumLL += l * l;
+        sumPL += p * l;
+    }
+
+    double varP  = sumPP - sumP * sumP / n;
+    double varL  = sumLL - sumL * sumL / n;
+    double covar = sumPL - sumP * sumL / n;
+    if ((varP <= 1e-6 * sumPP) || (varL <= 1e-6 * sumLL) || (varP <= 0.0) || (varL <= 0.0))
+        return 0.0f;  // Flat profile, nothing to line up
+
+    return (float)(covar / sqrt(varP * varL));
+}
+
+float FlmCorrelateProfiles(const float* pPrevious, const float* pLatest, int iCount, int iMinShift, int iMaxShift, int* pShift)
+{
+    iMinShift = std::max(iMinShift, -iCount / 2);
+    iMaxShift = std::min(iMaxShift, iCount / 2);
+
+    float fBest      = -1.0f;
+    int   iBestShift = 0;
+    for (int iShift = iMinShift; iShift <= iMaxShift; iShift++)
+    {
+        float fCorrelation = FlmCorrelateProfilesAt(pPrevious, pLatest, iCount, iShift);
+        if ((fCorrelation > fBest) || ((fCorrelation == fBest) && (abs(iShift) < abs(iBestShift))))
+        {
+            fBest      = fCorrelation;
+            iBestShift = iShift;
+        }
+    }
+
+    *pShift = iBestShift;
+    return fBest;
+}
+
+void FLM_Projection_Detector::UpdateProfiles(const FLM_SAD_INPUT& input)
+{
+    m_iWidth  = input.iWidth;
+    m_iHeight = input.iHeight;
+    m_columnSums.assign((size_t)m_iWidth, 0);
+    m_rowSums.assign((size_t)m_iHeight, 0);
+
+    m_columns.iBinSize = std::max(1, (m_iWidth + FLM_PROJECTION_MAX_BINS - 1) / FLM_PROJECTION_MAX_BINS);
+    m_rows.iBinSize    = std::max(1, (m_iHeight + FLM_PROJECTION_MAX_BINS - 1) / FLM_PROJECTION_MAX_BINS);
+    for (int i = 0; i < 2; i++)
+    {
+        m_columns.values[i].assign((size_t)m_iWidth, 0.0f);
+        m_columns.bins[i].assign((size_t)(m_iWidth / m_columns.iBinSize), 0.0f);
+        m_rows.values[i].assign((size_t)m_iHeight, 0.0f);
+        m_rows.bins[i].assign((size_t)(m_iHeight / m_rows.iBinSize), 0.0f);
+    }
+    m_bHavePrev = false;
+}
+
+void FLM_Projection_Detector::SetProfile(const int32_t* pSums, PROFILE& profile)
+{
+    std::vector<float>& values = profile.values[m_iLatest];
+    std::vector<float>& bins   = profile.bins[m_iLatest];
+
+    for (size_t i = 0; i < values.size(); i++)
+        values[i] = (float)pSums[i];
+
+    for (size_t i = 0; i < bins.size(); i++)
+    {
+        float sum = 0.0f;
+        for (int j = 0; j < profile.iBinSize; j++)
+            sum += values[i * profile.iBinSize + j];
+        bins[i] = sum;
+    }
+}
+
+float FLM_Projection_Detector::FindShift(const PROFILE& profile, int iMaxShift, int* pShift, float* pCorrelationAt0)
+{
+    const std::vector<float>& values     = profile.values[m_iLatest];
+    const std::vector<float>& prevValues = profile.values[m_iLatest ^ 1];
+    const std::vector<float>& bins       = profile.bins[m_iLatest];
+    const std::vector<float>& prevBins   = profile.bins[m_iLatest ^ 1];
+
+    int   iCount = (int)values.size();
+    int   iShift;
+    float fBest;
+    if (profile.iBinSize == 1)
+        fBest = FlmCorrelateProfiles(prevValues.data(), values.data(), iCount, -iMaxShift, iMaxShift, &iShift);
+    else
+    {
+        int iBinShift;
+        int iMaxBinShift = iMaxShift / profile.iBinSize;
+        FlmCorrelateProfiles(prevBins.data(), bins.data(), (int)bins.size(), -iMaxBinShift, iMaxBinShift, &iBinShift);
+
+        // A shift that is not a multiple of the bin size lowers the correlation of the bins, not of the pixels
+        fBest = FlmCorrelateProfiles(prevValues.data(), values.data(), iCount, (iBinShift - 1) * profile.iBinSize,
+                                     (iBinShift + 1) * profile.iBinSize, &iShift);
+    }
+
+    *pShift          = iShift;
+    *pCorrelationAt0 = FlmCorrelateProfilesAt(prevValues.data(), values.data(), iCount, 0);
+    return fBest;
+}
+
+int FLM_Projection_Detector::Process(const FLM_SAD_INPUT& input, int64_t iiFrameIdx)
+{
+    // A repeated frame has the profiles and the result of the previous call
+    if ((iiFrameIdx == m_iiFrameIdx) && (input.iWidth == m_iWidth) && (input.iHeight == m_iHeight))
+        return m_iSAD;
+    m_iiFrameIdx = iiFrameIdx;
+
+    if ((input.iWidth != m_iWidth) || (input.iHeight != m_iHeight))
+        UpdateProfiles(input);
+
+    m_iShiftX      = 0;
+    m_iShiftY      = 0;
+    m_fCorrelation = 0.0f;
+    m_bShifted     = false;
+    m_iSAD         = 0;
+    if ((m_iWidth < 4) || (m_iHeight < 1) || (input.pData0 == nullptr) || (input.pData1 == nullptr))
+        return 0;
+
+    const uint8_t* pLatest = input.bData1Latest ? input.pData1 : input.pData0;
+    FlmCalculateProjections(pLatest, m_iWidth, m_iHeight, input.iPitch, m_columnSums.data(), m_rowSums.data());
+
+    m_iLatest ^= 1;
+    SetProfile(m_columnSums.data(), m_columns);
+    SetProfile(m_rowSums.data(), m_rows);
+
+    bool bHavePrev = m_bHavePrev;
+    m_bHavePrev    = true;
+    if (bHavePrev == false)
+        return 0;
+
+    const std::vector<float>& columns     = m_columns.values[m_iLatest];
+    const std::vector<float>& prevColumns = m_columns.values[m_iLatest ^ 1];
+    double                    fChange     = 0.0;
+    for (size_t i = 0; i < columns.size(); i++)
+        fChange += fabs(columns[i] - prevColumns[i]);
+    m_iSAD = (int)(fChange * 10.0 / (3.0 * (double)m_iWidth * m_iHeight));
+    if (m_iSAD == 0)
+        return 0;
+
+    // Horizontal shifts up to a quarter of the width, a mouse step pans the camera by far less
+    float fColumnAt0, fRowAt0;
+    float fColumnBest = FindShift(m_columns, m_iWidth / 4, &m_iShiftX, &fColumnAt0);
+    float fRowBest    = FindShift(m_rows, m_iHeight / 8, &m_iShiftY, &fRowAt0);
+    m_fCorrelation    = fColumnBest;
+
+    bool bHorizontal = (m_iShiftX != 0) && (fColumnBest >= FLM_PROJECTION_MIN_CORRELATION) &&
+                       (fColumnBest - fColumnAt0 >= FLM_PROJECTION_MIN_GAIN);
+    bool bVertical   = (abs(m_iShiftY) > m_rows.iBinSize) && (fRowBest >= FLM_PROJECTION_MIN_CORRELATION) &&
+                       (fRowBest - fRowAt0 >= FLM_PROJECTION_MIN_GAIN);
+    m_bShifted = bHorizontal && (bVertical == false);
+    return m_iSAD;
+}
+
+int FLM_Projection_Detector::Detect(int iInjectedStep)
+{
+    if (m_bShifted == false)
+        return 0;
+
+    if (iInjectedStep != 0)
+    {
+        // A pan against the camera direction is not the response, unless enough of them in a row show an inverted axis
+        int iPolarity = ((m_iShiftX > 0) == (iInjectedStep > 0)) ? 1 : -1;
+        if (iPolarity != m_iPolarity)
+        {
+            m_iVotes = m_bLearnPolarity ? m_iVotes + 1 : 0;
+            if (m_iVotes >= FLM_PROJECTION_POLARITY_VOTES)
+            {
+                m_iPolarity = iPolarity;
+                m_iVotes    = 0;
+            }
+            return 0;
+        }
+        m_iVotes = 0;
+    }
+    return abs(m_iShiftX);
+}
+
+void FLM_Projection_Detector::Reset(bool bLearnPolarity)
+{
+    m_bHavePrev      = false;
+    m_iiFrameIdx     = -1;
+    m_iSAD           = 0;
+    m_iShiftX        = 0;
+    m_iShiftY        = 0;
+    m_fCorrelation   = 0.0f;
+    m_bShifted       = false;
+    m_bLearnPolarity = bLearnPolarity;
+    m_iPolarity      = FLM_PROJECTION_POLARITY;
+    m_iVotes         = 0;
+}
@@ -0,0 +1,102 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_projection.h
+/// @brief  Motion detection from the row and column profiles of the captured frames
+//=============================================================================
+
+#ifndef FLM_PROJECTION_H
+#define FLM_PROJECTION_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "flm_sad.h"
+
+#define FLM_PROJECTION_MAX_BINS        512    // The shift search is done on the profiles binned down to at most this many values
+#define FLM_PROJECTION_MIN_CORRELATION 0.6f   // Of the profiles at the best shift
+#define FLM_PROJECTION_MIN_GAIN        0.15f  // Correlation at the best shift over the correlation without a shift
+#define FLM_PROJECTION_POLARITY        -1     // Sign of the shift for a positive step, the camera moves the content against the mouse
+#define FLM_PROJECTION_POLARITY_VOTES  3      // Pans in a row against the camera direction that reverse it, when it is learned
+
+// Sums B+G+R of every pixel of a BGRA frame into pColumns (iWidth values) and pRows (iHeight values) in one pass.
+// Rows are 16 byte aligned with iPitch bytes.
+void FlmCalculateProjections(const uint8_t* pData, int iWidth, int iHeight, int iPitch, int32_t* pColumns, int32_t* pRows);
+
+// Correlation of profile pLatest with pPrevious shifted by iShift values, content that moved right has a positive shift.
+// The profiles are differentiated and the correlation is normalized over the overlap, so a brightness or contrast change
+// of the whole frame does not change it. 0 when either profile is flat.
+float FlmCorrelateProfilesAt(const float* pPrevious, const float* pLatest, int iCount, int iShift);
+
+// Shift of pLatest against pPrevious that correlates best, from iMinShift to iMaxShift. At least half of the profiles
+// overlap at every shift. Returns the correlation at the best shift.
+float FlmCorrelateProfiles(const float* pPrevious, const float* pLatest, int iCount, int iMinShift, int iMaxShift, int* pShift);
+
+//
+// Alternative to the SAD detection of the whole capture region for mouse moves. The injected motion is a horizontal
+// pan of the camera, so instead of differencing every pixel each frame is reduced to its column and row profiles and
+// the column profile is cross correlated with the one of the previous frame. Motion is detected when the profiles
+// line up clearly better at a horizontal shift than in place, with no vertical shift. Flicker, lighting changes and
+// animations that stay in place change the profiles without shifting them.
+//
+// The direction of the shift must match the sign of the injected step. The camera of a game moves the content
+// against the mouse, so pans with the mouse are rejected. For games with an inverted camera axis the direction can
+// be learned: FLM_PROJECTION_POLARITY_VOTES rejected pans in a row reverse it. The pan that reverses it is rejected
+// as well, only the pans after it are detected.
+//
+class FLM_Projection_Detector
+{
+public:
+    // Profiles of the latest frame of input, compared with the previous frame when iiFrameIdx is a new frame.
+    // Returns the average change of the column profile per pixel multiplied by 10, 0 when the frames are the same.
+    int Process(const FLM_SAD_INPUT& input, int64_t iiFrameIdx);
+
+    // Horizontal shift in pixels of the latest frame when it is motion in the direction of iInjectedStep, else 0.
+    // The direction is not checked when iInjectedStep is 0.
+    int Detect(int iInjectedStep);
+
+    // Shift in pixels of the latest frame against the previous one, whether or not it was detected
+    int   GetShiftX() const { return m_iShiftX; }
+    int   GetShiftY() const { return m_iShiftY; }
+    float GetCorrelation() const { return m_fCorrelation; }
+
+    // Forgets the previous frame and the learned direction of the camera, at the start of a measurement.
+    // bLearnPolarity lets rejected pans reverse the direction, for an inverted camera axis.
+    void Reset(bool bLearnPolarity = false);
+
+private:
+    // Profiles of the latest and the previous frame, per pixel and binned
+    struct PROFILE
+    {
+        std::vector<float> values[2];
+        std::vector<float> bins[2];
+        int                iBinSize = 1;
+    };
+
+    void UpdateProfiles(const FLM_SAD_INPUT& input);
+    void SetProfile(const int32_t* pSums, PROFILE& profile);
+
+    // Searched over the bins, refined around the best bin at full resolution. Returns the correlation at the shift.
+    float FindShift(const PROFILE& profile, int iMaxShift, int* pShift, float* pCorrelationAt0);
+
+    std::vector<int32_t> m_columnSums;
+    std::vector<int32_t> m_rowSums;
+    PROFILE              m_columns;
+    PROFILE              m_rows;
+    int                  m_iLatest      = 0;  // Index of the latest frame in the profiles
+    bool                 m_bHavePrev    = false;
+    int                  m_iWidth       = 0;
+    int                  m_iHeight      = 0;
+    int64_t              m_iiFrameIdx   = -1;
+
+    int   m_iSAD           = 0;
+    int   m_iShiftX        = 0;
+    int   m_iShiftY        = 0;
+    float m_fCorrelation   = 0.0f;
+    bool  m_bShifted       = false;  // Latest frame is a clear horizontal shift of the previous one
+    bool  m_bLearnPolarity = false;
+    int   m_iPolarity      = FLM_PROJECTION_POLARITY;  // Sign of the shift for a positive injected step
+    int   m_iVotes         = 0;                        // Rejected pans in a row
+};
+
+#endif
@@ -0,0 +1,203 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_refresh_estimator.cpp
+/// @brief  Display refresh rate and VRR estimation from captured present timestamps
+//=============================================================================
+
+#include "flm_refresh_estimator.h"
+
+#include <algorithm>
+#include <math.h>
+
+void FLM_Refresh_Estimator::Init(float fNominalRefreshHz, int64_t iiTicksPerMS)
+{
+    m_fNominalRefreshHz = std::max<float>(1.0f, fNominalRefreshHz);
+    m_iiTicksPerMS      = std::max<int64_t>(1, iiTicksPerMS);
+    Reset();
+}
+
+void FLM_Refresh_Estimator::Reset()
+{
+    m_iiPrevTimeStamp     = 0;
+    m_iiPrevFrameIdx      = 0;
+    m_iNumDeltas          = 0;
+    m_iWritePos           = 0;
+    m_iSamplesSinceUpdate = 0;
+
+    // Until enough frames are captured report the display mode as set in the OS, not the estimate of the previous session
+    m_estimate                 = FLM_REFRESH_ESTIMATE();
+    m_estimate.refreshRateHz   = m_fNominalRefreshHz;
+    m_estimate.scanoutPeriodMS = 1000.0f / m_fNominalRefreshHz;
+}
+
+const FLM_REFRESH_ESTIMATE& FLM_Refresh_Estimator::GetEstimate() const
+{
+    return m_estimate;
+}
+
+bool FLM_Refresh_Estimator::HasEstimate() const
+{
+    return m_estimate.numSamples > 0;
+}
+
+bool FLM_Refresh_Estimator::AddPresentTimestamp(int64_t iiTimeStamp, int64_t iiFrameIdx)
+{
+    if (iiFrameIdx == m_iiPrevFrameIdx)  // Repeating frame
+        return false;
+
+    // Only use intervals between consecutive presents, a skipped frame index means the capture missed a present
+    if ((m_iiPrevTimeStamp != 0) && (iiFrameIdx - m_iiPrevFrameIdx == 1) && (iiTimeStamp > m_iiPrevTimeStamp))
+    {
+        float fDeltaMS = float(iiTimeStamp - m_iiPrevTimeStamp) / m_iiTicksPerMS;
+        if (fDeltaMS < HISTOGRAM_BINS * BIN_SIZE_MS)
+        {
+            m_fDeltasMS[m_iWritePos] = fDeltaMS;
+            m_iWritePos              = (m_iWritePos + 1) % HISTORY_SIZE;
+            m_iNumDeltas             = std::min<int>(m_iNumDeltas + 1, HISTORY_SIZE);
+            m_iSamplesSinceUpdate++;
+        }
+    }
+
+    m_iiPrevTimeStamp = iiTimeStamp;
+    m_iiPrevFrameIdx  = iiFrameIdx;
+
+    if ((m_iNumDeltas >= MIN_SAMPLES) && (m_iSamplesSinceUpdate >= UPDATE_INTERVAL))
+    {
+        m_iSamplesSinceUpdate = 0;
+        UpdateEstimate();
+        return true;
+    }
+
+    return false;
+}
+
+void FLM_Refresh_Estimator::UpdateEstimate()
+{
+    const int   n                = m_iNumDeltas;
+    const float fNominalPeriodMS = 1000.0f / m_fNominalRefreshHz;
+
+    // 1. Histogram of the present intervals
+    int histogram[HISTOGRAM_BINS] = {};
+    for (int i = 0; i < n; i++)
+        histogram[std::min<int>(HISTOGRAM_BINS - 1, int(m_fDeltasMS[i] / BIN_SIZE_MS))]++;
+
+    // 2. The smallest well populated cluster (+-0.2 ms) is the candidate for the fundamental period
+    const int iMinClusterSize = std::max<int>(3, n / 10);
+    float     fPeriodMS       = 0.0f;
+    for (int bin = 0; bin < HISTOGRAM_BINS; bin++)
+    {
+        int lo    = std::max<int>(0, bin - 2);
+        int hi    = std::min<int>(HISTOGRAM_BINS - 1, bin + 2);
+        int count = 0;
+        for (int b = lo; b <= hi; b++)
+            count += histogram[b];
+
+        if (count >= iMinClusterSize)
+        {
+            float fLoMS = lo * BIN_SIZE_MS;
+            float fHiMS = (hi + 1) * BIN_SIZE_MS;
+            float fSum  = 0.0f;
+            int   iNum  = 0;
+            for (int i = 0; i < n; i++)
+            {
+                if ((m_fDeltasMS[i] >= fLoMS) && (m_fDeltasMS[i] < fHiMS))
+                {
+                    fSum += m_fDeltasMS[i];
+                    iNum++;
+                }
+            }
+            fPeriodMS = fSum / std::max<int>(1, iNum);
+            break;
+        }
+    }
+
+    if (fPeriodMS <= 0.0f)
+        return;
+
+    // 3. Harmonic fit: every interval should be close to an integer multiple of the period (approximate GCD)
+    double dSumMS       = 0.0;
+    int    iSumK        = 0;
+    int    iInliers     = 0;
+    float  fToleranceMS = std::max<float>(0.25f, 0.04f * fPeriodMS);
+    for (int i = 0; i < n; i++)
+    {
+        int k = (int)floorf(m_fDeltasMS[i] / fPeriodMS + 0.5f);
+        if ((k >= 1) && (fabsf(m_fDeltasMS[i] - k * fPeriodMS) <= fToleranceMS))
+        {
+            dSumMS += m_fDeltasMS[i];
+            iSumK += k;
+            iInliers++;
+        }
+    }
+
+    if (iSumK > 0)
+        fPeriodMS = float(dSumMS / iSumK);
+
+    float fInlierFraction = float(iInliers) / n;
+
+    // 4. Classify
+    float sorted[HISTORY_SIZE];
+    std::copy(m_fDeltasMS, m_fDeltasMS + n, sorted);
+    std::nth_element(sorted, sorted + n / 2, sorted + n);
+    float fMedianMS = sorted[n / 2];
+
+    FLM_REFRESH_ESTIMATE estimate;
+    estimate.numSamples = n;
+
+    if (fInlierFraction >= 0.9f)
+    {
+        float fRatio = fPeriodMS / fNominalPeriodMS;
+        int   k      = (int)floorf(fRatio + 0.5f);
+
+        if ((k >= 1) && (fabsf(fRatio - k) <= 0.05f * k))
+        {
+            // Presents are locked to the display mode: fixed refresh, the game may run at a fraction of it
+            estimate.scanoutPeriodMS = fPeriodMS / k;
+            estimate.refreshRateHz   = 1000.0f / estimate.scanoutPeriodMS;
+            estimate.isVRR           = false;
+            estimate.confidence      = fInlierFraction;
+        }
+        else if (fRatio < 0.95f)
+        {
+            // Presenting faster than the display can scan out (no vsync), the display keeps its mode
+            estimate.scanoutPeriodMS = fNominalPeriodMS;
+            estimate.refreshRateHz   = m_fNominalRefreshHz;
+            estimate.isVRR           = false;
+            estimate.confidence      = fInlierFraction;
+        }
+        else
+        {
+            // A steady rate that is not a multiple of the display mode: the display follows the game
+            estimate.scanoutPeriodMS = fNominalPeriodMS;  // VRR panels scan out at the maximum rate and extend the blanking
+            estimate.refreshRateHz   = std::clamp<float>(1000.0f / fPeriodMS, std::min(MIN_VRR_HZ, m_fNominalRefreshHz), m_fNominalRefreshHz);
+            estimate.isVRR           = true;
+            estimate.confidence      = fInlierFraction;
+        }
+    }
+    else
+    {
+        int iSlowerThanMode = 0;
+        for (int i = 0; i < n; i++)
+            if (m_fDeltasMS[i] >= 0.95f * fNominalPeriodMS)
+                iSlowerThanMode++;
+
+        estimate.scanoutPeriodMS = fNominalPeriodMS;
+        if (fMedianMS < 0.95f * fNominalPeriodMS)
+        {
+            // Unquantized intervals shorter than the display mode: tearing on a fixed refresh display
+            estimate.refreshRateHz = m_fNominalRefreshHz;
+            estimate.isVRR         = false;
+            estimate.confidence    = 1.0f - float(iSlowerThanMode) / n;
+        }
+        else
+        {
+            // Unquantized intervals inside the VRR range
+            estimate.refreshRateHz = std::clamp<float>(1000.0f / fMedianMS, std::min(MIN_VRR_HZ, m_fNominalRefreshHz), m_fNominalRefreshHz);
+            estimate.isVRR         = true;
+            estimate.confidence    = float(iSlowerThanMode) / n;
+        }
+    }
+
+    m_estimate = estimate;
+}
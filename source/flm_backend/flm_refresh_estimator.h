@@ -0,0 +1,61 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_refresh_estimator.h
+/// @brief  Display refresh rate and VRR estimation from captured present timestamps
+//=============================================================================
+
+#ifndef FLM_REFRESH_ESTIMATOR_H
+#define FLM_REFRESH_ESTIMATOR_H
+
+#include <stdint.h>
+
+struct FLM_REFRESH_ESTIMATE
+{
+    float refreshRateHz   = 0.0f;   // Effective refresh rate, for VRR displays this follows the presented frame rate
+    float scanoutPeriodMS = 0.0f;   // Time taken by the display to scan out one frame from top to bottom
+    bool  isVRR           = false;  // Present intervals are not quantized to a fixed scanout period
+    float confidence      = 0.0f;   // Fraction of present intervals that agree with the estimate (0..1)
+    int   numSamples      = 0;      // Number of present intervals used for the estimate
+};
+
+// Infers the display scanout period from the intervals between presented frames.
+// On a fixed refresh display every present interval is an integer multiple of the scanout period,
+// so the period is found as the approximate GCD of the intervals: the smallest well populated
+// histogram cluster, refined by a harmonic fit over all intervals. If the intervals do not line up
+// on a common period the display is treated as VRR.
+//
+// The class has no system dependencies, timestamps are passed in by the caller so recorded sessions
+// can be replayed through it.
+class FLM_Refresh_Estimator
+{
+public:
+    void                        Init(float fNominalRefreshHz, int64_t iiTicksPerMS);
+    void                        Reset();
+    bool                        AddPresentTimestamp(int64_t iiTimeStamp, int64_t iiFrameIdx);  // returns true when a new estimate is available
+    const FLM_REFRESH_ESTIMATE& GetEstimate() const;
+    bool                        HasEstimate() const;
+
+private:
+    void UpdateEstimate();
+
+    static const int HISTORY_SIZE      = 240;    // Number of present intervals kept for the estimate
+    static const int UPDATE_INTERVAL   = 60;     // Recalculate the estimate after this many new intervals
+    static const int MIN_SAMPLES       = 60;     // Minimum number of intervals needed before the first estimate
+    static const int HISTOGRAM_BINS    = 1000;   // 0.1 ms bins covering 0..100 ms
+    static constexpr float BIN_SIZE_MS = 0.1f;
+    static constexpr float MIN_VRR_HZ  = 24.0f;  // Lowest VRR estimate, below it the display repeats frames
+
+    float   m_fNominalRefreshHz    = 60.0f;
+    int64_t m_iiTicksPerMS         = 10000;
+    int64_t m_iiPrevTimeStamp      = 0;
+    int64_t m_iiPrevFrameIdx       = 0;
+    int     m_iNumDeltas           = 0;
+    int     m_iWritePos            = 0;
+    int     m_iSamplesSinceUpdate  = 0;
+    float   m_fDeltasMS[HISTORY_SIZE] = {};
+
+    FLM_REFRESH_ESTIMATE m_estimate;
+};
+
+#endif
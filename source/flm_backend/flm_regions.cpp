@@ -0,0 +1,230 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_regions.cpp
+/// @brief  Named detection regions measured from the same captured frame
+//=============================================================================
+
+#include "flm_regions.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+static std::string TrimRegionText(const std::string& text)
+{
+    size_t first = text.find_first_not_of(" \t");
+    if (first == std::string::npos)
+        return "";
+    size_t last = text.find_last_not_of(" \t");
+    return text.substr(first, last - first + 1);
+}
+
+bool FlmParseRegions(const std::string& text, std::vector<FLM_REGION_SETTINGS>& regions, std::string& error)
+{
+    regions.clear();
+
+    size_t start = 0;
+    while (start <= text.size())
+    {
+        size_t      end   = text.find(';', start);
+        std::string entry = TrimRegionText(text.substr(start, (end == std::string::npos) ? std::string::npos : end - start));
+        start             = (end == std::string::npos) ? text.size() + 1 : end + 1;
+
+        if (entry.empty())
+            continue;
+
+        size_t colon = entry.find(':');
+        if ((colon == std::string::npos) || (colon == 0))
+        {
+            error = "[" + entry + "] is not name:x,y,width,height";
+            return false;
+        }
+
+        FLM_REGION_SETTINGS region;
+        region.name = TrimRegionText(entry.substr(0, colon));
+
+        float values[5] = {0.0f, 0.0f, 1.0f, 1.0f, 0.0f};
+        int   count     = 0;
+        const char* p   = entry.c_str() + colon + 1;
+        while ((count < 5) && (*p != 0))
+        {
+            char* pEnd;
+            values[count] = strtof(p, &pEnd);
+            if (pEnd == p)
+                break;
+            count++;
+            p = pEnd;
+            while ((*p == ' ') || (*p == '\t'))
+                p++;
+            if (*p == ',')
+                p++;
+        }
+
+        if (((count != 4) && (count != 5)) || (*p != 0))
+        {
+            error = "[" + entry + "] is not name:x,y,width,height with an optional threshold coefficient";
+            return false;
+        }
+
+        region.fStartX              = values[0];
+        region.fStartY              = values[1];
+        region.fWidth               = values[2];
+        region.fHeight              = values[3];
+        region.thresholdCoefficient = values[4];
+
+        if ((region.fStartX < 0.0f) || (region.fStartY < 0.0f) || (region.fWidth <= 0.0f) || (region.fHeight <= 0.0f) ||
+            (region.fStartX + region.fWidth > 1.0001f) || (region.fStartY + region.fHeight > 1.0001f) || (region.thresholdCoefficient < 0.0f))
+        {
+            error = "[" + entry + "] is not inside the capture region, position and size are fractions of it from 0 to 1";
+            return false;
+        }
+
+        for (const FLM_REGION_SETTINGS& other : regions)
+        {
+            if (other.name == region.name)
+            {
+                error = "region name " + region.name + " is used twice";
+                return false;
+            }
+        }
+
+        if (regions.size() >= FLM_MAX_REGIONS)
+        {
+            error = "more than " + std::to_string(FLM_MAX_REGIONS) + " regions";
+            return false;
+        }
+
+        regions.push_back(region);
+    }
+    return true;
+}
+
+std::string FlmRegionsToString(const std::vector<FLM_REGION_SETTINGS>& regions)
+{
+    std::string text;
+    for (const FLM_REGION_SETTINGS& region : regions)
+    {
+        char values[128];
+        if (region.thresholdCoefficient > 0.0f)
+            snprintf(values, sizeof(values), ":%g,%g,%g,%g,%g", region.fStartX, region.fStartY, region.fWidth, region.fHeight, region.thresholdCoefficient);
+        else
+            snprintf(values, sizeof(values), ":%g,%g,%g,%g", region.fStartX, region.fStartY, region.fWidth, region.fHeight);
+
+        if (text.empty() == false)
+            text += ";";
+        text += region.name + values;
+    }
+    return text;
+}
+
+void FLM_Region_Set::Configure(const std::vector<FLM_REGION_SETTINGS>& settings)
+{
+    m_regions.clear();
+    for (const FLM_REGION_SETTINGS& setting : settings)
+    {
+        FLM_REGION region;
+        region.setting = setting;
+        m_regions.push_back(region);
+    }
+
+    m_rects.assign(m_regions.size(), FLM_SAD_RECT());
+    m_rectSAD.assign(m_regions.size(), 0);
+    m_iFrameWidth  = 0;
+    m_iFrameHeight = 0;
+    m_iiFrameIdx   = 0;
+}
+
+void FLM_Region_Set::UpdateRects(const FLM_SAD_INPUT& input)
+{
+    m_iFrameWidth  = input.iWidth;
+    m_iFrameHeight = input.iHeight;
+    m_bAveraged4   = input.bAveraged4;
+
+    int iBlockCount = FlmGetSADBlockCount(input);
+    m_rowScratch.assign((size_t)iBlockCount + 1, 0);
+
+    // Rounded to whole blocks and rows, at least one of each
+    for (size_t i = 0; i < m_regions.size(); i++)
+    {
+        const FLM_REGION_SETTINGS& setting = m_regions[i].setting;
+        FLM_SAD_RECT&              rect    = m_rects[i];
+
+        int iBlockX0 = std::clamp((int)(setting.fStartX * iBlockCount + 0.5f), 0, std::max(0, iBlockCount - 1));
+        int iBlockX1 = std::clamp((int)((setting.fStartX + setting.fWidth) * iBlockCount + 0.5f), iBlockX0 + 1, iBlockCount);
+        int iY0      = std::clamp((int)(setting.fStartY * input.iHeight + 0.5f), 0, std::max(0, input.iHeight - 1));
+        int iY1      = std::clamp((int)((setting.fStartY + setting.fHeight) * input.iHeight + 0.5f), iY0 + 1, input.iHeight);
+
+        rect.iBlockX     = iBlockX0;
+        rect.iBlockWidth = std::max(0, iBlockX1 - iBlockX0);
+        rect.iY          = iY0;
+        rect.iHeight     = std::max(0, iY1 - iY0);
+
+        m_regions[i].rect = rect;
+    }
+}
+
+int FLM_Region_Set::Process(const FLM_SAD_INPUT& input, float fThresholdMultiplierCoeff, float fAVGFilterAlpha, float fFalseTriggerRate, bool bInputPending)
+{
+    if ((input.iWidth != m_iFrameWidth) || (input.iHeight != m_iFrameHeight) || (input.bAveraged4 != m_bAveraged4))
+        UpdateRects(input);
+
+    int iSAD = FlmCalculateRegionSADs(input, m_rects.data(), (int)m_rects.size(), m_rectSAD.data(), m_rowScratch.data());
+
+    for (size_t i = 0; i < m_regions.size(); i++)
+    {
+        FLM_REGION& region  = m_regions[i];
+        bool        bOwn    = (region.setting.thresholdCoefficient > 0.0f);
+        float       fCoeff  = bOwn ? region.setting.thresholdCoefficient : fThresholdMultiplierCoeff;
+        region.iSAD         = m_rectSAD[i];
+        region.iThSAD       = region.background.Update(region.iSAD, fCoeff, fAVGFilterAlpha, bOwn ? 0.0f : fFalseTriggerRate, bInputPending);
+    }
+    return iSAD;
+}
+
+uint32_t FLM_Region_Set::Detect(int iSession, const FLM_DETECTION_SETTINGS& settings, int64_t iiInjectTime, int64_t iiFrameIdx, int64_t iiFrameTimeStamp,
+                                int64_t iiTicksPerMS)
+{
+    // A repeated frame is not counted as a frame without motion
+    bool bNewFrame = (iiFrameIdx != m_iiFrameIdx);
+    m_iiFrameIdx   = iiFrameIdx;
+
+    uint32_t measured = 0;
+    for (size_t i = 0; i < m_regions.size(); i++)
+    {
+        FLM_REGION&                  region    = m_regions[i];
+        FLM_Detection_State_Machine& detection = region.detection;
+
+        detection.SetSession(iSession, settings, iiFrameIdx);
+        detection.Inject(iiInjectTime, iiFrameIdx);
+
+        // A frame captured before the input event can not show its motion
+        if ((bNewFrame == false) || ((detection.GetInjectTime() != 0) && (iiFrameTimeStamp <= detection.GetInjectTime())))
+            continue;
+        if (detection.Frame(region.iThSAD != 0, iiFrameIdx) != FLM_DETECTION_ACTION::MEASURE)
+            continue;
+
+        float fLatencyMS = (float)(iiFrameTimeStamp - detection.GetDetectedInjectTime()) / (float)iiTicksPerMS;
+
+        region.latestMS  = fLatencyMS;
+        region.minMS     = (region.count == 0) ? fLatencyMS : std::min(region.minMS, fLatencyMS);
+        region.maxMS     = (region.count == 0) ? fLatencyMS : std::max(region.maxMS, fLatencyMS);
+        region.averageMS = (region.averageMS * region.count + fLatencyMS) / (region.count + 1);
+        region.count++;
+
+        measured |= (1u << i);
+    }
+    return measured;
+}
+
+void FLM_Region_Set::ResetStats()
+{
+    for (FLM_REGION& region : m_regions)
+    {
+        region.count     = 0;
+        region.latestMS  = 0.0f;
+        region.minMS     = 0.0f;
+        region.maxMS     = 0.0f;
+        region.averageMS = 0.0f;
+    }
+}
@@ -0,0 +1,95 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_regions.h
+/// @brief  Named detection regions measured from the same captured frame
+//=============================================================================
+
+#ifndef FLM_REGIONS_H
+#define FLM_REGIONS_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "flm_detection.h"
+#include "flm_sad.h"
+
+#define FLM_MAX_REGIONS 8
+
+// Position and size are fractions (0..1) of the capture region, so every region is inside the captured frame
+struct FLM_REGION_SETTINGS
+{
+    std::string name;
+    float       fStartX              = 0.0f;
+    float       fStartY              = 0.0f;
+    float       fWidth               = 1.0f;
+    float       fHeight              = 1.0f;
+    float       thresholdCoefficient = 0.0f;  // 0 uses ThresholdCoefficientMove or ThresholdCoefficientClick
+};
+
+// Parses "name:x,y,width,height[,threshold];name:..." as set in flm.ini "Regions", an empty text has no regions.
+// Returns false with a description in error.
+bool FlmParseRegions(const std::string& text, std::vector<FLM_REGION_SETTINGS>& regions, std::string& error);
+
+// Inverse of FlmParseRegions()
+std::string FlmRegionsToString(const std::vector<FLM_REGION_SETTINGS>& regions);
+
+struct FLM_REGION
+{
+    FLM_REGION_SETTINGS setting;
+    FLM_SAD_RECT        rect;                    // In the SAD blocks of the current frame size
+    FLM_SAD_BACKGROUND  background;
+    int                 iSAD   = 0;
+    int                 iThSAD = 0;   // SAD above the threshold, 0 when no motion was detected
+
+    FLM_Detection_State_Machine detection;  // Same session, settings and input events as the whole capture region
+
+    // Latencies since ResetStats()
+    int   count      = 0;
+    float latestMS   = 0.0f;
+    float minMS      = 0.0f;
+    float maxMS      = 0.0f;
+    float averageMS  = 0.0f;
+};
+
+//
+// Detection of several regions in one pass over the captured frame. Each region has its own SAD, background
+// estimate, threshold coefficient and latencies, measured from the same input events as the whole capture region.
+// Used from the processing thread only.
+//
+class FLM_Region_Set
+{
+public:
+    void Configure(const std::vector<FLM_REGION_SETTINGS>& settings);
+    bool IsEnabled() const { return m_regions.empty() == false; }
+
+    // SADs and thresholded SADs of every region, returns the SAD of the whole frame. Regions with their own
+    // threshold coefficient keep it, the others use fFalseTriggerRate when it is set.
+    int Process(const FLM_SAD_INPUT& input, float fThresholdMultiplierCoeff, float fAVGFilterAlpha, float fFalseTriggerRate, bool bInputPending = false);
+
+    // Drives the detection state machine of every region with the session, settings and latest input event of the whole
+    // capture region, so each region settles, warms up and pairs motion with input events as it does. Returns a bit per
+    // region that measured a latency with this frame.
+    uint32_t Detect(int iSession, const FLM_DETECTION_SETTINGS& settings, int64_t iiInjectTime, int64_t iiFrameIdx, int64_t iiFrameTimeStamp,
+                    int64_t iiTicksPerMS);
+
+    void ResetStats();
+
+    int               GetCount() const { return (int)m_regions.size(); }
+    const FLM_REGION& GetRegion(int index) const { return m_regions[index]; }
+
+private:
+    void UpdateRects(const FLM_SAD_INPUT& input);
+
+    std::vector<FLM_REGION>   m_regions;
+    std::vector<FLM_SAD_RECT> m_rects;
+    std::vector<int>          m_rectSAD;
+    std::vector<int64_t>      m_rowScratch;
+    int                       m_iFrameWidth  = 0;  // Frame size the rectangles were computed for
+    int                       m_iFrameHeight = 0;
+    bool                      m_bAveraged4   = false;
+    int64_t                   m_iiFrameIdx   = 0;  // Of the latest Detect()
+};
+
+#endif
@@ -0,0 +1,364 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_sad.cpp
+/// @brief  Sum of absolute differences of two captured BGRA frames
+//=============================================================================
+
+#include "flm_sad.h"
+
+#include <intrin.h>
+#include <math.h>
+#include <algorithm>
+
+int FlmCalculateSAD(const uint8_t* pData0, const uint8_t* pData1, int iWidth, int iHeight, int iPitch, int iFilmGrainThreshold)
+{
+    if ((iWidth <= 0) || (iHeight <= 0))
+        return 0;
+
+    bool bSkipFilmGrainFiltering = (iFilmGrainThreshold == 0) ? true : false;
+
+    int64_t iiSAD = 0;
+
+    const __m128i film_grain_thresh128 = _mm_set1_epi8((char)iFilmGrainThreshold); // ignore small deltas - helps filtering out film grain
+    const __m128i zero128              = _mm_set1_epi8(0); // == {0}, == _mm_setzero_si128();
+
+    const int iHCount = iWidth * 4 / 16; // each pixel is 4 bytes, and there are 16 bytes in one __m128i register
+
+    for (int y = 0; y < iHeight; y++)
+    {
+        const __m128i* pMM0         = (const __m128i*)pData0;
+        const __m128i* pMM1         = (const __m128i*)pData1;
+        __m128i        mm_line_2sad = zero128;
+        __m128i        mm_2sad;
+
+        if (bSkipFilmGrainFiltering == false)
+        {
+            for (int i = iHCount - 1; i >= 0; i--)
+            {
+                const __m128i mm0     = _mm_load_si128(pMM0++);
+                const __m128i mm1     = _mm_load_si128(pMM1++);
+
+                const __m128i diff            = _mm_sub_epi8(mm0, mm1);
+                const __m128i abs_diff        = _mm_abs_epi8(diff);
+                const __m128i thresh_abs_diff = _mm_subs_epu8(abs_diff, film_grain_thresh128);
+                mm_2sad = _mm_sad_epu8(thresh_abs_diff, zero128); // A hack: sum of absolute differences with zero ==> just a sum...
+
+                mm_line_2sad = _mm_add_epi64(mm_line_2sad, mm_2sad);  // Accumulate
+            }
+        }
+        else
+        {
+            for (int i = iHCount - 1; i >= 0; i--)
+            {
+                const __m128i mm0     = _mm_load_si128(pMM0++);
+                const __m128i mm1     = _mm_load_si128(pMM1++);
+
+                mm_2sad = _mm_sad_epu8(mm0, mm1); // Sum the absolute differences of packed unsigned 8-bit integers, 2 values representing 8 SADs each.
+
+                mm_line_2sad = _mm_add_epi64(mm_line_2sad, mm_2sad);  // Accumulate
+            }
+        }
+
+        iiSAD += _mm_extract_epi64(mm_line_2sad,0) + _mm_extract_epi64(mm_line_2sad,1);
+
+        pData0 += iPitch;
+        pData1 += iPitch;
+    }
+
+    iiSAD = iiSAD * 10 / (iHeight * iWidth * 3);  // Average change per pixel, multiplied by 10...
+
+    return (int)iiSAD;
+}
+
+int FlmCalculateSADAveraged4(const uint8_t* pData0, const uint8_t* pData1, int iWidth, int iHeight, int iPitch, int iFilmGrainThreshold)
+{
+    if ((iWidth < 4) || (iHeight <= 0))
+        return 0;
+
+    bool bSkipFilmGrainFiltering = (iFilmGrainThreshold == 0) ? true : false;
+
+    int64_t iiSAD = 0;
+
+    const __m128i film_grain_thresh128 = _mm_set1_epi8((char)iFilmGrainThreshold); // ignore small deltas - helps filtering out film grain
+    const __m128i zero128              = _mm_set1_epi8(0); // == {0}, == _mm_setzero_si128();
+
+    iWidth = iWidth / 4;                 // To reduce sensitivity to random noise (film grain), we are going to be averaging 4 adjacent pixel blocks...
+    const int iHCount = iWidth * 4 / 16; // each pixel is 4 bytes, and there are 16 bytes in one __m128i register
+
+    for (int y = 0; y < iHeight; y++)
+    {
+        const __m128i* pMM0         = (const __m128i*)pData0;
+        const __m128i* pMM1         = (const __m128i*)pData1;
+        __m128i        mm_line_2sad = zero128;
+        __m128i        mm_2sad;
+
+        if (bSkipFilmGrainFiltering == false)
+        {
+            for (int i = iHCount - 1; i >= 0; i--)
+            {
+                const __m128i mm0a = _mm_load_si128(pMM0++);
+                const __m128i mm0b = _mm_load_si128(pMM0++);
+                const __m128i mm0c = _mm_load_si128(pMM0++);
+                const __m128i mm0d = _mm_load_si128(pMM0++);
+
+                const __m128i mm1a = _mm_load_si128(pMM1++);
+                const __m128i mm1b = _mm_load_si128(pMM1++);
+                const __m128i mm1c = _mm_load_si128(pMM1++);
+                const __m128i mm1d = _mm_load_si128(pMM1++);
+
+                const __m128i mm0x = _mm_avg_epu8(mm0a, mm0b);
+                const __m128i mm0y = _mm_avg_epu8(mm0c, mm0d);
+
+                const __m128i mm1x = _mm_avg_epu8(mm1a, mm1b);
+                const __m128i mm1y = _mm_avg_epu8(mm1c, mm1d);
+
+                const __m128i mm0  = _mm_avg_epu8(mm0x, mm0y);
+                const __m128i mm1  = _mm_avg_epu8(mm1x, mm1y);
+
+                const __m128i diff            = _mm_sub_epi8(mm0, mm1);
+                const __m128i abs_diff        = _mm_abs_epi8(diff);
+                const __m128i thresh_abs_diff = _mm_subs_epu8(abs_diff, film_grain_thresh128);
+                mm_2sad = _mm_sad_epu8(thresh_abs_diff, zero128); // A hack: sum of absolute differences with zero ==> just a sum...
+
+                mm_line_2sad = _mm_add_epi64(mm_line_2sad, mm_2sad);  // Accumulate
+            }
+        }
+        else
+        {
+            for (int i = iHCount - 1; i >= 0; i--)
+            {
+                const __m128i mm0a = _mm_load_si128(pMM0++);
+                const __m128i mm0b = _mm_load_si128(pMM0++);
+                const __m128i mm0c = _mm_load_si128(pMM0++);
+                const __m128i mm0d = _mm_load_si128(pMM0++);
+
+                const __m128i mm1a = _mm_load_si128(pMM1++);
+                const __m128i mm1b = _mm_load_si128(pMM1++);
+                const __m128i mm1c = _mm_load_si128(pMM1++);
+                const __m128i mm1d = _mm_load_si128(pMM1++);
+
+                const __m128i mm0x = _mm_avg_epu8(mm0a, mm0b);
+                const __m128i mm0y = _mm_avg_epu8(mm0c, mm0d);
+
+                const __m128i mm1x = _mm_avg_epu8(mm1a, mm1b);
+                const __m128i mm1y = _mm_avg_epu8(mm1c, mm1d);
+
+                const __m128i mm0  = _mm_avg_epu8(mm0x, mm0y);
+                const __m128i mm1  = _mm_avg_epu8(mm1x, mm1y);
+
+                mm_2sad = _mm_sad_epu8(mm0, mm1); // Sum the absolute differences of packed unsigned 8-bit integers, 2 values representing 8 SADs each.
+
+                mm_line_2sad = _mm_add_epi64(mm_line_2sad, mm_2sad);  // Accumulate
+            }
+        }
+
+        iiSAD += _mm_extract_epi64(mm_line_2sad,0) + _mm_extract_epi64(mm_line_2sad,1);
+
+        pData0 += iPitch;
+        pData1 += iPitch;
+    }
+
+    iiSAD = iiSAD * 10 / (iHeight * iWidth * 3);  // Average change per pixel, multiplied by 10...
+
+    return (int)iiSAD;
+}
+
+int FlmCalculateSAD(const FLM_SAD_INPUT& input)
+{
+    if (input.bAveraged4)
+        return FlmCalculateSADAveraged4(input.pData0, input.pData1, input.iWidth, input.iHeight, input.iPitch, input.iFilmGrainThreshold);
+    return FlmCalculateSAD(input.pData0, input.pData1, input.iWidth, input.iHeight, input.iPitch, input.iFilmGrainThreshold);
+}
+
+int FlmGetSADBlockCount(const FLM_SAD_INPUT& input)
+{
+    // Same block counts as the loops of FlmCalculateSAD() and FlmCalculateSADAveraged4()
+    return input.bAveraged4 ? (input.iWidth / 4) * 4 / 16 : input.iWidth * 4 / 16;
+}
+
+// Sum of the two halves of _mm_sad_epu8()
+static inline int64_t HorizontalSum(const __m128i mm_2sad)
+{
+    return _mm_cvtsi128_si64(_mm_add_epi64(mm_2sad, _mm_unpackhi_epi64(mm_2sad, mm_2sad)));
+}
+
+// Differences the blocks of one row with the same arithmetic as FlmCalculateSAD() and FlmCalculateSADAveraged4(),
+// pPrefix[i] receives the sum of the blocks before block i
+static void CalculateRowPrefixSAD(const uint8_t* pData0, const uint8_t* pData1, int iBlockCount, bool bAveraged4, int iFilmGrainThreshold,
+                                  int64_t* pPrefix)
+{
+    const __m128i  film_grain_thresh128 = _mm_set1_epi8((char)iFilmGrainThreshold);
+    const __m128i  zero128              = _mm_set1_epi8(0);
+    const __m128i* pMM0                 = (const __m128i*)pData0;
+    const __m128i* pMM1                 = (const __m128i*)pData1;
+
+    int64_t iiSum = 0;
+    pPrefix[0]    = 0;
+    for (int i = 0; i < iBlockCount; i++)
+    {
+        __m128i mm0;
+        __m128i mm1;
+        if (bAveraged4)
+        {
+            const __m128i mm0x = _mm_avg_epu8(_mm_load_si128(pMM0 + 0), _mm_load_si128(pMM0 + 1));
+            const __m128i mm0y = _mm_avg_epu8(_mm_load_si128(pMM0 + 2), _mm_load_si128(pMM0 + 3));
+            const __m128i mm1x = _mm_avg_epu8(_mm_load_si128(pMM1 + 0), _mm_load_si128(pMM1 + 1));
+            const __m128i mm1y = _mm_avg_epu8(_mm_load_si128(pMM1 + 2), _mm_load_si128(pMM1 + 3));
+            mm0                = _mm_avg_epu8(mm0x, mm0y);
+            mm1                = _mm_avg_epu8(mm1x, mm1y);
+            pMM0 += 4;
+            pMM1 += 4;
+        }
+        else
+        {
+            mm0 = _mm_load_si128(pMM0++);
+            mm1 = _mm_load_si128(pMM1++);
+        }
+
+        __m128i mm_2sad;
+        if (iFilmGrainThreshold != 0)
+        {
+            const __m128i abs_diff        = _mm_abs_epi8(_mm_sub_epi8(mm0, mm1));
+            const __m128i thresh_abs_diff = _mm_subs_epu8(abs_diff, film_grain_thresh128);
+            mm_2sad                       = _mm_sad_epu8(thresh_abs_diff, zero128);
+        }
+        else
+            mm_2sad = _mm_sad_epu8(mm0, mm1);
+
+        iiSum += HorizontalSum(mm_2sad);
+        pPrefix[i + 1] = iiSum;
+    }
+}
+
+int FlmCalculateRegionSADs(const FLM_SAD_INPUT& input, const FLM_SAD_RECT* pRects, int iRectCount, int* pRectSAD, int64_t* pRowScratch)
+{
+    int iBlockCount = FlmGetSADBlockCount(input);
+    if ((iBlockCount <= 0) || (input.iHeight <= 0))
+    {
+        for (int r = 0; r < iRectCount; r++)
+            pRectSAD[r] = 0;
+        return 0;
+    }
+
+    int64_t iiRectSAD[FLM_SAD_MAX_RECTS] = {};
+    int64_t iiSAD                        = 0;
+    iRectCount                           = std::min(iRectCount, FLM_SAD_MAX_RECTS);
+
+    const uint8_t* pData0 = input.pData0;
+    const uint8_t* pData1 = input.pData1;
+    for (int y = 0; y < input.iHeight; y++)
+    {
+        CalculateRowPrefixSAD(pData0, pData1, iBlockCount, input.bAveraged4, input.iFilmGrainThreshold, pRowScratch);
+        iiSAD += pRowScratch[iBlockCount];
+
+        for (int r = 0; r < iRectCount; r++)
+        {
+            const FLM_SAD_RECT& rect = pRects[r];
+            if ((y >= rect.iY) && (y < rect.iY + rect.iHeight))
+                iiRectSAD[r] += pRowScratch[rect.iBlockX + rect.iBlockWidth] - pRowScratch[rect.iBlockX];
+        }
+
+        pData0 += input.iPitch;
+        pData1 += input.iPitch;
+    }
+
+    // Average change per pixel multiplied by 10, the pixel count of a block is 4 either way
+    for (int r = 0; r < iRectCount; r++)
+    {
+        int64_t iiPixels = (int64_t)pRects[r].iBlockWidth * 4 * pRects[r].iHeight;
+        pRectSAD[r]      = (iiPixels > 0) ? (int)(iiRectSAD[r] * 10 / (iiPixels * 3)) : 0;
+    }
+
+    int iPixelWidth = input.bAveraged4 ? input.iWidth / 4 : input.iWidth;
+    return (int)(iiSAD * 10 / (input.iHeight * iPixelWidth * 3));
+}
+
+float FlmNormalUpperQuantile(float fProbability)
+{
+    // Abramowitz and Stegun 26.2.23, the error is below 4.5e-4
+    double p = std::clamp((double)fProbability, 1e-9, 0.5);
+    double t = sqrt(-2.0 * log(p));
+    return (float)(t - (2.515517 + 0.802853 * t + 0.010328 * t * t) / (1.0 + 1.432788 * t + 0.189269 * t * t + 0.001308 * t * t * t));
+}
+
+float FLM_SAD_BACKGROUND::GetThreshold(float fThresholdMultiplierCoeff, float fTargetFalseTriggerRate) const
+{
+    if ((fTargetFalseTriggerRate <= 0.0f) || (iNoiseFrames < FLM_NOISE_MIN_FRAMES))
+        return fBackgroundSAD * fThresholdMultiplierCoeff;
+
+    // At least one SAD unit, a static scene has no variance at all
+    float fQuantile  = (fQuantileTarget == fTargetFalseTriggerRate) ? fQuantileZ : FlmNormalUpperQuantile(fTargetFalseTriggerRate);
+    float fDeviation = std::max(1.0f, sqrtf(fNoiseVariance));
+    return fNoiseMean + fQuantile * fDeviation;
+}
+
+int FLM_SAD_BACKGROUND::Update(int iSAD, float fThresholdMultiplierCoeff, float fAVGFilterAlpha, float fTargetFalseTriggerRate, bool bInputPending)
+{
+    // 1. Calculate the thresholded SAD
+    // First - calculate the thresh hold value
+    if ((fTargetFalseTriggerRate > 0.0f) && (fQuantileTarget != fTargetFalseTriggerRate))
+    {
+        fQuantileTarget = fTargetFalseTriggerRate;
+        fQuantileZ      = FlmNormalUpperQuantile(fTargetFalseTriggerRate);
+    }
+
+    bool bAdaptive       = (fTargetFalseTriggerRate > 0.0f) && (iNoiseFrames >= FLM_NOISE_MIN_FRAMES);
+    int  iThreshold      = (int)GetThreshold(fThresholdMultiplierCoeff, fTargetFalseTriggerRate);
+    int  iThresholdedSAD = std::max<int>(0, iSAD - iThreshold);
+    int  iFrameSAD       = iSAD;
+
+    // 2. Estimate the "background SAD" - these will be unrelated to mouse click/movement, and are usually due
+    //    to in-game animations and/or film grain noise effect happening in the monitored region.
+
+    // A workaround for situations where the SAD for even frames is significantly different from SAD for odd frames.
+    // For example, a pathological framegen case where every frame is duplicated, therefore every other SAD is zero.
+    iSAD = iSAD + iPrevSAD / 4;  // Note: the way this works is not straightforward to understand...................
+
+    // iSAD needs to be at least 1 to avoid quantization problems
+    iSAD = std::max<int>(1, iSAD);
+
+    // Second - update statistics. Filter out the large SADs caused by the mouse move
+    bool bBackground = (iSAD <= iPrevSAD         * fThresholdMultiplierCoeff) &&
+                       (iSAD <= iPrevPrevSAD     * fThresholdMultiplierCoeff) &&
+                       (iSAD <= iPrevPrevPrevSAD * fThresholdMultiplierCoeff);
+    if (bBackground)
+    {
+        fBackgroundSAD = fBackgroundSAD * fAVGFilterAlpha + (1 - fAVGFilterAlpha) * iSAD;
+    }
+
+    // Frames of a pending input event are left out of the noise model, their motion is a true trigger. So are the frames
+    // after a detection, they are usually the rest of the same motion.
+    if ((bPrevTriggered == false) && (bInputPending == false))
+    {
+        // The mean and variance are of the SAD as thresholded, without the framegen workaround, so duplicated frames
+        // widen the variance instead. Only frames that passed the filter are added, a spike would inflate the variance.
+        if (bBackground)
+        {
+            if (iNoiseFrames == 0)
+                fNoiseMean = (float)iFrameSAD;
+            float fDelta    = iFrameSAD - fNoiseMean;
+            fNoiseMean     += (1 - fAVGFilterAlpha) * fDelta;
+            fNoiseVariance  = fAVGFilterAlpha * (fNoiseVariance + (1 - fAVGFilterAlpha) * fDelta * fDelta);
+            iNoiseFrames    = std::min(iNoiseFrames + 1, FLM_NOISE_RATE_FRAMES);
+        }
+
+        // Any frame that starts a detection without input is a false trigger, background spikes such as a muzzle flash
+        // included. Averaged over the frames seen so far until there are FLM_NOISE_RATE_FRAMES of them.
+        float fTriggered   = (iThresholdedSAD > 0) ? 1.0f : 0.0f;
+        iRateFrames        = std::min(iRateFrames + 1, FLM_NOISE_RATE_FRAMES);
+        fFalseTriggerRate += (fTriggered - fFalseTriggerRate) / iRateFrames;
+
+        // Stochastic approximation of the quantile: in balance when the triggered fraction is the target
+        if (bAdaptive)
+            fQuantileZ = std::clamp(fQuantileZ + FLM_NOISE_QUANTILE_STEP * (fTriggered - fTargetFalseTriggerRate), 1.0f, 50.0f);
+    }
+
+    // Advance history
+    bPrevTriggered   = (iThresholdedSAD > 0);
+    iPrevPrevPrevSAD = iPrevPrevSAD;
+    iPrevPrevSAD     = iPrevSAD;
+    iPrevSAD         = iSAD;
+
+    return iThresholdedSAD;
+}
@@ -0,0 +1,102 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_sad.h
+/// @brief  Sum of absolute differences of two captured BGRA frames
+//=============================================================================
+
+#ifndef FLM_SAD_H
+#define FLM_SAD_H
+
+#include <stdint.h>
+
+// Both frames are BGRA, 16 byte aligned rows of iPitch bytes. iFilmGrainThreshold is subtracted
+// from every absolute byte difference to ignore film grain, 0 skips the filtering.
+// Returns the average change per pixel multiplied by 10.
+
+// One difference per pixel, the host surfaces of the AMF codec are already downscaled.
+// iWidth must be a multiple of 4.
+int FlmCalculateSAD(const uint8_t* pData0, const uint8_t* pData1, int iWidth, int iHeight, int iPitch, int iFilmGrainThreshold);
+
+// Blocks of 4 adjacent pixels are averaged before the difference to reduce the sensitivity to noise,
+// used for the full resolution DXGI captures. iWidth must be a multiple of 16.
+int FlmCalculateSADAveraged4(const uint8_t* pData0, const uint8_t* pData1, int iWidth, int iHeight, int iPitch, int iFilmGrainThreshold);
+
+// The two frames of a capture codec to difference, see FLM_Capture_Context::GetSADInput()
+struct FLM_SAD_INPUT
+{
+    const uint8_t* pData0              = nullptr;
+    const uint8_t* pData1              = nullptr;
+    int            iWidth              = 0;
+    int            iHeight             = 0;
+    int            iPitch              = 0;
+    int            iFilmGrainThreshold = 0;
+    bool           bAveraged4          = false;  // FlmCalculateSADAveraged4() instead of FlmCalculateSAD()
+    bool           bData1Latest        = false;  // pData1 is the newer of the two frames
+};
+
+int FlmCalculateSAD(const FLM_SAD_INPUT& input);
+
+#define FLM_SAD_MAX_RECTS 16  // Rectangles per FlmCalculateRegionSADs() call
+
+// Rectangle of a frame in SAD blocks of 4 pixels, or of 16 pixels with bAveraged4, and rows
+struct FLM_SAD_RECT
+{
+    int iBlockX      = 0;
+    int iY           = 0;
+    int iBlockWidth  = 0;
+    int iHeight      = 0;
+};
+
+// Number of SAD blocks per row of the input
+int FlmGetSADBlockCount(const FLM_SAD_INPUT& input);
+
+// SAD of the whole frame and of every rectangle in a single pass over the rows, each row is differenced once into
+// pRowScratch (FlmGetSADBlockCount() + 1 values) and the rectangles sum their part of it. Rectangles must lie inside
+// the frame. Returns the SAD of the whole frame, the same value as FlmCalculateSAD(input).
+int FlmCalculateRegionSADs(const FLM_SAD_INPUT& input, const FLM_SAD_RECT* pRects, int iRectCount, int* pRectSAD, int64_t* pRowScratch);
+
+// Noise model of the adaptive threshold
+#define FLM_NOISE_MIN_FRAMES     32      // Background frames before the adaptive threshold replaces the coefficient
+#define FLM_NOISE_QUANTILE_STEP  0.05f   // Change of fQuantileZ per false trigger, it falls by the target rate times this each frame
+#define FLM_NOISE_RATE_FRAMES    1000    // Frames without input averaged by fFalseTriggerRate
+
+// Quantile of the standard normal distribution for the upper tail probability fProbability
+float FlmNormalUpperQuantile(float fProbability);
+
+// Estimate of the SAD of frames without input motion, from in-game animations and film grain, and the
+// thresholding of SADs against it. One per monitored region.
+//
+// Besides the average, the mean and variance of the background SADs are tracked. With a target false trigger rate
+// the threshold is fNoiseMean + fQuantileZ * standard deviation, where fQuantileZ starts at the normal quantile of the
+// target and then follows the measured rate, so that scenes with heavier tails than a normal distribution such as
+// foliage or particles still trigger at the target rate. fFalseTriggerRate is the measured fraction of background
+// frames above the threshold, whichever way the threshold is set.
+struct FLM_SAD_BACKGROUND
+{
+    float fBackgroundSAD   = 0.0f;
+    int   iPrevSAD         = 0;
+    int   iPrevPrevSAD     = 0;
+    int   iPrevPrevPrevSAD = 0;
+
+    float fNoiseMean        = 0.0f;
+    float fNoiseVariance    = 0.0f;
+    int   iNoiseFrames      = 0;     // In the mean and variance, up to FLM_NOISE_RATE_FRAMES
+    int   iRateFrames       = 0;     // In fFalseTriggerRate, up to FLM_NOISE_RATE_FRAMES
+    float fQuantileZ        = 0.0f;  // Of the standard deviation above the mean, 0 until a target rate is set
+    float fQuantileTarget   = 0.0f;  // Target rate fQuantileZ follows
+    float fFalseTriggerRate = 0.0f;  // Probability that a frame without input motion triggers
+    bool  bPrevTriggered    = false;
+
+    // Returns what is left of iSAD above the threshold, then adds iSAD to the estimate. The threshold is
+    // fBackgroundSAD * fThresholdMultiplierCoeff, or set from the noise model when fTargetFalseTriggerRate > 0.
+    // fThresholdMultiplierCoeff also excludes sudden SAD jumps, the motion, from the estimates. bInputPending is set while
+    // an input event waits for its motion or was just detected, those frames are left out of the noise model.
+    int  Update(int iSAD, float fThresholdMultiplierCoeff, float fAVGFilterAlpha, float fTargetFalseTriggerRate = 0.0f, bool bInputPending = false);
+    void Reset() { *this = FLM_SAD_BACKGROUND(); }
+
+    // Threshold the next Update() applies
+    float GetThreshold(float fThresholdMultiplierCoeff, float fTargetFalseTriggerRate = 0.0f) const;
+};
+
+#endif
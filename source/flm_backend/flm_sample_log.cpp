@@ -0,0 +1,339 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_sample_log.cpp
+/// @brief  Binary per frame sample log written on a separate thread
+//=============================================================================
+
+#include "flm_sample_log.h"
+#include "flm_utils.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <new>
+#include <string>
+
+FLM_Sample_Log::~FLM_Sample_Log()
+{
+    Close();
+}
+
+bool FLM_Sample_Log::Open(const char* fileName, int64_t iiTicksPerSecond, const std::string& metadata)
+{
+    if (m_file != NULL)
+        return true;
+
+    m_file = fopen(fileName, "wb");
+    if (m_file == NULL)
+        return false;
+
+    FLM_SAMPLE_LOG_HEADER header = {};
+    memcpy(header.magic, FLM_SAMPLE_LOG_MAGIC, sizeof(header.magic));
+    header.version        = FLM_SAMPLE_LOG_VERSION;
+    header.recordSize     = sizeof(FLM_SAMPLE_RECORD);
+    header.metadataSize   = (uint32_t)metadata.size();
+    header.ticksPerSecond = iiTicksPerSecond;
+    fwrite(&header, sizeof(header), 1, m_file);
+    fwrite(metadata.data(), 1, metadata.size(), m_file);
+
+    m_writePos.store(0, std::memory_order_relaxed);
+    m_readPos.store(0, std::memory_order_relaxed);
+    m_droppedRecords.store(0, std::memory_order_relaxed);
+    m_iBlockBytes = 0;
+
+    if (m_thread.Start([this](const FLM_Stop_Token& stop) { WriterThreadFunction(stop); }) == false)
+    {
+        fclose(m_file);
+        m_file = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+void FLM_Sample_Log::Close()
+{
+    m_thread.Stop();
+
+    if (m_file != NULL)
+    {
+        fclose(m_file);
+        m_file = NULL;
+    }
+}
+
+void FLM_Sample_Log::Push(const FLM_SAMPLE_RECORD& record)
+{
+    uint64_t writePos = m_writePos.load(std::memory_order_relaxed);
+    if (writePos - m_readPos.load(std::memory_order_acquire) >= RING_SIZE)
+    {
+        m_droppedRecords.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    m_ring[writePos & (RING_SIZE - 1)] = record;
+    m_writePos.store(writePos + 1, std::memory_order_release);
+}
+
+void FLM_Sample_Log::WriterThreadFunction(const FLM_Stop_Token& stop)
+{
+    while (stop.SleepFor(WRITER_TIMEOUT_MS))
+        Drain();
+
+    // Write everything that is left, including a partial block
+    Drain();
+    if (m_iBlockBytes > 0)
+    {
+        fwrite(m_block, 1, m_iBlockBytes, m_file);
+        m_iBlockBytes = 0;
+    }
+    fflush(m_file);
+}
+
+void FLM_Sample_Log::Drain()
+{
+    uint64_t readPos  = m_readPos.load(std::memory_order_relaxed);
+    uint64_t writePos = m_writePos.load(std::memory_order_acquire);
+
+    while (readPos != writePos)
+    {
+        memcpy(m_block + m_iBlockBytes, &m_ring[readPos & (RING_SIZE - 1)], sizeof(FLM_SAMPLE_RECORD));
+        m_iBlockBytes += sizeof(FLM_SAMPLE_RECORD);
+        readPos++;
+
+        if (m_iBlockBytes + (int)sizeof(FLM_SAMPLE_RECORD) > BLOCK_SIZE_BYTES)
+        {
+            m_readPos.store(readPos, std::memory_order_release);  // Release ring space before the slow write
+            fwrite(m_block, 1, m_iBlockBytes, m_file);
+            m_iBlockBytes = 0;
+        }
+    }
+
+    m_readPos.store(readPos, std::memory_order_release);
+}
+
+//------------------------------------------------------------------------------------------
+// Conversion of a sample log to CSV or to a columnar file
+//------------------------------------------------------------------------------------------
+
+enum FLM_COLUMN_TYPE
+{
+    FLM_COLUMN_INT64   = 0,
+    FLM_COLUMN_INT32   = 1,
+    FLM_COLUMN_FLOAT32 = 2,
+    FLM_COLUMN_UINT32  = 3,
+};
+
+#pragma pack(push, 1)
+struct FLM_COLUMNAR_HEADER
+{
+    char     magic[4];        // FLM_SAMPLE_COLUMNAR_MAGIC
+    uint32_t version;         // FLM_SAMPLE_LOG_VERSION
+    uint32_t numColumns;
+    uint32_t metadataSize;    // Bytes of "key = value" lines following the header, copied from the sample log
+    uint64_t numRows;
+    int64_t  ticksPerSecond;
+};
+
+// Followed by numRows values of the column type
+struct FLM_COLUMNAR_COLUMN_HEADER
+{
+    char     name[16];
+    uint32_t type;       // FLM_COLUMN_TYPE
+    uint32_t valueSize;  // Bytes per value
+};
+#pragma pack(pop)
+
+struct FLM_SAMPLE_COLUMN
+{
+    const char*     name;
+    FLM_COLUMN_TYPE type;
+    uint32_t        offset;
+    uint32_t        size;
+};
+
+static const FLM_SAMPLE_COLUMN g_sampleColumns[] = {
+    {"inject_time",     FLM_COLUMN_INT64,   offsetof(FLM_SAMPLE_RECORD, injectTime),     sizeof(int64_t)},
+    {"present_time",    FLM_COLUMN_INT64,   offsetof(FLM_SAMPLE_RECORD, presentTime),    sizeof(int64_t)},
+    {"frame_idx",       FLM_COLUMN_INT64,   offsetof(FLM_SAMPLE_RECORD, frameIdx),       sizeof(int64_t)},
+    {"sad",             FLM_COLUMN_INT32,   offsetof(FLM_SAMPLE_RECORD, sad),            sizeof(int32_t)},
+    {"thresholded_sad", FLM_COLUMN_INT32,   offsetof(FLM_SAMPLE_RECORD, thresholdedSAD), sizeof(int32_t)},
+    {"latency_ms",      FLM_COLUMN_FLOAT32, offsetof(FLM_SAMPLE_RECORD, latencyMS),      sizeof(float)},
+    {"flags",           FLM_COLUMN_UINT32,  offsetof(FLM_SAMPLE_RECORD, flags),          sizeof(uint32_t)},
+};
+
+static const int FLM_NUM_SAMPLE_COLUMNS = sizeof(g_sampleColumns) / sizeof(g_sampleColumns[0]);
+static const int FLM_CONVERT_CHUNK      = 4096;  // Records read from the input per fread
+
+static FLM_STATUS ConvertSampleLogToCSV(FILE* input, FILE* output, const FLM_SAMPLE_LOG_HEADER& header, const std::string& metadata)
+{
+    fprintf(output, "# ticks_per_second = %lld\n", (long long)header.ticksPerSecond);
+
+    // Metadata lines become comments
+    size_t start = 0;
+    while (start < metadata.size())
+    {
+        size_t end = metadata.find('\n', start);
+        if (end == std::string::npos)
+            end = metadata.size();
+        if (end > start)
+            fprintf(output, "# %.*s\n", (int)(end - start), metadata.c_str() + start);
+        start = end + 1;
+    }
+
+    for (int c = 0; c < FLM_NUM_SAMPLE_COLUMNS; c++)
+        fprintf(output, "%s%s", g_sampleColumns[c].name, (c == FLM_NUM_SAMPLE_COLUMNS - 1) ? "\n" : ",");
+
+    FLM_SAMPLE_RECORD* records = new (std::nothrow) FLM_SAMPLE_RECORD[FLM_CONVERT_CHUNK];
+    if (records == NULL)
+        return FLM_STATUS::MEMORY_ALLOCATION_ERROR;
+
+    size_t numRead;
+    while ((numRead = fread(records, sizeof(FLM_SAMPLE_RECORD), FLM_CONVERT_CHUNK, input)) > 0)
+    {
+        for (size_t i = 0; i < numRead; i++)
+        {
+            const FLM_SAMPLE_RECORD& r = records[i];
+            fprintf(output,
+                    "%lld,%lld,%lld,%d,%d,%.3f,%u\n",
+                    (long long)r.injectTime,
+                    (long long)r.presentTime,
+                    (long long)r.frameIdx,
+                    r.sad,
+                    r.thresholdedSAD,
+                    r.latencyMS,
+                    r.flags);
+        }
+    }
+
+    delete[] records;
+    return ferror(output) ? FLM_STATUS::FAILED : FLM_STATUS::OK;
+}
+
+static FLM_STATUS ConvertSampleLogToColumnar(FILE* input, FILE* output, const FLM_SAMPLE_LOG_HEADER& header, const std::string& metadata)
+{
+    // Count the records, a truncated last record is ignored. Logs of long sessions exceed 2 GB, the offsets are 64 bit.
+    int64_t dataStart = _ftelli64(input);
+    _fseeki64(input, 0, SEEK_END);
+    uint64_t numRows = (uint64_t)(_ftelli64(input) - dataStart) / sizeof(FLM_SAMPLE_RECORD);
+
+    FLM_COLUMNAR_HEADER columnarHeader = {};
+    memcpy(columnarHeader.magic, FLM_SAMPLE_COLUMNAR_MAGIC, sizeof(columnarHeader.magic));
+    columnarHeader.version        = FLM_SAMPLE_LOG_VERSION;
+    columnarHeader.numColumns     = FLM_NUM_SAMPLE_COLUMNS;
+    columnarHeader.metadataSize   = (uint32_t)metadata.size();
+    columnarHeader.numRows        = numRows;
+    columnarHeader.ticksPerSecond = header.ticksPerSecond;
+    bool bWritten = (fwrite(&columnarHeader, sizeof(columnarHeader), 1, output) == 1) &&
+                    (fwrite(metadata.data(), 1, metadata.size(), output) == metadata.size());
+
+    // The size of every column is known, so each one is written at its place in the output and the input is read once
+    int64_t columnStart[FLM_NUM_SAMPLE_COLUMNS];
+    int64_t offset = (int64_t)(sizeof(columnarHeader) + metadata.size());
+    for (int c = 0; c < FLM_NUM_SAMPLE_COLUMNS; c++)
+    {
+        const FLM_SAMPLE_COLUMN&   column       = g_sampleColumns[c];
+        FLM_COLUMNAR_COLUMN_HEADER columnHeader = {};
+        strncpy(columnHeader.name, column.name, sizeof(columnHeader.name) - 1);
+        columnHeader.type      = column.type;
+        columnHeader.valueSize = column.size;
+        _fseeki64(output, offset, SEEK_SET);
+        bWritten       = bWritten && (fwrite(&columnHeader, sizeof(columnHeader), 1, output) == 1);
+        columnStart[c] = offset + sizeof(columnHeader);
+        offset         = columnStart[c] + (int64_t)(numRows * column.size);
+    }
+
+    FLM_SAMPLE_RECORD* records = new (std::nothrow) FLM_SAMPLE_RECORD[FLM_CONVERT_CHUNK];
+    uint8_t*           values  = new (std::nothrow) uint8_t[FLM_CONVERT_CHUNK * sizeof(int64_t)];
+    if ((records == NULL) || (values == NULL))
+    {
+        delete[] records;
+        delete[] values;
+        return FLM_STATUS::MEMORY_ALLOCATION_ERROR;
+    }
+
+    // A chunk of records is split into its columns, memory use is constant for any log size
+    _fseeki64(input, dataStart, SEEK_SET);
+    uint64_t row = 0;
+    while (bWritten && (row < numRows))
+    {
+        size_t numRead = fread(records, sizeof(FLM_SAMPLE_RECORD), (size_t)std::min<uint64_t>(numRows - row, FLM_CONVERT_CHUNK), input);
+        if (numRead == 0)
+            break;
+
+        for (int c = 0; c < FLM_NUM_SAMPLE_COLUMNS; c++)
+        {
+            const FLM_SAMPLE_COLUMN& column = g_sampleColumns[c];
+            for (size_t i = 0; i < numRead; i++)
+                memcpy(values + i * column.size, (const uint8_t*)&records[i] + column.offset, column.size);
+
+            _fseeki64(output, columnStart[c] + (int64_t)(row * column.size), SEEK_SET);
+            bWritten = bWritten && (fwrite(values, column.size, numRead, output) == numRead);
+        }
+        row += numRead;
+    }
+
+    delete[] records;
+    delete[] values;
+    return (bWritten && (row == numRows)) ? FLM_STATUS::OK : FLM_STATUS::FAILED;
+}
+
+FLM_STATUS FlmConvertSampleLog(const char* inputFile, const char* outputFile)
+{
+    FILE* input = fopen(inputFile, "rb");
+    if (input == NULL)
+    {
+        FlmPrintError("Unable to open sample log %s", inputFile);
+        return FLM_STATUS::FAILED;
+    }
+
+    FLM_SAMPLE_LOG_HEADER header = {};
+    if ((fread(&header, sizeof(header), 1, input) != 1) || (memcmp(header.magic, FLM_SAMPLE_LOG_MAGIC, sizeof(header.magic)) != 0) ||
+        (header.version < 1) || (header.version > FLM_SAMPLE_LOG_VERSION) || (header.recordSize != sizeof(FLM_SAMPLE_RECORD)) ||
+        (header.metadataSize > FLM_SAMPLE_MAX_METADATA))
+    {
+        FlmPrintError("%s is not a supported sample log file", inputFile);
+        fclose(input);
+        return FLM_STATUS::FAILED;
+    }
+
+    // Version 1 wrote 0 to metadataSize
+    std::string metadata(header.metadataSize, '\0');
+    if ((header.metadataSize > 0) && (fread(&metadata[0], 1, metadata.size(), input) != metadata.size()))
+    {
+        FlmPrintError("%s is truncated", inputFile);
+        fclose(input);
+        return FLM_STATUS::FAILED;
+    }
+
+    // Output format is set by the file extension, .csv or columnar for anything else
+    std::string extension = outputFile;
+    size_t      dot       = extension.find_last_of('.');
+    extension             = (dot == std::string::npos) ? "" : extension.substr(dot);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    bool bCSV = (extension.compare(".csv") == 0);
+
+    FILE* output = fopen(outputFile, bCSV ? "w" : "wb");
+    if (output == NULL)
+    {
+        FlmPrintError("Unable to create %s", outputFile);
+        fclose(input);
+        return FLM_STATUS::FAILED;
+    }
+
+    FLM_STATUS status = bCSV ? ConvertSampleLogToCSV(input, output, header, metadata) : ConvertSampleLogToColumnar(input, output, header, metadata);
+
+    // A full disk can fail the last write only when the file is closed
+    if ((fclose(output) != 0) && (status == FLM_STATUS::OK))
+        status = FLM_STATUS::FAILED;
+    fclose(input);
+
+    // No truncated output is left behind
+    if (status != FLM_STATUS::OK)
+    {
+        FlmPrintError("Unable to write %s", outputFile);
+        remove(outputFile);
+    }
+    return status;
+}
@@ -0,0 +1,54 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_sample_log.h
+/// @brief  Binary per frame sample log written on a separate thread
+//=============================================================================
+
+#ifndef FLM_SAMPLE_LOG_H
+#define FLM_SAMPLE_LOG_H
+
+#include <Windows.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+
+#include "flm.h"
+#include "flm_sample_log_format.h"
+#include "flm_thread.h"
+
+// Records are pushed by the Process() thread into a lock free single producer, single consumer ring.
+// A writer thread drains the ring and writes to disk in large blocks, so file I/O never stalls frame processing.
+// If the writer falls behind records are dropped and counted instead of blocking the producer.
+class FLM_Sample_Log
+{
+public:
+    ~FLM_Sample_Log();
+
+    bool     Open(const char* fileName, int64_t iiTicksPerSecond, const std::string& metadata);
+    void     Close();
+    bool     IsOpen() const { return m_file != NULL; }
+    void     Push(const FLM_SAMPLE_RECORD& record);
+    uint64_t GetDroppedCount() const { return m_droppedRecords.load(std::memory_order_relaxed); }
+
+private:
+    void WriterThreadFunction(const FLM_Stop_Token& stop);
+    void Drain();
+
+    static const int RING_SIZE         = 16384;  // Power of 2, about 8 minutes of samples at 30 fps
+    static const int BLOCK_SIZE_BYTES  = 65536;  // Size of a single file write
+    static const int WRITER_TIMEOUT_MS = 250;    // Writer drains the ring at this interval, Push() never signals it
+
+    FLM_SAMPLE_RECORD     m_ring[RING_SIZE];
+    std::atomic<uint64_t> m_writePos       = 0;
+    std::atomic<uint64_t> m_readPos        = 0;
+    std::atomic<uint64_t> m_droppedRecords = 0;
+
+    uint8_t m_block[BLOCK_SIZE_BYTES];
+    int     m_iBlockBytes = 0;
+
+    FILE*      m_file = NULL;
+    FLM_Thread m_thread;
+};
+
+#endif
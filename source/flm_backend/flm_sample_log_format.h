@@ -0,0 +1,51 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_sample_log_format.h
+/// @brief  File format of the binary per frame sample log
+//=============================================================================
+
+#ifndef FLM_SAMPLE_LOG_FORMAT_H
+#define FLM_SAMPLE_LOG_FORMAT_H
+
+// No platform headers, shared with the offline tools
+
+#include <stdint.h>
+
+#define FLM_SAMPLE_LOG_MAGIC       "FLMS"
+#define FLM_SAMPLE_LOG_VERSION     2  // Version 2 added the metadata text, version 1 files have metadataSize 0
+#define FLM_SAMPLE_COLUMNAR_MAGIC  "FLMC"
+#define FLM_SAMPLE_MAX_METADATA    (1 << 20)  // Larger metadata means the file is not a sample log
+
+enum FLM_SAMPLE_FLAGS
+{
+    FLM_SAMPLE_FLAG_MEASUREMENT  = 0x1,  // latencyMS is valid
+    FLM_SAMPLE_FLAG_MOTION       = 0x2,  // thresholdedSAD is above zero
+    FLM_SAMPLE_FLAG_REPEAT_FRAME = 0x4,  // Frame index did not change from the previous sample
+    FLM_SAMPLE_FLAG_MOUSE_CLICK  = 0x8,  // Sample was taken in mouse click mode
+};
+
+#pragma pack(push, 1)
+struct FLM_SAMPLE_LOG_HEADER
+{
+    char     magic[4];        // FLM_SAMPLE_LOG_MAGIC
+    uint32_t version;         // FLM_SAMPLE_LOG_VERSION
+    uint32_t recordSize;      // sizeof(FLM_SAMPLE_RECORD)
+    uint32_t metadataSize;    // Bytes of "key = value" lines following the header, not terminated
+    int64_t  ticksPerSecond;  // Time base of injectTime and presentTime
+};
+
+// One record per captured frame while measuring
+struct FLM_SAMPLE_RECORD
+{
+    int64_t  injectTime;      // Time the mouse event was sent, 0 if no event is pending
+    int64_t  presentTime;     // Present time stamp of the captured frame
+    int64_t  frameIdx;        // Captured frame index
+    int32_t  sad;             // Sum of absolute differences to the previous frame
+    int32_t  thresholdedSAD;  // SAD above the motion detection threshold
+    float    latencyMS;       // Measured latency, valid if FLM_SAMPLE_FLAG_MEASUREMENT is set
+    uint32_t flags;           // FLM_SAMPLE_FLAGS
+};
+#pragma pack(pop)
+
+#endif
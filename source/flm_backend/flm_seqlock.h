@@ -0,0 +1,84 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_seqlock.h
+/// @brief  Single writer, multiple reader sequence lock
+//=============================================================================
+
+#ifndef FLM_SEQLOCK_H
+#define FLM_SEQLOCK_H
+
+#include <atomic>
+#include <stdint.h>
+
+// Publishes a small trivially copyable value from one writer thread to any number of readers.
+// Readers never block the writer, they retry the copy if it overlapped with a write.
+template <typename T>
+class FLM_SeqLock
+{
+public:
+    void Store(const T& value)
+    {
+        uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);  // odd: write in progress
+        std::atomic_thread_fence(std::memory_order_release);
+        m_value = value;
+        m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    T Load() const
+    {
+        T        value;
+        uint32_t sequence0;
+        uint32_t sequence1;
+        do
+        {
+            sequence0 = m_sequence.load(std::memory_order_acquire);
+            value     = m_value;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            sequence1 = m_sequence.load(std::memory_order_relaxed);
+        } while ((sequence0 & 1) || (sequence0 != sequence1));
+
+        return value;
+    }
+
+    // Gives up after maxAttempts copies overlapped with a write, for readers in other processes
+    // that must not spin forever if the writer stopped in the middle of a Store()
+    bool TryLoad(T& value, int maxAttempts) const
+    {
+        for (int i = 0; i < maxAttempts; i++)
+        {
+            uint32_t sequence0 = m_sequence.load(std::memory_order_acquire);
+            value              = m_value;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint32_t sequence1 = m_sequence.load(std::memory_order_relaxed);
+            if (((sequence0 & 1) == 0) && (sequence0 == sequence1))
+                return true;
+        }
+
+        return false;
+    }
+
+    // Stores value for a writer that takes over from one that may have stopped in the middle of a Store(),
+    // which left the sequence odd and the value torn
+    void Restart(const T& value)
+    {
+        uint32_t sequence = m_sequence.load(std::memory_order_relaxed) | 1;
+        m_sequence.store(sequence, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_value = value;
+        m_sequence.store(sequence + 1, std::memory_order_release);
+    }
+
+    // Even values only, changes every time a new value is stored
+    uint32_t GetSequence() const
+    {
+        return m_sequence.load(std::memory_order_acquire) & ~1u;
+    }
+
+private:
+    std::atomic<uint32_t> m_sequence = 0;
+    T                     m_value    = {};
+};
+
+#endif
@@ -0,0 +1,38 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_session_metadata.cpp
+/// @brief  Key value description of a measurement session written at the start of every output
+//=============================================================================
+
+#include "flm_session_metadata.h"
+#include "flm_utils.h"
+
+void FLM_Session_Metadata::Add(const char* key, int value)
+{
+    m_entries.emplace_back(key, FlmFormatStr("%d", value));
+}
+
+void FLM_Session_Metadata::Add(const char* key, int64_t value)
+{
+    m_entries.emplace_back(key, FlmFormatStr("%lld", (long long)value));
+}
+
+void FLM_Session_Metadata::Add(const char* key, double value)
+{
+    m_entries.emplace_back(key, FlmFormatStr("%g", value));
+}
+
+void FLM_Session_Metadata::WriteComments(FILE* file) const
+{
+    for (const std::pair<std::string, std::string>& entry : m_entries)
+        fprintf(file, "# %s = %s\n", entry.first.c_str(), entry.second.c_str());
+}
+
+std::string FLM_Session_Metadata::ToText() const
+{
+    std::string text;
+    for (const std::pair<std::string, std::string>& entry : m_entries)
+        text += entry.first + " = " + entry.second + "\n";
+    return text;
+}
@@ -0,0 +1,42 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_session_metadata.h
+/// @brief  Key value description of a measurement session written at the start of every output
+//=============================================================================
+
+#ifndef FLM_SESSION_METADATA_H
+#define FLM_SESSION_METADATA_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Entries keep the order they were added in. Keys of settings use the flm.ini key names,
+// prefixed with the ini section, so a run can be reproduced from its output file.
+class FLM_Session_Metadata
+{
+public:
+    void Clear() { m_entries.clear(); }
+    void Add(const char* key, const std::string& value) { m_entries.emplace_back(key, value); }
+    void Add(const char* key, const char* value) { m_entries.emplace_back(key, value); }
+    void Add(const char* key, bool value) { m_entries.emplace_back(key, value ? "true" : "false"); }
+    void Add(const char* key, int value);
+    void Add(const char* key, int64_t value);
+    void Add(const char* key, double value);
+
+    const std::vector<std::pair<std::string, std::string>>& Entries() const { return m_entries; }
+
+    // "# key = value" lines, the comment form read back by flm_analyze
+    void WriteComments(FILE* file) const;
+
+    // "key = value" lines
+    std::string ToText() const;
+
+private:
+    std::vector<std::pair<std::string, std::string>> m_entries;
+};
+
+#endif
@@ -0,0 +1,105 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_shared_telemetry.cpp
+/// @brief  Live telemetry published in named shared memory for overlays and test harnesses
+//=============================================================================
+
+#include "flm_shared_telemetry.h"
+#include "flm_utils.h"
+
+#include <atomic>
+
+// True while the process that published into an existing block is still running
+static bool IsWriterRunning(uint32_t processId)
+{
+    if ((processId == 0) || (processId == GetCurrentProcessId()))
+        return false;
+
+    HANDLE hProcess = OpenProcess(SYNCHRONIZE, FALSE, processId);
+    if (hProcess == NULL)
+        return false;
+
+    bool bRunning = (WaitForSingleObject(hProcess, 0) == WAIT_TIMEOUT);
+    CloseHandle(hProcess);
+    return bRunning;
+}
+
+FLM_Shared_Telemetry::~FLM_Shared_Telemetry()
+{
+    Close();
+}
+
+bool FLM_Shared_Telemetry::Open(const char* pName)
+{
+    if (m_block != NULL)
+        return true;
+
+    m_hMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(FLM_SHARED_TELEMETRY_BLOCK), pName);
+    if (m_hMapping == NULL)
+    {
+        FlmPrint("Warning: Unable to create shared telemetry %s\n", pName);
+        return false;
+    }
+
+    bool bExisting = (GetLastError() == ERROR_ALREADY_EXISTS);
+
+    FLM_SHARED_TELEMETRY_BLOCK* block = (FLM_SHARED_TELEMETRY_BLOCK*)MapViewOfFile(m_hMapping, FILE_MAP_WRITE, 0, 0, sizeof(FLM_SHARED_TELEMETRY_BLOCK));
+    if (block == NULL)
+    {
+        CloseHandle(m_hMapping);
+        m_hMapping = NULL;
+        return false;
+    }
+
+    // A reader still holds the block of a previous FLM run. It is taken over when it has the same layout and its writer
+    // has exited, two writers would break the sequence lock.
+    if (bExisting && (block->magic == FLM_SHARED_TELEMETRY_MAGIC))
+    {
+        const char* reason = NULL;
+        if ((block->version != FLM_SHARED_TELEMETRY_VERSION) || (block->size != sizeof(FLM_SHARED_TELEMETRY_BLOCK)))
+            reason = "has another version";
+        else
+        if (IsWriterRunning(block->processId))
+            reason = "is in use by another FLM instance";
+
+        if (reason != NULL)
+        {
+            FlmPrint("Warning: Shared telemetry %s %s\n", pName, reason);
+            UnmapViewOfFile(block);
+            CloseHandle(m_hMapping);
+            m_hMapping = NULL;
+            return false;
+        }
+
+        block->processId = GetCurrentProcessId();
+        block->telemetry.Restart(FLM_SHARED_TELEMETRY());
+        m_block = block;
+        return true;
+    }
+
+    // A new mapping is zero filled, which is a valid empty sequence lock
+    block->version   = FLM_SHARED_TELEMETRY_VERSION;
+    block->size      = sizeof(FLM_SHARED_TELEMETRY_BLOCK);
+    block->processId = GetCurrentProcessId();
+    std::atomic_thread_fence(std::memory_order_release);
+    block->magic = FLM_SHARED_TELEMETRY_MAGIC;
+
+    m_block = block;
+    return true;
+}
+
+void FLM_Shared_Telemetry::Close()
+{
+    if (m_block != NULL)
+    {
+        m_block->processId = 0;  // No writer, a restarted FLM takes the block over
+        UnmapViewOfFile(m_block);
+        m_block = NULL;
+    }
+    if (m_hMapping != NULL)
+    {
+        CloseHandle(m_hMapping);
+        m_hMapping = NULL;
+    }
+}
@@ -0,0 +1,136 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_shared_telemetry.h
+/// @brief  Live telemetry published in named shared memory for overlays and test harnesses
+//=============================================================================
+
+#ifndef FLM_SHARED_TELEMETRY_H
+#define FLM_SHARED_TELEMETRY_H
+
+#include <Windows.h>
+#include <stdint.h>
+
+#include "flm_seqlock.h"
+
+// This header and flm_seqlock.h are all an external reader needs, FLM_Shared_Telemetry_Reader is header only.
+
+#define FLM_SHARED_TELEMETRY_NAME         "Local\\FLM_Telemetry"
+#define FLM_SHARED_TELEMETRY_MAGIC        0x544D4C46  // "FLMT"
+#define FLM_SHARED_TELEMETRY_VERSION      2
+#define FLM_SHARED_TELEMETRY_MAX_ROW_SIZE 32  // Matches the MeasurementsPerLine limit
+
+// Fixed size copy of FLM_TELEMETRY_DATA plus the per frame detection state.
+// Only fixed width types, so readers built with other compilers see the same layout.
+struct FLM_SHARED_TELEMETRY
+{
+    int32_t measuring;  // 1 while latency measurements are running
+
+    // FLM_TELEMETRY_DATA
+    float   fps;
+    float   fpsOdd;
+    float   fpsEven;
+    float   accLatency;
+    float   accFrames;
+    float   accFps;
+    float   rowLatency;
+    float   rowFrames;
+    int32_t rowSize;                                          // Valid entries in rowMeasurementMS
+    float   rowMeasurementMS[FLM_SHARED_TELEMETRY_MAX_ROW_SIZE];  // Latencies [ms] of the current row
+
+    float   latestLatency;    // Last measured latency [ms]
+    int32_t numMeasurements;  // Measurements since measuring started
+
+    // Detection state of the last captured frame
+    int64_t frameIdx;
+    int64_t frameTimeStamp;  // 10 MHz ticks
+    int32_t sad;
+    int32_t thresholdedSAD;  // Non zero when motion was detected
+    float   backgroundSAD;
+    float   threshold;       // SAD threshold applied to the next frame
+    float   falseTriggerRate;  // Estimated probability that a frame without input motion triggers
+};
+
+struct FLM_SHARED_TELEMETRY_BLOCK
+{
+    uint32_t                          magic;      // Written last, readers wait for it
+    uint32_t                          version;
+    uint32_t                          size;       // sizeof(FLM_SHARED_TELEMETRY_BLOCK)
+    uint32_t                          processId;  // Writer process, 0 after it closed the block
+    FLM_SeqLock<FLM_SHARED_TELEMETRY> telemetry;
+};
+
+// Owned by the pipeline, single writer
+class FLM_Shared_Telemetry
+{
+public:
+    ~FLM_Shared_Telemetry();
+
+    // pName is only set by tests, readers look for FLM_SHARED_TELEMETRY_NAME
+    bool Open(const char* pName = FLM_SHARED_TELEMETRY_NAME);
+    void Close();
+    bool IsOpen() const { return m_block != NULL; }
+    void Publish(const FLM_SHARED_TELEMETRY& telemetry) { m_block->telemetry.Store(telemetry); }
+
+private:
+    HANDLE                      m_hMapping = NULL;
+    FLM_SHARED_TELEMETRY_BLOCK* m_block    = NULL;
+};
+
+// Maps the block read only. Reads never block FLM, a read that keeps overlapping with writes fails instead.
+class FLM_Shared_Telemetry_Reader
+{
+public:
+    ~FLM_Shared_Telemetry_Reader() { Close(); }
+
+    // Fails while FLM is not running, call again later
+    bool Open(const char* pName = FLM_SHARED_TELEMETRY_NAME)
+    {
+        if (m_block != NULL)
+            return true;
+
+        m_hMapping = OpenFileMappingA(FILE_MAP_READ, FALSE, pName);
+        if (m_hMapping == NULL)
+            return false;
+
+        m_block = (const FLM_SHARED_TELEMETRY_BLOCK*)MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, sizeof(FLM_SHARED_TELEMETRY_BLOCK));
+        if ((m_block == NULL) || (m_block->magic != FLM_SHARED_TELEMETRY_MAGIC) || (m_block->version != FLM_SHARED_TELEMETRY_VERSION) ||
+            (m_block->size != sizeof(FLM_SHARED_TELEMETRY_BLOCK)))
+        {
+            Close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void Close()
+    {
+        if (m_block != NULL)
+        {
+            UnmapViewOfFile(m_block);
+            m_block = NULL;
+        }
+        if (m_hMapping != NULL)
+        {
+            CloseHandle(m_hMapping);
+            m_hMapping = NULL;
+        }
+    }
+
+    bool IsOpen() const { return m_block != NULL; }
+
+    // Changes every time FLM publishes, poll this to skip copies of unchanged data
+    uint32_t GetSequence() const { return (m_block != NULL) ? m_block->telemetry.GetSequence() : 0; }
+
+    bool Read(FLM_SHARED_TELEMETRY& telemetry, int maxAttempts = 64) const
+    {
+        return (m_block != NULL) && m_block->telemetry.TryLoad(telemetry, maxAttempts);
+    }
+
+private:
+    HANDLE                            m_hMapping = NULL;
+    const FLM_SHARED_TELEMETRY_BLOCK* m_block    = NULL;
+};
+
+#endif
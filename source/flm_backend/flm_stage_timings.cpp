@@ -0,0 +1,110 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_stage_timings.cpp
+/// @brief  Histograms of the time spent in each stage of FLM's own processing
+//=============================================================================
+
+#include "flm_stage_timings.h"
+
+#include <intrin.h>
+#include <algorithm>
+
+static const char* g_flmStageNames[(int)FLM_STAGE::COUNT] =
+    {"acquire wait", "gpu copy", "map", "host copy", "sad", "threshold", "print/csv", "mouse wakeup"};
+
+void FLM_Stage_Timings::Init(int64_t iiTicksPerSecond)
+{
+    m_fTicksPerUS = std::max<double>(1.0, (double)iiTicksPerSecond / 1000000.0);
+    Reset();
+}
+
+void FLM_Stage_Timings::Reset()
+{
+    for (int s = 0; s < (int)FLM_STAGE::COUNT; s++)
+    {
+        for (int b = 0; b < FLM_STAGE_NUM_BUCKETS; b++)
+            m_buckets[s][b].store(0, std::memory_order_relaxed);
+        m_iiMax[s].store(0, std::memory_order_relaxed);
+    }
+}
+
+// Values below FLM_STAGE_SUB_BUCKETS have a bucket each, above that every power of 2
+// is split into FLM_STAGE_SUB_BUCKETS buckets by the bits following the highest set bit.
+int FLM_Stage_Timings::GetBucket(uint64_t value)
+{
+    if (value < FLM_STAGE_SUB_BUCKETS)
+        return (int)value;
+
+    unsigned long msb;
+    _BitScanReverse64(&msb, value);
+    int sub = (int)((value >> (msb - 3)) & (FLM_STAGE_SUB_BUCKETS - 1));
+    return ((int)msb - 2) * FLM_STAGE_SUB_BUCKETS + sub;
+}
+
+int64_t FLM_Stage_Timings::GetBucketStart(int bucket)
+{
+    if (bucket < FLM_STAGE_SUB_BUCKETS)
+        return bucket;
+
+    int msb = bucket / FLM_STAGE_SUB_BUCKETS + 2;
+    int sub = bucket % FLM_STAGE_SUB_BUCKETS;
+    return (int64_t)(FLM_STAGE_SUB_BUCKETS + sub) << (msb - 3);
+}
+
+void FLM_Stage_Timings::Add(FLM_STAGE stage, int64_t iiTicks)
+{
+    if (iiTicks < 0)
+        return;
+
+    m_buckets[(int)stage][GetBucket((uint64_t)iiTicks)].fetch_add(1, std::memory_order_relaxed);
+
+    std::atomic<int64_t>& max      = m_iiMax[(int)stage];
+    int64_t               previous = max.load(std::memory_order_relaxed);
+    while ((iiTicks > previous) && !max.compare_exchange_weak(previous, iiTicks, std::memory_order_relaxed))
+        ;
+}
+
+uint64_t FLM_Stage_Timings::GetCount(FLM_STAGE stage) const
+{
+    uint64_t count = 0;
+    for (int b = 0; b < FLM_STAGE_NUM_BUCKETS; b++)
+        count += m_buckets[(int)stage][b].load(std::memory_order_relaxed);
+    return count;
+}
+
+// Interpolated within the bucket, so the error is below the bucket width
+double FLM_Stage_Timings::GetPercentileUS(FLM_STAGE stage, double percentile) const
+{
+    uint64_t count = GetCount(stage);
+    if (count == 0)
+        return 0.0;
+
+    double   rank       = percentile / 100.0 * (double)count;
+    uint64_t cumulative = 0;
+    for (int b = 0; b < FLM_STAGE_NUM_BUCKETS; b++)
+    {
+        uint32_t bucketCount = m_buckets[(int)stage][b].load(std::memory_order_relaxed);
+        if ((bucketCount > 0) && ((double)(cumulative + bucketCount) >= rank))
+        {
+            double start    = (double)GetBucketStart(b);
+            double end      = (double)GetBucketStart(b + 1);
+            double fraction = std::clamp((rank - (double)cumulative) / (double)bucketCount, 0.0, 1.0);
+            double ticks    = std::min(start + fraction * (end - start), (double)m_iiMax[(int)stage].load(std::memory_order_relaxed));
+            return ticks / m_fTicksPerUS;
+        }
+        cumulative += bucketCount;
+    }
+
+    return GetMaxUS(stage);
+}
+
+double FLM_Stage_Timings::GetMaxUS(FLM_STAGE stage) const
+{
+    return (double)m_iiMax[(int)stage].load(std::memory_order_relaxed) / m_fTicksPerUS;
+}
+
+const char* FLM_Stage_Timings::GetName(FLM_STAGE stage)
+{
+    return g_flmStageNames[(int)stage];
+}
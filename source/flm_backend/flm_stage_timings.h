@@ -0,0 +1,85 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_stage_timings.h
+/// @brief  Histograms of the time spent in each stage of FLM's own processing
+//=============================================================================
+
+#ifndef FLM_STAGE_TIMINGS_H
+#define FLM_STAGE_TIMINGS_H
+
+#include <Windows.h>
+#include <stdint.h>
+#include <atomic>
+
+enum class FLM_STAGE
+{
+    ACQUIRE_WAIT = 0,  // Waiting for the next captured frame
+    GPU_COPY     = 1,  // Copy or convert of the capture region on the GPU
+    MAP          = 2,  // Mapping the GPU copy for CPU access, DXGI only
+    HOST_COPY    = 3,  // Copy of the capture region to host memory
+    SAD          = 4,
+    THRESHOLD    = 5,
+    OUTPUT       = 6,  // Console print and CSV output of a measurement
+    MOUSE_WAKEUP = 7,  // From SetEvent(m_eventMovementDetected) until the mouse thread runs
+    COUNT
+};
+
+#define FLM_STAGE_SUB_BUCKETS 8                             // Buckets per power of 2, about 12% resolution
+#define FLM_STAGE_NUM_BUCKETS (FLM_STAGE_SUB_BUCKETS * 62)  // Covers all positive int64_t durations
+
+// Log bucketed histograms of stage durations in QueryPerformanceCounter ticks.
+// Add() can be called from any thread without locks, it is a relaxed atomic increment.
+class FLM_Stage_Timings
+{
+public:
+    void Init(int64_t iiTicksPerSecond);
+    void Reset();
+    void Add(FLM_STAGE stage, int64_t iiTicks);
+
+    uint64_t           GetCount(FLM_STAGE stage) const;
+    double             GetPercentileUS(FLM_STAGE stage, double percentile) const;
+    double             GetMaxUS(FLM_STAGE stage) const;
+    static const char* GetName(FLM_STAGE stage);
+
+private:
+    static int     GetBucket(uint64_t value);
+    static int64_t GetBucketStart(int bucket);
+
+    double                m_fTicksPerUS = 10.0;
+    std::atomic<uint32_t> m_buckets[(int)FLM_STAGE::COUNT][FLM_STAGE_NUM_BUCKETS] = {};
+    std::atomic<int64_t>  m_iiMax[(int)FLM_STAGE::COUNT]                          = {};
+};
+
+// Adds the time from construction to Stop() or destruction to a stage, does nothing if pTimings is NULL
+class FLM_Stage_Timer
+{
+public:
+    FLM_Stage_Timer(FLM_Stage_Timings* pTimings, FLM_STAGE stage)
+        : m_pTimings(pTimings)
+        , m_stage(stage)
+    {
+        if (m_pTimings != NULL)
+            QueryPerformanceCounter(&m_start);
+    }
+
+    ~FLM_Stage_Timer() { Stop(); }
+
+    void Stop()
+    {
+        if (m_pTimings != NULL)
+        {
+            LARGE_INTEGER now;
+            QueryPerformanceCounter(&now);
+            m_pTimings->Add(m_stage, now.QuadPart - m_start.QuadPart);
+            m_pTimings = NULL;
+        }
+    }
+
+private:
+    FLM_Stage_Timings* m_pTimings;
+    FLM_STAGE          m_stage;
+    LARGE_INTEGER      m_start = {};
+};
+
+#endif
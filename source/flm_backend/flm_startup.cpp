@@ -0,0 +1,140 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_startup.cpp
+/// @brief  Startup tasks run concurrently in the order of their dependencies
+//=============================================================================
+
+#include "flm_startup.h"
+#include "flm_thread.h"
+#include "flm_trace.h"
+
+#include <algorithm>
+
+int FLM_Startup_Graph::Add(const char* name, std::function<FLM_STATUS()> task, std::initializer_list<int> dependencies)
+{
+    return Add(name, std::move(task), std::vector<int>(dependencies));
+}
+
+int FLM_Startup_Graph::Add(const char* name, std::function<FLM_STATUS()> task, const std::vector<int>& dependencies)
+{
+    int id = (int)m_tasks.size();
+
+    TASK newTask;
+    newTask.function    = std::move(task);
+    newTask.timing.name = name;
+    for (int dependency : dependencies)
+    {
+        // Only earlier tasks, so the graph can not have cycles
+        if ((dependency >= 0) && (dependency < id))
+            newTask.dependencies.push_back(dependency);
+    }
+
+    m_tasks.push_back(std::move(newTask));
+    return id;
+}
+
+int FLM_Startup_Graph::NextReadyTask()
+{
+    // Dependencies are earlier tasks, so one pass also skips the tasks of a chain that failed
+    for (int id = 0; id < (int)m_tasks.size(); id++)
+    {
+        TASK& task = m_tasks[id];
+        if (task.state != TASK_STATE::WAITING)
+            continue;
+
+        bool       bReady = true;
+        FLM_STATUS failed = FLM_STATUS::OK;
+        for (int dependency : task.dependencies)
+        {
+            const TASK& other = m_tasks[dependency];
+            if (other.state != TASK_STATE::DONE)
+                bReady = false;
+            else
+            if (other.timing.status != FLM_STATUS::OK)
+                failed = other.timing.status;
+        }
+
+        if (failed != FLM_STATUS::OK)
+        {
+            task.state           = TASK_STATE::DONE;
+            task.timing.status   = failed;
+            task.timing.bSkipped = true;
+            m_iRemaining--;
+            m_taskDone.notify_all();
+            continue;
+        }
+
+        if (bReady)
+            return id;
+    }
+    return -1;
+}
+
+void FLM_Startup_Graph::WorkerFunction()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_iRemaining > 0)
+    {
+        int id = NextReadyTask();
+        if (id < 0)
+        {
+            if (m_iRemaining > 0)
+                m_taskDone.wait(lock);
+            continue;
+        }
+
+        TASK& task = m_tasks[id];
+        task.state = TASK_STATE::RUNNING;
+        lock.unlock();
+
+        LARGE_INTEGER start, end;
+        FLM_STATUS    status;
+        {
+            FLM_TRACE_SCOPE(task.timing.name);
+            QueryPerformanceCounter(&start);
+            status = task.function();
+            QueryPerformanceCounter(&end);
+        }
+
+        lock.lock();
+        task.timing.iiStart = start.QuadPart;
+        task.timing.iiEnd   = end.QuadPart;
+        task.timing.status  = status;
+        task.state          = TASK_STATE::DONE;
+        m_iRemaining--;
+        m_taskDone.notify_all();
+    }
+}
+
+FLM_STATUS FLM_Startup_Graph::Run()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_iRemaining = (int)m_tasks.size();
+    }
+
+    // Fewer workers only make the startup slower, the calling thread runs every task if none can be created
+    FLM_Thread workers[FLM_STARTUP_THREADS];
+    int        iWorkerCount = std::min<int>(FLM_STARTUP_THREADS, (int)m_tasks.size() - 1);
+    for (int i = 0; i < iWorkerCount; i++)
+    {
+        workers[i].Start([this](const FLM_Stop_Token&) {
+            if (FlmTraceEnabled())
+                FlmTraceSetThreadName("Startup");
+            WorkerFunction();
+        });
+    }
+
+    WorkerFunction();
+
+    for (int i = 0; i < iWorkerCount; i++)
+        workers[i].Stop();
+
+    for (const TASK& task : m_tasks)
+    {
+        if (task.timing.status != FLM_STATUS::OK)
+            return task.timing.status;
+    }
+    return FLM_STATUS::OK;
+}
@@ -0,0 +1,75 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_startup.h
+/// @brief  Startup tasks run concurrently in the order of their dependencies
+//=============================================================================
+
+#ifndef FLM_STARTUP_H
+#define FLM_STARTUP_H
+
+#include <stdint.h>
+#include <condition_variable>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <vector>
+
+#include "flm.h"
+
+#define FLM_STARTUP_THREADS 4  // Besides the calling thread, the tasks mostly wait on drivers and devices
+
+struct FLM_STARTUP_TASK_TIMING
+{
+    const char* name     = NULL;
+    int64_t     iiStart  = 0;  // QueryPerformanceCounter, 0 when the task was skipped
+    int64_t     iiEnd    = 0;
+    FLM_STATUS  status   = FLM_STATUS::OK;
+    bool        bSkipped = false;  // A task it depends on failed
+};
+
+//
+// Startup of independent parts such as the capture device, the timer and the input threads as a dependency graph.
+// Run() starts each task as soon as the tasks it depends on succeeded, up to FLM_STARTUP_THREADS + 1 at a time with
+// the calling thread being one of them. A task whose dependency failed is skipped and gets the status of that task.
+// Each task is recorded as a trace scope on the thread that ran it. A graph is run once.
+//
+class FLM_Startup_Graph
+{
+public:
+    // name must be a string literal. dependencies are ids returned by earlier Add() calls, returns the id of the task.
+    int Add(const char* name, std::function<FLM_STATUS()> task, std::initializer_list<int> dependencies = {});
+    int Add(const char* name, std::function<FLM_STATUS()> task, const std::vector<int>& dependencies);
+
+    // Returns when all tasks are done or skipped, with the status of the first failed task in the order they were added
+    FLM_STATUS Run();
+
+    int                            GetCount() const { return (int)m_tasks.size(); }
+    const FLM_STARTUP_TASK_TIMING& GetTiming(int id) const { return m_tasks[id].timing; }
+
+private:
+    enum class TASK_STATE
+    {
+        WAITING,
+        RUNNING,
+        DONE,
+    };
+
+    struct TASK
+    {
+        std::function<FLM_STATUS()> function;
+        std::vector<int>            dependencies;
+        FLM_STARTUP_TASK_TIMING     timing;
+        TASK_STATE                  state = TASK_STATE::WAITING;
+    };
+
+    int  NextReadyTask();  // Called with m_mutex held, -1 when no task can start yet
+    void WorkerFunction();
+
+    std::vector<TASK>       m_tasks;
+    std::mutex              m_mutex;
+    std::condition_variable m_taskDone;
+    int                     m_iRemaining = 0;
+};
+
+#endif
@@ -0,0 +1,80 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_thread.cpp
+/// @brief  Joinable threads with a stop token that wakes blocked waits
+//=============================================================================
+
+#include "flm_thread.h"
+
+FLM_Stop_Token::FLM_Stop_Token()
+{
+    m_hStopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+}
+
+FLM_Stop_Token::~FLM_Stop_Token()
+{
+    if (m_hStopEvent != NULL)
+        CloseHandle(m_hStopEvent);
+}
+
+void FLM_Stop_Token::RequestStop()
+{
+    m_bStop.store(true, std::memory_order_release);
+    if (m_hStopEvent != NULL)
+        SetEvent(m_hStopEvent);
+}
+
+void FLM_Stop_Token::Reset()
+{
+    m_bStop.store(false, std::memory_order_release);
+    if (m_hStopEvent != NULL)
+        ResetEvent(m_hStopEvent);
+}
+
+bool FLM_Stop_Token::Wait(HANDLE hObject, DWORD timeoutMS) const
+{
+    if (StopRequested())
+        return false;
+
+    if (m_hStopEvent == NULL)
+        return WaitForSingleObject(hObject, timeoutMS) == WAIT_OBJECT_0;
+
+    // The object is first so that it wins when both are signaled
+    HANDLE handles[2] = {hObject, m_hStopEvent};
+    return WaitForMultipleObjects(2, handles, FALSE, timeoutMS) == WAIT_OBJECT_0;
+}
+
+bool FLM_Stop_Token::SleepFor(DWORD timeoutMS) const
+{
+    if (m_hStopEvent == NULL)
+    {
+        Sleep(timeoutMS);
+        return StopRequested() == false;
+    }
+    return WaitForSingleObject(m_hStopEvent, timeoutMS) == WAIT_TIMEOUT;
+}
+
+bool FLM_Thread::Start(std::function<void(const FLM_Stop_Token&)> function)
+{
+    if (m_thread.joinable())
+        return false;
+
+    m_stopToken.Reset();
+    try
+    {
+        m_thread = std::thread([this, function]() { function(m_stopToken); });
+    }
+    catch (...)
+    {
+        return false;
+    }
+    return true;
+}
+
+void FLM_Thread::Stop()
+{
+    m_stopToken.RequestStop();
+    if (m_thread.joinable())
+        m_thread.join();
+}
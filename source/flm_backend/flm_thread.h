@@ -0,0 +1,65 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_thread.h
+/// @brief  Joinable threads with a stop token that wakes blocked waits
+//=============================================================================
+
+#ifndef FLM_THREAD_H
+#define FLM_THREAD_H
+
+#include <Windows.h>
+#include <atomic>
+#include <functional>
+#include <thread>
+
+// Stop request of one thread. RequestStop() sets an event as well as the flag, so that a thread blocked
+// in Wait() or SleepFor() returns at once instead of at the end of its timeout.
+class FLM_Stop_Token
+{
+public:
+    FLM_Stop_Token();
+    ~FLM_Stop_Token();
+
+    bool   StopRequested() const { return m_bStop.load(std::memory_order_acquire); }
+    void   RequestStop();
+    void   Reset();
+    HANDLE GetEvent() const { return m_hStopEvent; }  // Manual reset, set while a stop is requested
+
+    // Waits for hObject, returns true if it was signaled and false on time out or stop
+    bool Wait(HANDLE hObject, DWORD timeoutMS) const;
+
+    // Returns false if the sleep was cut short by a stop
+    bool SleepFor(DWORD timeoutMS) const;
+
+private:
+    FLM_Stop_Token(const FLM_Stop_Token&)            = delete;
+    FLM_Stop_Token& operator=(const FLM_Stop_Token&) = delete;
+
+    std::atomic<bool> m_bStop      = false;
+    HANDLE            m_hStopEvent = NULL;
+};
+
+// std::thread owning its stop token. The thread function gets the token and returns when a stop is requested.
+class FLM_Thread
+{
+public:
+    ~FLM_Thread() { Stop(); }
+
+    bool Start(std::function<void(const FLM_Stop_Token&)> function);
+
+    // Requests the stop and joins, RequestStop() on several threads first lets them stop in parallel
+    void RequestStop() { m_stopToken.RequestStop(); }
+    void Stop();
+
+    bool                  IsRunning() const { return m_thread.joinable(); }
+    bool                  StopRequested() const { return m_stopToken.StopRequested(); }
+    const FLM_Stop_Token& GetStopToken() const { return m_stopToken; }
+    HANDLE                GetNativeHandle() { return m_thread.joinable() ? (HANDLE)m_thread.native_handle() : NULL; }
+
+private:
+    std::thread    m_thread;
+    FLM_Stop_Token m_stopToken;
+};
+
+#endif
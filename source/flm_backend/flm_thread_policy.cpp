@@ -0,0 +1,248 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_thread_policy.cpp
+/// @brief  CPU affinity and priority of the FLM threads
+//=============================================================================
+
+#include "flm_thread_policy.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+struct FLM_PRIORITY_NAME
+{
+    const char* name;
+    int         priority;
+};
+
+static const FLM_PRIORITY_NAME g_priorityNames[] = {
+    {"idle", THREAD_PRIORITY_IDLE},
+    {"lowest", THREAD_PRIORITY_LOWEST},
+    {"below_normal", THREAD_PRIORITY_BELOW_NORMAL},
+    {"normal", THREAD_PRIORITY_NORMAL},
+    {"above_normal", THREAD_PRIORITY_ABOVE_NORMAL},
+    {"highest", THREAD_PRIORITY_HIGHEST},
+    {"time_critical", THREAD_PRIORITY_TIME_CRITICAL},
+};
+
+// Layout of SystemProcessorPerformanceInformation, times in 100 ns units. KernelTime includes IdleTime.
+struct FLM_PROCESSOR_TIMES
+{
+    LARGE_INTEGER IdleTime;
+    LARGE_INTEGER KernelTime;
+    LARGE_INTEGER UserTime;
+    LARGE_INTEGER Reserved1[2];
+    ULONG         Reserved2;
+};
+
+typedef LONG(WINAPI* FLM_NT_QUERY_SYSTEM_INFORMATION)(int SystemInformationClass, PVOID SystemInformation, ULONG SystemInformationLength, PULONG ReturnLength);
+
+#define FLM_SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION  8
+
+struct FLM_PHYSICAL_CORE
+{
+    uint64_t mask;
+    int      efficiencyClass;
+    double   load;
+};
+
+const char* FlmGetThreadRoleName(FLM_THREAD_ROLE role)
+{
+    switch (role)
+    {
+    case FLM_THREAD_ROLE::PROCESS:
+        return "Process";
+    case FLM_THREAD_ROLE::CAPTURE:
+        return "Capture";
+    case FLM_THREAD_ROLE::MOUSE:
+        return "Mouse";
+    case FLM_THREAD_ROLE::KEYBOARD:
+        return "Keyboard";
+    default:
+        return "Unknown";
+    }
+}
+
+bool FlmParseThreadAffinity(const std::string& text, FLM_THREAD_POLICY& policy)
+{
+    std::string value = text;
+    std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+
+    policy.bAutoAffinity = false;
+    policy.affinityMask  = 0;
+
+    if (value.empty())
+        return true;
+
+    if (value == "auto")
+    {
+        policy.bAutoAffinity = true;
+        return true;
+    }
+
+    char*    end  = NULL;
+    uint64_t mask = strtoull(value.c_str(), &end, 0);  // Hex with 0x, else decimal
+    if ((end == value.c_str()) || (*end != 0) || (mask == 0))
+        return false;
+
+    policy.affinityMask = mask;
+    return true;
+}
+
+bool FlmParseThreadPriority(const std::string& text, FLM_THREAD_POLICY& policy)
+{
+    std::string value = text;
+    std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+
+    if (value.empty())
+    {
+        policy.priority = FLM_THREAD_PRIORITY_DEFAULT;
+        return true;
+    }
+
+    for (const FLM_PRIORITY_NAME& entry : g_priorityNames)
+    {
+        if (value == entry.name)
+        {
+            policy.priority = entry.priority;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string FlmThreadPolicyToString(const FLM_THREAD_POLICY& policy)
+{
+    std::string text;
+    char        mask[32];
+
+    if (policy.affinityMask != 0)
+    {
+        snprintf(mask, sizeof(mask), "0x%llx", (unsigned long long)policy.affinityMask);
+        text = mask;
+        if (policy.bAutoAffinity)
+            text += " (auto)";
+    }
+    else
+        text = policy.bAutoAffinity ? "auto" : "default";
+
+    text += ", ";
+    for (const FLM_PRIORITY_NAME& entry : g_priorityNames)
+    {
+        if (policy.priority == entry.priority)
+            return text + entry.name;
+    }
+    return text + "default";
+}
+
+static bool GetProcessorTimes(FLM_NT_QUERY_SYSTEM_INFORMATION pQuery, std::vector<FLM_PROCESSOR_TIMES>& times)
+{
+    ULONG returnLength = 0;
+    LONG  status = pQuery(FLM_SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION, times.data(), (ULONG)(times.size() * sizeof(FLM_PROCESSOR_TIMES)), &returnLength);
+    if (status < 0)
+        return false;
+    times.resize(returnLength / sizeof(FLM_PROCESSOR_TIMES));
+    return true;
+}
+
+uint64_t FlmGetLeastLoadedCores(int numCores, DWORD sampleMS)
+{
+    // Physical cores and their SMT siblings
+    DWORD length = 0;
+    GetLogicalProcessorInformationEx(RelationProcessorCore, NULL, &length);
+    if (length == 0)
+        return 0;
+
+    std::vector<uint8_t> buffer(length);
+    if (GetLogicalProcessorInformationEx(RelationProcessorCore, (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)buffer.data(), &length) == FALSE)
+        return 0;
+
+    std::vector<FLM_PHYSICAL_CORE> cores;
+    int                            maxEfficiencyClass = 0;
+    for (DWORD offset = 0; offset < length;)
+    {
+        PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX info = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)(buffer.data() + offset);
+        if ((info->Relationship == RelationProcessorCore) && (info->Processor.GroupMask[0].Group == 0))
+        {
+            FLM_PHYSICAL_CORE core = {(uint64_t)info->Processor.GroupMask[0].Mask, (int)info->Processor.EfficiencyClass, 0.0};
+            maxEfficiencyClass     = std::max(maxEfficiencyClass, core.efficiencyClass);
+            cores.push_back(core);
+        }
+        offset += info->Size;
+    }
+
+    // Efficiency cores would slow down the frame comparisons
+    cores.erase(std::remove_if(cores.begin(), cores.end(), [maxEfficiencyClass](const FLM_PHYSICAL_CORE& c) { return c.efficiencyClass < maxEfficiencyClass; }),
+                cores.end());
+    if (cores.empty())
+        return 0;
+
+    // Per logical processor load, ntdll is always loaded
+    FLM_NT_QUERY_SYSTEM_INFORMATION pQuery = (FLM_NT_QUERY_SYSTEM_INFORMATION)GetProcAddress(GetModuleHandleA("ntdll.dll"), "NtQuerySystemInformation");
+    if (pQuery != NULL)
+    {
+        std::vector<FLM_PROCESSOR_TIMES> times0(64);
+        std::vector<FLM_PROCESSOR_TIMES> times1(64);
+
+        if (GetProcessorTimes(pQuery, times0))
+        {
+            Sleep(sampleMS);
+            if (GetProcessorTimes(pQuery, times1))
+            {
+                size_t count = std::min(times0.size(), times1.size());
+                for (FLM_PHYSICAL_CORE& core : cores)
+                {
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        if ((core.mask & (1ull << i)) == 0)
+                            continue;
+
+                        double total = (double)(times1[i].KernelTime.QuadPart - times0[i].KernelTime.QuadPart) +
+                                       (double)(times1[i].UserTime.QuadPart - times0[i].UserTime.QuadPart);
+                        double idle  = (double)(times1[i].IdleTime.QuadPart - times0[i].IdleTime.QuadPart);
+                        if (total > 0.0)
+                            core.load += std::clamp(1.0 - idle / total, 0.0, 1.0);
+                    }
+                }
+            }
+        }
+    }
+
+    // Without load information this picks the last cores, the first core usually services most interrupts
+    std::stable_sort(cores.begin(), cores.end(), [](const FLM_PHYSICAL_CORE& a, const FLM_PHYSICAL_CORE& b) { return a.mask > b.mask; });
+    std::stable_sort(cores.begin(), cores.end(), [](const FLM_PHYSICAL_CORE& a, const FLM_PHYSICAL_CORE& b) { return a.load < b.load; });
+
+    uint64_t mask = 0;
+    for (int i = 0; (i < numCores) && (i < (int)cores.size()); i++)
+        mask |= cores[i].mask;
+
+    return mask;
+}
+
+bool FlmApplyThreadPolicy(HANDLE hThread, const FLM_THREAD_POLICY& policy)
+{
+    bool bResult = true;
+
+    if (policy.affinityMask != 0)
+    {
+        // Keep the mask within the processors of the process
+        DWORD_PTR processMask = 0;
+        DWORD_PTR systemMask  = 0;
+        GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask);
+
+        DWORD_PTR mask = (DWORD_PTR)policy.affinityMask & processMask;
+        if ((mask == 0) || (SetThreadAffinityMask(hThread, mask) == 0))
+            bResult = false;
+    }
+
+    if (policy.priority != FLM_THREAD_PRIORITY_DEFAULT)
+    {
+        if (SetThreadPriority(hThread, policy.priority) == FALSE)
+            bResult = false;
+    }
+
+    return bResult;
+}
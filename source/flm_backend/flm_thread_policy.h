@@ -0,0 +1,54 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_thread_policy.h
+/// @brief  CPU affinity and priority of the FLM threads
+//=============================================================================
+
+#ifndef FLM_THREAD_POLICY_H
+#define FLM_THREAD_POLICY_H
+
+#include <Windows.h>
+#include <stdint.h>
+#include <string>
+
+enum class FLM_THREAD_ROLE
+{
+    PROCESS,   // Thread calling FLM_Pipeline::Init() and Process()
+    CAPTURE,
+    MOUSE,
+    KEYBOARD,
+    COUNT
+};
+
+// Sentinel for a priority left at the OS default
+#define FLM_THREAD_PRIORITY_DEFAULT  0x7fffffff
+
+struct FLM_THREAD_POLICY
+{
+    bool     bAutoAffinity = false;                        // Use the cores picked by FlmGetLeastLoadedCores()
+    uint64_t affinityMask  = 0;                            // Logical processors of processor group 0, 0 keeps the OS default
+    int      priority      = FLM_THREAD_PRIORITY_DEFAULT;  // THREAD_PRIORITY_xxx
+};
+
+const char* FlmGetThreadRoleName(FLM_THREAD_ROLE role);
+
+// "" keeps the OS default, "auto" or a mask of logical processors such as "0x30". Returns false on bad text.
+bool FlmParseThreadAffinity(const std::string& text, FLM_THREAD_POLICY& policy);
+
+// "", "idle", "lowest", "below_normal", "normal", "above_normal", "highest" or "time_critical". Returns false on bad text.
+bool FlmParseThreadPriority(const std::string& text, FLM_THREAD_POLICY& policy);
+
+// Text for the session description and the console, the inverse of the two parsers
+std::string FlmThreadPolicyToString(const FLM_THREAD_POLICY& policy);
+
+// Logical processor mask of the numCores least loaded physical cores of processor group 0. The load of every
+// logical processor is sampled over sampleMS, the load of a core is the sum over its SMT siblings so that FLM does
+// not share a core with a busy game thread. On hybrid CPUs only the fastest cores are considered.
+// Returns 0 if the processor information is not available.
+uint64_t FlmGetLeastLoadedCores(int numCores, DWORD sampleMS);
+
+// Applies the policy to hThread, the affinity must already be resolved from bAutoAffinity
+bool FlmApplyThreadPolicy(HANDLE hThread, const FLM_THREAD_POLICY& policy);
+
+#endif
@@ -6,13 +6,15 @@
 //=============================================================================
 
 #include "flm_timer.h"
-#pragma comment(lib, "Winmm.lib")
 
 bool FLM_Timer_AMF::Init()
 {
     QueryPerformanceFrequency((LARGE_INTEGER*)&m_iiFreqCountPerSecond);
     m_iiCountPerOneMS = m_iiFreqCountPerSecond / 1000;
 
+    if (m_sleeper.Init() == false)
+        return false;
+
 #ifdef USE_AMF_TIMER
     m_pAMF_CurrentTimer = new amf::AMFCurrentTimeImpl();
     if (m_pAMF_CurrentTimer == NULL)
@@ -41,59 +43,53 @@ int64_t FLM_Timer_AMF::UpdateAmfTimeToPerformanceCounterOffset()
 
     m_iiAmfTimeToPerformanceCounterTimeOffset = iiNow - iiAmfNowInTicks;
 
-    // We need this because of the Sleep(1) used in PrecisionSleepUntilTimestamp().
-    // amf_increase_timer_precision();
-
     return m_iiAmfTimeToPerformanceCounterTimeOffset;
 }
 
 int64_t FLM_Timer_AMF::TranslateAmfTimeToPerformanceCounter(int64_t iiAmfTime)
 {
+    // Use the tracked model once the clock correlator has samples, it corrects for drift during long sessions
+    if (m_clockSync.GetModel().numPairs > 0)
+        return m_clockSync.TranslateToReference(iiAmfTime);
+
     int64_t iiAmfTimeInTicks = (iiAmfTime * m_iiFreqCountPerSecond + AMF_SECOND / 2) / AMF_SECOND;  //with rounding...
     int64_t iiTime           = iiAmfTimeInTicks + m_iiAmfTimeToPerformanceCounterTimeOffset;
     return iiTime;
 }
-#endif
 
-void FLM_Timer_AMF::PrecisionSleepUntilTimestamp(int64_t iiSleepEnd)
+int64_t FLM_Timer_AMF::ReadAmfTime(void* pContext)
+{
+    return ((FLM_Timer_AMF*)pContext)->now();
+}
+
+int64_t FLM_Timer_AMF::ReadPerformanceCounter(void* pContext)
 {
     int64_t iiNow;
     QueryPerformanceCounter((LARGE_INTEGER*)&iiNow);
+    return iiNow;
+}
+
+bool FLM_Timer_AMF::StartClockTracking()
+{
+    if (m_pAMF_CurrentTimer == NULL)
+        return false;
+
+    m_clockSync.Init(ReadPerformanceCounter, NULL, m_iiFreqCountPerSecond, ReadAmfTime, this, AMF_SECOND);
+    return m_clockSync.Start();
+}
 
-    while (iiNow < iiSleepEnd)
-    {
-        if ((iiSleepEnd - iiNow) > 17 * m_iiCountPerOneMS)  // More than 17 ms remaining? Sleep(1) (default resolution is about 16 ms)
-        {
-            Sleep(1);
-        }
-        else if ((iiSleepEnd - iiNow) >
-                 4 * m_iiCountPerOneMS)  // (3 should be enough) More than 4 ms remaining? Sleep(1) with higher precision context switching
-        {
-            timeBeginPeriod(1);
-            Sleep(1);
-            timeEndPeriod(1);
-        }
-        else if ((iiSleepEnd - iiNow) > m_iiCountPerOneMS / 5)  // More than 0.2ms (2000 ticks) remaining? Sleep(0)
-        {
-            Sleep(0);
-        }
-        else
-        {
-            //for (int i = 0; i < PROCESSOR_YIELD_CYCLES; i++)
-            //    YieldProcessor();
-            #define y YieldProcessor()
-            y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;
-            y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;
-            y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;y;
-            #undef y
-        }
-        if (iiNow < iiSleepEnd)
-            QueryPerformanceCounter((LARGE_INTEGER*)&iiNow);
-    }
+void FLM_Timer_AMF::StopClockTracking()
+{
+    m_clockSync.Stop();
 }
-//#pragma optimize("", on)
 
-void FLM_Timer_AMF::PrecisionSleepMS(float fTimeToSleepMS, int64_t iiSleepStart)
+FLM_CLOCK_MODEL FLM_Timer_AMF::GetClockModel()
+{
+    return m_clockSync.GetModel();
+}
+#endif
+
+void FLM_Timer_AMF::PrecisionSleepMS(float fTimeToSleepMS, int64_t iiSleepStart, HANDLE hAbortEvent)
 {
     // FlamePrint("PrecisionSleepMS %4.4f ms\n",fTimeToSleepMS);
 
@@ -107,11 +103,15 @@ void FLM_Timer_AMF::PrecisionSleepMS(float fTimeToSleepMS, int64_t iiSleepStart)
 
     // Sanity check
     if (iiSleepEnd >= iiNow)
-        PrecisionSleepUntilTimestamp(iiSleepEnd);
+        m_sleeper.SleepUntil(iiSleepEnd, hAbortEvent);
     //else
     //    printf("#"); // debug
 }
 
 void FLM_Timer_AMF::Close()
 {
+    m_sleeper.Close();
+#ifdef USE_AMF_TIMER
+    StopClockTracking();
+#endif
 }
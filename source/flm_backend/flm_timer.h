@@ -11,6 +11,8 @@
 #define USE_AMF_TIMER
 
 #include "flm.h"
+#include "flm_clock_sync.h"
+#include "flm_precision_sleeper.h"
 
 #ifdef USE_AMF_TIMER
 #pragma warning(push)
@@ -78,6 +80,12 @@ public:
         QueryPerformanceCounter(&m_start);
     }
 
+    // Start from an earlier QueryPerformanceCounter time stamp
+    void Start(LONGLONG iiStartTime)
+    {
+        m_start.QuadPart = iiStartTime;
+    }
+
     double Stop_ms()
     {
         LARGE_INTEGER diff_us;
@@ -124,17 +132,32 @@ public:
 
     int64_t UpdateAmfTimeToPerformanceCounterOffset();
     int64_t TranslateAmfTimeToPerformanceCounter(int64_t iiAmfTime);
+
+    // Continuous tracking of the AMF to performance counter offset and drift
+    bool            StartClockTracking();
+    void            StopClockTracking();
+    FLM_CLOCK_MODEL GetClockModel();
 #endif
 
-    void PrecisionSleepMS(float fTimeToSleepMS, int64_t iiSleepStart);
+    // Sleeps fTimeToSleepMS from iiSleepStart, or from now if iiSleepStart is 0. Returns early when hAbortEvent is set.
+    void PrecisionSleepMS(float fTimeToSleepMS, int64_t iiSleepStart, HANDLE hAbortEvent = NULL);
+
+    // Wake up error of PrecisionSleepMS()
+    FLM_SLEEP_STATS GetSleepStats() const { return m_sleeper.GetStats(); }
+    void            ResetSleepStats() { m_sleeper.ResetStats(); }
 
 private:
-    void PrecisionSleepUntilTimestamp(int64_t iiSleepEnd);
 
 #ifdef USE_AMF_TIMER
+    static int64_t ReadAmfTime(void* pContext);
+    static int64_t ReadPerformanceCounter(void* pContext);
+
     amf::AMFCurrentTimePtr m_pAMF_CurrentTimer;
+    FLM_Clock_Correlator   m_clockSync;  // Maps AMF time to performance counter ticks
 #endif
 
+    FLM_Precision_Sleeper m_sleeper;
+
     int64_t m_iiFreqCountPerSecond                    = 0;
     int64_t m_iiCountPerOneMS                         = 0;
     int64_t m_iiAmfTimeToPerformanceCounterTimeOffset = 0;
@@ -0,0 +1,229 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_trace.cpp
+/// @brief  Low overhead per thread trace events, exported as Chrome trace JSON
+//=============================================================================
+
+#include "flm_trace.h"
+#include "flm_utils.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <mutex>
+
+std::atomic<bool>              g_flmTraceEnabled = false;
+thread_local FLM_Trace_Buffer* t_flmTraceBuffer  = NULL;
+
+// Set before the thread has a buffer, copied into it when the thread traces its first event
+static thread_local char t_flmTraceThreadName[FLM_TRACE_NAME_SIZE] = {};
+
+// Buffers of exited threads stay in g_flmTraceBuffers until their events are exported,
+// then move to the pool and are reused by new threads. Spare buffers beyond the pool size are freed.
+#define FLM_TRACE_POOL_SIZE 4
+
+static std::mutex                     g_flmTraceMutex;
+static std::mutex                     g_flmTraceExportMutex;
+static std::vector<FLM_Trace_Buffer*> g_flmTraceBuffers;
+static std::vector<FLM_Trace_Buffer*> g_flmTracePool;
+
+// Marks the buffer of the thread as exited when the thread ends
+struct FLM_Trace_Thread
+{
+    FLM_Trace_Buffer* buffer = NULL;
+
+    ~FLM_Trace_Thread()
+    {
+        if (buffer != NULL)
+        {
+            std::lock_guard<std::mutex> lock(g_flmTraceMutex);
+            buffer->m_bExited = true;
+        }
+        t_flmTraceBuffer = NULL;
+    }
+};
+
+static thread_local FLM_Trace_Thread t_flmTraceThread;
+
+// TSC and QPC read together when tracing was first enabled, the origin of the exported time line
+static int64_t g_iiTraceStartTSC = 0;
+static int64_t g_iiTraceStartQPC = 0;
+
+void FLM_Trace_Buffer::Snapshot(std::vector<FLM_TRACE_EVENT>& events) const
+{
+    uint64_t end   = m_writePos.load(std::memory_order_acquire);
+    uint64_t begin = (end > FLM_TRACE_BUFFER_SIZE) ? end - FLM_TRACE_BUFFER_SIZE : 0;
+    size_t   first = events.size();
+    for (uint64_t pos = begin; pos < end; pos++)
+        events.push_back(m_events[pos & (FLM_TRACE_BUFFER_SIZE - 1)]);
+
+    // The writer may have overwritten the oldest events while they were copied.
+    // The event at endAfter is being written to the slot of endAfter - FLM_TRACE_BUFFER_SIZE.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t endAfter   = m_writePos.load(std::memory_order_relaxed);
+    uint64_t validBegin = (endAfter + 1 > FLM_TRACE_BUFFER_SIZE) ? endAfter + 1 - FLM_TRACE_BUFFER_SIZE : 0;
+    if (validBegin > begin)
+    {
+        size_t numInvalid = (size_t)std::min(validBegin - begin, end - begin);
+        events.erase(events.begin() + first, events.begin() + first + numInvalid);
+    }
+}
+
+void FLM_Trace_Buffer::Reset(DWORD threadId)
+{
+    m_threadId      = threadId;
+    m_threadName[0] = 0;
+    m_bExited       = false;
+    m_writePos.store(0, std::memory_order_relaxed);
+}
+
+FLM_Trace_Buffer* FlmTraceRegisterThread()
+{
+    FLM_Trace_Buffer* buffer = NULL;
+    {
+        std::lock_guard<std::mutex> lock(g_flmTraceMutex);
+        if (g_flmTracePool.empty() == false)
+        {
+            buffer = g_flmTracePool.back();
+            g_flmTracePool.pop_back();
+            buffer->Reset(GetCurrentThreadId());
+        }
+    }
+
+    if (buffer == NULL)
+        buffer = new (std::nothrow) FLM_Trace_Buffer(GetCurrentThreadId());
+    if (buffer == NULL)
+    {
+        // Tracing is optional, stop instead of failing every event
+        g_flmTraceEnabled.store(false, std::memory_order_relaxed);
+        static FLM_Trace_Buffer* dummy = new FLM_Trace_Buffer(0);
+        return dummy;
+    }
+
+    strncpy_s(buffer->m_threadName, sizeof(buffer->m_threadName), t_flmTraceThreadName, _TRUNCATE);
+
+    std::lock_guard<std::mutex> lock(g_flmTraceMutex);
+    g_flmTraceBuffers.push_back(buffer);
+    t_flmTraceBuffer        = buffer;
+    t_flmTraceThread.buffer = buffer;
+    return buffer;
+}
+
+void FlmTraceSetOrigin()
+{
+    if (g_iiTraceStartTSC == 0)
+    {
+        LARGE_INTEGER qpc;
+        QueryPerformanceCounter(&qpc);
+        g_iiTraceStartTSC = (int64_t)__rdtsc();
+        g_iiTraceStartQPC = qpc.QuadPart;
+    }
+}
+
+void FlmTraceEnable(bool bEnable)
+{
+    if (bEnable)
+        FlmTraceSetOrigin();
+    g_flmTraceEnabled.store(bEnable, std::memory_order_relaxed);
+}
+
+void FlmTraceSetThreadName(const char* name)
+{
+    // Threads that never trace an event do not get a buffer, tracing is usually off
+    strncpy_s(t_flmTraceThreadName, sizeof(t_flmTraceThreadName), name, _TRUNCATE);
+    if (t_flmTraceBuffer != NULL)
+        strncpy_s(t_flmTraceBuffer->m_threadName, sizeof(t_flmTraceBuffer->m_threadName), name, _TRUNCATE);
+}
+
+bool FlmTraceExport(const char* fileName)
+{
+    if (g_iiTraceStartTSC == 0)
+        return false;
+
+    // Second calibration point, the TSC rate is taken over the whole trace
+    LARGE_INTEGER qpcFrequency;
+    LARGE_INTEGER qpc;
+    QueryPerformanceFrequency(&qpcFrequency);
+    QueryPerformanceCounter(&qpc);
+    int64_t iiTSC = (int64_t)__rdtsc();
+
+    double qpcPerUS  = (double)qpcFrequency.QuadPart / 1000000.0;
+    double elapsedUS = (double)(qpc.QuadPart - g_iiTraceStartQPC) / qpcPerUS;
+    double tscPerUS  = (elapsedUS > 1000.0) ? (double)(iiTSC - g_iiTraceStartTSC) / elapsedUS : 1000.0;
+
+    FILE* file = fopen(fileName, "w");
+    if (file == NULL)
+    {
+        FlmPrintError("Unable to open trace file %s", fileName);
+        return false;
+    }
+
+    // Only one export at a time, so no buffer is recycled while another export reads it
+    std::lock_guard<std::mutex> exportLock(g_flmTraceExportMutex);
+
+    // Buffers of threads that exited before the copy are complete and recycled after writing
+    std::vector<FLM_Trace_Buffer*> buffers;
+    std::vector<FLM_Trace_Buffer*> exited;
+    {
+        std::lock_guard<std::mutex> lock(g_flmTraceMutex);
+        buffers = g_flmTraceBuffers;
+        for (FLM_Trace_Buffer* buffer : buffers)
+        {
+            if (buffer->m_bExited)
+                exited.push_back(buffer);
+        }
+    }
+
+    DWORD pid = GetCurrentProcessId();
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%lu,\"tid\":0,\"args\":{\"name\":\"FLM\"}}", pid);
+
+    std::vector<FLM_TRACE_EVENT> events;
+    for (FLM_Trace_Buffer* buffer : buffers)
+    {
+        DWORD tid = buffer->GetThreadId();
+        if (buffer->m_threadName[0] != 0)
+            fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%lu,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}", pid, tid, buffer->m_threadName);
+
+        events.clear();
+        buffer->Snapshot(events);
+        for (const FLM_TRACE_EVENT& event : events)
+        {
+            double ts = (event.type == FLM_TRACE_EVENT_TYPE::INSTANT_QPC) ? (double)(event.time - g_iiTraceStartQPC) / qpcPerUS
+                                                                           : (double)(event.time - g_iiTraceStartTSC) / tscPerUS;
+            if (ts < 0.0)
+                continue;
+
+            switch (event.type)
+            {
+            case FLM_TRACE_EVENT_TYPE::SCOPE:
+                fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%lu,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f}",
+                        event.name, pid, tid, ts, (double)event.value / tscPerUS);
+                break;
+            case FLM_TRACE_EVENT_TYPE::INSTANT:
+            case FLM_TRACE_EVENT_TYPE::INSTANT_QPC:
+                fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%lu,\"tid\":%lu,\"ts\":%.3f}", event.name, pid, tid, ts);
+                break;
+            case FLM_TRACE_EVENT_TYPE::COUNTER:
+                fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":%lu,\"tid\":%lu,\"ts\":%.3f,\"args\":{\"value\":%lld}}",
+                        event.name, pid, tid, ts, (long long)event.value);
+                break;
+            }
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    std::lock_guard<std::mutex> lock(g_flmTraceMutex);
+    for (FLM_Trace_Buffer* buffer : exited)
+    {
+        g_flmTraceBuffers.erase(std::find(g_flmTraceBuffers.begin(), g_flmTraceBuffers.end(), buffer));
+        if (g_flmTracePool.size() < FLM_TRACE_POOL_SIZE)
+            g_flmTracePool.push_back(buffer);
+        else
+            delete buffer;
+    }
+    return true;
+}
@@ -0,0 +1,152 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_trace.h
+/// @brief  Low overhead per thread trace events, exported as Chrome trace JSON
+//=============================================================================
+
+#ifndef FLM_TRACE_H
+#define FLM_TRACE_H
+
+#include <Windows.h>
+#include <intrin.h>
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+#define FLM_TRACE_BUFFER_SIZE 65536  // Events kept per thread, a power of 2. Older events are overwritten.
+#define FLM_TRACE_NAME_SIZE   32
+
+enum class FLM_TRACE_EVENT_TYPE : uint32_t
+{
+    SCOPE       = 0,  // time is the start, value the duration in TSC ticks
+    INSTANT     = 1,
+    INSTANT_QPC = 2,  // time is a QueryPerformanceCounter value, for time stamps taken elsewhere such as frame present times
+    COUNTER     = 3,
+};
+
+struct FLM_TRACE_EVENT
+{
+    const char*          name;  // Must be a string literal, only the pointer is stored
+    int64_t              time;  // __rdtsc() unless noted in FLM_TRACE_EVENT_TYPE
+    int64_t              value;
+    FLM_TRACE_EVENT_TYPE type;
+};
+
+// Ring of trace events written by one thread only. Writing is a few stores and never blocks,
+// the exporting thread copies the ring and drops events that were overwritten while copying.
+class FLM_Trace_Buffer
+{
+public:
+    FLM_Trace_Buffer(DWORD threadId) : m_threadId(threadId) {}
+
+    void Add(FLM_TRACE_EVENT_TYPE type, const char* name, int64_t time, int64_t value)
+    {
+        uint64_t         pos   = m_writePos.load(std::memory_order_relaxed);
+        FLM_TRACE_EVENT& event = m_events[pos & (FLM_TRACE_BUFFER_SIZE - 1)];
+        event.name             = name;
+        event.time             = time;
+        event.value            = value;
+        event.type             = type;
+        m_writePos.store(pos + 1, std::memory_order_release);
+    }
+
+    void  Snapshot(std::vector<FLM_TRACE_EVENT>& events) const;
+    void  Reset(DWORD threadId);
+    DWORD GetThreadId() const { return m_threadId; }
+
+    char m_threadName[FLM_TRACE_NAME_SIZE] = {};
+    bool m_bExited                         = false;  // The thread exited, the buffer is recycled after its events are exported
+
+private:
+    DWORD                 m_threadId;
+    std::atomic<uint64_t> m_writePos = 0;
+    FLM_TRACE_EVENT       m_events[FLM_TRACE_BUFFER_SIZE];
+};
+
+extern std::atomic<bool>              g_flmTraceEnabled;
+extern thread_local FLM_Trace_Buffer* t_flmTraceBuffer;
+
+FLM_Trace_Buffer* FlmTraceRegisterThread();
+
+inline FLM_Trace_Buffer* FlmTraceThreadBuffer()
+{
+    FLM_Trace_Buffer* buffer = t_flmTraceBuffer;
+    return (buffer != NULL) ? buffer : FlmTraceRegisterThread();
+}
+
+inline bool FlmTraceEnabled()
+{
+    return g_flmTraceEnabled.load(std::memory_order_relaxed);
+}
+
+// Starts recording, events of threads that exited are kept until the next export
+void FlmTraceEnable(bool bEnable);
+
+// Starts the exported time line now if tracing is enabled later, so scopes that began before can still be recorded
+void FlmTraceSetOrigin();
+
+// Records a scope that started at iiStartTSC (__rdtsc()) and ends now, for example one that ran before tracing was enabled
+inline void FlmTraceAddScope(const char* name, int64_t iiStartTSC)
+{
+    if (FlmTraceEnabled())
+        FlmTraceThreadBuffer()->Add(FLM_TRACE_EVENT_TYPE::SCOPE, name, iiStartTSC, (int64_t)__rdtsc() - iiStartTSC);
+}
+
+// Name shown for the calling thread in the trace viewer
+void FlmTraceSetThreadName(const char* name);
+
+// Writes the events of all threads as Chrome trace JSON, open in chrome://tracing or ui.perfetto.dev
+bool FlmTraceExport(const char* fileName);
+
+// Records the duration of the enclosing scope
+class FLM_Trace_Scope
+{
+public:
+    FLM_Trace_Scope(const char* name)
+    {
+        if (FlmTraceEnabled())
+        {
+            m_name  = name;
+            m_start = (int64_t)__rdtsc();
+        }
+    }
+
+    ~FLM_Trace_Scope()
+    {
+        if (m_name != NULL)
+            FlmTraceThreadBuffer()->Add(FLM_TRACE_EVENT_TYPE::SCOPE, m_name, m_start, (int64_t)__rdtsc() - m_start);
+    }
+
+private:
+    const char* m_name  = NULL;
+    int64_t     m_start = 0;
+};
+
+#define FLM_TRACE_CONCAT2(a, b) a##b
+#define FLM_TRACE_CONCAT(a, b)  FLM_TRACE_CONCAT2(a, b)
+
+#define FLM_TRACE_SCOPE(name) FLM_Trace_Scope FLM_TRACE_CONCAT(flmTraceScope, __LINE__)(name)
+
+#define FLM_TRACE_INSTANT(name)                                                                     \
+    do                                                                                              \
+    {                                                                                               \
+        if (FlmTraceEnabled())                                                                      \
+            FlmTraceThreadBuffer()->Add(FLM_TRACE_EVENT_TYPE::INSTANT, (name), (int64_t)__rdtsc(), 0); \
+    } while (0)
+
+#define FLM_TRACE_INSTANT_QPC(name, qpcTime)                                                      \
+    do                                                                                            \
+    {                                                                                             \
+        if (FlmTraceEnabled())                                                                    \
+            FlmTraceThreadBuffer()->Add(FLM_TRACE_EVENT_TYPE::INSTANT_QPC, (name), (qpcTime), 0); \
+    } while (0)
+
+#define FLM_TRACE_COUNTER(name, value)                                                                       \
+    do                                                                                                       \
+    {                                                                                                        \
+        if (FlmTraceEnabled())                                                                               \
+            FlmTraceThreadBuffer()->Add(FLM_TRACE_EVENT_TYPE::COUNTER, (name), (int64_t)__rdtsc(), (value)); \
+    } while (0)
+
+#endif
@@ -0,0 +1,204 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_bench.cpp
+/// @brief  Repetition based timing of FLM hot path functions
+//=============================================================================
+
+#include "flm_bench.h"
+#include "flm_statistics.h"
+#include "version.h"
+
+#include <Windows.h>
+#include <intrin.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+volatile int64_t g_flmBenchSink = 0;
+
+FLM_Bench_Runner::FLM_Bench_Runner(const FLM_BENCH_SETTINGS& settings)
+    : m_settings(settings)
+{
+    m_settings.repetitions = std::max(3, m_settings.repetitions);
+
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    m_fTicksPerNS = (double)frequency.QuadPart / 1e9;
+}
+
+bool FLM_Bench_Runner::Selected(const char* name) const
+{
+    return m_settings.filter.empty() || (strstr(name, m_settings.filter.c_str()) != NULL);
+}
+
+double FLM_Bench_Runner::TimeNS(const FLM_BENCH_BODY& body, int64_t iterations)
+{
+    LARGE_INTEGER start;
+    LARGE_INTEGER end;
+    QueryPerformanceCounter(&start);
+    body(iterations);
+    QueryPerformanceCounter(&end);
+    return (double)(end.QuadPart - start.QuadPart) / m_fTicksPerNS;
+}
+
+void FLM_Bench_Runner::Run(const char* name, uint64_t bytesPerFrame, const FLM_BENCH_BODY& body)
+{
+    if (!Selected(name))
+        return;
+
+    // Calibrate the iterations per sample, this also warms up caches and the CPU clock
+    double  minSampleNS = m_settings.minSampleMS * 1e6;
+    int64_t iterations  = 1;
+    for (;;)
+    {
+        double ns = TimeNS(body, iterations);
+        if (ns >= minSampleNS)
+            break;
+
+        int64_t estimate = (ns > 0.0) ? (int64_t)(minSampleNS / ns * (double)iterations * 1.2) : iterations * 10;
+        iterations       = std::clamp<int64_t>(estimate, iterations + 1, iterations * 10);
+    }
+
+    std::vector<double> samples(m_settings.repetitions);
+    FLM_Running_Stats   stats;
+    for (double& sample : samples)
+    {
+        sample = TimeNS(body, iterations) / (double)iterations;
+        stats.Add(sample);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    // Confidence interval of the median from the ranks of the order statistics, normal approximation of the binomial
+    int    n      = (int)samples.size();
+    double spread = FLM_Z_95 * sqrt((double)n) / 2.0;
+    int    low    = std::max(0, (int)floor(n / 2.0 - spread));
+    int    high   = std::min(n - 1, (int)ceil(n / 2.0 + spread));
+
+    FLM_BENCH_RESULT result;
+    result.name           = name;
+    result.bytesPerFrame  = bytesPerFrame;
+    result.repetitions    = n;
+    result.iterations     = iterations;
+    result.nsMedian       = (n & 1) ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2.0;
+    result.nsCILow        = samples[low];
+    result.nsCIHigh       = samples[high];
+    result.nsMean         = stats.Mean();
+    result.nsStdDev       = stats.StdDev();
+    result.nsMin          = stats.Min();
+    result.bytesPerSecond = (result.nsMedian > 0.0) ? (double)bytesPerFrame / result.nsMedian * 1e9 : 0.0;
+
+    FlmPrintBenchResult(stdout, result);
+    m_results.push_back(result);
+}
+
+void FlmPrintBenchResult(FILE* file, const FLM_BENCH_RESULT& result)
+{
+    fprintf(file, "%-36s %12.1f ns/frame  [%10.1f, %10.1f]  +-%5.1f%%", result.name.c_str(), result.nsMedian, result.nsCILow, result.nsCIHigh,
+            (result.nsMean > 0.0) ? result.nsStdDev / result.nsMean * 100.0 : 0.0);
+    if (result.bytesPerFrame > 0)
+        fprintf(file, "  %8.2f GB/s", result.bytesPerSecond / 1e9);
+    fprintf(file, "\n");
+}
+
+std::string FlmGetCpuName()
+{
+    int  cpuInfo[4] = {};
+    char brand[49]  = {};
+    __cpuid(cpuInfo, 0x80000000);
+    if ((unsigned int)cpuInfo[0] < 0x80000004)
+        return "unknown";
+
+    for (int i = 0; i < 3; i++)
+    {
+        __cpuid(cpuInfo, 0x80000002 + i);
+        memcpy(brand + i * 16, cpuInfo, 16);
+    }
+
+    std::string name = brand;
+    name.erase(0, name.find_first_not_of(' '));
+    std::replace(name.begin(), name.end(), '"', '\'');
+    return name;
+}
+
+bool FlmWriteBenchJson(const char* fileName, const std::vector<FLM_BENCH_RESULT>& results)
+{
+    FILE* file = fopen(fileName, "w");
+    if (file == NULL)
+        return false;
+
+    fprintf(file, "{\"flm_version\":\"%s\",\"cpu\":\"%s\",\"benchmarks\":[\n", VERSION_TEXT, FlmGetCpuName().c_str());
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const FLM_BENCH_RESULT& r = results[i];
+        fprintf(file,
+                "{\"name\":\"%s\",\"bytes_per_frame\":%llu,\"repetitions\":%d,\"iterations\":%lld,\"ns_per_frame\":%.3f,"
+                "\"ns_per_frame_ci_low\":%.3f,\"ns_per_frame_ci_high\":%.3f,\"ns_per_frame_mean\":%.3f,\"ns_per_frame_stddev\":%.3f,"
+                "\"ns_per_frame_min\":%.3f,\"bytes_per_second\":%.0f}%s\n",
+                r.name.c_str(), (unsigned long long)r.bytesPerFrame, r.repetitions, (long long)r.iterations, r.nsMedian, r.nsCILow, r.nsCIHigh,
+                r.nsMean, r.nsStdDev, r.nsMin, r.bytesPerSecond, (i + 1 < results.size()) ? "," : "");
+    }
+    fprintf(file, "]}\n");
+    fclose(file);
+    return true;
+}
+
+bool FlmReadJsonNumber(const char* line, const char* key, double& value)
+{
+    const char* pos = strstr(line, key);
+    if (pos == NULL)
+        return false;
+    value = atof(pos + strlen(key));
+    return true;
+}
+
+bool FlmReadBenchJson(const char* fileName, std::vector<FLM_BENCH_RESULT>& results)
+{
+    FILE* file = fopen(fileName, "r");
+    if (file == NULL)
+        return false;
+
+    char line[1024];
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        const char* name = strstr(line, "{\"name\":\"");
+        if (name == NULL)
+            continue;
+        name += strlen("{\"name\":\"");
+        const char* nameEnd = strchr(name, '"');
+        if (nameEnd == NULL)
+            continue;
+
+        FLM_BENCH_RESULT result;
+        result.name = std::string(name, nameEnd - name);
+        if (FlmReadJsonNumber(line, "\"ns_per_frame\":", result.nsMedian) && FlmReadJsonNumber(line, "\"ns_per_frame_ci_low\":", result.nsCILow) &&
+            FlmReadJsonNumber(line, "\"ns_per_frame_ci_high\":", result.nsCIHigh))
+        {
+            FlmReadJsonNumber(line, "\"bytes_per_second\":", result.bytesPerSecond);
+            results.push_back(result);
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+void FlmPrintBenchComparison(FILE* file, const std::vector<FLM_BENCH_RESULT>& baseline, const std::vector<FLM_BENCH_RESULT>& results)
+{
+    fprintf(file, "\n%-36s %12s %12s %9s\n", "Benchmark [ns/frame]", "baseline", "current", "change");
+    for (const FLM_BENCH_RESULT& result : results)
+    {
+        auto it = std::find_if(baseline.begin(), baseline.end(), [&](const FLM_BENCH_RESULT& b) { return b.name == result.name; });
+        if ((it == baseline.end()) || (it->nsMedian <= 0.0))
+            continue;
+
+        double      change  = (result.nsMedian / it->nsMedian - 1.0) * 100.0;
+        const char* verdict = "";
+        if (result.nsCIHigh < it->nsCILow)
+            verdict = "faster";
+        else if (result.nsCILow > it->nsCIHigh)
+            verdict = "slower";
+
+        fprintf(file, "%-36s %12.1f %12.1f %+8.1f%%  %s\n", result.name.c_str(), it->nsMedian, result.nsMedian, change, verdict);
+    }
+}
@@ -0,0 +1,81 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_bench.h
+/// @brief  Repetition based timing of FLM hot path functions
+//=============================================================================
+
+#ifndef FLM_BENCH_H
+#define FLM_BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct FLM_BENCH_SETTINGS
+{
+    int         repetitions = 15;    // Timed samples per benchmark, the median and its confidence interval are taken over these
+    double      minSampleMS = 20.0;  // Iterations per sample are calibrated so each sample takes at least this long
+    std::string filter;              // Only run benchmarks whose name contains this
+};
+
+// Times are per call, each call processes one captured frame
+struct FLM_BENCH_RESULT
+{
+    std::string name;
+    uint64_t    bytesPerFrame = 0;  // Bytes read per call, 0 if the benchmark does not process pixels
+    int         repetitions   = 0;
+    int64_t     iterations    = 0;  // Calls per repetition
+    double      nsMedian      = 0.0;
+    double      nsCILow       = 0.0;  // 95% confidence interval of the median
+    double      nsCIHigh      = 0.0;
+    double      nsMean        = 0.0;
+    double      nsStdDev      = 0.0;
+    double      nsMin         = 0.0;
+    double      bytesPerSecond = 0.0;  // At the median
+};
+
+// The body runs the benchmarked call the given number of times
+typedef std::function<void(int64_t iterations)> FLM_BENCH_BODY;
+
+class FLM_Bench_Runner
+{
+public:
+    FLM_Bench_Runner(const FLM_BENCH_SETTINGS& settings);
+
+    bool Selected(const char* name) const;
+    void Run(const char* name, uint64_t bytesPerFrame, const FLM_BENCH_BODY& body);
+
+    const std::vector<FLM_BENCH_RESULT>& Results() const { return m_results; }
+
+private:
+    double TimeNS(const FLM_BENCH_BODY& body, int64_t iterations);
+
+    FLM_BENCH_SETTINGS            m_settings;
+    double                        m_fTicksPerNS = 1.0;
+    std::vector<FLM_BENCH_RESULT> m_results;
+};
+
+// Keeps results of benchmarked calls alive so the compiler can not remove them
+extern volatile int64_t g_flmBenchSink;
+
+void FlmPrintBenchResult(FILE* file, const FLM_BENCH_RESULT& result);
+
+// One benchmark per line, so results of two commits can also be compared with a text diff
+bool FlmWriteBenchJson(const char* fileName, const std::vector<FLM_BENCH_RESULT>& results);
+
+// Reads files written by FlmWriteBenchJson
+bool FlmReadBenchJson(const char* fileName, std::vector<FLM_BENCH_RESULT>& results);
+
+// Brand string of the CPU, recorded with the results
+std::string FlmGetCpuName();
+
+// Number following key on a line of the JSON files written by flm_bench
+bool FlmReadJsonNumber(const char* line, const char* key, double& value);
+
+// Median change per benchmark, flagged when the confidence intervals do not overlap
+void FlmPrintBenchComparison(FILE* file, const std::vector<FLM_BENCH_RESULT>& baseline, const std::vector<FLM_BENCH_RESULT>& results);
+
+#endif
@@ -0,0 +1,308 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_bench_e2e.cpp
+/// @brief  End to end accuracy and overhead of the FLM pipeline on generated frames
+//=============================================================================
+
+#include "flm_bench_e2e.h"
+#include "flm_bench.h"
+#include "flm_pipeline.h"
+#include "version.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+// Allowed absolute changes, below these the run to run noise dominates
+#define FLM_E2E_ERROR_NOISE_MS     0.25
+#define FLM_E2E_MISS_RATE_NOISE    0.02
+#define FLM_E2E_CPU_NOISE_MS       0.05
+#define FLM_E2E_CPU_PERCENT_NOISE  2.0
+
+// Limit of the click_idle CPU use in percent of one core, with or without a baseline. Waiting for a click is event driven,
+// the capture and SAD of the frames cost far less, polling the button state costs a whole core.
+#define FLM_E2E_IDLE_CPU_PERCENT   25.0
+
+std::vector<FLM_E2E_SCENARIO> FlmGetE2EScenarios(int refreshRate)
+{
+    std::vector<FLM_E2E_SCENARIO> scenarios(4);
+
+    scenarios[0].name              = "fixed";
+    scenarios[0].script.type       = FLM_SYNTHETIC_LATENCY::FIXED;
+    scenarios[0].script.latencyMS  = 20.0f;
+
+    scenarios[1].name              = "jitter";
+    scenarios[1].script.type       = FLM_SYNTHETIC_LATENCY::JITTER;
+    scenarios[1].script.latencyMS  = 20.0f;
+    scenarios[1].script.jitterMS   = 5.0f;
+
+    scenarios[2].name               = "bimodal";
+    scenarios[2].script.type        = FLM_SYNTHETIC_LATENCY::BIMODAL;
+    scenarios[2].script.latencyMS   = 15.0f;
+    scenarios[2].script.latency2MS  = 45.0f;
+    scenarios[2].script.probability = 0.3f;
+
+    scenarios[3].name              = "frame_generation";
+    scenarios[3].script.type       = FLM_SYNTHETIC_LATENCY::FRAME_GENERATION;
+    scenarios[3].script.latencyMS  = 30.0f;
+
+    FLM_E2E_SCENARIO idle;
+    idle.name           = "click_idle";
+    idle.mouseEventType = FLM_MOUSE_EVENT_TYPE::MOUSE_CLICK;
+    scenarios.push_back(idle);
+
+    for (FLM_E2E_SCENARIO& scenario : scenarios)
+        scenario.script.refreshRate = refreshRate;
+
+    return scenarios;
+}
+
+static int64_t GetProcessCPUTime()
+{
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime) == false)
+        return 0;
+    return (((int64_t)kernelTime.dwHighDateTime << 32) | kernelTime.dwLowDateTime) + (((int64_t)userTime.dwHighDateTime << 32) | userTime.dwLowDateTime);
+}
+
+// Linear interpolation between the closest ranks of sorted values
+static double Percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty())
+        return 0.0;
+    double rank = p / 100.0 * (double)(sorted.size() - 1);
+    size_t low  = (size_t)floor(rank);
+    size_t high = std::min(low + 1, sorted.size() - 1);
+    return sorted[low] + (sorted[high] - sorted[low]) * (rank - (double)low);
+}
+
+bool FlmRunE2EScenario(const FLM_E2E_SCENARIO& scenario, double durationS, FLM_E2E_RESULT& result)
+{
+    FLM_Pipeline* pipeline = new (std::nothrow) FLM_Pipeline();
+    if (pipeline == NULL)
+        return false;
+
+    pipeline->m_syntheticScript = scenario.script;
+    if (pipeline->Init(FLM_CAPTURE_CODEC_TYPE::SYNTHETIC) != FLM_STATUS::OK)
+    {
+        pipeline->Close();
+        delete pipeline;
+        return false;
+    }
+
+    // Only the pipeline itself is measured, no outputs and no drawing on the screen
+    pipeline->m_setting.saveToFile                        = false;
+    pipeline->m_setting.saveSampleLog                     = false;
+    pipeline->m_setting.showBoundingBox                   = false;
+    pipeline->m_runtimeOptions.mouseEventType             = scenario.mouseEventType;
+    pipeline->m_runtimeOptions.minimizeApp                = false;
+    pipeline->m_runtimeOptions.gameUsesFrameGeneration    = (scenario.script.type == FLM_SYNTHETIC_LATENCY::FRAME_GENERATION);
+
+    FLM_Capture_Synthetic* synthetic = pipeline->GetSynthetic();
+
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER start;
+    LARGE_INTEGER now;
+    QueryPerformanceFrequency(&frequency);
+
+    int64_t iiCPUTime0       = GetProcessCPUTime();
+    int64_t iiGeneratorTime0 = synthetic->GetGeneratorCPUTime();
+    QueryPerformanceCounter(&start);
+
+    pipeline->StartMeasurements();
+    do
+    {
+        if (pipeline->Process() == FLM_PROCESS_STATUS::CLOSE)
+            break;
+        QueryPerformanceCounter(&now);
+    } while ((double)(now.QuadPart - start.QuadPart) / (double)frequency.QuadPart < durationS);
+    pipeline->StopMeasurements();
+
+    QueryPerformanceCounter(&now);
+    int64_t iiCPUTime = (GetProcessCPUTime() - iiCPUTime0) - (synthetic->GetGeneratorCPUTime() - iiGeneratorTime0);
+
+    std::vector<FLM_SYNTHETIC_INJECTION> injections = synthetic->GetInjections();
+    pipeline->Close();
+    delete pipeline;
+
+    // The pipeline skips its first detection and needs a few frames for the frame time average,
+    // injections before the first measurement are the warm up
+    auto first = std::find_if(injections.begin(), injections.end(), [](const FLM_SYNTHETIC_INJECTION& i) { return i.bMeasured; });
+
+    std::vector<double> absErrors;
+    double              sumErrors        = 0.0;
+    double              sumSquaredErrors = 0.0;
+
+    result               = FLM_E2E_RESULT();
+    result.name          = scenario.name;
+    result.durationS     = (double)(now.QuadPart - start.QuadPart) / (double)frequency.QuadPart;
+
+    for (auto it = first; it != injections.end(); ++it)
+    {
+        if ((it->bCounted == false) || (it->iiPresentTime == 0))
+            continue;
+
+        result.injections++;
+        if (it->bMeasured)
+        {
+            double error = (double)it->fMeasuredMS - (double)it->fTrueMS;
+            absErrors.push_back(fabs(error));
+            sumErrors += error;
+            sumSquaredErrors += error * error;
+        }
+    }
+
+    std::sort(absErrors.begin(), absErrors.end());
+    result.measurements = (int)absErrors.size();
+
+    if (result.injections > 0)
+        result.missRate = (double)(result.injections - result.measurements) / (double)result.injections;
+
+    if (result.measurements > 0)
+    {
+        double sumAbsErrors = 0.0;
+        for (double absError : absErrors)
+            sumAbsErrors += absError;
+
+        result.meanAbsErrorMS = sumAbsErrors / result.measurements;
+        result.p50AbsErrorMS  = Percentile(absErrors, 50.0);
+        result.p95AbsErrorMS  = Percentile(absErrors, 95.0);
+        result.maxAbsErrorMS  = absErrors.back();
+        result.biasMS         = sumErrors / result.measurements;
+        result.stdDevErrorMS  = sqrt(std::max(0.0, sumSquaredErrors / result.measurements - result.biasMS * result.biasMS));
+        result.cpuMSPerSample = (double)iiCPUTime / 10000.0 / result.measurements;  // 100 ns units
+    }
+
+    if (result.durationS > 0.0)
+    {
+        result.samplesPerMinute = result.measurements / result.durationS * 60.0;
+        result.cpuPercent       = (double)iiCPUTime / 100000.0 / result.durationS;  // 100 ns units
+    }
+
+    return true;
+}
+
+void FlmPrintE2EResult(FILE* file, const FLM_E2E_RESULT& result)
+{
+    fprintf(file,
+            "%-18s %5d samples  error mean %6.2f p50 %6.2f p95 %6.2f max %6.2f bias %+6.2f sd %5.2f ms  miss %5.1f%%  %7.1f samples/min  %6.3f ms CPU/sample  "
+            "%5.1f%% CPU\n",
+            result.name.c_str(), result.measurements, result.meanAbsErrorMS, result.p50AbsErrorMS, result.p95AbsErrorMS, result.maxAbsErrorMS, result.biasMS,
+            result.stdDevErrorMS, result.missRate * 100.0, result.samplesPerMinute, result.cpuMSPerSample, result.cpuPercent);
+}
+
+bool FlmWriteE2EJson(const char* fileName, const std::vector<FLM_E2E_RESULT>& results)
+{
+    FILE* file = fopen(fileName, "w");
+    if (file == NULL)
+        return false;
+
+    fprintf(file, "{\"flm_version\":\"%s\",\"cpu\":\"%s\",\"scenarios\":[\n", VERSION_TEXT, FlmGetCpuName().c_str());
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const FLM_E2E_RESULT& r = results[i];
+        fprintf(file,
+                "{\"name\":\"%s\",\"duration_s\":%.3f,\"injections\":%d,\"measurements\":%d,\"miss_rate\":%.4f,\"mean_abs_error_ms\":%.3f,"
+                "\"p50_abs_error_ms\":%.3f,\"p95_abs_error_ms\":%.3f,\"max_abs_error_ms\":%.3f,\"bias_ms\":%.3f,\"std_dev_error_ms\":%.3f,\"samples_per_minute\":%.1f,"
+                "\"cpu_ms_per_sample\":%.4f,\"cpu_percent\":%.2f}%s\n",
+                r.name.c_str(), r.durationS, r.injections, r.measurements, r.missRate, r.meanAbsErrorMS, r.p50AbsErrorMS, r.p95AbsErrorMS, r.maxAbsErrorMS,
+                r.biasMS, r.stdDevErrorMS, r.samplesPerMinute, r.cpuMSPerSample, r.cpuPercent, (i + 1 < results.size()) ? "," : "");
+    }
+    fprintf(file, "]}\n");
+    fclose(file);
+    return true;
+}
+
+bool FlmReadE2EJson(const char* fileName, std::vector<FLM_E2E_RESULT>& results)
+{
+    FILE* file = fopen(fileName, "r");
+    if (file == NULL)
+        return false;
+
+    char line[1024];
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        const char* name = strstr(line, "{\"name\":\"");
+        if (name == NULL)
+            continue;
+        name += strlen("{\"name\":\"");
+        const char* nameEnd = strchr(name, '"');
+        if (nameEnd == NULL)
+            continue;
+
+        FLM_E2E_RESULT result;
+        result.name = std::string(name, nameEnd - name);
+        if (FlmReadJsonNumber(line, "\"mean_abs_error_ms\":", result.meanAbsErrorMS) && FlmReadJsonNumber(line, "\"miss_rate\":", result.missRate) &&
+            FlmReadJsonNumber(line, "\"samples_per_minute\":", result.samplesPerMinute))
+        {
+            FlmReadJsonNumber(line, "\"p95_abs_error_ms\":", result.p95AbsErrorMS);
+            FlmReadJsonNumber(line, "\"std_dev_error_ms\":", result.stdDevErrorMS);
+            FlmReadJsonNumber(line, "\"cpu_ms_per_sample\":", result.cpuMSPerSample);
+            FlmReadJsonNumber(line, "\"cpu_percent\":", result.cpuPercent);
+
+            double measurements = 0.0;
+            FlmReadJsonNumber(line, "\"measurements\":", measurements);
+            result.measurements = (int)measurements;
+            results.push_back(result);
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+static int CompareMetric(FILE* file, const char* name, const char* metric, double baseline, double current, bool bRegressed)
+{
+    fprintf(file, "%-18s %-20s %10.3f %10.3f  %s\n", name, metric, baseline, current, bRegressed ? "REGRESSION" : "");
+    return bRegressed ? 1 : 0;
+}
+
+int FlmPrintE2ELimitViolations(FILE* file, const std::vector<FLM_E2E_RESULT>& results)
+{
+    int violations = 0;
+    for (const FLM_E2E_RESULT& r : results)
+    {
+        if ((r.name == "click_idle") && (r.cpuPercent > FLM_E2E_IDLE_CPU_PERCENT))
+        {
+            fprintf(file, "%-18s cpu_percent %.1f is above the limit of %.1f\n", r.name.c_str(), r.cpuPercent, FLM_E2E_IDLE_CPU_PERCENT);
+            violations++;
+        }
+    }
+    return violations;
+}
+
+int FlmPrintE2EComparison(FILE* file, const std::vector<FLM_E2E_RESULT>& baseline, const std::vector<FLM_E2E_RESULT>& results, double tolerance)
+{
+    int regressions = 0;
+
+    fprintf(file, "\n%-18s %-20s %10s %10s\n", "Scenario", "Metric", "baseline", "current");
+    for (const FLM_E2E_RESULT& r : results)
+    {
+        auto it = std::find_if(baseline.begin(), baseline.end(), [&](const FLM_E2E_RESULT& b) { return b.name == r.name; });
+        if (it == baseline.end())
+            continue;
+
+        const FLM_E2E_RESULT& b = *it;
+        regressions += CompareMetric(file, r.name.c_str(), "cpu_percent", b.cpuPercent, r.cpuPercent,
+                                     r.cpuPercent > b.cpuPercent * (1.0 + tolerance) + FLM_E2E_CPU_PERCENT_NOISE);
+
+        // The idle scenario has no measurements
+        if (b.measurements == 0)
+            continue;
+
+        regressions += CompareMetric(file, r.name.c_str(), "mean_abs_error_ms", b.meanAbsErrorMS, r.meanAbsErrorMS,
+                                     r.meanAbsErrorMS > b.meanAbsErrorMS * (1.0 + tolerance) + FLM_E2E_ERROR_NOISE_MS);
+        regressions += CompareMetric(file, r.name.c_str(), "p95_abs_error_ms", b.p95AbsErrorMS, r.p95AbsErrorMS,
+                                     r.p95AbsErrorMS > b.p95AbsErrorMS * (1.0 + tolerance) + 2.0 * FLM_E2E_ERROR_NOISE_MS);
+        regressions += CompareMetric(file, r.name.c_str(), "std_dev_error_ms", b.stdDevErrorMS, r.stdDevErrorMS,
+                                     r.stdDevErrorMS > b.stdDevErrorMS * (1.0 + tolerance) + FLM_E2E_ERROR_NOISE_MS);
+        regressions += CompareMetric(file, r.name.c_str(), "miss_rate", b.missRate, r.missRate,
+                                     r.missRate > b.missRate * (1.0 + tolerance) + FLM_E2E_MISS_RATE_NOISE);
+        regressions += CompareMetric(file, r.name.c_str(), "samples_per_minute", b.samplesPerMinute, r.samplesPerMinute,
+                                     r.samplesPerMinute < b.samplesPerMinute * (1.0 - tolerance));
+        regressions += CompareMetric(file, r.name.c_str(), "cpu_ms_per_sample", b.cpuMSPerSample, r.cpuMSPerSample,
+                                     r.cpuMSPerSample > b.cpuMSPerSample * (1.0 + tolerance) + FLM_E2E_CPU_NOISE_MS);
+    }
+
+    return regressions;
+}
@@ -0,0 +1,66 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file flm_bench_e2e.h
+/// @brief  End to end accuracy and overhead of the FLM pipeline on generated frames
+//=============================================================================
+
+#ifndef FLM_BENCH_E2E_H
+#define FLM_BENCH_E2E_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "flm_capture_synthetic.h"
+
+struct FLM_E2E_SCENARIO
+{
+    std::string          name;
+    FLM_SYNTHETIC_SCRIPT script;
+    FLM_MOUSE_EVENT_TYPE mouseEventType = FLM_MOUSE_EVENT_TYPE::MOUSE_MOVE;  // Nothing clicks in MOUSE_CLICK, it measures the idle overhead
+};
+
+// Errors are measured - true latency, where the true latency is the present time of the first frame showing the response
+struct FLM_E2E_RESULT
+{
+    std::string name;
+    double      durationS        = 0.0;
+    int         injections       = 0;    // Mouse moves after the warm up whose response was presented before the end of the run
+    int         measurements     = 0;    // Of those, the ones FLM measured
+    double      missRate         = 0.0;  // Injections without a measurement
+    double      meanAbsErrorMS   = 0.0;
+    double      p50AbsErrorMS    = 0.0;
+    double      p95AbsErrorMS    = 0.0;
+    double      maxAbsErrorMS    = 0.0;
+    double      biasMS           = 0.0;  // Mean signed error
+    double      stdDevErrorMS    = 0.0;  // Standard deviation of the signed error, the spread added by scheduling and detection
+    double      samplesPerMinute = 0.0;
+    double      cpuMSPerSample   = 0.0;  // CPU time of FLM, without the frame generator, per measurement
+    double      cpuPercent       = 0.0;  // CPU time of FLM, without the frame generator, in percent of one core
+};
+
+// Fixed, jittered, bimodal and frame generated latencies on a virtual display of refreshRate Hz,
+// and a click mode session without clicks for the overhead while FLM waits
+std::vector<FLM_E2E_SCENARIO> FlmGetE2EScenarios(int refreshRate);
+
+// Runs the full pipeline in the scenario mouse mode for durationS seconds, flm.ini is read from the working directory
+bool FlmRunE2EScenario(const FLM_E2E_SCENARIO& scenario, double durationS, FLM_E2E_RESULT& result);
+
+void FlmPrintE2EResult(FILE* file, const FLM_E2E_RESULT& result);
+
+// Same layout as FlmWriteBenchJson, one scenario per line
+bool FlmWriteE2EJson(const char* fileName, const std::vector<FLM_E2E_RESULT>& results);
+
+// Reads files written by FlmWriteE2EJson
+bool FlmReadE2EJson(const char* fileName, std::vector<FLM_E2E_RESULT>& results);
+
+// Prints the results above the absolute limits and returns their number, they fail without a baseline
+int FlmPrintE2ELimitViolations(FILE* file, const std::vector<FLM_E2E_RESULT>& results);
+
+// Prints the changes and returns the number of regressions. tolerance is the allowed relative change,
+// small absolute changes of the error and the miss rate are ignored as they are within the run to run noise.
+int FlmPrintE2EComparison(FILE* file, const std::vector<FLM_E2E_RESULT>& baseline, const std::vector<FLM_E2E_RESULT>& results, double tolerance);
+
+#endif
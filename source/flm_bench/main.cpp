@@ -0,0 +1,1210 @@
+//=============================================================================
+// Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+/// @author AMD Developer Tools Team
+/// @file main.cpp
+/// @brief  Microbenchmarks of the FLM detection hot path on generated frames
+//=============================================================================
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "flm_bench.h"
+#include "flm_bench_e2e.h"
+#include "flm_capture_context.h"
+#include "flm_detection.h"
+#include "flm_hotkeys.h"
+#include "flm_output_sessions.h"
+#include "flm_precision_sleeper.h"
+#include "flm_projection.h"
+#include "flm_refresh_estimator.h"
+#include "flm_regions.h"
+#include "flm_sad.h"
+#include "flm_shared_telemetry.h"
+#include "flm_startup.h"
+#include "version.h"
+
+static const std::vector<std::string> flm_bench_help = {
+    {"Usage: flm_bench [options]"},
+    {""},
+    {"   -o <file>            : Write the results as JSON, default flm_bench.json"},
+    {"   -baseline <file>     : Compare with the JSON results of an earlier run, for example of the previous commit"},
+    {"   -filter <text>       : Only run benchmarks whose name contains text"},
+    {"   -repetitions <n>     : Timed samples per benchmark, default 15"},
+    {"   -mintime <ms>        : Minimum time of one sample, default 20"},
+    {"   -check               : Only run the checks of the detection code, exits with 1 when one fails."},
+    {"                          They run before the benchmarks unless -filter is given"},
+    {""},
+    {"   -e2e                 : Run the full pipeline on generated frames with scripted latencies instead,"},
+    {"                          reports the latency error, miss rate, samples per minute and CPU time per sample."},
+    {"                          Run from the folder with flm.ini, the results are written to flm_bench_e2e.json"},
+    {"   -duration <s>        : Seconds per -e2e scenario, default 60"},
+    {"   -refresh <hz>        : Refresh rate of the generated frames, default 144"},
+    {"   -tolerance <f>       : Allowed relative change against -baseline before -e2e exits with 1, default 0.2"},
+};
+
+struct FLM_BENCH_OPTIONS
+{
+    FLM_BENCH_SETTINGS settings;
+    std::string        outputFile;
+    std::string        baselineFile;
+    bool               check       = false;
+    bool               e2e         = false;
+    double             durationS   = 60.0;
+    int                refreshRate = 144;
+    double             tolerance   = 0.2;
+};
+
+// BGRA frame with 16 byte aligned rows, as the capture codecs provide them
+struct FLM_BENCH_FRAME
+{
+    std::vector<uint8_t> storage;
+    uint8_t*             data   = NULL;
+    int                  width  = 0;
+    int                  height = 0;
+    int                  pitch  = 0;
+};
+
+struct FLM_BENCH_SIZE
+{
+    const char* name;
+    int         width;
+    int         height;
+};
+
+// The default capture region is 0.75 x 0.125 of the display
+static const FLM_BENCH_SIZE g_benchSizes[] = {
+    {"region_1080p", 1440, 135},
+    {"region_1440p", 1920, 180},
+    {"region_4k", 2880, 270},
+    {"full_1080p", 1920, 1080},
+    {"full_4k", 3840, 2160},
+};
+
+// Only the frame statistics of the capture context are benchmarked, there is no capture device
+class FLM_Bench_Context : public FLM_Capture_Context
+{
+public:
+    int          CalculateSAD() { return 0; }
+    bool         GetConverterOutput(int64_t*, int64_t*) { return false; }
+    FLM_STATUS   GetFrame() { return FLM_STATUS::OK; }
+    bool         GetSADInput(FLM_SAD_INPUT&) { return false; }
+    unsigned int GetImageFormat() { return 0; }
+    FLM_STATUS   InitCaptureDevice(unsigned int, FLM_Timer_AMF*) { return FLM_STATUS::OK; }
+    bool         InitContext(FLM_GPU_VENDOR_TYPE) { return true; }
+    void         Release() {}
+    FLM_STATUS   ReleaseFrameBuffer(FLM_PIXEL_DATA&) { return FLM_STATUS::OK; }
+    void         SaveCaptureSurface(uint32_t) {}
+};
+
+// xorshift, the frames are the same on every run
+static uint32_t NextRandom(uint32_t& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static void InitFrame(FLM_BENCH_FRAME& frame, int width, int height)
+{
+    frame.width  = width;
+    frame.height = height;
+    frame.pitch  = (width * 4 + 63) & ~63;
+    frame.storage.assign((size_t)frame.pitch * height + 64, 0);
+    frame.data = frame.storage.data() + ((64 - ((uintptr_t)frame.storage.data() & 63)) & 63);
+}
+
+// frame1 is frame0 with film grain noise and a block that moved, like a game reacting to a mouse move
+static void GenerateFrames(FLM_BENCH_FRAME& frame0, FLM_BENCH_FRAME& frame1, int width, int height)
+{
+    InitFrame(frame0, width, height);
+    InitFrame(frame1, width, height);
+
+    uint32_t state = 0x12345678;
+    for (int y = 0; y < height; y++)
+    {
+        uint8_t* row0 = frame0.data + (size_t)y * frame0.pitch;
+        uint8_t* row1 = frame1.data + (size_t)y * frame1.pitch;
+        for (int x = 0; x < width * 4; x++)
+        {
+            row0[x] = (uint8_t)(64 + (x + y) % 128 + (NextRandom(state) & 7));
+            row1[x] = (uint8_t)std::clamp((int)row0[x] + (int)(NextRandom(state) & 7) - 3, 0, 255);
+        }
+    }
+
+    int blockWidth  = width / 8;
+    int blockHeight = height / 2;
+    for (int y = 0; y < blockHeight; y++)
+    {
+        uint8_t* row1 = frame1.data + (size_t)(y + height / 4) * frame1.pitch + (width / 2) * 4;
+        for (int x = 0; x < blockWidth * 4; x++)
+            row1[x] = (uint8_t)(255 - row1[x]);
+    }
+}
+
+static void RunSADBenchmarks(FLM_Bench_Runner& runner)
+{
+    const int iFilmGrainThreshold = FLM_CAPTURE_SETTINGS().iFilmGrainThreshold;
+
+    for (const FLM_BENCH_SIZE& size : g_benchSizes)
+    {
+        std::string names[4] = {std::string("sad_amf/") + size.name,
+                                std::string("sad_amf_film_grain/") + size.name,
+                                std::string("sad_dxgi/") + size.name,
+                                std::string("sad_dxgi_film_grain/") + size.name};
+        if (!runner.Selected(names[0].c_str()) && !runner.Selected(names[1].c_str()) && !runner.Selected(names[2].c_str()) &&
+            !runner.Selected(names[3].c_str()))
+            continue;
+
+        FLM_BENCH_FRAME frame0;
+        FLM_BENCH_FRAME frame1;
+        GenerateFrames(frame0, frame1, size.width, size.height);
+
+        uint64_t bytesPerFrame = 2ull * size.width * 4 * size.height;  // Both frames are read
+
+        for (int variant = 0; variant < 4; variant++)
+        {
+            int  threshold  = (variant & 1) ? iFilmGrainThreshold : 0;
+            bool bAveraged4 = (variant >= 2);
+            runner.Run(names[variant].c_str(), bytesPerFrame, [&](int64_t iterations) {
+                int64_t sum = 0;
+                for (int64_t i = 0; i < iterations; i++)
+                {
+                    if (bAveraged4)
+                        sum += FlmCalculateSADAveraged4(frame0.data, frame1.data, frame0.width, frame0.height, frame0.pitch, threshold);
+                    else
+                        sum += FlmCalculateSAD(frame0.data, frame1.data, frame0.width, frame0.height, frame0.pitch, threshold);
+                }
+                g_flmBenchSink = g_flmBenchSink + sum;
+            });
+        }
+    }
+}
+
+// Scene, muzzle flash and HUD counter, as fractions of the capture region
+static const char* g_benchRegions = "scene:0,0,1,1;flash:0.4,0.3,0.2,0.4;hud:0.9,0,0.1,0.2";
+
+// Returns false when the single pass over all regions gives another SAD of the whole frame than FlmCalculateSAD()
+static bool CheckRegionSADs()
+{
+    std::vector<FLM_REGION_SETTINGS> settings;
+    std::string                      error;
+    FlmParseRegions(g_benchRegions, settings, error);
+
+    FLM_BENCH_FRAME frame0;
+    FLM_BENCH_FRAME frame1;
+    GenerateFrames(frame0, frame1, g_benchSizes[0].width, g_benchSizes[0].height);
+
+    for (int variant = 0; variant < 4; variant++)
+    {
+        FLM_SAD_INPUT input;
+        input.pData0              = frame0.data;
+        input.pData1              = frame1.data;
+        input.iWidth              = frame0.width;
+        input.iHeight             = frame0.height;
+        input.iPitch              = frame0.pitch;
+        input.iFilmGrainThreshold = (variant & 1) ? FLM_CAPTURE_SETTINGS().iFilmGrainThreshold : 0;
+        input.bAveraged4          = (variant >= 2);
+
+        FLM_Region_Set regions;
+        regions.Configure(settings);
+        int iSAD      = regions.Process(input, 5.0f, 0.9f, 0.0f);
+        int iExpected = FlmCalculateSAD(input);
+
+        // The scene region covers the whole frame
+        if ((iSAD != iExpected) || (regions.GetRegion(0).iSAD != iExpected))
+        {
+            printf("Error: region SAD %d, scene region %d instead of %d (averaged %d, film grain %d)\n", iSAD, regions.GetRegion(0).iSAD, iExpected,
+                   input.bAveraged4 ? 1 : 0, input.iFilmGrainThreshold);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Normal distribution from two uniform values, Box-Muller
+static float NextGaussian(uint32_t& state)
+{
+    double u1 = (NextRandom(state) + 1.0) / 4294967297.0;
+    double u2 = NextRandom(state) / 4294967296.0;
+    return (float)(sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2));
+}
+
+// Background SAD with more outliers than a normal distribution, as from foliage or particles, spikes far above it as from a
+// muzzle flash and the motion of an input event every 50 frames. Returns false when the adaptive threshold does not
+// trigger at the target rate without input, the estimated rate is off or motion is not detected.
+static bool CheckNoiseModel()
+{
+    const float fTargetRate = 0.01f;
+    const float fAlpha      = FLM_Capture_Context::CalculateFilterAlpha(FLM_CAPTURE_SETTINGS().iAVGFilterFrames);
+
+    FLM_SAD_BACKGROUND background;
+    uint32_t           state    = 0x2545f491;
+    int                triggers = 0;
+    int                frames   = 0;
+    bool               bPrev    = false;
+    for (int i = 0; i < 40000; i++)
+    {
+        // Pending from the input event to the frame after its motion, small enough to pass the background filter
+        bool  bPending   = (i % 50) < 3;
+        float fDeviation = ((NextRandom(state) % 20) == 0) ? 200.0f : 50.0f;
+        int   iSAD       = std::max(0, (int)(1000.0f + fDeviation * NextGaussian(state)));
+        if ((i % 50) == 1)
+            iSAD = 3000;
+        else
+        if ((bPending == false) && ((NextRandom(state) % 200) == 0))
+            iSAD = 8000;
+        bool bTriggered = background.Update(iSAD, 5.0f, fAlpha, fTargetRate, bPending) > 0;
+
+        // Only the first frame of a detection measures, measured after the threshold settled
+        if ((i >= 20000) && (bPrev == false) && (bPending == false))
+        {
+            frames++;
+            triggers += bTriggered ? 1 : 0;
+        }
+        bPrev = bTriggered;
+    }
+
+    float fRate = (float)triggers / frames;
+    if ((fRate < fTargetRate * 0.5f) || (fRate > fTargetRate * 2.0f) || (fabsf(background.fFalseTriggerRate - fRate) > fTargetRate * 0.5f))
+    {
+        printf("Error: adaptive threshold triggered at %.4f, estimated %.4f, instead of %.4f\n", fRate, background.fFalseTriggerRate, fTargetRate);
+        return false;
+    }
+
+    // A mouse move that doubles the SAD
+    if (background.Update(2000, 5.0f, fAlpha, fTargetRate) == 0)
+    {
+        printf("Error: adaptive threshold %.1f missed a SAD of 2000\n", background.GetThreshold(5.0f, fTargetRate));
+        return false;
+    }
+    return true;
+}
+
+// Replays 240 present timestamps of a game locked to half of a 144 Hz display, then of a VRR display following a game
+// at 85 to 110 fps. Returns false when either is classified wrongly or Reset() keeps the VRR estimate.
+static bool CheckRefreshEstimator()
+{
+    const int64_t iiTicksPerMS = 10000;
+    const float   fNominalHz   = 144.0f;
+    const float   fPeriodMS    = 1000.0f / fNominalHz;
+
+    FLM_Refresh_Estimator estimator;
+    estimator.Init(fNominalHz, iiTicksPerMS);
+
+    uint32_t state  = 0x7f4a7c15;
+    int64_t  iiTime = 1000000;
+    for (int i = 1; i <= 240; i++)
+    {
+        // Every other scanout, a dropped frame now and then, with a little timestamp jitter
+        int   iScanouts = ((NextRandom(state) % 10) == 0) ? 4 : 2;
+        float fJitterMS = 0.05f * NextGaussian(state);
+        iiTime += (int64_t)((iScanouts * fPeriodMS + fJitterMS) * iiTicksPerMS);
+        estimator.AddPresentTimestamp(iiTime, i);
+    }
+
+    FLM_REFRESH_ESTIMATE fixed = estimator.GetEstimate();
+    if ((estimator.HasEstimate() == false) || fixed.isVRR || (fabsf(fixed.refreshRateHz - fNominalHz) > 1.0f))
+    {
+        printf("Error: fixed refresh replay estimated %.1f Hz%s instead of %.1f Hz\n", fixed.refreshRateHz, fixed.isVRR ? " VRR" : "", fNominalHz);
+        return false;
+    }
+
+    estimator.Reset();
+    for (int i = 1; i <= 240; i++)
+    {
+        iiTime += (int64_t)((9.1f + 2.6f * (NextRandom(state) % 1000) / 1000.0f) * iiTicksPerMS);
+        estimator.AddPresentTimestamp(iiTime, i);
+    }
+
+    FLM_REFRESH_ESTIMATE vrr = estimator.GetEstimate();
+    if ((vrr.isVRR == false) || (vrr.refreshRateHz < 85.0f) || (vrr.refreshRateHz > 110.0f))
+    {
+        printf("Error: VRR replay estimated %.1f Hz%s instead of VRR at about 97 Hz\n", vrr.refreshRateHz, vrr.isVRR ? " VRR" : "");
+        return false;
+    }
+
+    estimator.Reset();
+    if (estimator.HasEstimate() || estimator.GetEstimate().isVRR || (estimator.GetEstimate().refreshRateHz != fNominalHz))
+    {
+        printf("Error: the refresh estimator kept the estimate of the previous session after Reset()\n");
+        return false;
+    }
+    return true;
+}
+
+// Frame of a wide textured scene seen from iOffset, with film grain and a brightness change like a flicker or muzzle flash
+static void RenderProjectionFrame(FLM_BENCH_FRAME& frame, const std::vector<uint8_t>& scene, int sceneWidth, int iOffset, int iBrightness, uint32_t& state)
+{
+    for (int y = 0; y < frame.height; y++)
+    {
+        uint8_t*       row      = frame.data + (size_t)y * frame.pitch;
+        const uint8_t* sceneRow = scene.data() + (size_t)y * sceneWidth + iOffset;
+        for (int x = 0; x < frame.width; x++)
+        {
+            int value = std::clamp((int)sceneRow[x] + iBrightness + (int)(NextRandom(state) & 7) - 3, 0, 255);
+            row[x * 4 + 0] = (uint8_t)value;
+            row[x * 4 + 1] = (uint8_t)value;
+            row[x * 4 + 2] = (uint8_t)value;
+            row[x * 4 + 3] = 255;
+        }
+    }
+}
+
+// Returns false when a camera pan is not detected with its direction, when a brightness flicker without motion or a pan
+// with the mouse is detected, when learning does not reverse the camera direction after as many pans with the mouse in a
+// row, or when the projections differ from the pixel sums. Runs with a width that is not a multiple of 4 as well.
+static bool CheckProjection()
+{
+    const int height     = g_benchSizes[0].height;
+    const int shift      = 16;
+    const int sceneWidth = g_benchSizes[0].width + 4 * shift;
+
+    std::vector<uint8_t> scene((size_t)sceneWidth * height);
+    uint32_t             state = 0x9e3779b9;
+    for (uint8_t& value : scene)
+        value = (uint8_t)(32 + NextRandom(state) % 192);
+
+    // Camera pans of the mouse moves, a larger offset moves the content left against a positive step
+    struct STEP
+    {
+        int  iOffset;
+        int  iBrightness;
+        int  iInjectedStep;
+        bool bDetected;          // With the default camera direction
+        bool bDetectedLearning;  // With learning of the camera direction
+        int  iShift;
+    };
+    const STEP steps[] = {
+        {2 * shift, 0, 0, false, false, 0},
+        {3 * shift, 0, 50, true, true, -shift},
+        {3 * shift, 40, 0, false, false, 0},        // Flicker, the SAD is far larger than from the film grain
+        {2 * shift, 40, -50, true, true, shift},
+        {2 * shift, 0, 0, false, false, 0},
+        {1 * shift, 0, 50, false, false, shift},    // Content moved with the step
+        {2 * shift, 0, 50, true, true, -shift},     // Against the step again, the pans with the step are counted in a row
+        {1 * shift, 0, 50, false, false, shift},
+        {2 * shift, 0, -50, false, false, -shift},
+        {3 * shift, 0, -50, false, false, -shift},  // Third pan with the step in a row, learning reverses the direction
+        {4 * shift, 0, -50, false, true, -shift},
+        {3 * shift, 0, -50, true, false, shift},
+    };
+
+    for (int run = 0; run < 4; run++)
+    {
+        bool bLearn = (run >= 2);
+        int  width  = (run & 1) ? g_benchSizes[0].width - 3 : g_benchSizes[0].width;
+
+        FLM_BENCH_FRAME frames[2];
+        InitFrame(frames[0], width, height);
+        InitFrame(frames[1], width, height);
+
+        FLM_Projection_Detector detector;
+        detector.Reset(bLearn);
+        for (int i = 0; i < (int)(sizeof(steps) / sizeof(steps[0])); i++)
+        {
+            const STEP& step = steps[i];
+            RenderProjectionFrame(frames[i & 1], scene, sceneWidth, step.iOffset, step.iBrightness, state);
+
+            FLM_SAD_INPUT input;
+            input.pData0       = frames[0].data;
+            input.pData1       = frames[1].data;
+            input.iWidth       = width;
+            input.iHeight      = height;
+            input.iPitch       = frames[0].pitch;
+            input.bAveraged4   = true;
+            input.bData1Latest = ((i & 1) != 0);
+            detector.Process(input, i + 1);
+
+            int  iDetected = detector.Detect(step.iInjectedStep);
+            bool bExpected = bLearn ? step.bDetectedLearning : step.bDetected;
+            if (((iDetected != 0) != bExpected) || (detector.GetShiftX() != step.iShift))
+            {
+                printf("Error: projection frame %d of width %d%s detected %d, shift %d with correlation %.2f, instead of %s a shift of %d\n", i, width,
+                       bLearn ? " learning" : "", iDetected, detector.GetShiftX(), detector.GetCorrelation(), bExpected ? "detecting" : "not detecting",
+                       step.iShift);
+                return false;
+            }
+        }
+
+        // The padding after the last pixel must not be summed, nor the column after the last one changed
+        for (int y = 0; y < height; y++)
+            memset(frames[0].data + (size_t)y * frames[0].pitch + width * 4, 0xff, (size_t)frames[0].pitch - width * 4);
+        std::vector<int32_t> columns((size_t)width + 1, -1);
+        std::vector<int32_t> rows((size_t)height);
+        FlmCalculateProjections(frames[0].data, width, height, frames[0].pitch, columns.data(), rows.data());
+        std::vector<int32_t> expectedColumns((size_t)width + 1, 0);
+        expectedColumns[width] = -1;
+        for (int y = 0; y < height; y++)
+        {
+            int32_t        rowSum = 0;
+            const uint8_t* row    = frames[0].data + (size_t)y * frames[0].pitch;
+            for (int x = 0; x < width; x++)
+            {
+                int32_t sum = row[x * 4 + 0] + row[x * 4 + 1] + row[x * 4 + 2];
+                expectedColumns[x] += sum;
+                rowSum += sum;
+            }
+            if (rows[y] != rowSum)
+            {
+                printf("Error: projection of row %d of width %d is %d instead of %d\n", y, width, rows[y], rowSum);
+                return false;
+            }
+        }
+        if (columns != expectedColumns)
+        {
+            printf("Error: column projections of width %d differ from the pixel sums\n", width);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void RunProjectionBenchmarks(FLM_Bench_Runner& runner)
+{
+    for (const FLM_BENCH_SIZE& size : g_benchSizes)
+    {
+        // Compare with sad_dxgi_film_grain, only the latest frame is read
+        std::string name = std::string("projection/") + size.name;
+        if (!runner.Selected(name.c_str()))
+            continue;
+
+        FLM_BENCH_FRAME frame0;
+        FLM_BENCH_FRAME frame1;
+        GenerateFrames(frame0, frame1, size.width, size.height);
+
+        FLM_SAD_INPUT input;
+        input.pData0     = frame0.data;
+        input.pData1     = frame1.data;
+        input.iWidth     = frame0.width;
+        input.iHeight    = frame0.height;
+        input.iPitch     = frame0.pitch;
+        input.bAveraged4 = true;
+
+        FLM_Projection_Detector detector;
+        int64_t                 iiFrameIdx = 0;
+
+        runner.Run(name.c_str(), 1ull * size.width * 4 * size.height, [&](int64_t iterations) {
+            int64_t sum = 0;
+            for (int64_t i = 0; i < iterations; i++)
+            {
+                iiFrameIdx++;
+                input.bData1Latest = (iiFrameIdx & 1) != 0;
+                sum += detector.Process(input, iiFrameIdx) + detector.Detect(50);
+            }
+            g_flmBenchSink = g_flmBenchSink + sum;
+        });
+    }
+}
+
+static void RunRegionBenchmarks(FLM_Bench_Runner& runner)
+{
+    std::vector<FLM_REGION_SETTINGS> settings;
+    std::string                      error;
+    FlmParseRegions(g_benchRegions, settings, error);
+
+    const int iFilmGrainThreshold = FLM_CAPTURE_SETTINGS().iFilmGrainThreshold;
+
+    for (const FLM_BENCH_SIZE& size : g_benchSizes)
+    {
+        // Compare with sad_dxgi_film_grain, the extra cost of measuring three regions in the same pass
+        std::string name = std::string("region_sads/") + size.name;
+        if (!runner.Selected(name.c_str()))
+            continue;
+
+        FLM_BENCH_FRAME frame0;
+        FLM_BENCH_FRAME frame1;
+        GenerateFrames(frame0, frame1, size.width, size.height);
+
+        FLM_SAD_INPUT input;
+        input.pData0              = frame0.data;
+        input.pData1              = frame1.data;
+        input.iWidth              = frame0.width;
+        input.iHeight             = frame0.height;
+        input.iPitch              = frame0.pitch;
+        input.iFilmGrainThreshold = iFilmGrainThreshold;
+        input.bAveraged4          = true;
+
+        FLM_Region_Set regions;
+        regions.Configure(settings);
+
+        runner.Run(name.c_str(), 2ull * size.width * 4 * size.height, [&](int64_t iterations) {
+            int64_t sum = 0;
+            for (int64_t i = 0; i < iterations; i++)
+                sum += regions.Process(input, 5.0f, 0.9f, 0.0f);
+            g_flmBenchSink = g_flmBenchSink + sum;
+        });
+    }
+}
+
+static void RunContextBenchmarks(FLM_Bench_Runner& runner)
+{
+    FLM_Bench_Context context;
+    context.m_fAVGFilterAlpha = FLM_Capture_Context::CalculateFilterAlpha(FLM_CAPTURE_SETTINGS().iAVGFilterFrames);
+
+    // SAD of background animation with a mouse movement every 32 frames
+    std::vector<int> sads(1024);
+    uint32_t         state = 0x9e3779b9;
+    for (size_t i = 0; i < sads.size(); i++)
+        sads[i] = 20 + (int)(NextRandom(state) % 10) + (((i % 32) == 0) ? 400 : 0);
+
+    runner.Run("thresholded_sad", 0, [&](int64_t iterations) {
+        int64_t sum = 0;
+        for (int64_t i = 0; i < iterations; i++)
+            sum += context.GetThresholdedSAD(0, sads[i & 1023], 2.0f, 0.0f);
+        g_flmBenchSink = g_flmBenchSink + sum;
+    });
+
+    runner.Run("thresholded_sad_adaptive", 0, [&](int64_t iterations) {
+        int64_t sum = 0;
+        for (int64_t i = 0; i < iterations; i++)
+            sum += context.GetThresholdedSAD(0, sads[i & 1023], 2.0f, 0.01f);
+        g_flmBenchSink = g_flmBenchSink + sum;
+    });
+
+    // 144 Hz with up to 0.5 ms present jitter, a frame is repeated or skipped now and then
+    std::vector<int64_t> jitter(1024);
+    for (int64_t& value : jitter)
+        value = (int64_t)(NextRandom(state) % 10000) - 5000;
+
+    int64_t iiFrameIdx = 0;
+    int64_t iiTime     = 0;
+    runner.Run("update_average_frame_time", 0, [&](int64_t iterations) {
+        for (int64_t i = 0; i < iterations; i++)
+        {
+            iiFrameIdx += ((i & 255) == 0) ? 2 : ((i & 255) == 128) ? 0 : 1;
+            iiTime += AMF_SECOND / 144 + jitter[i & 1023];
+            context.UpdateAverageFrameTime(iiTime, iiFrameIdx);
+        }
+        g_flmBenchSink = g_flmBenchSink + (int64_t)context.m_fMovingAverageFrameTimeMS;
+    });
+
+    runner.Run("calculate_filter_alpha", 0, [&](int64_t iterations) {
+        float sum = 0.0f;
+        for (int64_t i = 0; i < iterations; i++)
+            sum += FLM_Capture_Context::CalculateFilterAlpha(1 + (int)(i & 1023));
+        g_flmBenchSink = g_flmBenchSink + (int64_t)sum;
+    });
+
+    // Writes to the temp directory, the time depends on the file system cache more than on the code
+    char tempPath[MAX_PATH] = {};
+    GetTempPathA(MAX_PATH, tempPath);
+    std::string bitmapFile = std::string(tempPath) + "flm_bench.bmp";
+
+    for (int s = 0; s < 2; s++)
+    {
+        const FLM_BENCH_SIZE& size = (s == 0) ? g_benchSizes[0] : g_benchSizes[3];
+        std::string           name = std::string("save_as_bitmap/") + size.name;
+        if (!runner.Selected(name.c_str()))
+            continue;
+
+        FLM_BENCH_FRAME frame0;
+        FLM_BENCH_FRAME frame1;
+        GenerateFrames(frame0, frame1, size.width, size.height);
+
+        FLM_PIXEL_DATA pixelData   = {};
+        pixelData.data             = frame0.data;
+        pixelData.width            = frame0.width;
+        pixelData.height           = frame0.height;
+        pixelData.pitchH           = frame0.pitch;
+        pixelData.pixelSizeInBytes = 4;
+
+        runner.Run(name.c_str(), (uint64_t)size.width * 4 * size.height, [&](int64_t iterations) {
+            for (int64_t i = 0; i < iterations; i++)
+                context.SaveAsBitmap(bitmapFile.c_str(), pixelData, true);
+        });
+    }
+    DeleteFileA(bitmapFile.c_str());
+}
+
+struct FLM_BENCH_KEY_EVENT
+{
+    uint8_t  key;
+    bool     bDown;
+    uint32_t expectedFired;  // Combinations expected to fire with this transition
+};
+
+// Combinations 0 ALT+T, 1 CTRL+SHIFT+F1, 2 ALT+Q and 3 the right mouse button, registered in this order
+static const FLM_BENCH_KEY_EVENT g_hotkeyStream[] = {
+    {VK_LMENU, true, 0},    {'T', true, 1 << 0},   {'T', true, 0},        {'T', false, 0},       // Auto repeat does not fire again
+    {'T', true, 1 << 0},    {VK_LMENU, false, 0},  {'T', false, 0},                              // Fires again after a release
+    {'T', true, 0},         {VK_RMENU, true, 1 << 0}, {'Q', true, 1 << 2}, {'Q', false, 0},      // Any order, either ALT
+    {'T', false, 0},        {VK_RMENU, false, 0},
+    {VK_LCONTROL, true, 0}, {VK_F1, true, 0},      {VK_RSHIFT, true, 1 << 1},                    // Three keys
+    {VK_F1, false, 0},      {VK_F1, true, 1 << 1}, {VK_LCONTROL, false, 0}, {VK_RCONTROL, true, 1 << 1},
+    {VK_F1, false, 0},      {VK_RSHIFT, false, 0}, {VK_RCONTROL, false, 0},
+    {VK_RBUTTON, true, 1 << 3}, {VK_RBUTTON, false, 0}, {VK_LBUTTON, true, 0}, {VK_LBUTTON, false, 0},
+};
+
+static void RegisterBenchHotkeys(FLM_Hotkey_Matcher& matcher)
+{
+    const uint8_t combinations[4][FLM_HOTKEY_KEYS] = {{VK_MENU, 'T', 0}, {VK_CONTROL, VK_SHIFT, VK_F1}, {VK_MENU, 'Q', 0}, {VK_RBUTTON, 0, 0}};
+    for (const uint8_t* keys : combinations)
+        matcher.Register(keys);
+}
+
+// Returns false and prints the first transition that fired other combinations than expected
+static bool CheckHotkeyMatcher()
+{
+    FLM_Hotkey_Matcher matcher;
+    RegisterBenchHotkeys(matcher);
+
+    int eventCount = (int)(sizeof(g_hotkeyStream) / sizeof(g_hotkeyStream[0]));
+    for (int i = 0; i < eventCount; i++)
+    {
+        const FLM_BENCH_KEY_EVENT& event = g_hotkeyStream[i];
+        uint32_t                   fired = matcher.OnKey(event.key, event.bDown);
+        if (fired != event.expectedFired)
+        {
+            printf("Error: hotkey matcher fired 0x%x instead of 0x%x at key event %d (0x%02x %s)\n", fired, event.expectedFired, i, event.key,
+                   event.bDown ? "down" : "up");
+            return false;
+        }
+    }
+
+    // Keys held while registering must not fire
+    matcher.Clear();
+    matcher.OnKey(VK_LMENU, true);
+    matcher.OnKey('T', true);
+    RegisterBenchHotkeys(matcher);
+    if (matcher.OnKey(VK_RMENU, true) != 0)
+    {
+        printf("Error: hotkey matcher fired a combination held while registering\n");
+        return false;
+    }
+    return true;
+}
+
+static void RunHotkeyBenchmarks(FLM_Bench_Runner& runner)
+{
+    FLM_Hotkey_Matcher matcher;
+    RegisterBenchHotkeys(matcher);
+
+    int eventCount = (int)(sizeof(g_hotkeyStream) / sizeof(g_hotkeyStream[0]));
+    runner.Run("hotkey_matcher_on_key", 0, [&](int64_t iterations) {
+        uint32_t fired = 0;
+        for (int64_t i = 0; i < iterations; i++)
+        {
+            const FLM_BENCH_KEY_EVENT& event = g_hotkeyStream[i % eventCount];
+            fired += matcher.OnKey(event.key, event.bDown);
+        }
+        g_flmBenchSink = g_flmBenchSink + fired;
+    });
+}
+
+// Output sessions are checked with generated time stamps, in 100 ns ticks like the QPC and AMF clocks
+#define FLM_BENCH_TICKS_PER_MS    10000
+#define FLM_BENCH_INJECTIONS      8
+#define FLM_BENCH_INJECT_START    (100 * FLM_BENCH_TICKS_PER_MS)
+#define FLM_BENCH_INJECT_PERIOD   (100 * FLM_BENCH_TICKS_PER_MS)
+#define FLM_BENCH_REFERENCE_MS    40.0f  // Latency of the primary output for every input event
+
+// Stand in for a captured output. Frames are generated as fast as the ring takes them, the first frame latencyMS
+// after an input event and the one after it show motion, like a game response with motion blur.
+class FLM_Bench_Frame_Source : public FLM_Frame_Source
+{
+public:
+    FLM_Bench_Frame_Source(int refreshRate, float latencyMS, int64_t iiPhase)
+        : m_refreshRate(refreshRate)
+        , m_iiFramePeriod(1000 * FLM_BENCH_TICKS_PER_MS / refreshRate)
+        , m_iiLatency((int64_t)(latencyMS * FLM_BENCH_TICKS_PER_MS))
+        , m_iiPhase(iiPhase)
+    {
+    }
+
+    bool NextFrame(FLM_OUTPUT_FRAME& frame, const FLM_Stop_Token& stop)
+    {
+        if (m_iiFrameIdx >= GetFrameCount())
+        {
+            stop.SleepFor(1);
+            return false;
+        }
+
+        m_iiFrameIdx++;
+        frame.iiFrameIdx  = m_iiFrameIdx;
+        frame.iiTimeStamp = GetTimeStamp(m_iiFrameIdx);
+        frame.iSAD        = 100;
+        frame.iThSAD      = (IsResponseFrame(m_iiFrameIdx) || IsResponseFrame(m_iiFrameIdx - 1)) ? 1000 : 0;
+        return true;
+    }
+
+    int GetRefreshRate() { return m_refreshRate; }
+
+    int64_t GetFrameCount() const { return (FLM_BENCH_INJECT_START + (FLM_BENCH_INJECTIONS + 1) * FLM_BENCH_INJECT_PERIOD) / m_iiFramePeriod; }
+    int64_t GetTimeStamp(int64_t iiFrameIdx) const { return m_iiPhase + iiFrameIdx * m_iiFramePeriod; }
+
+    // Latency of the first frame at latencyMS or later after the input event
+    float GetExpectedLatencyMS(int injection) const
+    {
+        int64_t iiInjectTime = FLM_BENCH_INJECT_START + injection * FLM_BENCH_INJECT_PERIOD;
+        int64_t iiFrameIdx   = (iiInjectTime + m_iiLatency - m_iiPhase + m_iiFramePeriod - 1) / m_iiFramePeriod;
+        return (float)(GetTimeStamp(iiFrameIdx) - iiInjectTime) / (float)FLM_BENCH_TICKS_PER_MS;
+    }
+
+private:
+    bool IsResponseFrame(int64_t iiFrameIdx) const
+    {
+        for (int i = 0; i < FLM_BENCH_INJECTIONS; i++)
+        {
+            int64_t iiResponseTime = FLM_BENCH_INJECT_START + i * FLM_BENCH_INJECT_PERIOD + m_iiLatency;
+            if ((GetTimeStamp(iiFrameIdx) >= iiResponseTime) && (GetTimeStamp(iiFrameIdx - 1) < iiResponseTime))
+                return true;
+        }
+        return false;
+    }
+
+    int     m_refreshRate;
+    int64_t m_iiFramePeriod;
+    int64_t m_iiLatency;
+    int64_t m_iiPhase;
+    int64_t m_iiFrameIdx = 0;
+};
+
+// Returns false when the outputs running on their own threads do not measure the latencies of their stand in sources.
+// Two outputs at different refresh rates and latencies are compared with the primary output.
+static bool CheckOutputSessions()
+{
+    const int   refreshRates[2] = {144, 60};
+    const float latenciesMS[2]  = {30.0f, 50.0f};
+
+    FLM_Bench_Frame_Source* sources[2];
+    float                   expectedMS[2][FLM_BENCH_INJECTIONS];
+    int64_t                 frameCounts[2];
+
+    // Every input event measures, the frame after a response settles the scene for the next one
+    FLM_DETECTION_SETTINGS settings;
+    settings.settleFrames     = 1;
+    settings.warmupDetections = 0;
+
+    FLM_Output_Session_Set outputs;
+    outputs.SetSession(1, settings);
+    for (int i = 0; i < FLM_BENCH_INJECTIONS; i++)
+        outputs.AddInjection(FLM_BENCH_INJECT_START + i * FLM_BENCH_INJECT_PERIOD);
+
+    for (int o = 0; o < 2; o++)
+    {
+        sources[o]     = new FLM_Bench_Frame_Source(refreshRates[o], latenciesMS[o], o * 3 * FLM_BENCH_TICKS_PER_MS);
+        frameCounts[o] = sources[o]->GetFrameCount();
+        for (int i = 0; i < FLM_BENCH_INJECTIONS; i++)
+            expectedMS[o][i] = sources[o]->GetExpectedLatencyMS(i);
+        if (outputs.Add(sources[o], o + 1) == false)
+        {
+            printf("Error: unable to start output session %d\n", o + 1);
+            return false;
+        }
+    }
+
+    // The primary output measures while the sessions run
+    for (int i = 0; i < FLM_BENCH_INJECTIONS; i++)
+        outputs.SetReferenceLatency(FLM_BENCH_INJECT_START + i * FLM_BENCH_INJECT_PERIOD, FLM_BENCH_REFERENCE_MS);
+
+    LARGE_INTEGER frequency, start, now;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+    do
+    {
+        outputs.Process(FLM_BENCH_TICKS_PER_MS);
+        QueryPerformanceCounter(&now);
+    } while (((outputs.GetStats(0).framesCaptured < frameCounts[0]) || (outputs.GetStats(1).framesCaptured < frameCounts[1])) &&
+             (now.QuadPart - start.QuadPart < frequency.QuadPart * 5));
+
+    for (int o = 0; o < 2; o++)
+    {
+        const FLM_OUTPUT_STATS& stats = outputs.GetStats(o);
+
+        float sumMS = 0.0f;
+        for (int i = 0; i < FLM_BENCH_INJECTIONS; i++)
+            sumMS += expectedMS[o][i];
+        float averageMS = sumMS / FLM_BENCH_INJECTIONS;
+
+        if ((stats.framesCaptured != frameCounts[o]) || (stats.framesDropped != 0) || (stats.ringOverflows != 0) || (stats.refreshRate != refreshRates[o]))
+        {
+            printf("Error: output %d captured %lld of %lld frames, %lld dropped, %lld lost, %d Hz\n", o + 1, stats.framesCaptured, frameCounts[o],
+                   stats.framesDropped, stats.ringOverflows, stats.refreshRate);
+            return false;
+        }
+        if ((stats.count != FLM_BENCH_INJECTIONS) || (fabsf(stats.averageMS - averageMS) > 0.01f) || (fabsf(stats.latestMS - expectedMS[o][FLM_BENCH_INJECTIONS - 1]) > 0.01f))
+        {
+            printf("Error: output %d measured %d latencies averaging %.3f ms instead of %d averaging %.3f ms\n", o + 1, stats.count, stats.averageMS,
+                   FLM_BENCH_INJECTIONS, averageMS);
+            return false;
+        }
+        if ((stats.deltaCount != FLM_BENCH_INJECTIONS) || (fabsf(stats.deltaAverageMS - (averageMS - FLM_BENCH_REFERENCE_MS)) > 0.01f))
+        {
+            printf("Error: output %d compared %d latencies with the primary output, %.3f ms instead of %.3f ms\n", o + 1, stats.deltaCount,
+                   stats.deltaAverageMS, averageMS - FLM_BENCH_REFERENCE_MS);
+            return false;
+        }
+    }
+
+    outputs.Stop();
+    return true;
+}
+
+// Every field of a stored value is the same counter, so a torn copy has fields of different stores
+static bool IsConsistentTelemetry(const FLM_SHARED_TELEMETRY& telemetry)
+{
+    for (int i = 0; i < FLM_SHARED_TELEMETRY_MAX_ROW_SIZE; i++)
+        if ((int64_t)telemetry.rowMeasurementMS[i] != telemetry.frameIdx)
+            return false;
+    return (telemetry.sad == telemetry.frameIdx) && (telemetry.numMeasurements == telemetry.frameIdx);
+}
+
+// One writer publishing as fast as it can against readers copying in a loop: no read may be torn or go back in time.
+// Then a restarted writer must take over a block that a reader kept mapped.
+static bool CheckSharedTelemetry()
+{
+    FLM_SeqLock<FLM_SHARED_TELEMETRY> lock;
+    std::atomic<bool>                 bStop  = false;
+    std::atomic<int>                  torn   = 0;
+    std::atomic<int>                  reads  = 0;
+    const int                         stores = 1 << 20;  // Exact in the float fields
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; r++)
+    {
+        readers.emplace_back([&lock, &bStop, &torn, &reads, r]() {
+            int64_t iiPrev = 0;
+            while (bStop.load(std::memory_order_relaxed) == false)
+            {
+                FLM_SHARED_TELEMETRY telemetry;
+                if (r == 0)
+                    telemetry = lock.Load();
+                else
+                if (lock.TryLoad(telemetry, 64) == false)
+                    continue;
+
+                if ((IsConsistentTelemetry(telemetry) == false) || (telemetry.frameIdx < iiPrev))
+                    torn++;
+                iiPrev = telemetry.frameIdx;
+                reads++;
+            }
+        });
+    }
+
+    FLM_SHARED_TELEMETRY telemetry = {};
+    for (int i = 1; i <= stores; i++)
+    {
+        telemetry.frameIdx        = i;
+        telemetry.sad             = i;
+        telemetry.numMeasurements = i;
+        for (int j = 0; j < FLM_SHARED_TELEMETRY_MAX_ROW_SIZE; j++)
+            telemetry.rowMeasurementMS[j] = (float)i;
+        lock.Store(telemetry);
+    }
+    bStop = true;
+    for (std::thread& reader : readers)
+        reader.join();
+
+    if ((torn > 0) || (reads == 0))
+    {
+        printf("Error: %d of %d shared telemetry reads were torn\n", torn.load(), reads.load());
+        return false;
+    }
+
+    // A block of this process only, a running FLM keeps its own
+    char name[64];
+    snprintf(name, sizeof(name), "Local\\FLM_Telemetry_Bench_%lu", GetCurrentProcessId());
+
+    FLM_Shared_Telemetry        writer;
+    FLM_Shared_Telemetry_Reader reader;
+    if ((writer.Open(name) == false) || (reader.Open(name) == false))
+    {
+        printf("Error: unable to open the shared telemetry %s\n", name);
+        return false;
+    }
+    telemetry.frameIdx = 1;
+    writer.Publish(telemetry);
+    writer.Close();
+
+    FLM_Shared_Telemetry restarted;
+    telemetry.frameIdx = 2;
+    if (restarted.Open(name))
+        restarted.Publish(telemetry);
+
+    FLM_SHARED_TELEMETRY read = {};
+    if ((restarted.IsOpen() == false) || (reader.Read(read) == false) || (read.frameIdx != 2))
+    {
+        printf("Error: a restarted writer did not take over the shared telemetry held by a reader\n");
+        return false;
+    }
+    return true;
+}
+
+// Returns false when Init() leaves the spin margin it started with, the calibration did not sample the timer
+static bool CheckPrecisionSleeper()
+{
+    FLM_Precision_Sleeper sleeper;
+    if (sleeper.Init() == false)
+    {
+        printf("Error: Unable to create a waitable timer\n");
+        return false;
+    }
+
+    FLM_SLEEP_STATS stats       = sleeper.GetStats();
+    double          startMargin = stats.bHighResolution ? FLM_SLEEP_START_MARGIN_US : FLM_SLEEP_START_MARGIN_LOW_RES_US;
+    if (stats.spinMarginUS == startMargin)
+    {
+        printf("Error: the precision sleeper calibration left the spin margin at %.0f us\n", stats.spinMarginUS);
+        return false;
+    }
+    return true;
+}
+
+// Waiting tasks as at startup: the two device tasks must overlap, run after the task they depend on and a failure
+// must skip the tasks that depend on it
+static bool CheckStartupGraph()
+{
+    FLM_Startup_Graph startup;
+
+    int timer   = startup.Add("timer", []() { return FLM_STATUS::OK; });
+    int device0 = startup.Add("device0", []() { Sleep(50); return FLM_STATUS::OK; }, {timer});
+    int device1 = startup.Add("device1", []() { Sleep(50); return FLM_STATUS::OK; }, {timer});
+    int threads = startup.Add("threads", []() { return FLM_STATUS::OK; }, {device0, device1});
+    int failed  = startup.Add("failed", []() { return FLM_STATUS::CAPTURE_INIT_FAILED; });
+    int skipped = startup.Add("skipped", []() { return FLM_STATUS::OK; }, {failed});
+
+    if (startup.Run() != FLM_STATUS::CAPTURE_INIT_FAILED)
+    {
+        printf("Error: the startup graph did not return the status of its failed task\n");
+        return false;
+    }
+
+    const FLM_STARTUP_TASK_TIMING& t  = startup.GetTiming(timer);
+    const FLM_STARTUP_TASK_TIMING& d0 = startup.GetTiming(device0);
+    const FLM_STARTUP_TASK_TIMING& d1 = startup.GetTiming(device1);
+    const FLM_STARTUP_TASK_TIMING& th = startup.GetTiming(threads);
+
+    if ((d0.iiStart < t.iiEnd) || (d1.iiStart < t.iiEnd) || (th.iiStart < d0.iiEnd) || (th.iiStart < d1.iiEnd))
+    {
+        printf("Error: a startup task ran before a task it depends on\n");
+        return false;
+    }
+    if ((d0.iiStart >= d1.iiEnd) || (d1.iiStart >= d0.iiEnd))
+    {
+        printf("Error: independent startup tasks did not run concurrently\n");
+        return false;
+    }
+    if ((startup.GetTiming(skipped).bSkipped == false) || (startup.GetTiming(skipped).iiStart != 0) || th.bSkipped)
+    {
+        printf("Error: the startup graph did not skip exactly the tasks depending on the failed task\n");
+        return false;
+    }
+    return true;
+}
+
+// Replays a scripted session of input events and frames: the warm-up detection, motion blur and settling with
+// SettleFrames 2 for mouse moves, then a session with the click settings
+static bool CheckDetectionStates()
+{
+    using S = FLM_DETECTION_STATE;
+    using A = FLM_DETECTION_ACTION;
+
+    FLM_DETECTION_SETTINGS moveSettings;
+    moveSettings.settleFrames     = 2;
+    moveSettings.warmupDetections = 1;
+    FLM_DETECTION_SETTINGS clickSettings;
+    clickSettings.settleFrames     = 0;
+    clickSettings.warmupDetections = 0;
+
+    struct STEP
+    {
+        int     iSession;
+        int64_t iiInjectTime;
+        bool    bMotion;
+        S       state;
+        A       action;
+    };
+    const STEP steps[] = {
+        {1, 0, false, S::SETTLING, A::NONE},
+        {1, 0, false, S::ARMED, A::NONE},
+        {1, 100, true, S::DETECTED, A::SKIP},      // Warm-up
+        {1, 100, false, S::SETTLING, A::NONE},
+        {1, 200, false, S::INJECTED, A::NONE},     // Injected while settling
+        {1, 200, true, S::DETECTED, A::MEASURE},
+        {1, 300, true, S::INJECTED, A::NONE},      // Motion blur of the previous move
+        {1, 300, false, S::INJECTED, A::NONE},
+        {1, 300, true, S::INJECTED, A::NONE},      // Only one frame without motion
+        {1, 300, false, S::INJECTED, A::NONE},
+        {1, 300, false, S::INJECTED, A::NONE},
+        {1, 300, true, S::DETECTED, A::MEASURE},
+        {1, 300, true, S::SETTLING, A::NONE},      // Motion without input
+        {0, 300, false, S::IDLE, A::NONE},
+        {2, 400, true, S::DETECTED, A::MEASURE},   // Clicks, no warm-up and no settling
+        {2, 400, false, S::ARMED, A::NONE},
+    };
+
+    FLM_Detection_State_Machine detection;
+    int64_t                     iiMeasured = 0;
+    for (int i = 0; i < (int)(sizeof(steps) / sizeof(steps[0])); i++)
+    {
+        const STEP& step = steps[i];
+        detection.SetSession(step.iSession, (step.iSession == 2) ? clickSettings : moveSettings, i);
+        detection.Inject(step.iiInjectTime, i);
+        A action = (step.iSession != 0) ? detection.Frame(step.bMotion, i) : A::NONE;
+        if (action == A::MEASURE)
+            iiMeasured = detection.GetDetectedInjectTime();
+
+        if ((detection.GetState() != step.state) || (action != step.action) || ((action == A::MEASURE) && (iiMeasured != step.iiInjectTime)))
+        {
+            const FLM_DETECTION_TRANSITION& last = detection.GetTransition(detection.GetTransitionCount() - 1);
+            printf("Error: detection frame %d is %s after \"%s\" instead of %s\n", i, FlmGetDetectionStateName(detection.GetState()),
+                   last.reason, FlmGetDetectionStateName(step.state));
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns false when one of the checks of the detection code fails, it prints the error
+static bool RunChecks()
+{
+    return CheckHotkeyMatcher() && CheckRegionSADs() && CheckNoiseModel() && CheckRefreshEstimator() && CheckProjection() && CheckOutputSessions() &&
+           CheckSharedTelemetry() && CheckPrecisionSleeper() && CheckStartupGraph() && CheckDetectionStates();
+}
+
+static bool ParseCommandLine(int argCount, char* args[], FLM_BENCH_OPTIONS& options)
+{
+    for (int i = 1; i < argCount; ++i)
+    {
+        std::string cmd_arg = args[i];
+        std::transform(cmd_arg.begin(), cmd_arg.end(), cmd_arg.begin(), ::tolower);
+
+        if ((cmd_arg.compare("-o") == 0) && (i + 1 < argCount))
+            options.outputFile = args[++i];
+        else if ((cmd_arg.compare("-baseline") == 0) && (i + 1 < argCount))
+            options.baselineFile = args[++i];
+        else if ((cmd_arg.compare("-filter") == 0) && (i + 1 < argCount))
+            options.settings.filter = args[++i];
+        else if ((cmd_arg.compare("-repetitions") == 0) && (i + 1 < argCount))
+            options.settings.repetitions = atoi(args[++i]);
+        else if ((cmd_arg.compare("-mintime") == 0) && (i + 1 < argCount))
+            options.settings.minSampleMS = std::max(0.1, atof(args[++i]));
+        else if (cmd_arg.compare("-check") == 0)
+            options.check = true;
+        else if (cmd_arg.compare("-e2e") == 0)
+            options.e2e = true;
+        else if ((cmd_arg.compare("-duration") == 0) && (i + 1 < argCount))
+            options.durationS = std::max(5.0, atof(args[++i]));
+        else if ((cmd_arg.compare("-refresh") == 0) && (i + 1 < argCount))
+            options.refreshRate = std::clamp(atoi(args[++i]), 24, 1000);
+        else if ((cmd_arg.compare("-tolerance") == 0) && (i + 1 < argCount))
+            options.tolerance = std::max(0.0, atof(args[++i]));
+        else
+        {
+            printf("Unknown command: %s\n", args[i]);
+            return false;
+        }
+    }
+
+    if (options.outputFile.empty())
+        options.outputFile = options.e2e ? "flm_bench_e2e.json" : "flm_bench.json";
+    return true;
+}
+
+// Returns 1 when a scenario regressed against the baseline, so CI can fail the commit
+static int RunE2EBenchmarks(const FLM_BENCH_OPTIONS& options)
+{
+    std::vector<FLM_E2E_RESULT> baseline;
+    if (!options.baselineFile.empty() && !FlmReadE2EJson(options.baselineFile.c_str(), baseline))
+    {
+        printf("Error: Unable to open %s\n", options.baselineFile.c_str());
+        return -1;
+    }
+
+    printf("flm_bench v%s, end to end on generated frames at %d Hz, %.0f s per scenario\n\n", VERSION_TEXT, options.refreshRate, options.durationS);
+
+    std::vector<FLM_E2E_RESULT> results;
+    for (const FLM_E2E_SCENARIO& scenario : FlmGetE2EScenarios(options.refreshRate))
+    {
+        if (!options.settings.filter.empty() && (scenario.name.find(options.settings.filter) == std::string::npos))
+            continue;
+
+        FLM_E2E_RESULT result;
+        if (!FlmRunE2EScenario(scenario, options.durationS, result))
+        {
+            printf("Error: Unable to run the pipeline for %s\n", scenario.name.c_str());
+            return -1;
+        }
+        FlmPrintE2EResult(stdout, result);
+        results.push_back(result);
+    }
+
+    if (!FlmWriteE2EJson(options.outputFile.c_str(), results))
+    {
+        printf("Error: Unable to write %s\n", options.outputFile.c_str());
+        return -1;
+    }
+
+    int violations = FlmPrintE2ELimitViolations(stdout, results);
+    if (baseline.empty())
+        return (violations > 0) ? 1 : 0;
+
+    int regressions = FlmPrintE2EComparison(stdout, baseline, results, options.tolerance) + violations;
+    if (regressions > 0)
+        printf("\n%d regression(s) against %s\n", regressions, options.baselineFile.c_str());
+    return (regressions > 0) ? 1 : 0;
+}
+
+int main(int argc, char* argv[])
+{
+    FLM_BENCH_OPTIONS options;
+    if (!ParseCommandLine(argc, argv, options))
+    {
+        printf("flm_bench v%s\n\n", VERSION_TEXT);
+        for (const std::string& line : flm_bench_help)
+            printf("%s\n", line.c_str());
+        return -1;
+    }
+
+    // The pipeline runs its own threads, only the microbenchmarks are pinned to one core
+    if (options.e2e)
+        return RunE2EBenchmarks(options);
+
+    std::vector<FLM_BENCH_RESULT> baseline;
+    if (!options.baselineFile.empty() && !FlmReadBenchJson(options.baselineFile.c_str(), baseline))
+    {
+        printf("Error: Unable to open %s\n", options.baselineFile.c_str());
+        return -1;
+    }
+
+    // Fewer interruptions and a steadier clock during the measurements
+    SetPriorityClass(GetCurrentProcess(), HIGH_PRIORITY_CLASS);
+    SetThreadAffinityMask(GetCurrentThread(), 1);
+
+    // A filtered run only times the benchmarks it names
+    if ((options.check || options.settings.filter.empty()) && (RunChecks() == false))
+        return 1;
+    if (options.check)
+    {
+        printf("flm_bench v%s, all checks passed\n", VERSION_TEXT);
+        return 0;
+    }
+
+    printf("flm_bench v%s, median of %d samples with its 95%% confidence interval\n\n", VERSION_TEXT, std::max(3, options.settings.repetitions));
+
+    FLM_Bench_Runner runner(options.settings);
+    RunSADBenchmarks(runner);
+    RunRegionBenchmarks(runner);
+    RunProjectionBenchmarks(runner);
+    RunContextBenchmarks(runner);
+    RunHotkeyBenchmarks(runner);
+
+    if (!FlmWriteBenchJson(options.outputFile.c_str(), runner.Results()))
+    {
+        printf("Error: Unable to write %s\n", options.outputFile.c_str());
+        return -1;
+    }
+
+    if (!baseline.empty())
+        FlmPrintBenchComparison(stdout, baseline, runner.Results());
+
+    return 0;
+}
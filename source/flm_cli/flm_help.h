@@ -42,6 +42,11 @@ std::vector<std::string> flm_help = {
     {""},
     {"   -FG   : Use this flag when measurements are for games with frame generation enabled."},
     {""},
+    {"   Tools:"},
+    {""},
+    {"   -CONVERT <input> <output> : Convert a binary sample log (SaveSampleLog in flm.ini) to CSV when the output"},
+    {"                               file extension is .csv, else to a columnar binary file."},
+    {""},
     {"   Example usage:"},
     {""},
     {"   flm.exe -DXGI"},
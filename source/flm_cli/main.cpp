@@ -83,6 +83,8 @@ char* captureCodec(FLM_CAPTURE_CODEC_TYPE codec)
         return ("AMF");
     else if (codec == FLM_CAPTURE_CODEC_TYPE::DXGI)
         return ("DXGI");
+    else if (codec == FLM_CAPTURE_CODEC_TYPE::SYNTHETIC)
+        return ("SYNTHETIC");
     return ("UNKNOWN");
 }
 
@@ -110,6 +112,17 @@ bool ParseCommandLine(int argCount, char* args[], FLM_CLI_OPTIONS& cliOptions)
         else
         if (cmd_arg.compare("-fg") == 0)
             cliOptions.enableFG = true;
+        else
+        if (cmd_arg.compare("-convert") == 0)
+        {
+            if (i + 2 >= argCount)
+            {
+                printf("Usage: -convert <input> <output>\n");
+                return false;
+            }
+            cliOptions.convertInput  = args[++i];
+            cliOptions.convertOutput = args[++i];
+        }
         else
             break;
     }
@@ -239,6 +252,16 @@ int main(int argCount, char* args[])
                 printHelpOptions();
                 return 0;
             }
+
+            if (cliOptions.convertInput.size() > 0)
+            {
+                result = FlmConvertSampleLog(cliOptions.convertInput.c_str(), cliOptions.convertOutput.c_str());
+                if (result == FLM_STATUS::OK)
+                    printf("Converted %s to %s\n", cliOptions.convertInput.c_str(), cliOptions.convertOutput.c_str());
+                else
+                    printf("Error: Unable to convert %s\n", cliOptions.convertInput.c_str());
+                return (int)result;
+            }
         }
 
         // Create pipeline context, returns null ptr on failure
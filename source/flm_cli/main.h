@@ -19,6 +19,8 @@ typedef struct FLM_CLI_OPTIONS_TYPE
     bool                   enableFG        = false;
     FLM_GPU_VENDOR_TYPE    vendor          = FLM_GPU_VENDOR_TYPE::UNKNOWN;
     FLM_CAPTURE_CODEC_TYPE captureUsing    = (FLM_CAPTURE_CODEC_TYPE)(-1);
+    std::string            convertInput    = "";  // Sample log to convert, set by -convert
+    std::string            convertOutput   = "";
 } FLM_CLI_OPTIONS;
 
 #endif